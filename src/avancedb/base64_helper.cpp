@@ -33,6 +33,12 @@ std::string Base64Helper::Encode(const buffer_type& data) {
     return text;
 }
 
+void Base64Helper::Encode(const buffer_type::value_type* data, std::size_t size, char* text) {
+    // text must have room for the encoded size and a terminator
+    base64Encode(text, data, size);
+    text[GetEncodedSize(size)] = '\0';
+}
+
 Base64Helper::buffer_type Base64Helper::Decode(const char* text, std::size_t size) {
     buffer_type data;
     
@@ -60,4 +66,8 @@ std::size_t Base64Helper::GetDecodedSize(const char* text, std::size_t size) {
     }
     
     return decodedSize;
+}
+
+std::size_t Base64Helper::GetEncodedSize(std::size_t size) {
+    return ((size + 2) / 3) * 4;
 }
\ No newline at end of file
@@ -29,9 +29,11 @@ public:
     Base64Helper() = delete;
     
     static std::string Encode(const buffer_type& data);
+    static void Encode(const buffer_type::value_type* data, std::size_t size, char* text);
     static buffer_type Decode(const char* text, std::size_t size);
     
     static std::size_t GetDecodedSize(const char* text, std::size_t size);
+    static std::size_t GetEncodedSize(std::size_t size);
     
 private:
 
@@ -32,6 +32,12 @@ unsigned Config::Http::workersPerCpu_ = DefaultWorkersPerCpu;
 
 const float Config::MapReduce::DefaultWorkersPerCpu = 0.5;
 float Config::MapReduce::workersPerCpu_ = DefaultWorkersPerCpu;
+const unsigned Config::MapReduce::DefaultResultsCacheSize = 64;
+unsigned Config::MapReduce::resultsCacheSize_ = DefaultResultsCacheSize;
+
+bool Config::Data::hashIndex_ = true;
+const unsigned Config::Data::DefaultShardThreshold = 10000;
+unsigned Config::Data::shardThreshold_ = DefaultShardThreshold;
 
 unsigned Config::Environment::cpuCount_ = Config::Environment::RealCpuCount();
 
@@ -71,6 +77,9 @@ void Config::Parse(int argc, const char** argv) {
             (processColor, "use color in the log file")
             ("dir", boost::program_options::value(&Process::rootDirectory_), "sets the working directory")
             ("mapreduce-workers", boost::program_options::value(&MapReduce::workersPerCpu_)->default_value(MapReduce::workersPerCpu_), "the number of map/reduce worker threads per CPU core")
+            ("mapreduce-results-cache", boost::program_options::value(&MapReduce::resultsCacheSize_)->default_value(MapReduce::resultsCacheSize_), "the megabytes of view query results cached per database")
+            ("data-hash-index", boost::program_options::value(&Data::hashIndex_)->default_value(Data::hashIndex_), "index document ids by hash for constant time point lookups")
+            ("data-shard-threshold", boost::program_options::value(&Data::shardThreshold_)->default_value(Data::shardThreshold_), "the number of documents a database holds before it is split into shards, 0 always shards")
             ("jsapi-heap-size", boost::program_options::value(&SpiderMonkey::heapSizeMB_)->default_value(SpiderMonkey::heapSizeMB_), "the JSAPI heap size in MB")
             ("jsapi-nursery-size", boost::program_options::value(&SpiderMonkey::nurserySizeMB_)->default_value(SpiderMonkey::nurserySizeMB_), "the JSAPI nursery size in MB")
             (jsapiDisableBaseLineArg, "disable the JSAPI baseline compiler")
@@ -172,6 +181,18 @@ float Config::MapReduce::WorkersPerCpu() noexcept {
     return workersPerCpu_;
 }
 
+unsigned Config::MapReduce::ResultsCacheSize() noexcept {
+    return resultsCacheSize_;
+}
+
 unsigned Config::Data::DatabaseDeleteDelay() noexcept {
     return 5;
+}
+
+bool Config::Data::HashIndex() noexcept {
+    return hashIndex_;
+}
+
+unsigned Config::Data::ShardThreshold() noexcept {
+    return shardThreshold_;
 }
\ No newline at end of file
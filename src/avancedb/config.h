@@ -102,20 +102,40 @@ public:
     
     struct MapReduce final {
         static const float DefaultWorkersPerCpu;
+        static const unsigned DefaultResultsCacheSize;
 
         static unsigned Workers() noexcept;
         static float WorkersPerCpu() noexcept;
+        
+        /// The megabytes of view query results cached per database, zero disables the cache
+        static unsigned ResultsCacheSize() noexcept;
 
     private:
         friend Config;
 
         static float workersPerCpu_;
+        static unsigned resultsCacheSize_;
     };
     
     struct Data final {
+        static const unsigned DefaultShardThreshold;
+        
         /// The amount of time, in seconds, to wait after a database has been removed
         /// before the database destructor is called
         static unsigned DatabaseDeleteDelay() noexcept;
+        
+        /// Whether each document collection keeps a hash index of document ids for point lookups
+        static bool HashIndex() noexcept;
+        
+        /// The number of documents a database created without a shard count holds in a 
+        /// single collection before it is split into the default shards, zero disables it
+        static unsigned ShardThreshold() noexcept;
+        
+    private:
+        friend Config;
+        
+        static bool hashIndex_;
+        static unsigned shardThreshold_;
     };
     
     static void Clear() { vm_.clear(); }
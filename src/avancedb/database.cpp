@@ -27,14 +27,18 @@ Database::Database(const char* name) :
     name_(name), instanceStartTime_(Now()), docDelCount_(0) {
 }
 
-database_ptr Database::Create(const char* name) {
+database_ptr Database::Create(const char* name, unsigned shards) {
     auto ptr = boost::make_shared<database_ptr::element_type>(name);
     if (!!ptr) {
-        ptr->docs_ = Documents::Create(ptr);
+        ptr->docs_ = Documents::Create(ptr, shards);
     }
     return ptr;
 }
 
+void Database::Reshard(unsigned shards) {
+    docs_->Reshard(shards);
+}
+
 unsigned long Database::Now() {
     auto now = boost::chrono::system_clock::now().time_since_epoch();
     return boost::chrono::duration_cast<boost::chrono::microseconds>(now).count();
@@ -64,6 +68,10 @@ document_ptr Database::SetDocument(const char* id, script_object_ptr obj) {
     return docs_->SetDocument(id, obj);
 }
 
+document_ptr Database::UpdateDocument(const char* id, const char* function, script_object_ptr req, DesignFunctions::Response& response) {
+    return docs_->UpdateDocument(id, function, req, response);
+}
+
 document_ptr Database::SetDocumentAttachment(const char* id, const char* rev, const char* name, const char* contentType, const std::vector<unsigned char>& attachment) {
     return docs_->SetDocumentAttachment(id, rev, name, contentType, attachment);
 }
@@ -92,6 +100,10 @@ document_array_ptr Database::GetDocuments(const GetAllDocumentsOptions& options,
     return docs_->GetDocuments(options, offset, totalDocs, updateSequence);
 }
 
+DocumentCollectionMergedResultsIterator Database::GetDocumentsIterator(const GetAllDocumentsOptions& options, sequence_type& updateSequence) {
+    return docs_->GetDocumentsIterator(options, updateSequence);
+}
+
 document_array_ptr Database::PostDocuments(const PostAllDocumentsOptions& options, DocumentCollection::size_type& totalDocs, sequence_type& updateSequence) {
     return docs_->PostDocuments(options, totalDocs, updateSequence);
 }
@@ -112,6 +124,46 @@ BulkDocumentsResults Database::PostBulkDocuments(script_array_ptr docs, bool new
     return docs_->PostBulkDocuments(docs, newEdits);
 }
 
+document_array_ptr Database::FindDocuments(const MangoQuery& query) {
+    return docs_->FindDocuments(query);
+}
+
+mango_index_ptr Database::PlanFindDocuments(const MangoQuery& query) {
+    return docs_->PlanFindDocuments(query);
+}
+
+mango_index_ptr Database::CreateIndex(script_object_ptr definition, bool& created) {
+    return docs_->CreateIndex(definition, created);
+}
+
+bool Database::DeleteIndex(const char* designId, const char* name) {
+    return docs_->DeleteIndex(designId, name);
+}
+
+mango_index_array Database::GetIndexes() {
+    return docs_->GetIndexes();
+}
+
+search_index_ptr Database::GetSearchIndex(const char* designId, const char* name, const char* function) {
+    return docs_->GetSearchIndex(designId, name, function);
+}
+
+SearchIndex::hit_array Database::SearchDocuments(search_index_ptr index, const SearchQuery& query, std::size_t skip, std::size_t limit, std::uint64_t& totalHits) {
+    return docs_->SearchDocuments(index, query, skip, limit, totalHits);
+}
+
+spatial_index_ptr Database::GetSpatialIndex(const char* designId, const char* name, script_object_ptr spatial) {
+    return docs_->GetSpatialIndex(designId, name, spatial);
+}
+
+SpatialIndex::hit_array Database::QuerySpatial(spatial_index_ptr index, const SpatialIndex::Region& region, std::size_t skip, std::size_t limit, std::uint64_t& totalRows) {
+    return docs_->QuerySpatial(index, region, skip, limit, totalRows);
+}
+
 map_reduce_results_ptr Database::PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj) {
     return docs_->PostTempView(options, obj);
+}
+
+void Database::PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj, const MapReduce::shard_results_handler& handler) {
+    docs_->PostTempView(options, obj, handler);
 }
\ No newline at end of file
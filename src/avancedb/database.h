@@ -36,20 +36,34 @@
 class Database final : public boost::enable_shared_from_this<Database>, private boost::noncopyable {
 public:
         
-    static database_ptr Create(const char* name);
+    // shards of 0 uses the default shard count
+    static database_ptr Create(const char* name, unsigned shards = 0);
     
+    const char* Name() const { return name_.c_str(); }
     unsigned long CommitedUpdateSequence() { return docs_->getUpdateSequence(); }
     unsigned long UpdateSequence() { return docs_->getUpdateSequence(); }
     unsigned long PurgeSequence() { return 0; }
+    const MapReduceResultsCache& ResultsCache() { return docs_->getMapReduceResultsCache(); }
     unsigned long DataSize();
     unsigned long DiskSize();
     unsigned long DocCount();
     unsigned long DocDelCount() { return docDelCount_; }
     unsigned long InstanceStartTime() { return instanceStartTime_; }
+    unsigned ShardCount() { return docs_->getShardCount(); }
+    
+    void Reshard(unsigned shards);
+    bool StartReshard(unsigned shards) { return docs_->StartReshard(shards); }
+    bool GetReshardTask(Documents::ReshardTask& task) { return docs_->GetReshardTask(task); }
+    
+    // used by the reaper once the database has been removed and the reaper holds the only 
+    // reference, the documents are released a shard at a time once nothing else holds them
+    bool IsReleasable() { return docs_.use_count() == 1; }
+    bool ReleaseShard(std::uint64_t& bytes) { return docs_->ReleaseShard(bytes); }
     
     document_ptr GetDocument(const char* id, bool throwOnFail = true);
     document_ptr DeleteDocument(const char* id, const char* rev);
     document_ptr SetDocument(const char* id, script_object_ptr);
+    document_ptr UpdateDocument(const char* id, const char* function, script_object_ptr req, DesignFunctions::Response& response);
     
     document_ptr SetDocumentAttachment(const char* id, const char* rev, const char* name, const char* contentType, const std::vector<unsigned char>& attachment);
     document_attachment_ptr GetDocumentAttachment(const char* id, const char* name, bool includeBody);
@@ -64,11 +78,26 @@ public:
     document_ptr SetLocalDocument(const char* id, script_object_ptr);
     
     document_array_ptr GetDocuments(const GetAllDocumentsOptions& options, DocumentCollection::size_type& offset, DocumentCollection::size_type& totalDocs, sequence_type& updateSequence);
+    DocumentCollectionMergedResultsIterator GetDocumentsIterator(const GetAllDocumentsOptions& options, sequence_type& updateSequence);
     document_array_ptr PostDocuments(const PostAllDocumentsOptions& options, DocumentCollection::size_type& totalDocs, sequence_type& updateSequence);
     
     BulkDocumentsResults PostBulkDocuments(script_array_ptr docs, bool newEdits);
     
+    document_array_ptr FindDocuments(const MangoQuery& query);
+    mango_index_ptr PlanFindDocuments(const MangoQuery& query);
+    
+    mango_index_ptr CreateIndex(script_object_ptr definition, bool& created);
+    bool DeleteIndex(const char* designId, const char* name);
+    mango_index_array GetIndexes();
+    
+    search_index_ptr GetSearchIndex(const char* designId, const char* name, const char* function);
+    SearchIndex::hit_array SearchDocuments(search_index_ptr index, const SearchQuery& query, std::size_t skip, std::size_t limit, std::uint64_t& totalHits);
+    
+    spatial_index_ptr GetSpatialIndex(const char* designId, const char* name, script_object_ptr spatial);
+    SpatialIndex::hit_array QuerySpatial(spatial_index_ptr index, const SpatialIndex::Region& region, std::size_t skip, std::size_t limit, std::uint64_t& totalRows);
+    
     map_reduce_results_ptr PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj);
+    void PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj, const MapReduce::shard_results_handler& handler);
     
 private:
     friend database_ptr boost::make_shared<database_ptr::element_type>(const char*&);
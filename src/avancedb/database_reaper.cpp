@@ -0,0 +1,160 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "database_reaper.h"
+
+#include <algorithm>
+
+#include "database.h"
+#include "set_thread_name.h"
+
+// how long to wait before looking again at a database that is still in use
+static const std::chrono::milliseconds inUseRetryDelay{100};
+
+DatabaseReaper::Job::Job(database_ptr db, clock::time_point due) : 
+        db_(db), due_(due), startedOn_(Now()), updatedOn_(startedOn_), shards_(db->ShardCount()), released_(0) {
+    
+}
+
+DatabaseReaper::DatabaseReaper(std::chrono::seconds delay) : 
+        delay_(delay), stop_(false), databasesReaped_(0), bytesReclaimed_(0) {
+    
+}
+
+DatabaseReaper::~DatabaseReaper() {
+    std::unique_lock<std::mutex> lock{m_};
+    stop_ = true;
+    jobPosted_.notify_all();
+    lock.unlock();
+    
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::uint64_t DatabaseReaper::Now() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::seconds>(now).count();
+}
+
+void DatabaseReaper::Post(database_ptr db) {
+    std::unique_lock<std::mutex> lock{m_};
+    
+    if (!stop_) {
+        Enqueue(Job{db, clock::now() + delay_});
+        
+        if (!thread_.joinable()) {
+            thread_ = std::thread{&DatabaseReaper::Run, this};
+        }
+        
+        jobPosted_.notify_one();
+    }
+}
+
+void DatabaseReaper::Enqueue(Job&& job) {
+    // the queue is kept in due order, a job goes after any due at the same time
+    auto iter = std::upper_bound(jobs_.begin(), jobs_.end(), job.due_, [](const clock::time_point& due, const Job& other) {
+        return due < other.due_;
+    });
+    
+    jobs_.emplace(iter, std::move(job));
+}
+
+DatabaseReaper::task_array DatabaseReaper::GetTasks() const {
+    std::unique_lock<std::mutex> lock{m_};
+    
+    task_array tasks;
+    tasks.reserve(jobs_.size());
+    
+    for (const auto& job : jobs_) {
+        auto progress = job.shards_ > 0 ? (job.released_ * 100) / job.shards_ : 0;
+        tasks.emplace_back(Task{job.db_->Name(), job.startedOn_, job.updatedOn_, progress});
+    }
+    
+    return tasks;
+}
+
+std::size_t DatabaseReaper::Pending() const {
+    std::unique_lock<std::mutex> lock{m_};
+    return jobs_.size();
+}
+
+void DatabaseReaper::Run() {
+    SetThreadName::Set("avancedb-reaper");
+    
+    std::unique_lock<std::mutex> lock{m_};
+    
+    while (!stop_) {
+        if (jobs_.size() == 0) {
+            jobPosted_.wait(lock, [&]() { return stop_ || jobs_.size() > 0; });
+            continue;
+        }
+        
+        auto& job = jobs_.front();
+        if (clock::now() < job.due_) {
+            auto due = job.due_;
+            jobPosted_.wait_until(lock, due, [&]() { return stop_ || jobs_.front().due_ < due; });
+            continue;
+        }
+        
+        // a request that found the database before it was removed may still be using it, 
+        // it's requeued to be looked at again so the databases due before then aren't held up
+        if (job.db_.use_count() > 1 || !job.db_->IsReleasable()) {
+            auto retry = std::move(job);
+            jobs_.pop_front();
+            
+            retry.due_ = clock::now() + inUseRetryDelay;
+            Enqueue(std::move(retry));
+            continue;
+        }
+        
+        auto db = job.db_.get();
+        lock.unlock();
+        
+        std::uint64_t bytes = 0;
+        auto released = db->ReleaseShard(bytes);
+        bytesReclaimed_ += bytes;
+        
+        lock.lock();
+        
+        // the job can't have moved, only this thread removes jobs and one posted meanwhile 
+        // is due later than this one so it's queued behind it
+        auto& releasedJob = jobs_.front();
+        releasedJob.updatedOn_ = Now();
+        
+        if (released) {
+            ++releasedJob.released_;
+            lock.unlock();
+            
+            std::this_thread::yield();
+            
+            lock.lock();
+        } else {
+            auto lastDb = std::move(releasedJob.db_);
+            jobs_.pop_front();
+            lock.unlock();
+            
+            // whatever is left, the indexes and the view results cache, is freed here
+            lastDb.reset();
+            ++databasesReaped_;
+            
+            lock.lock();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RS_AVANCEDB_DATABASE_REAPER_H
+#define RS_AVANCEDB_DATABASE_REAPER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "types.h"
+
+// frees removed databases on a single background thread once their delete delay has passed 
+// and nothing else holds them, a database is released one collection at a time so that a 
+// large database doesn't hold the thread, the thread is only started when the first is posted
+class DatabaseReaper final {
+public:
+    
+    struct Task final {
+        std::string database_;
+        std::uint64_t startedOn_;
+        std::uint64_t updatedOn_;
+        unsigned progress_;
+    };
+    
+    using task_array = std::vector<Task>;
+    
+    DatabaseReaper(std::chrono::seconds delay);
+    DatabaseReaper(const DatabaseReaper&) = delete;
+    DatabaseReaper& operator=(const DatabaseReaper&) = delete;
+    ~DatabaseReaper();
+    
+    void Post(database_ptr db);
+    
+    // the databases waiting to be freed or being freed, progress is a percentage
+    task_array GetTasks() const;
+    
+    std::size_t Pending() const;
+    std::uint64_t DatabasesReaped() const { return databasesReaped_; }
+    std::uint64_t BytesReclaimed() const { return bytesReclaimed_; }
+    
+private:
+    
+    using clock = std::chrono::steady_clock;
+    
+    struct Job final {
+        Job(database_ptr db, clock::time_point due);
+        
+        database_ptr db_;
+        clock::time_point due_;
+        std::uint64_t startedOn_;
+        std::uint64_t updatedOn_;
+        unsigned shards_;
+        unsigned released_;
+    };
+    
+    static std::uint64_t Now();
+    
+    // called holding the mutex
+    void Enqueue(Job&& job);
+    
+    void Run();
+    
+    const std::chrono::seconds delay_;
+    
+    mutable std::mutex m_;
+    std::condition_variable jobPosted_;
+    std::deque<Job> jobs_;
+    bool stop_;
+    
+    std::atomic<std::uint64_t> databasesReaped_;
+    std::atomic<std::uint64_t> bytesReclaimed_;
+    
+    std::thread thread_;
+};
+
+#endif /* RS_AVANCEDB_DATABASE_REAPER_H */
+
@@ -19,18 +19,109 @@
 #include "databases.h"
 
 #include <algorithm>
-#include <thread>
 #include <chrono>
 
 #include "database.h"
 #include "config.h"
 
-bool Databases::AddDatabase(const char* name) {
+std::atomic<Databases::HazardSlot*> Databases::hazardSlots_{nullptr};
+
+Databases::Databases() : databases_(new database_map{}), 
+        reaper_(std::chrono::seconds{Config::Data::DatabaseDeleteDelay()}) {
+    
+}
+
+Databases::~Databases() {
+    delete databases_.load();
+}
+
+Databases::HazardSlot& Databases::ThreadSlot() {
+    // gives the slot back when the thread exits
+    struct SlotOwner final {
+        SlotOwner() : slot_(AcquireSlot()) {}
+        ~SlotOwner() { slot_->active_.store(false, std::memory_order_release); }
+        
+        HazardSlot* slot_;
+    };
+    
+    static thread_local SlotOwner owner;
+    return *owner.slot_;
+}
+
+Databases::HazardSlot* Databases::AcquireSlot() {
+    for (auto slot = hazardSlots_.load(std::memory_order_acquire); slot != nullptr; slot = slot->next_) {
+        auto active = false;
+        if (!slot->active_.load(std::memory_order_relaxed) && slot->active_.compare_exchange_strong(active, true, std::memory_order_acquire)) {
+            return slot;
+        }
+    }
+    
+    // there are only ever as many slots as threads which have read a registry at the same time
+    auto slot = new HazardSlot{};
+    slot->next_ = hazardSlots_.load(std::memory_order_relaxed);
+    while (!hazardSlots_.compare_exchange_weak(slot->next_, slot, std::memory_order_release, std::memory_order_relaxed)) {
+        
+    }
+    
+    return slot;
+}
+
+Databases::MapGuard::MapGuard(const Databases& databases) : slot_(ThreadSlot()) {
+    // the map is only safe to read once the slot holds it and it is still current, 
+    // otherwise a writer may have replaced it and checked the slot before it was set
+    auto map = databases.databases_.load(std::memory_order_acquire);
+    for (;;) {
+        slot_.map_.store(map);
+        auto current = databases.databases_.load();
+        if (current == map) {
+            break;
+        }
+        
+        map = current;
+    }
+    
+    map_ = map;
+}
+
+Databases::MapGuard::~MapGuard() {
+    slot_.map_.store(nullptr, std::memory_order_release);
+}
+
+void Databases::Publish(database_map* databases) {
+    retired_.emplace_back(databases_.exchange(databases));
+    Reclaim();
+}
+
+void Databases::Reclaim() {
+    std::vector<const database_map*> hazards;
+    for (auto slot = hazardSlots_.load(std::memory_order_acquire); slot != nullptr; slot = slot->next_) {
+        auto map = slot->map_.load();
+        if (map != nullptr) {
+            hazards.push_back(map);
+        }
+    }
+    
+    std::sort(hazards.begin(), hazards.end());
+    
+    // a map a reader still holds is left for a later create or delete to free
+    retired_.erase(std::remove_if(retired_.begin(), retired_.end(), [&](const std::unique_ptr<const database_map>& map) {
+        return !std::binary_search(hazards.cbegin(), hazards.cend(), map.get());
+    }), retired_.end());
+}
+
+bool Databases::AddDatabase(const char* name, unsigned shards) {
     std::lock_guard<std::mutex> lock(databasesMutex_);
     bool added = false;
-
-    if (databases_.find(name) == databases_.cend()) {
-        databases_.emplace(name, Database::Create(name));
+    
+    // the writers hold the mutex so the map can't be freed while it's copied
+    auto databases = databases_.load(std::memory_order_relaxed);
+    if (databases->find(name) == databases->cend()) {
+        // copying the map makes a create or delete O(n) in the number of databases, which is 
+        // accepted since they are rare next to lookups and those never wait on a writer
+        std::unique_ptr<database_map> newDatabases{new database_map(*databases)};
+        newDatabases->emplace(name, Database::Create(name, shards));
+        
+        Publish(newDatabases.release());
         added = true;
     }
     
@@ -41,19 +132,17 @@ bool Databases::RemoveDatabase(const char* name) {
     auto removed = false;
     
     std::lock_guard<std::mutex> lock(databasesMutex_);
-    auto iter = databases_.find(name);
-    if (iter != databases_.end()) {
-        // capture the db in a lambda and launch it on a background thread
-        auto db = iter->second;
-        std::thread removeThread{[db]() mutable {
-            auto delay = Config::Data::DatabaseDeleteDelay();
-            std::this_thread::sleep_for(std::chrono::seconds(delay));
-            db.reset();
-        }};
-        removeThread.detach();
+    
+    auto databases = databases_.load(std::memory_order_relaxed);
+    auto iter = databases->find(name);
+    if (iter != databases->end()) {
+        reaper_.Post(iter->second);
         
-        // remove the db from the collection now
-        databases_.erase(iter);
+        // remove the db from the collection now, readers holding the old registry can still find it
+        std::unique_ptr<database_map> newDatabases{new database_map(*databases)};
+        newDatabases->erase(name);
+        
+        Publish(newDatabases.release());
         removed = true;
     }
     
@@ -61,27 +150,26 @@ bool Databases::RemoveDatabase(const char* name) {
 }
 
 bool Databases::IsDatabase(const char* name) {
-    std::lock_guard<std::mutex> lock(databasesMutex_);
-    return databases_.find(name) != databases_.cend();
+    MapGuard databases{*this};
+    return databases->find(name) != databases->cend();
 }
 
 database_ptr Databases::GetDatabase(const char* name) {
-    std::lock_guard<std::mutex> lock(databasesMutex_);
+    MapGuard databases{*this};
     
-    auto iter = databases_.find(name);
-    return iter != databases_.cend() ? iter->second : nullptr;
+    auto iter = databases->find(name);
+    return iter != databases->cend() ? iter->second : nullptr;
 }
 
 std::vector<std::string> Databases::GetDatabases() {
-    std::vector<std::string> databases;
-    databases.reserve(databases_.size());
-    
-    if (true) {
-        std::lock_guard<std::mutex> lock(databasesMutex_);
-        std::for_each(databases_.cbegin(), databases_.cend(), [&](const std::pair<std::string, database_ptr>& item) {
-            databases.push_back(item.first);
-        });
-    }
+    MapGuard databases{*this};
+    
+    std::vector<std::string> names;
+    names.reserve(databases->size());
     
-    return databases;
-}
\ No newline at end of file
+    std::for_each(databases->cbegin(), databases->cend(), [&](const std::pair<std::string, database_ptr>& item) {
+        names.push_back(item.first);
+    });
+    
+    return names;
+}
@@ -23,22 +23,81 @@
 #include <vector>
 #include <string>
 #include <mutex>
+#include <memory>
+#include <atomic>
+
+#include <boost/noncopyable.hpp>
 
 #include "types.h"
+#include "database_reaper.h"
 
+// lookups read an immutable snapshot of the registry without taking a lock or touching a 
+// shared reference count, adding or removing a database copies the registry and publishes 
+// the copy, the replaced snapshot is freed once no reader holds it in its hazard slot
 class Databases {
 public:
     
-    bool AddDatabase(const char*);
+    Databases();
+    ~Databases();
+    
+    bool AddDatabase(const char*, unsigned shards = 0);
     bool RemoveDatabase(const char*);
     database_ptr GetDatabase(const char*);
     bool IsDatabase(const char*);
     std::vector<std::string> GetDatabases();
     
+    const DatabaseReaper& Reaper() const { return reaper_; }
+    
 private:
-    std::map<std::string, database_ptr> databases_;
+    using database_map = std::map<std::string, database_ptr>;
+    
+    // one per thread that reads a registry, a slot is never freed but is taken 
+    // again by a later thread once the thread holding it has exited
+    struct HazardSlot final {
+        HazardSlot() : map_(nullptr), active_(true), next_(nullptr) {}
+        
+        std::atomic<const database_map*> map_;
+        std::atomic<bool> active_;
+        HazardSlot* next_;
+        
+        // keeps the slots of different threads off the same cache line
+        char padding_[64];
+    };
+    
+    // holds the current map in the calling thread's slot while it's in scope, 
+    // a thread reads through one guard at a time
+    class MapGuard final : private boost::noncopyable {
+    public:
+        MapGuard(const Databases&);
+        ~MapGuard();
+        
+        const database_map* operator->() const { return map_; }
+        const database_map& operator*() const { return *map_; }
+        
+    private:
+        HazardSlot& slot_;
+        const database_map* map_;
+    };
     
+    static HazardSlot& ThreadSlot();
+    static HazardSlot* AcquireSlot();
+    
+    // the caller holds databasesMutex_, frees the replaced maps no slot holds
+    void Publish(database_map* databases);
+    void Reclaim();
+    
+    // the slots of every thread across all registries, only ever pushed on to
+    static std::atomic<HazardSlot*> hazardSlots_;
+    
+    // only replaced by a writer holding databasesMutex_
+    std::atomic<const database_map*> databases_;
+    
+    // serializes the writers and guards the maps waiting to be freed
     std::mutex databasesMutex_;
+    std::vector<std::unique_ptr<const database_map>> retired_;
+    
+    // frees the removed databases after the delete delay
+    DatabaseReaper reaper_;
 };
 
 #endif /* RS_AVANCEDB_DATABASES_H */
\ No newline at end of file
@@ -0,0 +1,386 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "design_functions.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "document.h"
+#include "global_function_scope.h"
+#include "map_reduce.h"
+#include "map_reduce_result.h"
+#include "map_reduce_thread_pool.h"
+#include "rest_exceptions.h"
+
+const char DesignFunctions::DefaultContentType[] = "text/html; charset=utf-8";
+
+// show and update responses are normalized to a code, a content type and a string body
+static const char respondScript[] = R"((function() {
+    var respondWith = function(resp, doc) {
+        if (typeof resp === 'string') {
+            resp = { body: resp };
+        } else if (resp === null || typeof resp !== 'object') {
+            resp = {};
+        }
+        var headers = resp.headers || {};
+        var contentType = headers['Content-Type'];
+        var body = resp.body;
+        if (resp.json !== undefined) {
+            body = JSON.stringify(resp.json);
+            contentType = contentType || 'application/json';
+        }
+        respond(resp.code || 0, contentType || '', body === undefined || body === null ? '' : String(body), doc);
+    };)";
+
+static const std::string showPrefix = std::string{respondScript} + "\n    var show = ";
+static const char showSuffix[] = R"(;
+    return function(doc, req) {
+        respondWith(show(doc, req), null);
+    };
+})();)";
+
+// the update function gets a plain copy of the document so that it can be modified
+static const std::string updatePrefix = std::string{respondScript} + "\n    var update = ";
+static const char updateSuffix[] = R"(;
+    return function(doc, req) {
+        var result = update(doc === null ? null : JSON.parse(JSON.stringify(doc)), req) || [];
+        respondWith(result[1], result[0] === undefined ? null : result[0]);
+    };
+})();)";
+
+// getRow and start are declared ahead of the list function so it resolves them from this scope
+static const char listPrefix[] = R"((function() {
+    var getRow = function() {
+        if (!nextRow()) {
+            return null;
+        }
+        var keyValue = rowKeyValue();
+        var row = { id: rowId(), key: keyValue[0], value: keyValue[1] };
+        var doc = rowDoc();
+        if (doc !== null) {
+            row.doc = doc;
+        }
+        return row;
+    };
+    var start = function(resp) {
+        resp = resp || {};
+        var headers = resp.headers || {};
+        startResponse(resp.code || 200, headers['Content-Type'] || '');
+    };
+    var list = )";
+static const char listSuffix[] = R"(;
+    return function(head, req) {
+        var tail = list(head, req);
+        if (tail !== undefined && tail !== null) {
+            send(String(tail));
+        }
+    };
+})();)";
+
+// a thrown { forbidden: ... } or { unauthorized: ... } rejects the document, anything else is an error
+static const char validatePrefix[] = R"((function() {
+    var validate = )";
+static const char validateSuffix[] = R"(;
+    return function(id, newDoc, oldDoc, dbName) {
+        if (newDoc._id === undefined) {
+            newDoc = JSON.parse(JSON.stringify(newDoc));
+            newDoc._id = id;
+        }
+        try {
+            validate(newDoc, oldDoc, { db: dbName, name: null, roles: [] }, {});
+        } catch (e) {
+            if (e === null || typeof e !== 'object') {
+                throw e;
+            } else if (e.forbidden !== undefined) {
+                reject('forbidden', String(e.forbidden));
+            } else if (e.unauthorized !== undefined) {
+                reject('unauthorized', String(e.unauthorized));
+            } else {
+                throw e;
+            }
+        }
+    };
+})();)";
+
+static int GetCode(const rs::jsapi::Value& value) {
+    return value.isInt32() ? value.toInt32() : static_cast<int>(value.toNumber());
+}
+
+DesignFunctions::Response DesignFunctions::Show(const char* function, const document_ptr& doc, script_object_ptr req) {
+    Response response;
+    
+    Execute([&](rs::jsapi::Context& cx, std::size_t threadId) {
+        Render(cx, threadId, showPrefix, showSuffix, function, doc, req, response);
+    });
+    
+    if (response.code_ == 0) {
+        response.code_ = 200;
+    }
+    
+    return response;
+}
+
+script_object_ptr DesignFunctions::Update(rs::jsapi::Context& cx, std::size_t threadId, const char* function, const document_ptr& doc, script_object_ptr req, Response& response) {
+    auto obj = Render(cx, threadId, updatePrefix, updateSuffix, function, doc, req, response);
+    
+    // like CouchDB a saved document is reported as created
+    if (response.code_ == 0) {
+        response.code_ = !!obj ? 201 : 200;
+    }
+    
+    return obj;
+}
+
+std::string DesignFunctions::CreateValidator(const char* function) {
+    std::string script = validatePrefix;
+    script += function;
+    script += validateSuffix;
+    return script;
+}
+
+void DesignFunctions::Validate(rs::jsapi::Context& cx, std::size_t threadId, const validator_array& validators, const char* dbName, validation_array& validations) {
+    Validation* validation = nullptr;
+    
+    GlobalFunctionScope rejectScope(cx, "reject", 
+        [&](const std::vector<rs::jsapi::Value>& args, rs::jsapi::Value&) {
+            validation->error_ = args[0].ToString();
+            validation->reason_ = args[1].ToString();
+    });
+    
+    rs::jsapi::Value dbNameValue(cx);
+    dbNameValue = dbName;
+    
+    for (const auto& validator : validators) {
+        auto& func = GetFunction(threadId, validator);
+        
+        for (auto& pending : validations) {
+            // the first rejection wins
+            if (pending.error_.size() > 0) {
+                continue;
+            }
+            
+            validation = &pending;
+            
+            rs::jsapi::Value idValue(cx);
+            idValue = pending.id_;
+            
+            rs::jsapi::Value docValue(cx);
+            MapReduce::CreateValueObject(pending.doc_, docValue);
+            
+            rs::jsapi::Value oldDocValue(cx);
+            if (!!pending.oldDoc_) {
+                MapReduce::CreateValueObject(pending.oldDoc_->getObject(), oldDocValue);
+            } else {
+                oldDocValue = JS::NullHandleValue;
+            }
+            
+            rs::jsapi::FunctionArguments args(cx);
+            args.Append(idValue);
+            args.Append(docValue);
+            args.Append(oldDocValue);
+            args.Append(dbNameValue);
+            
+            try {
+                func.CallFunction(args);
+            } catch (const rs::jsapi::ScriptException& ex) {
+                throw RenderError{ex.what()};
+            }
+        }
+    }
+}
+
+void DesignFunctions::List(const char* function, script_object_ptr head, script_object_ptr req, bool includeDocs, 
+        const row_source& rows, const start_handler& start, const send_handler& send) {
+    Response response;
+    auto started = false;
+    
+    auto startOnce = [&]() {
+        if (!started) {
+            if (response.contentType_.size() == 0) {
+                response.contentType_ = DefaultContentType;
+            }
+            
+            start(response);
+            started = true;
+        }
+    };
+    
+    Execute([&](rs::jsapi::Context& cx, std::size_t threadId) {
+        map_reduce_result_ptr row;
+        
+        GlobalFunctionScope startResponseScope(cx, "startResponse", 
+            [&](const std::vector<rs::jsapi::Value>& args, rs::jsapi::Value&) {
+                // like CouchDB a start after the first chunk has no effect
+                if (!started) {
+                    response.code_ = GetCode(args[0]);
+                    response.contentType_ = args[1].ToString();
+                }
+        });
+        
+        GlobalFunctionScope sendScope(cx, "send", 
+            [&](const std::vector<rs::jsapi::Value>& args, rs::jsapi::Value&) {
+                startOnce();
+                
+                auto chunk = args[0].ToString();
+                if (chunk.size() > 0) {
+                    send(chunk.c_str(), chunk.size());
+                }
+        });
+        
+        GlobalFunctionScope nextRowScope(cx, "nextRow", 
+            [&](const std::vector<rs::jsapi::Value>&, rs::jsapi::Value& result) {
+                row = rows();
+                result = !!row;
+        });
+        
+        GlobalFunctionScope rowIdScope(cx, "rowId", 
+            [&](const std::vector<rs::jsapi::Value>&, rs::jsapi::Value& result) {
+                result = row->getId();
+        });
+        
+        GlobalFunctionScope rowKeyValueScope(cx, "rowKeyValue", 
+            [&](const std::vector<rs::jsapi::Value>&, rs::jsapi::Value& result) {
+                MapReduce::CreateValueArray(row->getResultArray(), result);
+        });
+        
+        GlobalFunctionScope rowDocScope(cx, "rowDoc", 
+            [&](const std::vector<rs::jsapi::Value>&, rs::jsapi::Value& result) {
+                auto doc = row->getDoc();
+                if (includeDocs && !!doc) {
+                    MapReduce::CreateValueObject(doc->getObject(), result);
+                } else {
+                    result = JS::NullHandleValue;
+                }
+        });
+        
+        auto& func = GetFunction(threadId, listPrefix, function, listSuffix);
+        
+        rs::jsapi::Value headValue(cx);
+        MapReduce::CreateValueObject(head, headValue);
+        
+        rs::jsapi::Value reqValue(cx);
+        MapReduce::CreateValueObject(req, reqValue);
+        
+        rs::jsapi::FunctionArguments args(cx);
+        args.Append(headValue);
+        args.Append(reqValue);
+        
+        try {
+            func.CallFunction(args);
+        } catch (const rs::jsapi::ScriptException& ex) {
+            throw RenderError{ex.what()};
+        }
+    });
+    
+    // a list which never sent anything still has a response
+    startOnce();
+}
+
+script_object_ptr DesignFunctions::Render(rs::jsapi::Context& cx, std::size_t threadId, const std::string& prefix, const char* suffix, 
+        const char* function, const document_ptr& doc, script_object_ptr req, Response& response) {
+    script_object_ptr obj;
+    
+    GlobalFunctionScope respondScope(cx, "respond", 
+        [&](const std::vector<rs::jsapi::Value>& args, rs::jsapi::Value&) {
+            SetResponse(args, response);
+            
+            const auto& docValue = args[3];
+            if (JS_TypeOfValue(docValue.getContext(), docValue) == JSTYPE_OBJECT && !docValue.isNull()) {
+                obj = MapReduce::GetValueScriptObject(docValue);
+            }
+    });
+    
+    auto& func = GetFunction(threadId, prefix.c_str(), function, suffix);
+    
+    rs::jsapi::Value docValue(cx);
+    if (!!doc) {
+        MapReduce::CreateValueObject(doc->getObject(), docValue);
+    } else {
+        docValue = JS::NullHandleValue;
+    }
+    
+    rs::jsapi::Value reqValue(cx);
+    MapReduce::CreateValueObject(req, reqValue);
+    
+    rs::jsapi::FunctionArguments args(cx);
+    args.Append(docValue);
+    args.Append(reqValue);
+    
+    try {
+        func.CallFunction(args);
+    } catch (const rs::jsapi::ScriptException& ex) {
+        throw RenderError{ex.what()};
+    }
+    
+    return obj;
+}
+
+void DesignFunctions::SetResponse(const std::vector<rs::jsapi::Value>& args, Response& response) {
+    response.code_ = GetCode(args[0]);
+    response.contentType_ = args[1].ToString();
+    response.body_ = args[2].ToString();
+    
+    if (response.contentType_.size() == 0) {
+        response.contentType_ = DefaultContentType;
+    }
+}
+
+void DesignFunctions::Execute(const pool_function& func) {
+    std::mutex m;
+    std::condition_variable executed;
+    auto done = false;
+    std::exception_ptr error;
+    
+    auto threadPool = MapReduceThreadPool::Get();
+    threadPool->Post([&](std::size_t threadId) {
+        try {
+            func(threadPool->GetThreadContext(threadId), threadId);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        
+        std::lock_guard<std::mutex> lock{m};
+        done = true;
+        executed.notify_one();
+    });
+    
+    std::unique_lock<std::mutex> lock{m};
+    executed.wait(lock, [&]() { return done; });
+    
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+rs::jsapi::Value& DesignFunctions::GetFunction(std::size_t threadId, const char* prefix, const char* function, const char* suffix) {
+    std::string script = prefix;
+    script += function;
+    script += suffix;
+    
+    return GetFunction(threadId, script);
+}
+
+rs::jsapi::Value& DesignFunctions::GetFunction(std::size_t threadId, const std::string& script) {
+    try {
+        return MapReduceThreadPool::Get()->GetThreadFunction(threadId, script);
+    } catch (const rs::jsapi::ScriptException& ex) {
+        throw CompilationError{ex.what()};
+    }
+}
\ No newline at end of file
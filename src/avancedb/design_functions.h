@@ -0,0 +1,102 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_DESIGN_FUNCTIONS_H
+#define RS_AVANCEDB_DESIGN_FUNCTIONS_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <boost/shared_ptr.hpp>
+
+#include "libjsapi.h"
+
+#include "types.h"
+
+// runs design document show, list, update and validate functions on the map/reduce thread pool, 
+// the compiled functions are cached per pool thread so a request only pays for the call
+class DesignFunctions final {
+public:
+    DesignFunctions() = delete;
+    
+    struct Response final {
+        Response() : code_(200) {}
+        
+        int code_;
+        std::string contentType_;
+        std::string body_;
+    };
+    
+    using row_source = std::function<map_reduce_result_ptr()>;
+    using start_handler = std::function<void(const Response&)>;
+    using send_handler = std::function<void(const char* chunk, std::size_t size)>;
+    
+    // the document is null when none was requested or it doesn't exist
+    static Response Show(const char* function, const document_ptr& doc, script_object_ptr req);
+    
+    // rows are only pulled from the source when the function calls getRow(), the start handler 
+    // is called once before the first chunk and each send() is passed straight to the send handler
+    static void List(const char* function, script_object_ptr head, script_object_ptr req, bool includeDocs, 
+        const row_source& rows, const start_handler& start, const send_handler& send);
+    
+    // must be called on a pool thread, returns the document to save or null when there is nothing to save
+    static script_object_ptr Update(rs::jsapi::Context& cx, std::size_t threadId, const char* function, const document_ptr& doc, script_object_ptr req, Response& response);
+    
+    // a document waiting to be validated, the error is left empty when every validator accepts it
+    struct Validation final {
+        Validation(const char* id, script_object_ptr doc, const document_ptr& oldDoc) : 
+            id_(id), doc_(doc), oldDoc_(oldDoc) {}
+        
+        const char* id_;
+        script_object_ptr doc_;
+        document_ptr oldDoc_;
+        std::string error_;
+        std::string reason_;
+    };
+    
+    using validation_array = std::vector<Validation>;
+    using validator_array = std::vector<std::string>;
+    using validator_array_ptr = boost::shared_ptr<const validator_array>;
+    
+    // wraps a validate_doc_update function, done once per design document revision
+    static std::string CreateValidator(const char* function);
+    
+    // must be called on a pool thread, each validator is looked up once and then run against the whole batch
+    static void Validate(rs::jsapi::Context& cx, std::size_t threadId, const validator_array& validators, const char* dbName, validation_array& validations);
+    
+    using pool_function = std::function<void(rs::jsapi::Context& cx, std::size_t threadId)>;
+    
+    // blocks the calling thread until the function has run on a pool thread
+    static void Execute(const pool_function& func);
+    
+    static const char DefaultContentType[];
+    
+private:
+    // runs a show or update function, returning the document it passed to respond()
+    static script_object_ptr Render(rs::jsapi::Context& cx, std::size_t threadId, const std::string& prefix, const char* suffix, 
+        const char* function, const document_ptr& doc, script_object_ptr req, Response& response);
+    
+    static void SetResponse(const std::vector<rs::jsapi::Value>& args, Response& response);
+    
+    static rs::jsapi::Value& GetFunction(std::size_t threadId, const char* prefix, const char* function, const char* suffix);
+    static rs::jsapi::Value& GetFunction(std::size_t threadId, const std::string& script);
+};
+
+#endif /* RS_AVANCEDB_DESIGN_FUNCTIONS_H */
+
@@ -20,12 +20,14 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 
 #include "script_object_vector_source.h"
 
 #include "document_revision.h"
 #include "city.h"
 #include "base64_helper.h"
+#include "rest_exceptions.h"
 
 Document::Document(script_object_ptr obj, sequence_type seqNum) : obj_(obj), id_(obj->getString("_id")), rev_(obj->getString("_rev")), seqNum_(seqNum) {
 }
@@ -35,11 +37,17 @@ document_ptr Document::Create(const char* id, script_object_ptr obj, sequence_ty
     const char* newRev = nullptr;
     DocumentRevision::RevString newRevString;
     
-    if (incrementRev || oldRev == nullptr) {
-        // TODO: strtoul is unsafe
-        auto oldVersion = oldRev != nullptr ? std::strtoul(oldRev, nullptr, 10) : 0;
-        auto nextVersion = oldVersion + 1;
+    // TODO: strtoul is unsafe
+    auto oldVersion = oldRev != nullptr ? std::strtoul(oldRev, nullptr, 10) : 0;
+    auto nextVersion = oldVersion + 1;
+    
+    // inline attachment bodies are decoded once here and replaced by stubs before the hash is taken
+    std::vector<document_attachment_ptr> attachments;
+    auto revpos = incrementRev || oldRev == nullptr ? nextVersion : oldVersion;
+    obj = ExtractAttachments(obj, revpos, attachments);
+    oldRev = obj->getString("_rev", false);
     
+    if (incrementRev || oldRev == nullptr) {
         rs::scriptobject::ScriptObjectHash digest;
         obj->CalculateHash(digest, &Document::ValidateHashField);
 
@@ -68,6 +76,8 @@ document_ptr Document::Create(const char* id, script_object_ptr obj, sequence_ty
         doc = boost::make_shared<document_ptr::element_type>(newObj, seqNum);
     }
     
+    doc->attachments_ = std::move(attachments);
+    
     return doc;
 }
 
@@ -91,35 +101,39 @@ sequence_type Document::getUpdateSequence() const {
     return seqNum_;
 }
 
+void Document::setUpdateSequence(sequence_type seqNum) {
+    seqNum_ = seqNum;
+}
+
 const script_object_ptr Document::getObject() const {
     return obj_;
 }
 
+std::uint64_t Document::getDataSize() const {
+    std::uint64_t size = obj_->getSize(true);
+    
+    for (const auto& attachment : attachments_) {
+        size += attachment->Size();
+    }
+    
+    return size;
+}
+
 bool Document::ValidateHashField(const char* name) {
     return name != nullptr && std::strcmp(name, "_id") != 0 && std::strcmp(name, "_rev") != 0;
 }
 
-document_attachment_ptr Document::getAttachment(const char* name, bool includeBody) {    
+document_attachment_ptr Document::getAttachment(const char* name, bool includeBody) const {
     document_attachment_ptr attachment;
     
     auto attachmentsObj = obj_->getObject("_attachments", false);
     if (!!attachmentsObj) {        
         auto attachmentObj = attachmentsObj->getObject(name, false);
         if (!!attachmentObj) {
-            auto contentType = attachmentObj->getString("content_type");
-            auto digest = attachmentObj->getString("digest");
-
-            if (includeBody) {
-                auto encodedData = attachmentObj->getString("data");
-                auto encodedDataSize = attachmentObj->getStringLength("data");
-                auto data = Base64Helper::Decode(encodedData, encodedDataSize);
-                attachment = DocumentAttachment::Create(name, contentType, digest, std::move(data));
-            } else {
-                int lengthIndex = -1;
-                auto size = attachmentObj->getType("length", lengthIndex) == rs::scriptobject::ScriptObjectType::UInt32 ? 
-                    attachmentObj->getUInt32(lengthIndex) : attachmentObj->getUInt64(lengthIndex);
-
-                attachment = DocumentAttachment::Create(name, contentType, digest, Base64Helper::buffer_type{}, size);
+            attachment = findAttachment(name);
+            
+            if (!attachment && !includeBody) {
+                attachment = CreateAttachment(name, attachmentObj, DocumentAttachment::buffer_ptr{});
             }
         }
     }
@@ -127,7 +141,7 @@ document_attachment_ptr Document::getAttachment(const char* name, bool includeBo
     return attachment;
 }
 
-std::vector<document_attachment_ptr> Document::getAttachments() {
+std::vector<document_attachment_ptr> Document::getAttachments() const {
     std::vector<document_attachment_ptr> attachments;
     
     auto attachmentsObj = obj_->getObject("_attachments", false);
@@ -135,24 +149,149 @@ std::vector<document_attachment_ptr> Document::getAttachments() {
         auto count = attachmentsObj->getCount();        
         attachments.reserve(count);
         
+        for (decltype(count) i = 0; i < count; ++i) {
+            auto type = attachmentsObj->getType(i);
+            if (type == rs::scriptobject::ScriptObjectType::Object) {
+                auto attachment = findAttachment(attachmentsObj->getName(i));
+                if (!!attachment) {
+                    attachments.push_back(attachment);
+                }
+            }
+        }
+    }
+    
+    return attachments;
+}
+
+void Document::setAttachment(document_attachment_ptr attachment) {
+    auto iter = std::find_if(attachments_.begin(), attachments_.end(), [&](const document_attachment_ptr& a) {
+        return a->Name() == attachment->Name();
+    });
+    
+    if (iter != attachments_.end()) {
+        *iter = attachment;
+    } else {
+        attachments_.push_back(attachment);
+    }
+}
+
+void Document::inheritAttachments(const document_ptr& oldDoc) {
+    auto attachmentsObj = obj_->getObject("_attachments", false);
+    if (!!attachmentsObj) {
+        auto count = attachmentsObj->getCount();
+        
         for (decltype(count) i = 0; i < count; ++i) {
             auto type = attachmentsObj->getType(i);
             if (type == rs::scriptobject::ScriptObjectType::Object) {
                 auto name = attachmentsObj->getName(i);
-                auto attachmentObj = attachmentsObj->getObject(i);
                 
-                auto contentType = attachmentObj->getString("content_type");
-                auto digest = attachmentObj->getString("digest");
-                
-                auto encodedData = attachmentObj->getString("data");
-                auto encodedDataSize = attachmentObj->getStringLength("data");
-                auto data = Base64Helper::Decode(encodedData, encodedDataSize);
-                
-                auto attachment = DocumentAttachment::Create(name, contentType, digest, std::move(data));
-                attachments.push_back(attachment);
+                if (!findAttachment(name)) {
+                    // the stub takes the body of the previous revision when it names the same content
+                    auto oldAttachment = !!oldDoc ? oldDoc->findAttachment(name) : document_attachment_ptr{};
+                    if (!oldAttachment) {
+                        throw MissingStub{getId(), name};
+                    }
+                    
+                    auto attachment = CreateAttachment(name, attachmentsObj->getObject(i), oldAttachment->Buffer());
+                    if (!attachment->Digest().empty() && attachment->Digest() != oldAttachment->Digest()) {
+                        throw MissingStub{getId(), name};
+                    }
+                    
+                    attachments_.push_back(attachment);
+                }
             }
         }
     }
+}
+
+script_object_ptr Document::ExtractAttachments(script_object_ptr obj, std::uint64_t revpos, std::vector<document_attachment_ptr>& attachments) {
+    if (obj->getType("_attachments") != rs::scriptobject::ScriptObjectType::Object) {
+        return obj;
+    }
     
-    return attachments;
+    auto attachmentsObj = obj->getObject("_attachments");
+    auto newAttachmentsObj = attachmentsObj;
+    
+    auto count = attachmentsObj->getCount();
+    for (decltype(count) i = 0; i < count; ++i) {
+        auto type = attachmentsObj->getType(i);
+        if (type != rs::scriptobject::ScriptObjectType::Object) {
+            continue;
+        }
+        
+        auto name = attachmentsObj->getName(i);
+        auto attachmentObj = attachmentsObj->getObject(i);
+        
+        int dataIndex = -1;
+        if (attachmentObj->getType("data", dataIndex) != rs::scriptobject::ScriptObjectType::String) {
+            continue;
+        }
+        
+        auto encodedData = attachmentObj->getString(dataIndex);
+        auto encodedDataSize = attachmentObj->getStringLength(dataIndex);
+        DocumentAttachment::buffer_ptr data = boost::make_shared<DocumentAttachment::buffer_type>(Base64Helper::Decode(encodedData, encodedDataSize));
+        
+        auto contentType = attachmentObj->getString("content_type", false);
+        auto digest = DocumentAttachment::FormatDigest(data->data(), data->size());
+        
+        rs::scriptobject::utils::ScriptObjectVectorSource stubSource({
+            std::make_pair("content_type", contentType != nullptr ? contentType : "application/octet-stream"),
+            std::make_pair("revpos", revpos),
+            std::make_pair("digest", digest.c_str()),
+            std::make_pair("length", data->size()),
+            std::make_pair("stub", true)
+        });
+        
+        auto stubObj = rs::scriptobject::ScriptObjectFactory::CreateObject(stubSource, true);
+        
+        rs::scriptobject::utils::ScriptObjectVectorSource namedStubSource{
+            { std::make_pair(name, stubObj) }
+        };
+        
+        auto namedStubObj = rs::scriptobject::ScriptObjectFactory::CreateObject(namedStubSource, false);
+        
+        newAttachmentsObj = rs::scriptobject::ScriptObject::Merge(newAttachmentsObj, namedStubObj, rs::scriptobject::ScriptObject::MergeStrategy::Back);
+        
+        attachments.push_back(CreateAttachment(name, stubObj, data));
+    }
+    
+    if (attachments.empty()) {
+        return obj;
+    }
+    
+    rs::scriptobject::utils::ScriptObjectVectorSource newAttachmentsSource{
+        { std::make_pair("_attachments", newAttachmentsObj) }
+    };
+
+    newAttachmentsObj = rs::scriptobject::ScriptObjectFactory::CreateObject(newAttachmentsSource, true);
+    
+    return rs::scriptobject::ScriptObject::Merge(obj, newAttachmentsObj, rs::scriptobject::ScriptObject::MergeStrategy::Back);
+}
+
+document_attachment_ptr Document::CreateAttachment(const char* name, script_object_ptr attachmentObj, DocumentAttachment::buffer_ptr data) {
+    auto contentType = attachmentObj->getString("content_type", false);
+    auto digest = attachmentObj->getString("digest", false);
+    
+    DocumentAttachment::size_type size = 0;
+    if (!data) {
+        int lengthIndex = -1;
+        auto type = attachmentObj->getType("length", lengthIndex);
+        if (type == rs::scriptobject::ScriptObjectType::UInt32) {
+            size = attachmentObj->getUInt32(lengthIndex);
+        } else if (type == rs::scriptobject::ScriptObjectType::UInt64) {
+            size = attachmentObj->getUInt64(lengthIndex);
+        }
+    }
+    
+    return DocumentAttachment::Create(name, contentType != nullptr ? contentType : "", digest != nullptr ? digest : "", data, size);
+}
+
+document_attachment_ptr Document::findAttachment(const char* name) const {
+    for (const auto& attachment : attachments_) {
+        if (attachment->Name() == name) {
+            return attachment;
+        }
+    }
+    
+    return document_attachment_ptr{};
 }
\ No newline at end of file
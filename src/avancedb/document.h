@@ -68,10 +68,19 @@ public:
     const char* getRev() const;
     sequence_type getUpdateSequence() const;
     
+    // only while no reader can see the document
+    void setUpdateSequence(sequence_type seqNum);
+    
     const script_object_ptr getObject() const;
+    std::uint64_t getDataSize() const;
 
-    document_attachment_ptr getAttachment(const char* name, bool includeBody);
-    std::vector<document_attachment_ptr> getAttachments();
+    document_attachment_ptr getAttachment(const char* name, bool includeBody) const;
+    std::vector<document_attachment_ptr> getAttachments() const;
+    
+    // only while no reader can see the document
+    void setAttachment(document_attachment_ptr attachment);
+    // throws MissingStub for a stub the previous revision has no body for
+    void inheritAttachments(const document_ptr& oldDoc);
         
 private:
     
@@ -81,10 +90,18 @@ private:
     
     static bool ValidateHashField(const char*);
     
+    static script_object_ptr ExtractAttachments(script_object_ptr obj, std::uint64_t revpos, std::vector<document_attachment_ptr>& attachments);
+    static document_attachment_ptr CreateAttachment(const char* name, script_object_ptr attachmentObj, DocumentAttachment::buffer_ptr data);
+    
+    document_attachment_ptr findAttachment(const char* name) const;
+    
     script_object_ptr obj_;
     const char* id_;
     const char* rev_;
-    const sequence_type seqNum_;
+    sequence_type seqNum_;
+    
+    // the attachment bodies are held outside the document object and shared between revisions
+    std::vector<document_attachment_ptr> attachments_;
 };
 
 #endif /* RS_AVANCEDB_DOCUMENT_H */
@@ -19,15 +19,57 @@
 #include "document_attachment.h"
 
 #include <utility>
+#include <algorithm>
 
-DocumentAttachment::DocumentAttachment(const char* name, const char* contentType, const char* digest, std::vector<value_type>&& data, size_type size) :
-    name_(name), contentType_(contentType), digest_(ParseDigest(digest)), data_(std::move(data)), size_(size) {
+#include <boost/format.hpp>
+
+#include "base64_helper.h"
+
+#include "md5.h"
+
+DocumentAttachment::DocumentAttachment(const char* name, const char* contentType, const char* digest, buffer_ptr data, size_type size) :
+    name_(name), contentType_(contentType), digest_(ParseDigest(digest)), data_(data), size_(size) {
 
 }
 
 document_attachment_ptr DocumentAttachment::Create(const char* name, const char* contentType, const char* digest, std::vector<value_type>&& data, size_type size) {
-    size = size > 0 ? size : data.size();
-    return boost::make_shared<document_attachment_ptr::element_type>(name, contentType, digest, std::forward<decltype(data)>(data), size);
+    buffer_ptr buffer = boost::make_shared<buffer_type>(std::forward<decltype(data)>(data));
+    return Create(name, contentType, digest, buffer, size);
+}
+
+document_attachment_ptr DocumentAttachment::Create(const char* name, const char* contentType, const char* digest, buffer_ptr data, size_type size) {
+    size = size > 0 || !data ? size : data->size();
+    return boost::make_shared<document_attachment_ptr::element_type>(name, contentType, digest, data, size);
+}
+
+std::string DocumentAttachment::FormatDigest(const value_type* data, size_type size) {
+    MD5 md5;
+    md5.update(data, size);
+    md5.finalize();
+    
+    Base64Helper::buffer_type digest(16);
+    md5.bindigest(digest.data());
+    
+    return std::string("md5-") + Base64Helper::Encode(digest).c_str();
+}
+
+bool DocumentAttachment::ResolveRange(std::int64_t& start, std::int64_t& end, size_type size) {
+    auto total = static_cast<std::int64_t>(size);
+    
+    if (start < 0) {
+        start += total;
+    }
+
+    if (start < 0 || start >= total) {
+        return false;
+    }
+
+    end = std::min(end, total - 1);
+    return end >= start;
+}
+
+std::string DocumentAttachment::FormatContentRange(std::int64_t start, std::int64_t end, size_type size) {
+    return (boost::format("bytes %1%-%2%/%3%") % start % end % size).str();
 }
 
 const std::string& DocumentAttachment::Name() const {
@@ -43,13 +85,17 @@ DocumentAttachment::size_type DocumentAttachment::Size() const {
 }
 
 const DocumentAttachment::value_type* DocumentAttachment::Data() const {
-    return data_.data();
+    return !!data_ ? data_->data() : nullptr;
 }
 
 const std::string& DocumentAttachment::Digest() const {
     return digest_;
 }
 
+const DocumentAttachment::buffer_ptr& DocumentAttachment::Buffer() const {
+    return data_;
+}
+
 const char* DocumentAttachment::ParseDigest(const std::string& digest) {
     if (digest.find("md5-") == 0) {
         return digest.c_str() + 4;
@@ -19,6 +19,7 @@
 #ifndef RS_AVANCEDB_DOCUMENT_ATTACHMENT_H
 #define RS_AVANCEDB_DOCUMENT_ATTACHMENT_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -33,25 +34,35 @@ class DocumentAttachment final : public boost::enable_shared_from_this<DocumentA
 public:
     using value_type = unsigned char;
     using size_type = std::size_t;        
+    using buffer_type = std::vector<value_type>;
+    using buffer_ptr = boost::shared_ptr<const buffer_type>;
     
     static document_attachment_ptr Create(const char* name, const char* contentType, const char* digest, std::vector<value_type>&& data, size_type size = 0);
+    static document_attachment_ptr Create(const char* name, const char* contentType, const char* digest, buffer_ptr data, size_type size = 0);
+    
+    static std::string FormatDigest(const value_type* data, size_type size);
+    
+    // resolves a requested byte range against the body size, a negative start counts back from the end
+    static bool ResolveRange(std::int64_t& start, std::int64_t& end, size_type size);
+    static std::string FormatContentRange(std::int64_t start, std::int64_t end, size_type size);
     
     const std::string& Name() const;
     const std::string& ContentType() const;
     size_type Size() const;
     const value_type* Data() const;
     const std::string& Digest() const;
+    const buffer_ptr& Buffer() const;
     
 private:
-    friend document_attachment_ptr boost::make_shared<document_attachment_ptr::element_type>(const char*&, const char*&, const char*&, std::vector<value_type>&&, size_type&);
+    friend document_attachment_ptr boost::make_shared<document_attachment_ptr::element_type>(const char*&, const char*&, const char*&, buffer_ptr&, size_type&);
     
-    DocumentAttachment(const char* name, const char* contentType, const char* digest, std::vector<value_type>&& data, size_type size);
+    DocumentAttachment(const char* name, const char* contentType, const char* digest, buffer_ptr data, size_type size);
 
     static const char* ParseDigest(const std::string&);
     
     const std::string name_;
     const std::string contentType_;
-    const std::vector<value_type> data_;
+    const buffer_ptr data_;
     const size_type size_;
     const std::string digest_;
 };
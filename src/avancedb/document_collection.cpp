@@ -16,26 +16,19 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "document_collection.h"
 
-DocumentCollection::DocumentCollection(unsigned maxUnsortedEntries, unsigned maxNurseryEntries) : coll_(maxUnsortedEntries, maxNurseryEntries) {
-    
-}
-
-document_collection_ptr DocumentCollection::Create(unsigned maxUnsortedEntries, unsigned maxNurseryEntries) {
-    return boost::make_shared<DocumentCollection>(maxUnsortedEntries, maxNurseryEntries);
-}
+#include "document_collection.h"
 
-DocumentCollection::collection::const_iterator DocumentCollection::cbegin() {
-    return coll_.cbegin();
-}
+#include <algorithm>
+#include <cstring>
 
-DocumentCollection::collection::const_iterator DocumentCollection::cend() {
-    return coll_.cend();
+DocumentCollection::DocumentCollection(bool hashIndex) : 
+        size_(0), version_(0), index_(hashIndex ? new DocumentHashIndex{} : nullptr) {
+    
 }
 
-DocumentCollection::const_reference DocumentCollection::operator[](int index) const {
-    return coll_[index];
+document_collection_ptr DocumentCollection::Create(bool hashIndex) {
+    return boost::make_shared<DocumentCollection>(hashIndex);
 }
 
 void DocumentCollection::lock() const { 
@@ -50,22 +43,151 @@ void DocumentCollection::unlock() const {
     mtx_.unlock(); 
 }
 
+void DocumentCollection::lock_shared() const { 
+    mtx_.lock_shared(); 
+}
+
+void DocumentCollection::unlock_shared() const { 
+    mtx_.unlock_shared(); 
+}
+
 DocumentCollection::size_type DocumentCollection::size() const {
-    return coll_.size();
+    return size_;
+}
+
+void DocumentCollection::insert(const document_ptr& doc) {
+    Write();
+    
+    Document::Less less;
+    
+    auto iter = FindChunk(doc);
+    if (iter == chunks_.end()) {
+        // the document goes after everything else, onto the end of the last chunk
+        if (chunks_.size() == 0 || chunks_.back()->size() >= MaxChunkSize) {
+            chunks_.emplace_back(boost::make_shared<chunk>());
+            chunks_.back()->reserve(MaxChunkSize + 1);
+        }
+        
+        iter = chunks_.end() - 1;
+    }
+    
+    auto& docs = WriteChunk(iter);
+    auto pos = std::lower_bound(docs.begin(), docs.end(), doc, less);
+    
+    if (pos != docs.end() && !less(doc, *pos)) {
+        *pos = doc;
+    } else {
+        docs.insert(pos, doc);
+        ++size_;
+        
+        if (docs.size() > MaxChunkSize) {
+            auto half = docs.size() / 2;
+            
+            auto split = boost::make_shared<chunk>();
+            split->reserve(MaxChunkSize + 1);
+            split->assign(docs.begin() + half, docs.end());
+            docs.resize(half);
+            
+            chunks_.insert(iter + 1, split);
+        }
+    }
+    
+    if (!!index_) {
+        index_->insert(doc);
+    }
 }
 
-void DocumentCollection::insert(const collection::value_type& k, insert_hint hint) {
-    return coll_.insert(k, hint);
+DocumentCollection::size_type DocumentCollection::erase(const document_ptr& doc) {
+    Document::Less less;
+    
+    auto iter = FindChunk(doc);
+    if (iter == chunks_.end()) {
+        return 0;
+    }
+    
+    auto pos = std::lower_bound((*iter)->cbegin(), (*iter)->cend(), doc, less);
+    if (pos == (*iter)->cend() || less(doc, *pos)) {
+        return 0;
+    }
+    
+    auto index = std::distance((*iter)->cbegin(), pos);
+    
+    Write();
+    
+    auto& docs = WriteChunk(iter);
+    docs.erase(docs.begin() + index);
+    --size_;
+    
+    if (docs.size() == 0) {
+        chunks_.erase(iter);
+    } else if (iter + 1 != chunks_.end() && docs.size() + (*(iter + 1))->size() <= MaxChunkSize / 2) {
+        // small neighbours are merged so deletes can't leave a long tail of tiny chunks
+        docs.insert(docs.end(), (*(iter + 1))->cbegin(), (*(iter + 1))->cend());
+        chunks_.erase(iter + 1);
+    }
+    
+    if (!!index_) {
+        index_->erase(doc);
+    }
+    
+    return 1;
 }
 
-DocumentCollection::size_type DocumentCollection::erase(const collection::value_type& k) {
-    return coll_.erase(k);
+document_ptr DocumentCollection::find(const char* id) const {
+    if (!!index_) {
+        return index_->find(id, Document::getIdHash(id));
+    }
+    
+    auto iter = std::lower_bound(chunks_.cbegin(), chunks_.cend(), id, 
+        [](const chunk_array::value_type& c, const char* i) { return std::strcmp(c->back()->getId(), i) < 0; });
+    
+    if (iter != chunks_.cend()) {
+        auto pos = std::lower_bound((*iter)->cbegin(), (*iter)->cend(), id, 
+            [](const document_ptr& d, const char* i) { return std::strcmp(d->getId(), i) < 0; });
+        
+        if (std::strcmp((*pos)->getId(), id) == 0) {
+            return *pos;
+        }
+    }
+    
+    return document_ptr{};
+}
+
+document_collection_snapshot_ptr DocumentCollection::Snapshot() const {
+    boost::lock_guard<decltype(snapshotMtx_)> guard{snapshotMtx_};
+    
+    // only the chunk pointers are copied, never the documents
+    if (!snapshot_) {
+        snapshot_ = DocumentCollectionSnapshot::Create(chunks_, size_, version_);
+    }
+    
+    return snapshot_;
 }
 
-DocumentCollection::collection::value_type_ptr DocumentCollection::find_fn(collection::compare_type compare) {
-    return coll_.find_fn(compare);
+DocumentCollection::chunk_array::iterator DocumentCollection::FindChunk(const document_ptr& doc) {
+    Document::Less less;
+    
+    // the first chunk ending at or after the document is the only one which can hold it
+    return std::lower_bound(chunks_.begin(), chunks_.end(), doc, 
+        [&](const chunk_array::value_type& c, const document_ptr& d) { return less(c->back(), d); });
+}
+
+DocumentCollection::chunk& DocumentCollection::WriteChunk(chunk_array::iterator iter) {
+    // the snapshots are only built under the lock so nothing else can take a reference to 
+    // the chunk while the writer holds it, a stale count only costs an unnecessary copy
+    if (iter->use_count() > 1) {
+        auto copy = boost::make_shared<chunk>();
+        copy->reserve(MaxChunkSize + 1);
+        copy->assign((*iter)->cbegin(), (*iter)->cend());
+        *iter = copy;
+    }
+    
+    return **iter;
 }
 
-void DocumentCollection::copy(std::vector<collection::value_type>& coll, bool sort) {
-    coll_.copy(coll, sort);
+void DocumentCollection::Write() {
+    // the writer holds the lock exclusively so no reader can be publishing a snapshot, dropping 
+    // ours first means a chunk only we had been sharing doesn't need to be copied
+    snapshot_.reset();
+    ++version_;
 }
\ No newline at end of file
@@ -16,53 +16,75 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #ifndef RS_AVANCEDB_DOCUMENT_COLLECTION_H
 #define RS_AVANCEDB_DOCUMENT_COLLECTION_H
 
 #include "types.h"
 #include "document.h"
+#include "document_hash_index.h"
+#include "document_collection_snapshot.h"
 
+#include <cstdint>
 #include <vector>
+#include <memory>
 
 #include <boost/thread.hpp>
 #include <boost/make_shared.hpp>
 
-#include "../../externals/lazyflatset/lazyflatset.hpp"
-
+// the documents are kept sorted in bounded chunks, a snapshot shares the chunks with the collection
+// and a writer copies a chunk before changing it whenever a snapshot still holds it, so a scan can 
+// run without the lock and without stopping the writers
 class DocumentCollection final {
 public:
-    using collection = rs::LazyFlatSet<document_ptr, Document::Less, Document::Equal, rs::LazyFlatSetQuickSort<document_ptr, Document::Less>, std::allocator<document_ptr>, true>;
-    using const_iterator = collection::const_iterator;
-    using const_reference = collection::const_reference;
-    using size_type = collection::size_type;
-    using insert_hint = collection::insert_hint;
-    
-    static document_collection_ptr Create(unsigned maxUnsortedEntries = 16, unsigned maxNurseryEntries = 1024);
+    using size_type = DocumentCollectionSnapshot::size_type;
     
-    collection::const_iterator cbegin();
-    collection::const_iterator cend();
-    
-    const_reference operator[](int index) const;
+    static document_collection_ptr Create(bool hashIndex = false);
     
+    // writers take the lock exclusively, readers share it
     void lock() const;
     bool try_lock() const;
     void unlock() const;
     
+    void lock_shared() const;
+    void unlock_shared() const;
+    
     size_type size() const;
-    void insert(const collection::value_type&, insert_hint hint = insert_hint::no_hint);
-    size_type erase(const collection::value_type&);
-    void copy(std::vector<collection::value_type>& coll, bool sort = true);
-    collection::value_type_ptr find_fn(collection::compare_type);
+    void insert(const document_ptr& doc);
+    size_type erase(const document_ptr& doc);
+    
+    // a point lookup, using the hash index when the collection has one
+    document_ptr find(const char* id) const;
+    
+    // the caller holds the lock, either shared or exclusively, the snapshot is only rebuilt 
+    // when there has been a write since the last one
+    document_collection_snapshot_ptr Snapshot() const;
     
 private:
     
-    friend document_collection_ptr boost::make_shared<document_collection_ptr::element_type>(unsigned&, unsigned&);
+    using chunk = DocumentCollectionSnapshot::chunk;
+    using chunk_array = DocumentCollectionSnapshot::chunk_array;
+    
+    static const size_type MaxChunkSize = 512;
+    
+    friend document_collection_ptr boost::make_shared<document_collection_ptr::element_type>(bool&);
+    
+    DocumentCollection(bool hashIndex);
+    
+    chunk_array::iterator FindChunk(const document_ptr& doc);
+    chunk& WriteChunk(chunk_array::iterator iter);
+    void Write();
     
-    DocumentCollection(unsigned maxUnsortedEntries, unsigned maxNurseryEntries);
+    chunk_array chunks_;
+    size_type size_;
+    std::uint64_t version_;
+    std::unique_ptr<DocumentHashIndex> index_;
     
-    collection coll_;
+    // readers sharing the lock publish the snapshot between them, a writer only resets it
+    mutable document_collection_snapshot_ptr snapshot_;
+    mutable boost::mutex snapshotMtx_;
     
-    mutable boost::mutex mtx_;
+    mutable boost::shared_mutex mtx_;
     char padding_[64];
 };
 
@@ -0,0 +1,134 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "document_collection_merged_results_iterator.h"
+
+#include <algorithm>
+
+#include "document.h"
+#include "document_collection_results.h"
+#include "get_all_documents_options.h"
+
+DocumentCollectionMergedResultsIterator::DocumentCollectionMergedResultsIterator(const document_collections_ptr_array& collections, const GetAllDocumentsOptions& options) :
+        descending_(options.Descending()), skip_(0), limit_(options.Limit()), offset_(0), totalRows_(0) {
+    
+    size_type filteredRows = 0;
+    
+    cursors_.reserve(collections.size());
+    for (const auto& coll : collections) {
+        document_collection_snapshot_ptr docs;
+        {
+            boost::shared_lock<DocumentCollection> lock{*coll};
+            docs = coll->Snapshot();
+        }
+        
+        // only the range is found here, the rows are read from the snapshot as they're merged
+        DocumentCollectionResults results{docs, docs->size(), options.Key().c_str(), options.StartKey().c_str(), 
+            options.EndKey().c_str(), options.InclusiveEnd(), options.Descending()};
+        
+        auto begin = results.cbegin();
+        auto end = results.cend();
+        
+        filteredRows += std::distance(begin, end);
+        totalRows_ += results.TotalRows();
+        offset_ += results.Offset();
+        
+        if (begin != end) {
+            cursors_.push_back({docs, begin, end});
+        }
+    }
+    
+    skip_ = std::min(options.Skip(), filteredRows);
+    offset_ = std::min(offset_ + skip_, totalRows_);
+    
+    heap_.reserve(cursors_.size());
+    for (std::size_t i = 0; i < cursors_.size(); ++i) {
+        heap_.push_back(i);
+    }
+    
+    std::make_heap(heap_.begin(), heap_.end(), [&](std::size_t a, std::size_t b) { return HeapCompare(a, b); });
+}
+
+document_ptr DocumentCollectionMergedResultsIterator::Next() {
+    while (skip_ > 0) {
+        --skip_;
+        Pop();
+    }
+    
+    document_ptr doc;
+    if (limit_ > 0) {
+        doc = Pop();
+        if (!!doc) {
+            --limit_;
+        }
+    }
+    
+    return doc;
+}
+
+DocumentCollectionMergedResultsIterator::size_type DocumentCollectionMergedResultsIterator::Offset() const {
+    return offset_;
+}
+
+DocumentCollectionMergedResultsIterator::size_type DocumentCollectionMergedResultsIterator::TotalRows() const {
+    return totalRows_;
+}
+
+const document_ptr& DocumentCollectionMergedResultsIterator::Current(const Cursor& cursor) const {
+    return !descending_ ? *cursor.begin_ : *(cursor.end_ - 1);
+}
+
+document_ptr DocumentCollectionMergedResultsIterator::Pop() {
+    document_ptr doc;
+    
+    if (heap_.size() > 0) {
+        auto compare = [&](std::size_t a, std::size_t b) { return HeapCompare(a, b); };
+        
+        std::pop_heap(heap_.begin(), heap_.end(), compare);
+        
+        auto& cursor = cursors_[heap_.back()];
+        doc = Current(cursor);
+        
+        if (!descending_) {
+            ++cursor.begin_;
+        } else {
+            --cursor.end_;
+        }
+        
+        if (cursor.begin_ != cursor.end_) {
+            std::push_heap(heap_.begin(), heap_.end(), compare);
+        } else {
+            heap_.pop_back();
+        }
+    }
+    
+    return doc;
+}
+
+bool DocumentCollectionMergedResultsIterator::HeapCompare(std::size_t a, std::size_t b) const {
+    const auto& cursorA = cursors_[a];
+    const auto& cursorB = cursors_[b];
+    
+    // std heaps keep the greatest element at the front so the order is inverted when ascending
+    Document::Less less;
+    if (!descending_) {
+        return less(Current(cursorB), Current(cursorA));
+    } else {
+        return less(Current(cursorA), Current(cursorB));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_DOCUMENT_COLLECTION_MERGED_RESULTS_ITERATOR_H
+#define RS_AVANCEDB_DOCUMENT_COLLECTION_MERGED_RESULTS_ITERATOR_H
+
+#include <vector>
+
+#include "types.h"
+#include "document_collection.h"
+#include "document_collection_snapshot.h"
+
+class GetAllDocumentsOptions;
+
+// performs a k-way merge over the document collections in either direction, each collection is read
+// from a snapshot taken under its lock so skipped rows are never materialized and the writers carry 
+// on while the rows are being streamed
+class DocumentCollectionMergedResultsIterator final {
+public:
+    using size_type = DocumentCollectionSnapshot::size_type;
+    
+    DocumentCollectionMergedResultsIterator(const document_collections_ptr_array& collections, const GetAllDocumentsOptions& options);
+    
+    document_ptr Next();
+    
+    size_type Offset() const;
+    size_type TotalRows() const;
+    
+private:
+    
+    using const_iterator = DocumentCollectionSnapshot::const_iterator;
+    
+    // the rows still to be read are between begin and end, descending reads them from the end
+    struct Cursor final {
+        document_collection_snapshot_ptr docs_;
+        const_iterator begin_;
+        const_iterator end_;
+    };
+    
+    const document_ptr& Current(const Cursor& cursor) const;
+    
+    document_ptr Pop();
+    
+    bool HeapCompare(std::size_t a, std::size_t b) const;
+    
+    const bool descending_;
+    std::vector<Cursor> cursors_;
+    std::vector<std::size_t> heap_;
+    size_type skip_;
+    size_type limit_;
+    size_type offset_;
+    size_type totalRows_;
+};
+
+#endif /* RS_AVANCEDB_DOCUMENT_COLLECTION_MERGED_RESULTS_ITERATOR_H */
+
@@ -21,7 +21,9 @@
 #include <cstring>
 #include <algorithm>
 
-DocumentCollectionResults::DocumentCollectionResults(document_collection_ptr docs, 
+#include "document.h"
+
+DocumentCollectionResults::DocumentCollectionResults(document_collection_snapshot_ptr docs, 
     size_type limit, const char* key,
     const char* startKey, const char* endKey, bool inclusiveEnd, bool descending) :
         docs_(docs),
@@ -74,7 +76,7 @@ DocumentCollectionResults::DocumentCollectionResults(document_collection_ptr doc
     }
 }
 
-DocumentCollectionResults::size_type DocumentCollectionResults::FindDocument(const DocumentCollection& docs, const char* key) {
+DocumentCollectionResults::size_type DocumentCollectionResults::FindDocument(const DocumentCollectionSnapshot& docs, const char* key) {
     const auto size = docs.size();
     
     if (size == 0) {
@@ -87,9 +89,9 @@ DocumentCollectionResults::size_type DocumentCollectionResults::FindDocument(con
             keyIdLength -= 2;
         }
         
-        DocumentCollection::size_type min = 0;
-        DocumentCollection::size_type mid = 0;
-        DocumentCollection::size_type max = size - 1;
+        size_type min = 0;
+        size_type mid = 0;
+        size_type max = size - 1;
 
         while (min <= max) {
             mid = ((max - min) / 2) + min;
@@ -22,14 +22,14 @@
 #include <limits>
 
 #include "types.h"
-#include "document_collection.h"
+#include "document_collection_snapshot.h"
 
 class DocumentCollectionResults final {
 public:
-    using const_iterator = DocumentCollection::const_iterator;
-    using size_type = DocumentCollection::size_type;
+    using const_iterator = DocumentCollectionSnapshot::const_iterator;
+    using size_type = DocumentCollectionSnapshot::size_type;
     
-    DocumentCollectionResults(document_collection_ptr docs, size_type limit, const char* key, const char* startKey, const char* endKey, bool inclusiveEnd, bool descending);
+    DocumentCollectionResults(document_collection_snapshot_ptr docs, size_type limit, const char* key, const char* startKey, const char* endKey, bool inclusiveEnd, bool descending);
     
     size_type Offset() const;
     size_type FilteredRows() const;
@@ -42,11 +42,11 @@ private:
     
     const size_type FindMissedFlag = ~(std::numeric_limits<size_type>::max() / 2);
     
-    static size_type FindDocument(const DocumentCollection& docs, const char* key);
+    static size_type FindDocument(const DocumentCollectionSnapshot& docs, const char* key);
     
     static size_type Subtract(size_type, size_type);
     
-    const document_collection_ptr docs_;
+    const document_collection_snapshot_ptr docs_;
     const bool inclusiveEnd_;
     const bool descending_;
     size_type startIndex_;
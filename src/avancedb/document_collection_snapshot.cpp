@@ -0,0 +1,102 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "document_collection_snapshot.h"
+
+#include <algorithm>
+
+#include "document.h"
+
+DocumentCollectionSnapshot::DocumentCollectionSnapshot(const chunk_array& chunks, size_type size, std::uint64_t version) :
+        chunks_(chunks), size_(size), version_(version) {
+    
+    offsets_.reserve(chunks_.size() + 1);
+    
+    size_type offset = 0;
+    for (const auto& chunk : chunks_) {
+        offsets_.push_back(offset);
+        offset += chunk->size();
+    }
+    
+    offsets_.push_back(offset);
+}
+
+document_collection_snapshot_ptr DocumentCollectionSnapshot::Create(const chunk_array& chunks, size_type size, std::uint64_t version) {
+    return boost::make_shared<DocumentCollectionSnapshot>(chunks, size, version);
+}
+
+DocumentCollectionSnapshot::size_type DocumentCollectionSnapshot::size() const {
+    return size_;
+}
+
+std::uint64_t DocumentCollectionSnapshot::Version() const {
+    return version_;
+}
+
+DocumentCollectionSnapshot::const_iterator DocumentCollectionSnapshot::cbegin() const {
+    return const_iterator{this, 0, 0};
+}
+
+DocumentCollectionSnapshot::const_iterator DocumentCollectionSnapshot::cend() const {
+    return const_iterator{this, chunks_.size(), 0};
+}
+
+const document_ptr& DocumentCollectionSnapshot::operator[](size_type index) const {
+    return *(cbegin() + index);
+}
+
+DocumentCollectionSnapshot::const_iterator DocumentCollectionSnapshot::lower_bound(const document_ptr& doc) const {
+    Document::Less less;
+    
+    // the first chunk ending at or after the document holds it if anything does
+    auto chunk = std::lower_bound(chunks_.cbegin(), chunks_.cend(), doc, 
+        [&](const chunk_ptr& c, const document_ptr& d) { return less(c->back(), d); });
+    
+    if (chunk == chunks_.cend()) {
+        return cend();
+    }
+    
+    auto pos = std::lower_bound((*chunk)->cbegin(), (*chunk)->cend(), doc, less);
+    return const_iterator{this, static_cast<size_type>(std::distance(chunks_.cbegin(), chunk)), 
+        static_cast<size_type>(std::distance((*chunk)->cbegin(), pos))};
+}
+
+DocumentCollectionSnapshot::const_iterator DocumentCollectionSnapshot::upper_bound(const document_ptr& doc) const {
+    Document::Less less;
+    
+    auto chunk = std::upper_bound(chunks_.cbegin(), chunks_.cend(), doc, 
+        [&](const document_ptr& d, const chunk_ptr& c) { return less(d, c->back()); });
+    
+    if (chunk == chunks_.cend()) {
+        return cend();
+    }
+    
+    auto pos = std::upper_bound((*chunk)->cbegin(), (*chunk)->cend(), doc, less);
+    return const_iterator{this, static_cast<size_type>(std::distance(chunks_.cbegin(), chunk)), 
+        static_cast<size_type>(std::distance((*chunk)->cbegin(), pos))};
+}
+
+void DocumentCollectionSnapshot::const_iterator::Seek(size_type index) {
+    const auto& offsets = snapshot_->offsets_;
+    
+    // the last offset is the size so the index of the end lands one past the last chunk
+    auto offset = std::upper_bound(offsets.cbegin(), offsets.cend(), index);
+    chunk_ = std::distance(offsets.cbegin(), offset) - 1;
+    pos_ = index - offsets[chunk_];
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_DOCUMENT_COLLECTION_SNAPSHOT_H
+#define RS_AVANCEDB_DOCUMENT_COLLECTION_SNAPSHOT_H
+
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/make_shared.hpp>
+
+#include "types.h"
+
+// an immutable, sorted view of a document collection at one version, the documents are held in 
+// chunks which are shared with the collection until a writer changes one and copies it first
+class DocumentCollectionSnapshot final : private boost::noncopyable {
+public:
+    using chunk = document_array;
+    using chunk_ptr = boost::shared_ptr<chunk>;
+    using chunk_array = std::vector<chunk_ptr>;
+    using size_type = document_array::size_type;
+    
+    class const_iterator final : public std::iterator<std::random_access_iterator_tag, const document_ptr> {
+    public:
+        const_iterator() : snapshot_(nullptr), chunk_(0), pos_(0) {}
+        
+        reference operator*() const { return (*snapshot_->chunks_[chunk_])[pos_]; }
+        pointer operator->() const { return &**this; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+        
+        const_iterator& operator++() {
+            if (++pos_ == snapshot_->chunks_[chunk_]->size()) {
+                ++chunk_;
+                pos_ = 0;
+            }
+            return *this;
+        }
+        
+        const_iterator& operator--() {
+            if (pos_ == 0) {
+                --chunk_;
+                pos_ = snapshot_->chunks_[chunk_]->size();
+            }
+            --pos_;
+            return *this;
+        }
+        
+        const_iterator operator++(int) { auto iter = *this; ++*this; return iter; }
+        const_iterator operator--(int) { auto iter = *this; --*this; return iter; }
+        
+        const_iterator& operator+=(difference_type n) { Seek(Index() + n); return *this; }
+        const_iterator& operator-=(difference_type n) { Seek(Index() - n); return *this; }
+        
+        const_iterator operator+(difference_type n) const { auto iter = *this; return iter += n; }
+        const_iterator operator-(difference_type n) const { auto iter = *this; return iter -= n; }
+        friend const_iterator operator+(difference_type n, const const_iterator& iter) { return iter + n; }
+        
+        difference_type operator-(const const_iterator& other) const { 
+            return static_cast<difference_type>(Index()) - static_cast<difference_type>(other.Index()); 
+        }
+        
+        bool operator==(const const_iterator& other) const { return chunk_ == other.chunk_ && pos_ == other.pos_; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+        bool operator<(const const_iterator& other) const { return chunk_ < other.chunk_ || (chunk_ == other.chunk_ && pos_ < other.pos_); }
+        bool operator>(const const_iterator& other) const { return other < *this; }
+        bool operator<=(const const_iterator& other) const { return !(other < *this); }
+        bool operator>=(const const_iterator& other) const { return !(*this < other); }
+        
+    private:
+        friend class DocumentCollectionSnapshot;
+        
+        const_iterator(const DocumentCollectionSnapshot* snapshot, size_type chunk, size_type pos) : 
+            snapshot_(snapshot), chunk_(chunk), pos_(pos) {}
+        
+        size_type Index() const { return snapshot_->offsets_[chunk_] + pos_; }
+        void Seek(size_type index);
+        
+        // the end is one past the last chunk so every iterator has a single position
+        const DocumentCollectionSnapshot* snapshot_;
+        size_type chunk_;
+        size_type pos_;
+    };
+    
+    // the chunks must be sorted, non-empty and never modified while the snapshot holds them
+    static document_collection_snapshot_ptr Create(const chunk_array& chunks, size_type size, std::uint64_t version);
+    
+    size_type size() const;
+    std::uint64_t Version() const;
+    
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+    
+    const document_ptr& operator[](size_type index) const;
+    
+    const_iterator lower_bound(const document_ptr& doc) const;
+    const_iterator upper_bound(const document_ptr& doc) const;
+    
+private:
+    
+    friend boost::shared_ptr<DocumentCollectionSnapshot> boost::make_shared<DocumentCollectionSnapshot>(const chunk_array&, size_type&, std::uint64_t&);
+    
+    DocumentCollectionSnapshot(const chunk_array& chunks, size_type size, std::uint64_t version);
+    
+    const chunk_array chunks_;
+    
+    // the index of the first document in each chunk followed by the size
+    std::vector<size_type> offsets_;
+    const size_type size_;
+    const std::uint64_t version_;
+};
+
+#endif /* RS_AVANCEDB_DOCUMENT_COLLECTION_SNAPSHOT_H */
+
@@ -0,0 +1,119 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "document_hash_index.h"
+
+#include <cstring>
+#include <utility>
+
+#include "document.h"
+
+DocumentHashIndex::DocumentHashIndex() : 
+        entries_(size_type{1} << InitialBits), size_(0), 
+        mask_((size_type{1} << InitialBits) - 1), shift_(64 - InitialBits) {
+    
+}
+
+document_ptr DocumentHashIndex::find(const char* id, std::uint64_t hash) const {
+    auto slot = Find(id, hash);
+    return entries_[slot].doc_;
+}
+
+void DocumentHashIndex::insert(const document_ptr& doc) {
+    // the table is kept at most half full so the probe sequences stay short
+    if ((size_ + 1) * 2 > entries_.size()) {
+        Grow();
+    }
+    
+    auto hash = doc->getIdHash();
+    auto slot = Find(doc->getId(), hash);
+    
+    auto& entry = entries_[slot];
+    if (!entry.doc_) {
+        entry.hash_ = hash;
+        ++size_;
+    }
+    
+    entry.doc_ = doc;
+}
+
+bool DocumentHashIndex::erase(const document_ptr& doc) {
+    auto slot = Find(doc->getId(), doc->getIdHash());
+    if (!entries_[slot].doc_) {
+        return false;
+    }
+    
+    entries_[slot] = Entry{};
+    --size_;
+    
+    // move back any later entries in the cluster which would no longer be found past the hole
+    for (auto next = (slot + 1) & mask_; !!entries_[next].doc_; next = (next + 1) & mask_) {
+        auto home = Slot(entries_[next].hash_);
+        
+        auto stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+        if (!stays) {
+            entries_[slot] = std::move(entries_[next]);
+            entries_[next] = Entry{};
+            slot = next;
+        }
+    }
+    
+    return true;
+}
+
+DocumentHashIndex::size_type DocumentHashIndex::size() const {
+    return size_;
+}
+
+DocumentHashIndex::size_type DocumentHashIndex::Slot(std::uint64_t hash) const {
+    // the low bits of the hash also pick the collection so the slot is taken from a fibonacci 
+    // multiply of the whole hash rather than from the low bits
+    return static_cast<size_type>((hash * 0x9E3779B97F4A7C15ull) >> shift_);
+}
+
+DocumentHashIndex::size_type DocumentHashIndex::Find(const char* id, std::uint64_t hash) const {
+    auto slot = Slot(hash);
+    
+    for (;;) {
+        const auto& entry = entries_[slot];
+        if (!entry.doc_ || (entry.hash_ == hash && std::strcmp(id, entry.doc_->getId()) == 0)) {
+            return slot;
+        }
+        
+        slot = (slot + 1) & mask_;
+    }
+}
+
+void DocumentHashIndex::Grow() {
+    std::vector<Entry> entries(entries_.size() * 2);
+    entries.swap(entries_);
+    
+    mask_ = entries_.size() - 1;
+    --shift_;
+    
+    for (auto& entry : entries) {
+        if (!!entry.doc_) {
+            auto slot = Slot(entry.hash_);
+            while (!!entries_[slot].doc_) {
+                slot = (slot + 1) & mask_;
+            }
+            
+            entries_[slot] = std::move(entry);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_DOCUMENT_HASH_INDEX_H
+#define RS_AVANCEDB_DOCUMENT_HASH_INDEX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+
+// an open addressing hash table of documents keyed by the CityHash of their id, it gives 
+// constant time point lookups instead of a binary search through the sorted chunks
+class DocumentHashIndex final {
+public:
+    using size_type = std::size_t;
+    
+    DocumentHashIndex();
+    
+    document_ptr find(const char* id, std::uint64_t hash) const;
+    
+    // replaces any document with the same id
+    void insert(const document_ptr& doc);
+    bool erase(const document_ptr& doc);
+    
+    size_type size() const;
+    
+private:
+    
+    struct Entry final {
+        std::uint64_t hash_;
+        document_ptr doc_;
+    };
+    
+    static const unsigned InitialBits = 4;
+    
+    size_type Slot(std::uint64_t hash) const;
+    size_type Find(const char* id, std::uint64_t hash) const;
+    void Grow();
+    
+    // an entry without a document is free, linear probing with backward shift deletion means 
+    // there are no tombstones so lookups never scan past the end of a cluster
+    std::vector<Entry> entries_;
+    size_type size_;
+    size_type mask_;
+    unsigned shift_;
+};
+
+#endif /* RS_AVANCEDB_DOCUMENT_HASH_INDEX_H */
+
@@ -19,7 +19,10 @@
 #include "documents.h"
 
 #include <algorithm>
-#include <type_traits>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
 
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
@@ -27,34 +30,140 @@
 
 #include "document.h"
 #include "document_collection.h"
-#include "document_collection_results.h"
 #include "rest_exceptions.h"
 #include "database.h"
 #include "document_revision.h"
 #include "config.h"
 #include "uuid_helper.h"
 #include "map_reduce_result.h"
-#include "base64_helper.h"
 #include "document_attachment.h"
+#include "map_reduce_thread_pool.h"
+#include "mango_query.h"
+#include "mango_index.h"
+#include "search_query.h"
 
 #include "script_object_vector_source.h"
 
-#include "md5.h"
 
-Documents::Documents(database_ptr db) : db_(db), docCount_(0),
+const unsigned Documents::MaxShards;
+const unsigned Documents::MaxUpdateRetries;
+
+static bool IsDesignDocument(const char* id) {
+    return std::strncmp(id, "_design/", 8) == 0;
+}
+
+// seconds since the epoch, the same as the tasks of the database reaper
+static std::uint64_t Now() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::seconds>(now).count();
+}
+
+static mango_index_ptr BuildReshardedIndex(const mango_index_ptr& index, const document_collections_ptr_array& colls) {
+    auto resharded = index->Reshard(colls.size());
+    for (unsigned i = 0; i < colls.size(); ++i) {
+        resharded->Build(i, *colls[i]->Snapshot());
+    }
+    
+    return resharded;
+}
+
+// search and spatial indexes take the documents as changes and index them when next queried
+template <typename T>
+static T QueueReshardedIndex(const T& index, const document_collections_ptr_array& colls) {
+    auto resharded = index->Reshard(colls.size());
+    for (unsigned i = 0; i < colls.size(); ++i) {
+        auto docs = colls[i]->Snapshot();
+        for (auto iter = docs->cbegin(), end = docs->cend(); iter != end; ++iter) {
+            resharded->Update(i, document_ptr{}, *iter);
+        }
+    }
+    
+    return resharded;
+}
+
+// pairs the current indexes with the ones resharded from the copied list, any not 
+// in the copied list is resharded by the given function
+template <typename T, typename F>
+static std::vector<T> MatchReshardedIndexes(const std::vector<T>& current, const std::vector<T>& copied, const std::vector<T>& resharded, const F& reshard) {
+    std::vector<T> indexes;
+    for (const auto& index : current) {
+        auto iter = std::find(copied.cbegin(), copied.cend(), index);
+        indexes.emplace_back(iter != copied.cend() ? resharded[iter - copied.cbegin()] : reshard(index));
+    }
+    
+    return indexes;
+}
+
+Documents::Shards::Shards(unsigned count) : count_(count), retired_(false) {
+    for (unsigned i = 0; i < count_; ++i) {
+        docs_.emplace_back(DocumentCollection::Create(Config::Data::HashIndex()));
+    }
+}
+
+Documents::Documents(database_ptr db, unsigned shards) : db_(db), docCount_(0),
         dataSize_(0), updateSeq_(0), localUpdateSeq_(0),
-        collections_(GetCollectionCount()),
-        allDocsCacheDocs_(boost::make_shared<document_array>()),
-        allDocsCacheUpdateSequence_(0),
-        localDocs_(DocumentCollection::Create()) {
+        autoShard_(shards == 0 && Config::Data::ShardThreshold() > 0),
+        shards_(boost::make_shared<Shards>(shards > 0 ? shards : (autoShard_ ? 1 : GetCollectionCount()))),
+        reshardTask_(),
+        localDocs_(DocumentCollection::Create()),
+        mapReduceResultsCache_(static_cast<MapReduceResultsCache::size_type>(Config::MapReduce::ResultsCacheSize()) * 1024 * 1024),
+        mapReduceIndexer_(boost::bind(&Documents::IndexView, this, _1, _2)) {
    
-    for (unsigned i = 0; i < collections_; ++i) {
-        docs_.emplace_back(DocumentCollection::Create(64, 32 * 1024));
-    }
 }
 
-documents_ptr Documents::Create(database_ptr db) {
-    return boost::make_shared<documents_ptr::element_type>(db);
+Documents::~Documents() {
+    JoinReshardThread();
+}
+
+documents_ptr Documents::Create(database_ptr db, unsigned shards) {
+    return boost::make_shared<documents_ptr::element_type>(db, shards);
+}
+
+unsigned Documents::getShardCount() {
+    return GetShards()->count_;
+}
+
+bool Documents::ReleaseShard(std::uint64_t& bytes) {
+    bytes = 0;
+    
+    // no request can reach the documents but the background threads still use them,
+    // once they are stopped nothing else reads the shards so they are changed in place
+    mapReduceIndexer_.Stop();
+    JoinReshardThread();
+    
+    // the collection count is left as it was, no reader can route to the missing collections
+    auto shards = GetShards();
+    if (shards->docs_.size() == 0) {
+        return false;
+    }
+    
+    // the indexes hold the documents too so their entries for the shard go first
+    auto index = static_cast<unsigned>(shards->docs_.size() - 1);
+    for (const auto& mangoIndex : indexes_) {
+        mangoIndex->Release(index);
+    }
+    
+    for (const auto& searchIndex : searchIndexes_) {
+        searchIndex->Release(index);
+    }
+    
+    for (const auto& spatialIndex : spatialIndexes_) {
+        spatialIndex->Release(index);
+    }
+    
+    auto coll = shards->docs_.back();
+    shards->docs_.pop_back();
+    
+    {
+        boost::shared_lock<DocumentCollection> lock{*coll};
+        auto docs = coll->Snapshot();
+        
+        for (auto iter = docs->cbegin(), end = docs->cend(); iter != end; ++iter) {
+            bytes += (*iter)->getDataSize();
+        }
+    }
+    
+    return true;
 }
 
 DocumentCollection::size_type Documents::getCount() {
@@ -70,12 +179,13 @@ sequence_type Documents::getUpdateSequence() {
 }
 
 document_ptr Documents::GetDocument(const char* id, bool throwOnFail) {
-    auto coll = GetDocumentCollectionIndex(id);
+    // retired shards still hold every document as it was when they were replaced
+    auto shards = GetShards();
+    auto coll = GetDocumentCollectionIndex(*shards, id);
     
-    boost::lock_guard<DocumentCollection> guard{*docs_[coll]};
+    boost::shared_lock<DocumentCollection> lock{*shards->docs_[coll]};
     
-    Document::Compare compare{id};
-    auto doc = docs_[coll]->find_fn(compare);
+    auto doc = shards->docs_[coll]->find(id);
     
     if (!doc && throwOnFail) {
         throw DocumentMissing{};
@@ -85,12 +195,32 @@ document_ptr Documents::GetDocument(const char* id, bool throwOnFail) {
 }
 
 document_ptr Documents::DeleteDocument(const char* id, const char* rev) {
-    auto coll = GetDocumentCollectionIndex(id);
+    auto validators = GetValidators(id);
+    document_ptr validatedDoc;
+    if (!!validators) {
+        // like CouchDB the validators see a deletion as a stub with _deleted set, as with 
+        // SetDocument they run without the lock so the document must not change meanwhile
+        validatedDoc = GetDocument(id, false);
+        if (!!validatedDoc) {
+            rs::scriptobject::utils::ScriptObjectVectorSource deletedSource({
+                std::make_pair("_id", id),
+                std::make_pair("_rev", rev),
+                std::make_pair("_deleted", true)
+            });
+            
+            auto deletedObj = rs::scriptobject::ScriptObjectFactory::CreateObject(deletedSource);
+            
+            DesignFunctions::Execute([&](rs::jsapi::Context& cx, std::size_t threadId) {
+                ValidateDocument(cx, threadId, *validators, id, deletedObj, validatedDoc);
+            });
+        }
+    }
     
-    boost::lock_guard<DocumentCollection> guard{*docs_[coll]};
+    shards_ptr shards;
+    unsigned coll;
+    auto lock = LockDocumentCollection(id, shards, coll);
     
-    Document::Compare compare{id};
-    auto doc = docs_[coll]->find_fn(compare);
+    auto doc = shards->docs_[coll]->find(id);
     
     if (!doc) {
         throw DocumentMissing{};
@@ -99,63 +229,120 @@ document_ptr Documents::DeleteDocument(const char* id, const char* rev) {
     DocumentRevision::Validate(rev, true);
     
     auto docRev = doc->getRev();
-    if (std::strcmp(rev, docRev) != 0) {
+    if (std::strcmp(rev, docRev) != 0 || (!!validators && doc != validatedDoc)) {
         throw DocumentConflict{};
     }
     
-    docs_[coll]->erase(doc);
+    shards->docs_[coll]->erase(doc);
+    UpdateIndexes(coll, doc, document_ptr{});
     
     ++updateSeq_;
     docCount_.fetch_sub(1, boost::memory_order_relaxed);
-    dataSize_.fetch_sub(doc->getObject()->getSize(true), boost::memory_order_relaxed);
+    dataSize_.fetch_sub(doc->getDataSize(), boost::memory_order_relaxed);
     
     return doc;
 }
 
 document_ptr Documents::SetDocument(const char* id, script_object_ptr obj) {
-    auto coll = GetDocumentCollectionIndex(id);
+    auto validators = GetValidators(id);
+    if (!!validators) {
+        // validation runs without the collection lock, the revision check when storing 
+        // ensures the document it was validated against is still the one being replaced
+        auto oldDoc = GetDocument(id, false);
+        DesignFunctions::Execute([&](rs::jsapi::Context& cx, std::size_t threadId) {
+            ValidateDocument(cx, threadId, *validators, id, obj, oldDoc);
+        });
+    }
     
-    boost::unique_lock<DocumentCollection> lock{*docs_[coll]};
+    shards_ptr shards;
+    unsigned coll;
+    auto lock = LockDocumentCollection(id, shards, coll);
     
-    Document::Compare compare{id};
-    auto oldDoc = docs_[coll]->find_fn(compare);
+    auto oldDoc = shards->docs_[coll]->find(id);
     
-    auto objRev = obj->getString("_rev", false);
+    auto newDoc = StoreDocument(*shards, coll, id, obj, oldDoc);
+    
+    lock.unlock();
+    
+    UpdateStatistics(oldDoc, newDoc);
 
-    if (!!oldDoc) {
-        auto docRev = oldDoc->getRev();
+    return newDoc;
+}
+
+document_ptr Documents::UpdateDocument(const char* id, const char* function, script_object_ptr req, DesignFunctions::Response& response) {
+    if (id == nullptr) {
+        script_object_ptr obj;
+        DesignFunctions::Execute([&](rs::jsapi::Context& cx, std::size_t threadId) {
+            obj = DesignFunctions::Update(cx, threadId, function, document_ptr{}, req, response);
+        });
         
-        if (objRev == nullptr || std::strcmp(objRev, docRev) != 0) {
-            throw DocumentConflict{};
+        if (!obj) {
+            return document_ptr{};
         }
-    } else if (objRev != nullptr) {
-        DocumentRevision::Validate(objRev, true);
+        
+        // there is nothing to lock until the function has named its document
+        UuidHelper::UuidString uuidString;
+        auto newId = obj->getString("_id", false);
+        if (!newId) {
+            UuidHelper::UuidGenerator gen;
+            UuidHelper::FormatUuid(gen(), uuidString);
+            newId = uuidString.data();
+        }
+        
+        return SetDocument(newId, obj);
     }
-
-    auto newDoc = Document::Create(id, obj, ++updateSeq_);
-
-    docs_[coll]->insert(newDoc);
     
-    lock.unlock();
+    auto validators = GetValidators(id);
     
-    if (!oldDoc) {
-        docCount_.fetch_add(1, boost::memory_order_relaxed);
-    } else {
-        dataSize_.fetch_sub(oldDoc->getObject()->getSize(true), boost::memory_order_relaxed);
+    // the function and the validators run without the collection lock, when the document
+    // changes meanwhile the update is run again against the new revision like SetDocument 
+    // does the revision check when storing, once the retries are used up it's a conflict
+    for (unsigned attempt = 0; ; ++attempt) {
+        auto oldDoc = GetDocument(id, false);
+        
+        DesignFunctions::Response attemptResponse;
+        script_object_ptr obj;
+        DesignFunctions::Execute([&](rs::jsapi::Context& cx, std::size_t threadId) {
+            obj = DesignFunctions::Update(cx, threadId, function, oldDoc, req, attemptResponse);
+            if (!!obj && !!validators) {
+                ValidateDocument(cx, threadId, *validators, id, obj, oldDoc);
+            }
+        });
+        
+        if (!obj) {
+            response = attemptResponse;
+            return document_ptr{};
+        }
+        
+        shards_ptr shards;
+        unsigned coll;
+        auto lock = LockDocumentCollection(id, shards, coll);
+        
+        if (shards->docs_[coll]->find(id) != oldDoc) {
+            if (attempt < MaxUpdateRetries) {
+                continue;
+            }
+            
+            throw DocumentConflict{};
+        }
+        
+        auto newDoc = StoreDocument(*shards, coll, id, obj, oldDoc);
+        
+        lock.unlock();
+        
+        response = attemptResponse;
+        UpdateStatistics(oldDoc, newDoc);
+        
+        return newDoc;
     }
-    
-    dataSize_.fetch_add(newDoc->getObject()->getSize(true), boost::memory_order_relaxed);
-
-    return newDoc;
 }
 
 document_ptr Documents::SetDocumentAttachment(const char* id, const char* rev, const char* name, const char* contentType, const std::vector<unsigned char>& attachment) {
-    auto coll = GetDocumentCollectionIndex(id);
+    shards_ptr shards;
+    unsigned coll;
+    auto lock = LockDocumentCollection(id, shards, coll);
     
-    boost::unique_lock<DocumentCollection> lock{*docs_[coll]};
-    
-    Document::Compare compare{id};
-    auto oldDoc = docs_[coll]->find_fn(compare);
+    auto oldDoc = shards->docs_[coll]->find(id);
     if (!oldDoc) {
         throw DocumentMissing{};
     }
@@ -166,21 +353,15 @@ document_ptr Documents::SetDocumentAttachment(const char* id, const char* rev, c
     
     auto oldRev = DocumentRevision::Parse(rev);
     
-    auto encodedAttachment = Base64Helper::Encode(attachment);
-    
-    MD5 md5;
-    md5.update(attachment.data(), attachment.size());
-    md5.finalize();
-    std::vector<unsigned char> digest(16);
-    md5.bindigest(digest.data());
-    auto encodedDigest = std::string("md5-") + Base64Helper::Encode(digest).data();
+    // the body is kept as raw bytes beside the document, only a stub goes into the object
+    auto encodedDigest = DocumentAttachment::FormatDigest(attachment.data(), attachment.size());
     
     rs::scriptobject::utils::ScriptObjectVectorSource newAttachmentSource({
         std::make_pair("content_type", contentType),
         std::make_pair("revpos", oldRev.getVersion() + 1),
         std::make_pair("digest", encodedDigest.data()),
-        std::make_pair("data", encodedAttachment.c_str()),
-        std::make_pair("length", attachment.size())
+        std::make_pair("length", attachment.size()),
+        std::make_pair("stub", true)
     });
     
     auto newAttachmentObj = rs::scriptobject::ScriptObjectFactory::CreateObject(newAttachmentSource, true);
@@ -207,13 +388,16 @@ document_ptr Documents::SetDocumentAttachment(const char* id, const char* rev, c
     newAttachmentsObj = rs::scriptobject::ScriptObject::Merge(oldDoc->getObject(), newAttachmentsObj, rs::scriptobject::ScriptObject::MergeStrategy::Back);
     
     auto newDoc = Document::Create(id, newAttachmentsObj, ++updateSeq_);
+    newDoc->setAttachment(DocumentAttachment::Create(name, contentType, encodedDigest.c_str(), std::vector<unsigned char>(attachment)));
+    newDoc->inheritAttachments(oldDoc);
 
-    docs_[coll]->insert(newDoc);
+    shards->docs_[coll]->insert(newDoc);
+    UpdateIndexes(coll, oldDoc, newDoc);
     
     lock.unlock();
 
-    dataSize_.fetch_sub(oldDoc->getObject()->getSize(true), boost::memory_order_relaxed);    
-    dataSize_.fetch_add(newDoc->getObject()->getSize(true), boost::memory_order_relaxed);
+    dataSize_.fetch_sub(oldDoc->getDataSize(), boost::memory_order_relaxed);    
+    dataSize_.fetch_add(newDoc->getDataSize(), boost::memory_order_relaxed);
 
     return newDoc;
 }
@@ -230,12 +414,11 @@ document_attachment_ptr Documents::GetDocumentAttachment(const char* id, const c
 }
 
 document_ptr Documents::DeleteDocumentAttachment(const char* id, const char* rev, const char* name) {
-    auto coll = GetDocumentCollectionIndex(id);
+    shards_ptr shards;
+    unsigned coll;
+    auto lock = LockDocumentCollection(id, shards, coll);
     
-    boost::unique_lock<DocumentCollection> lock{*docs_[coll]};
-    
-    Document::Compare compare{id};
-    auto oldDoc = docs_[coll]->find_fn(compare);
+    auto oldDoc = shards->docs_[coll]->find(id);
     if (!oldDoc) {
         throw DocumentMissing{};
     }
@@ -271,13 +454,15 @@ document_ptr Documents::DeleteDocumentAttachment(const char* id, const char* rev
     }
     
     auto newDoc = Document::Create(id, newDocObj, ++updateSeq_);
+    newDoc->inheritAttachments(oldDoc);
 
-    docs_[coll]->insert(newDoc);
+    shards->docs_[coll]->insert(newDoc);
+    UpdateIndexes(coll, oldDoc, newDoc);
     
     lock.unlock();
 
-    dataSize_.fetch_sub(oldDocObj->getSize(true), boost::memory_order_relaxed);
-    dataSize_.fetch_add(newDoc->getObject()->getSize(true), boost::memory_order_relaxed);
+    dataSize_.fetch_sub(oldDoc->getDataSize(), boost::memory_order_relaxed);
+    dataSize_.fetch_add(newDoc->getDataSize(), boost::memory_order_relaxed);
 
     return newDoc;    
 }
@@ -300,108 +485,62 @@ document_ptr Documents::SetDesignDocument(const char* id, script_object_ptr obj)
     return SetDocument(designId.c_str(), obj);
 }
 
-document_array_ptr Documents::GetDocuments(sequence_type& updateSequence) {
-    boost::unique_lock<decltype(allDocsCacheMtx_)> guard(allDocsCacheMtx_);
-    updateSequence = allDocsCacheUpdateSequence_;
-    
-    if (allDocsCacheUpdateSequence_ == updateSeq_) {
-        return allDocsCacheDocs_;
-    } else {
-        auto count = getCount();
-
-        auto allDocs = boost::make_shared<document_array>();
-        allDocs->reserve(count);
-        
-        updateSequence = updateSeq_;
-        allDocsCacheUpdateSequence_ = updateSequence;
-
-        for (unsigned i = 0; i < collections_; ++i) {
-            auto oldSize = allDocs->size();
-            boost::unique_lock<DocumentCollection> lock{*docs_[i]};
-            allDocs->insert(allDocs->end(), docs_[i]->cbegin(), docs_[i]->cend());
-            lock.unlock();
-            
-            if (i > 0) {
-                std::inplace_merge(allDocs->begin(), allDocs->begin() + oldSize, allDocs->end(), Document::Less{});
-            }
-        }
-
-        allDocsCacheDocs_ = allDocs;
-
-        return allDocs;
-    }
-}
-
 document_array_ptr Documents::GetDocuments(const GetAllDocumentsOptions& options, DocumentCollection::size_type& offset, DocumentCollection::size_type& totalDocs, sequence_type& updateSequence) {
-    offset = 0;    
-    totalDocs = 0;
-    updateSequence = updateSeq_;
+    auto iter = GetDocumentsIterator(options, updateSequence);
     
     auto results = boost::make_shared<document_array>();
-    
-    auto skip = options.Skip();
-    auto limit = options.Limit();
-    
-    for (unsigned i = 0; i < collections_; ++i) {
-        boost::unique_lock<DocumentCollection> lock{*docs_[i]};
-        DocumentCollectionResults filteredResults{docs_[i], skip + std::min(limit, docs_[i]->size()), options.Key().c_str(),
-            options.StartKey().c_str(), options.EndKey().c_str(), options.InclusiveEnd(), options.Descending()};
-
-        if (i == 0) {
-            results->reserve(filteredResults.FilteredRows() * collections_);
-        }
-
-        auto oldSize = results->size();
-        results->insert(results->end(), filteredResults.cbegin(), filteredResults.cend());        
-        offset += filteredResults.Offset();
-        totalDocs += filteredResults.TotalRows();
-        lock.unlock();
-
-        if (i > 0) {
-            std::inplace_merge(results->begin(), results->begin() + oldSize, results->end(), Document::Less{});
-        }
-    }
-
-    // TODO: this should be optimized out
-    if (options.Descending()) {
-        results = boost::make_shared<document_array>(results->begin(), results->end());
-        std::reverse(results->begin(), results->end());
+    for (auto doc = iter.Next(); !!doc; doc = iter.Next()) {
+        results->emplace_back(doc);
     }
     
-    // TODO: this should be optimized out
-    limit = std::min(limit, results->size());
-    if ((skip > 0 && skip < results->size()) || limit < results->size()) {
-        auto startIndex = std::min(skip, results->size());
-        auto endIndex = std::min(skip + limit, results->size());
-        results = boost::make_shared<document_array>(results->cbegin() + startIndex, results->cbegin() + endIndex);
-        offset += startIndex;
-    } else if (skip >= results->size()) {
-        offset += results->size();
-        results = boost::make_shared<document_array>();
-    }
+    offset = iter.Offset();
+    totalDocs = iter.TotalRows();
     
     return results;
 }
 
+DocumentCollectionMergedResultsIterator Documents::GetDocumentsIterator(const GetAllDocumentsOptions& options, sequence_type& updateSequence) {
+    updateSequence = updateSeq_;
+    return DocumentCollectionMergedResultsIterator{GetShards()->docs_, options};
+}
+
 document_array_ptr Documents::PostDocuments(const PostAllDocumentsOptions& options, DocumentCollection::size_type& totalDocs, sequence_type& updateSequence) {
-    auto docs = GetDocuments(updateSequence);
-    
     const auto& keys = options.Keys();
+    auto keysCount = keys.size();
+    
+    // a key can only be stored in one collection so it is looked up there directly rather than in 
+    // a merged copy of every collection, the keys are grouped so each collection is locked once
+    auto shards = GetShards();
+    std::vector<std::string> ids(keysCount);
+    std::vector<std::vector<std::size_t>> collectionKeys(shards->count_);
+    
+    for (decltype(keysCount) i = 0; i < keysCount; ++i) {
+        const auto& key = keys[i];
+        if (key.size() > 0) {
+            if (key.size() > 1 && key.front() == '"' && key.back() == '"') {
+                ids[i].assign(key, 1, key.size() - 2);
+            } else {
+                ids[i] = key;
+            }
+            
+            collectionKeys[GetDocumentCollectionIndex(*shards, ids[i].c_str())].push_back(i);
+        }
+    }
     
-    auto results = boost::make_shared<document_array>();
-    results->reserve(keys.size());
+    auto results = boost::make_shared<document_array>(keysCount);
     
-    for (auto key : keys) {
-        auto index = key.size() > 0 ? FindDocument(*docs, key, false) : FindMissedFlag;
-        if ((index & FindMissedFlag) == 0) {
-            auto doc = (*docs)[index];
-            results->emplace_back(doc);
-        } else {
-            results->emplace_back(nullptr);
+    updateSequence = updateSeq_;
+    for (unsigned i = 0; i < shards->count_; ++i) {
+        if (collectionKeys[i].size() > 0) {
+            boost::shared_lock<DocumentCollection> lock{*shards->docs_[i]};
+            
+            for (auto index : collectionKeys[i]) {
+                (*results)[index] = shards->docs_[i]->find(ids[index].c_str());
+            }
         }
     }
     
-    totalDocs = docs->size();
+    totalDocs = getCount();
     
     if (options.Descending()) {
         std::reverse(results->begin(), results->end());
@@ -424,16 +563,18 @@ document_array_ptr Documents::PostDocuments(const PostAllDocumentsOptions& optio
 }
 
 BulkDocumentsResults Documents::PostBulkDocuments(script_array_ptr docs, bool newEdits) {
-    using collections_size_type = std::remove_const<decltype(collections_)>::type;
+    auto docsCount = docs->getCount();
     
-    // a global collection start index counter - we use this to avoid lock collisions
-    // when dealing with multiple inbound bulk requests
-    static std::atomic<collections_size_type> rollingStartIndex{collections_};
+    // a batch which takes a database in its single collection past the threshold is split 
+    // before it's stored, otherwise the whole batch would be written under a single lock
+    if (autoShard_.load(boost::memory_order_relaxed) && getCount() + docsCount > Config::Data::ShardThreshold() && autoShard_.exchange(false)) {
+        ReshardCollections(GetCollectionCount());
+    }
     
-    auto docsCount = docs->getCount();
+    auto shards = GetShards();
     
     // calculate a suitable size for each of the pending collections
-    auto pendingCollSizeEstimate = (docsCount / collections_) + collections_;
+    auto pendingCollSizeEstimate = (docsCount / shards->count_) + shards->count_;
     
     struct PendingDoc final {
         PendingDoc(std::size_t resultIndex, const char* id, const char* rev, script_object_ptr doc) :
@@ -446,7 +587,7 @@ BulkDocumentsResults Documents::PostBulkDocuments(script_array_ptr docs, bool ne
         const script_object_ptr doc_;
     };
     using PendingDocs = std::vector<PendingDoc>;
-    std::vector<PendingDocs> pendingDocs(collections_);
+    std::vector<PendingDocs> pendingDocs(shards->count_);
     std::vector<UuidHelper::UuidString> uuids(docsCount);
     BulkDocumentsResults results(docsCount);
 
@@ -455,7 +596,7 @@ BulkDocumentsResults Documents::PostBulkDocuments(script_array_ptr docs, bool ne
     
     // reserve space for the pending documents
     for (decltype(pendingDocs.size()) i = 0; i < pendingDocs.size(); ++i) {
-        pendingDocs.reserve(pendingCollSizeEstimate);
+        pendingDocs[i].reserve(pendingCollSizeEstimate);
     }
     
     // store the pending documents in sharded collections
@@ -474,46 +615,146 @@ BulkDocumentsResults Documents::PostBulkDocuments(script_array_ptr docs, bool ne
             id = uuids[i].data();
         }
         
-        auto coll = GetDocumentCollectionIndex(id);
+        auto coll = GetDocumentCollectionIndex(*shards, id);
         pendingDocs[coll].emplace_back(i, id, objRev, obj);
     }
-
-    // loop through the pending collections inserting the docs into the db
-    for (collections_size_type i = 0, startIndex = --rollingStartIndex; i < collections_; ++i, ++startIndex) {
-        // calculate which collection we will be inserting into
-        auto index = startIndex % collections_;
+    
+    auto validators = GetValidators(nullptr);
+    std::string dbName;
+    if (!!validators) {
+        auto db = db_.lock();
+        dbName = !!db ? db->Name() : "";
+    }
+    
+    // each collection is written by its own pool task, the documents are validated and their 
+    // revisions hashed before the collection lock is taken exclusively for the inserts
+    ForEachCollection(*shards, [&](unsigned index, std::size_t threadId) {
+        auto& collPendingDocs = pendingDocs[index];
+        if (collPendingDocs.size() == 0) {
+            return;
+        }
+        
+        DesignFunctions::validation_array validations;
+        if (!!validators) {
+            validations.reserve(collPendingDocs.size());
+            
+            {
+                boost::shared_lock<DocumentCollection> lock{*shards->docs_[index]};
+                for (const auto& pendingDoc : collPendingDocs) {
+                    if (!IsDesignDocument(pendingDoc.id_)) {
+                        validations.emplace_back(pendingDoc.id_, pendingDoc.doc_, shards->docs_[index]->find(pendingDoc.id_));
+                    }
+                }
+            }
+            
+            auto& cx = MapReduceThreadPool::Get()->GetThreadContext(threadId);
+            DesignFunctions::Validate(cx, threadId, *validators, dbName.c_str(), validations);
+        }
         
-        // lock the collection
-        boost::lock_guard<DocumentCollection> lock{*docs_[index]};
+        struct PreparedDoc final {
+            const char* error_;
+            const char* reason_;
+            DocumentRevision::RevString rev_;
+            document_ptr doc_;
+            
+            // the document the validators saw, only set when they ran
+            bool validated_;
+            document_ptr validatedOldDoc_;
+        };
+        
+        std::vector<PreparedDoc> preparedDocs(collPendingDocs.size());
+        
+        // the validations are in pending document order without the design documents
+        auto validation = validations.cbegin();
         
-        // for each of the pendingDocs in the collection
-        for (auto pendingDoc : pendingDocs[index]) {
+        for (decltype(collPendingDocs.size()) i = 0; i < collPendingDocs.size(); ++i) {
+            const auto& pendingDoc = collPendingDocs[i];
+            auto& preparedDoc = preparedDocs[i];
+            
+            // check the document was accepted by the validators
+            preparedDoc.error_ = nullptr;
+            preparedDoc.reason_ = nullptr;
+            preparedDoc.validated_ = false;
+            if (!!validators && !IsDesignDocument(pendingDoc.id_)) {
+                preparedDoc.validated_ = true;
+                preparedDoc.validatedOldDoc_ = validation->oldDoc_;
+                
+                if (validation->error_.size() > 0) {
+                    preparedDoc.error_ = validation->error_.c_str();
+                    preparedDoc.reason_ = validation->reason_.c_str();
+                }
+                
+                ++validation;
+            }
+            
+            if (!preparedDoc.error_) {
+                // creating the doc can rewrite the submitted rev so it's kept for the conflict check
+                preparedDoc.rev_[0] = '\0';
+                if (pendingDoc.rev_ != nullptr) {
+                    std::strncpy(preparedDoc.rev_.data(), pendingDoc.rev_, preparedDoc.rev_.size() - 1);
+                    preparedDoc.rev_.back() = '\0';
+                }
+                
+                // the update sequence is only known once the collection is locked
+                preparedDoc.doc_ = Document::Create(pendingDoc.id_, pendingDoc.doc_, 0, newEdits);
+            }
+        }
+        
+        // the shared counters are updated once for the whole batch rather than once per document
+        document_array insertedDocs;
+        insertedDocs.reserve(collPendingDocs.size());
+        
+        DocumentCollection::size_type newDocCount = 0;
+        std::uint64_t addedDataSize = 0;
+        std::uint64_t removedDataSize = 0;
+        
+        // the caller holds the lock of the collection the document belongs in
+        auto storeDoc = [&](DocumentCollection& collection, unsigned coll, std::size_t i) {
+            const auto& pendingDoc = collPendingDocs[i];
+            auto& preparedDoc = preparedDocs[i];
+            
+            auto error = preparedDoc.error_;
+            auto reason = preparedDoc.reason_;
             
             // find an existing doc
-            Document::Compare compare{pendingDoc.id_};
-            auto oldDoc = docs_[index]->find_fn(compare);
+            auto oldDoc = collection.find(pendingDoc.id_);
             auto gotOldDoc = !!oldDoc;
             
+            // the validators ran before the lock was taken, a document replaced since then is a conflict 
+            // since the new one was never validated against it, with new_edits=false nothing else checks
+            if (!error && preparedDoc.validated_ && oldDoc != preparedDoc.validatedOldDoc_) {
+                error = "conflict";
+                reason = "Document update conflict.";
+            }
+            
             // check the existing rev matches
-            const char* error = nullptr;
-            const char* reason = nullptr;
-            if (gotOldDoc && newEdits) {
+            if (!error && gotOldDoc && newEdits) {
                 auto oldRev = oldDoc->getRev();
 
-                if (pendingDoc.rev_ == nullptr || std::strcmp(pendingDoc.rev_, oldRev) != 0) {
+                if (pendingDoc.rev_ == nullptr || std::strcmp(preparedDoc.rev_.data(), oldRev) != 0) {
                     error = "conflict";
                     reason = "Document update conflict.";
                 }
             }
             
+            const auto& newDoc = preparedDoc.doc_;
+            
+            // attachment stubs pick up their bodies from the revision being replaced
+            if (!error) {
+                try {
+                    newDoc->inheritAttachments(oldDoc);
+                } catch (const MissingStub&) {
+                    error = "missing_stub";
+                    reason = "Invalid attachment stub.";
+                }
+            }
+            
             // if we don't have an error we can do the insert
             if (!error) {
-                // create the doc
-                auto newDoc = Document::Create(pendingDoc.id_, pendingDoc.doc_, ++updateSeq_, newEdits);
-                
                 // insert into the collection
-                auto insertHint = !gotOldDoc ? DocumentCollection::insert_hint::new_item : DocumentCollection::insert_hint::no_hint;
-                docs_[index]->insert(newDoc, insertHint);
+                collection.insert(newDoc);
+                UpdateIndexes(coll, oldDoc, newDoc);
+                insertedDocs.push_back(newDoc);
 
                 // get the new doc rev and update the results collection
                 auto newRev = newDoc->getRev();
@@ -521,18 +762,67 @@ BulkDocumentsResults Documents::PostBulkDocuments(script_array_ptr docs, bool ne
 
                 // update the doc count and db size counters
                 if (!oldDoc) {
-                    docCount_.fetch_add(1, boost::memory_order_relaxed);
+                    ++newDocCount;
                 } else {
-                    dataSize_.fetch_sub(oldDoc->getObject()->getSize(true), boost::memory_order_relaxed);
+                    removedDataSize += oldDoc->getDataSize();
                 }
 
-                dataSize_.fetch_add(newDoc->getObject()->getSize(true), boost::memory_order_relaxed);
+                addedDataSize += newDoc->getDataSize();
             } else {
                 // store the error in the results
                 results[pendingDoc.resultIndex_] = BulkDocumentsResults::value_type{pendingDoc.id_, error, reason};
             }  
+        };
+        
+        // the batch reserves a block of update sequences, nothing can read the documents before 
+        // the lock is released so they are numbered in insertion order without any gaps
+        auto publishDocs = [&]() {
+            if (insertedDocs.size() > 0) {
+                auto updateSeq = updateSeq_.fetch_add(insertedDocs.size());
+                for (const auto& newDoc : insertedDocs) {
+                    newDoc->setUpdateSequence(++updateSeq);
+                }
+
+                docCount_.fetch_add(newDocCount, boost::memory_order_relaxed);
+                dataSize_.fetch_add(addedDataSize, boost::memory_order_relaxed);
+                dataSize_.fetch_sub(removedDataSize, boost::memory_order_relaxed);
+                
+                if (newDocCount > 0) {
+                    CheckShardThreshold();
+                }
+                
+                insertedDocs.clear();
+                newDocCount = 0;
+                addedDataSize = 0;
+                removedDataSize = 0;
+            }
+        };
+        
+        {
+            // lock the collection
+            boost::lock_guard<DocumentCollection> lock{*shards->docs_[index]};
+            
+            if (!shards->retired_) {
+                for (decltype(collPendingDocs.size()) i = 0; i < collPendingDocs.size(); ++i) {
+                    storeDoc(*shards->docs_[index], index, i);
+                }
+                
+                publishDocs();
+                return;
+            }
         }
-    }
+        
+        // the database was resharded while the documents were prepared so each 
+        // is stored in whichever of the current collections now holds its id
+        for (decltype(collPendingDocs.size()) i = 0; i < collPendingDocs.size(); ++i) {
+            shards_ptr currentShards;
+            unsigned coll;
+            auto lock = LockDocumentCollection(collPendingDocs[i].id_, currentShards, coll);
+            
+            storeDoc(*currentShards->docs_[coll], coll, i);
+            publishDocs();
+        }
+    });
     
     return results;
 }
@@ -540,8 +830,7 @@ BulkDocumentsResults Documents::PostBulkDocuments(script_array_ptr docs, bool ne
 document_ptr Documents::GetLocalDocument(const char* id) {
     boost::lock_guard<DocumentCollection> guard{*localDocs_};
     
-    Document::Compare compare{id};
-    auto doc = localDocs_->find_fn(compare);
+    auto doc = localDocs_->find(id);
     
     if (!doc) {
         throw DocumentMissing{};
@@ -553,8 +842,7 @@ document_ptr Documents::GetLocalDocument(const char* id) {
 document_ptr Documents::SetLocalDocument(const char* id, script_object_ptr obj) {
     boost::lock_guard<DocumentCollection> guard{*localDocs_};
     
-    Document::Compare compare{id};
-    auto doc = localDocs_->find_fn(compare);
+    auto doc = localDocs_->find(id);
     
     const char* objRev = obj->getString("_rev", false);
 
@@ -578,8 +866,7 @@ document_ptr Documents::SetLocalDocument(const char* id, script_object_ptr obj)
 document_ptr Documents::DeleteLocalDocument(const char* id, const char* rev) {
     boost::lock_guard<DocumentCollection> guard{*localDocs_};
     
-    Document::Compare compare{id};
-    auto doc = localDocs_->find_fn(compare);
+    auto doc = localDocs_->find(id);
     
     if (!doc) {
         throw DocumentMissing{};
@@ -597,66 +884,802 @@ document_ptr Documents::DeleteLocalDocument(const char* id, const char* rev) {
     return doc;
 }
 
-map_reduce_results_ptr Documents::PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj) {        
-    document_collections_ptr_array colls{docs_.cbegin(), docs_.cend()};
+document_array_ptr Documents::FindDocuments(const MangoQuery& query) {
+    const auto skip = query.Skip();
+    const auto limit = query.Limit();
+    const auto maxRows = limit < std::numeric_limits<decltype(limit)>::max() - skip ? skip + limit : limit;
     
-    auto task = MapReduce::MapReduceTask::Create(obj);
+    auto less = [&](const document_ptr& a, const document_ptr& b) { return query.Less(a, b); };
+    const auto& selector = query.Selector();
+    
+    // when an index covers the selector only its matching range is read from each shard
+    shards_ptr shards;
+    auto index = PlanFindDocuments(query, shards);
+    
+    std::vector<document_array> shardResults(shards->count_);
+    
+    // the selector is evaluated natively on each shard in the map/reduce pool, 
+    // no shard needs to keep more than skip + limit of its matches
+    ForEachCollection(*shards, [&](unsigned i, std::size_t) {
+        document_array docs;
+        document_collection_snapshot_ptr snapshot;
+        
+        {
+            // a full scan reads a snapshot so the shard isn't held while the selector runs
+            boost::shared_lock<DocumentCollection> lock{*shards->docs_[i]};
+            if (!!index) {
+                index->Find(i, selector, docs);
+            } else {
+                snapshot = shards->docs_[i]->Snapshot();
+            }
+        }
+        
+        auto& results = shardResults[i];
+        if (!!snapshot) {
+            for (auto iter = snapshot->cbegin(), end = snapshot->cend(); iter != end; ++iter) {
+                if (query.Match(*iter)) {
+                    results.emplace_back(*iter);
+                }
+            }
+        } else {
+            for (const auto& doc : docs) {
+                if (query.Match(doc)) {
+                    results.emplace_back(doc);
+                }
+            }
+        }
+        
+        if (results.size() > maxRows) {
+            std::partial_sort(results.begin(), results.begin() + maxRows, results.end(), less);
+            results.resize(maxRows);
+        } else {
+            std::sort(results.begin(), results.end(), less);
+        }
+    });
+    
+    auto results = boost::make_shared<document_array>();
+    for (auto& shardResult : shardResults) {
+        auto oldSize = results->size();
+        results->insert(results->end(), shardResult.cbegin(), shardResult.cend());
+        std::inplace_merge(results->begin(), results->begin() + oldSize, results->end(), less);
+    }
+    
+    auto startIndex = std::min<std::uint64_t>(skip, results->size());
+    auto endIndex = std::min<std::uint64_t>(maxRows, results->size());
+    if (startIndex > 0 || endIndex < results->size()) {
+        results = boost::make_shared<document_array>(results->cbegin() + startIndex, results->cbegin() + endIndex);
+    }
     
-    auto results = mapReduce_.Execute(options, task, colls);    
     return results;
 }
 
-DocumentCollection::size_type Documents::FindDocument(const document_array& docs, const std::string& key, bool descending) {
-    const auto size = docs.size();
+mango_index_ptr Documents::PlanFindDocuments(const MangoQuery& query) {
+    shards_ptr shards;
+    return PlanFindDocuments(query, shards);
+}
+
+mango_index_ptr Documents::PlanFindDocuments(const MangoQuery& query, shards_ptr& shards) {
+    boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+    
+    shards = GetShards();
+    
+    mango_index_ptr bestIndex;
+    unsigned bestScore = 0;
+    
+    for (const auto& index : indexes_) {
+        auto score = index->Score(query.Selector());
+        if (score > bestScore) {
+            bestIndex = index;
+            bestScore = score;
+        }
+    }
+    
+    return bestIndex;
+}
+
+mango_index_ptr Documents::CreateIndex(script_object_ptr definition, bool& created) {
+    created = false;
+    
+    boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+    
+    auto shards = GetShards();
+    auto index = MangoIndex::Create(definition, shards->count_);
+    
+    mango_index_array indexes;
+    for (const auto& existing : indexes_) {
+        if (existing->IsSameDefinition(*index)) {
+            return existing;
+        }
+        
+        // an index with the same name but a different definition is replaced
+        if (existing->Name() != index->Name() || existing->DesignId() != index->DesignId()) {
+            indexes.push_back(existing);
+        }
+    }
+    
+    // hold every collection lock so that no update can miss the index while it's built
+    auto locks = LockCollections(*shards);
+    
+    for (unsigned i = 0; i < shards->count_; ++i) {
+        index->Build(i, *shards->docs_[i]->Snapshot());
+    }
+    
+    indexes.push_back(index);
+    indexes_.swap(indexes);
+    
+    created = true;
+    return index;
+}
+
+bool Documents::DeleteIndex(const char* designId, const char* name) {
+    boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+    
+    auto iter = std::find_if(indexes_.begin(), indexes_.end(), [&](const mango_index_ptr& index) {
+        return index->DesignId() == designId && index->Name() == name;
+    });
+    
+    auto found = iter != indexes_.end();
+    if (found) {
+        auto locks = LockCollections(*GetShards());
+        indexes_.erase(iter);
+    }
     
-    if (size == 0) {
-        return ~0;
+    return found;
+}
+
+mango_index_array Documents::GetIndexes() {
+    boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+    return indexes_;
+}
+
+search_index_ptr Documents::GetSearchIndex(const char* designId, const char* name, const char* function) {
+    boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+    
+    auto iter = std::find_if(searchIndexes_.begin(), searchIndexes_.end(), [&](const search_index_ptr& index) {
+        return index->DesignId() == designId && index->Name() == name;
+    });
+    
+    if (iter != searchIndexes_.end() && (*iter)->Function() == function) {
+        return *iter;
+    }
+    
+    // the existing documents are queued as changes, the first search indexes them
+    auto shards = GetShards();
+    auto index = SearchIndex::Create(designId, name, function, shards->count_);
+    auto locks = LockCollections(*shards);
+    
+    for (unsigned i = 0; i < shards->count_; ++i) {
+        auto docs = shards->docs_[i]->Snapshot();
+        
+        for (auto iter = docs->cbegin(), end = docs->cend(); iter != end; ++iter) {
+            index->Update(i, document_ptr{}, *iter);
+        }
+    }
+    
+    if (iter != searchIndexes_.end()) {
+        *iter = index;
     } else {
-        const char* keyId = key.c_str();
-        auto keyIdLength = key.size();
-        if (keyId[0] == '"' && keyId[keyIdLength - 1] == '"') {
-            keyId++;
-            keyIdLength -= 2;
+        searchIndexes_.push_back(index);
+    }
+    
+    return index;
+}
+
+SearchIndex::hit_array Documents::SearchDocuments(search_index_ptr index, const SearchQuery& query, std::size_t skip, std::size_t limit, std::uint64_t& totalHits) {
+    const auto maxHits = limit < std::numeric_limits<decltype(limit)>::max() - skip ? skip + limit : limit;
+    const auto terms = query.Terms().size();
+    
+    shards_ptr shards;
+    {
+        // an index built before the database was resharded is replaced by one for the current shards
+        boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+        shards = GetShards();
+        
+        auto iter = std::find(searchIndexes_.cbegin(), searchIndexes_.cend(), index);
+        if (iter == searchIndexes_.cend()) {
+            iter = std::find_if(searchIndexes_.cbegin(), searchIndexes_.cend(), [&](const search_index_ptr& current) {
+                return current->DesignId() == index->DesignId() && current->Name() == index->Name();
+            });
+            
+            if (iter == searchIndexes_.cend()) {
+                throw MissingIndex{};
+            }
+            
+            index = *iter;
         }
+    }
+    
+    // BM25 needs the document frequencies across every shard before any can be scored
+    std::vector<SearchIndex::Statistics> shardStats(shards->count_, SearchIndex::Statistics{terms});
+    ForEachCollection(*shards, [&](unsigned i, std::size_t threadId) {
+        index->Refresh(i, *shards->docs_[i], threadId);
+        index->GetStatistics(i, query, shardStats[i]);
+    });
+    
+    SearchIndex::Statistics stats{terms};
+    for (const auto& shardStat : shardStats) {
+        stats.Merge(shardStat);
+    }
+    
+    std::vector<SearchIndex::hit_array> shardHits(shards->count_);
+    std::vector<std::uint64_t> shardTotalHits(shards->count_);
+    ForEachCollection(*shards, [&](unsigned i, std::size_t) {
+        index->Search(i, query, stats, maxHits, shardHits[i], shardTotalHits[i]);
+    });
+    
+    totalHits = 0;
+    SearchIndex::hit_array hits;
+    for (unsigned i = 0; i < shards->count_; ++i) {
+        totalHits += shardTotalHits[i];
         
-        DocumentCollection::size_type min = 0;
-        DocumentCollection::size_type mid = 0;
-        DocumentCollection::size_type max = size - 1;
+        auto oldSize = hits.size();
+        hits.insert(hits.end(), shardHits[i].cbegin(), shardHits[i].cend());
+        std::inplace_merge(hits.begin(), hits.begin() + oldSize, hits.end(), &SearchIndex::Less);
+    }
+    
+    auto startIndex = std::min(skip, hits.size());
+    auto endIndex = std::min(maxHits, hits.size());
+    
+    return SearchIndex::hit_array(hits.cbegin() + startIndex, hits.cbegin() + endIndex);
+}
 
-        while (min <= max) {
-            mid = ((max - min) / 2) + min;
+spatial_index_ptr Documents::GetSpatialIndex(const char* designId, const char* name, script_object_ptr spatial) {
+    boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+    
+    // parsing the definition is cheap and tells us whether the existing index is stale
+    auto shards = GetShards();
+    auto index = SpatialIndex::Create(designId, name, spatial, shards->count_);
+    
+    auto iter = std::find_if(spatialIndexes_.begin(), spatialIndexes_.end(), [&](const spatial_index_ptr& existing) {
+        return existing->DesignId() == designId && existing->Name() == name;
+    });
+    
+    if (iter != spatialIndexes_.end() && (*iter)->Definition() == index->Definition()) {
+        return *iter;
+    }
+    
+    auto locks = LockCollections(*shards);
+    
+    for (unsigned i = 0; i < shards->count_; ++i) {
+        auto docs = shards->docs_[i]->Snapshot();
+        
+        for (auto iter = docs->cbegin(), end = docs->cend(); iter != end; ++iter) {
+            index->Update(i, document_ptr{}, *iter);
+        }
+    }
+    
+    if (iter != spatialIndexes_.end()) {
+        *iter = index;
+    } else {
+        spatialIndexes_.push_back(index);
+    }
+    
+    return index;
+}
 
-            auto docId = docs[mid]->getId();
-            auto diff = std::strncmp(keyId, docId, keyIdLength);
-            if (diff == 0 && docId[keyIdLength] != '\0') {
-                diff = -1;
+SpatialIndex::hit_array Documents::QuerySpatial(spatial_index_ptr index, const SpatialIndex::Region& region, std::size_t skip, std::size_t limit, std::uint64_t& totalRows) {
+    shards_ptr shards;
+    {
+        // an index built before the database was resharded is replaced by one for the current shards
+        boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+        shards = GetShards();
+        
+        auto iter = std::find(spatialIndexes_.cbegin(), spatialIndexes_.cend(), index);
+        if (iter == spatialIndexes_.cend()) {
+            iter = std::find_if(spatialIndexes_.cbegin(), spatialIndexes_.cend(), [&](const spatial_index_ptr& current) {
+                return current->DesignId() == index->DesignId() && current->Name() == index->Name();
+            });
+            
+            if (iter == spatialIndexes_.cend()) {
+                throw MissingIndex{};
             }
+            
+            index = *iter;
+        }
+    }
+    
+    std::vector<SpatialIndex::hit_array> shardHits(shards->count_);
+    ForEachCollection(*shards, [&](unsigned i, std::size_t threadId) {
+        index->Refresh(i, *shards->docs_[i], threadId);
+        index->Query(i, region, shardHits[i]);
+    });
+    
+    // radius queries are ordered nearest first, bounding boxes by id
+    const auto byDistance = region.IsRadius();
+    auto less = [&](const SpatialIndex::Hit& a, const SpatialIndex::Hit& b) { return SpatialIndex::Less(a, b, byDistance); };
+    
+    SpatialIndex::hit_array hits;
+    for (auto& shardHit : shardHits) {
+        std::sort(shardHit.begin(), shardHit.end(), less);
+        
+        auto oldSize = hits.size();
+        hits.insert(hits.end(), shardHit.cbegin(), shardHit.cend());
+        std::inplace_merge(hits.begin(), hits.begin() + oldSize, hits.end(), less);
+    }
+    
+    totalRows = hits.size();
+    
+    auto startIndex = std::min(skip, hits.size());
+    auto endIndex = std::min(limit < std::numeric_limits<decltype(limit)>::max() - skip ? skip + limit : limit, hits.size());
+    
+    return SpatialIndex::hit_array(hits.cbegin() + startIndex, hits.cbegin() + endIndex);
+}
+
+document_ptr Documents::StoreDocument(Shards& shards, unsigned coll, const char* id, script_object_ptr obj, const document_ptr& oldDoc) {
+    auto objRev = obj->getString("_rev", false);
+
+    if (!!oldDoc) {
+        auto docRev = oldDoc->getRev();
+        
+        if (objRev == nullptr || std::strcmp(objRev, docRev) != 0) {
+            throw DocumentConflict{};
+        }
+    } else if (objRev != nullptr) {
+        DocumentRevision::Validate(objRev, true);
+    }
+
+    // the sequence is only taken once the attachment stubs have been resolved
+    auto newDoc = Document::Create(id, obj, 0);
+    newDoc->inheritAttachments(oldDoc);
+    newDoc->setUpdateSequence(++updateSeq_);
+
+    shards.docs_[coll]->insert(newDoc);
+    UpdateIndexes(coll, oldDoc, newDoc);
+    
+    return newDoc;
+}
+
+void Documents::UpdateStatistics(const document_ptr& oldDoc, const document_ptr& newDoc) {
+    if (!oldDoc) {
+        docCount_.fetch_add(1, boost::memory_order_relaxed);
+        CheckShardThreshold();
+    } else {
+        dataSize_.fetch_sub(oldDoc->getDataSize(), boost::memory_order_relaxed);
+    }
+    
+    dataSize_.fetch_add(newDoc->getDataSize(), boost::memory_order_relaxed);
+}
+
+Documents::shards_ptr Documents::GetShards() const {
+    return boost::atomic_load(&shards_);
+}
+
+boost::unique_lock<DocumentCollection> Documents::LockDocumentCollection(const char* id, shards_ptr& shards, unsigned& coll) {
+    for (;;) {
+        shards = GetShards();
+        coll = GetDocumentCollectionIndex(*shards, id);
+        
+        boost::unique_lock<DocumentCollection> lock{*shards->docs_[coll]};
+        if (!shards->retired_) {
+            return lock;
+        }
+    }
+}
+
+void Documents::Reshard(unsigned count) {
+    autoShard_ = false;
+    ReshardCollections(count);
+}
+
+bool Documents::StartReshard(unsigned count) {
+    autoShard_ = false;
+    return StartReshardThread(count);
+}
+
+bool Documents::GetReshardTask(ReshardTask& task) {
+    boost::lock_guard<boost::mutex> guard{reshardTaskMtx_};
+    task = reshardTask_;
+    return task.startedOn_ != 0;
+}
+
+void Documents::CheckShardThreshold() {
+    if (autoShard_.load(boost::memory_order_relaxed) && getCount() > Config::Data::ShardThreshold() && autoShard_.exchange(false)) {
+        StartReshardThread(GetCollectionCount());
+    }
+}
+
+bool Documents::StartReshardThread(unsigned count) {
+    boost::lock_guard<boost::mutex> guard{reshardTaskMtx_};
+    if (reshardTask_.running_) {
+        return false;
+    }
+    
+    // the last reshard has marked itself as done so its thread has nothing left to do but exit
+    if (reshardThread_.joinable()) {
+        reshardThread_.join();
+    }
+    
+    auto now = Now();
+    reshardTask_.shards_ = count;
+    reshardTask_.startedOn_ = now;
+    reshardTask_.updatedOn_ = now;
+    reshardTask_.progress_ = 0;
+    reshardTask_.running_ = true;
+    reshardTask_.error_.clear();
+    
+    // a failure is kept on the task instead of escaping the thread, the thread 
+    // is joined by the next reshard or when the shards are released
+    reshardThread_ = boost::thread{[this, count]() {
+        std::string error;
+        try {
+            ReshardCollections(count, [this](unsigned progress) { UpdateReshardTask(progress); });
+        } catch (const std::exception& e) {
+            error = e.what();
+        } catch (...) {
+            error = "unknown error";
+        }
+        
+        boost::lock_guard<boost::mutex> guard{reshardTaskMtx_};
+        reshardTask_.updatedOn_ = Now();
+        reshardTask_.running_ = false;
+        if (error.empty()) {
+            reshardTask_.progress_ = 100;
+        } else {
+            reshardTask_.error_.swap(error);
+        }
+    }};
+    
+    return true;
+}
+
+void Documents::JoinReshardThread() {
+    boost::thread thread;
+    {
+        boost::lock_guard<boost::mutex> guard{reshardTaskMtx_};
+        thread.swap(reshardThread_);
+    }
+    
+    // joined outside the lock since the thread takes it to report its progress
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Documents::UpdateReshardTask(unsigned progress) {
+    boost::lock_guard<boost::mutex> guard{reshardTaskMtx_};
+    reshardTask_.progress_ = progress;
+    reshardTask_.updatedOn_ = Now();
+}
 
-            diff = descending ? -diff : diff;
-            if (diff == 0) {
-                return mid;
-            } else if (diff < 0) {
-                if (mid == 0) {
-                    break;
+void Documents::ReshardCollections(unsigned count, const std::function<void(unsigned)>& progress) {
+    boost::lock_guard<boost::mutex> reshardGuard{reshardMtx_};
+    
+    auto oldShards = GetShards();
+    if (count == oldShards->count_) {
+        return;
+    }
+    
+    auto newShards = boost::make_shared<Shards>(count);
+    auto addDoc = [&](const document_ptr& doc) {
+        newShards->docs_[GetDocumentCollectionIndex(*newShards, doc->getId())]->insert(doc);
+    };
+    
+    // the documents are copied from snapshots of the old collections without blocking 
+    // anything, the new collections aren't visible so they are filled without their locks
+    std::vector<document_collection_snapshot_ptr> snapshots(oldShards->count_);
+    for (unsigned i = 0; i < oldShards->count_; ++i) {
+        {
+            boost::shared_lock<DocumentCollection> lock{*oldShards->docs_[i]};
+            snapshots[i] = oldShards->docs_[i]->Snapshot();
+        }
+        
+        for (auto iter = snapshots[i]->cbegin(), end = snapshots[i]->cend(); iter != end; ++iter) {
+            addDoc(*iter);
+        }
+        
+        // copying the documents is most of the work, building the indexes is the rest
+        if (!!progress) {
+            progress((i + 1) * 80 / oldShards->count_);
+        }
+    }
+    
+    // the same goes for the indexes of the new shards, they are built from the copied 
+    // documents before any lock is taken and only get the later changes under the locks
+    mango_index_array copiedIndexes;
+    search_index_array copiedSearchIndexes;
+    spatial_index_array copiedSpatialIndexes;
+    {
+        boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+        copiedIndexes = indexes_;
+        copiedSearchIndexes = searchIndexes_;
+        copiedSpatialIndexes = spatialIndexes_;
+    }
+    
+    mango_index_array reshardedIndexes;
+    for (const auto& index : copiedIndexes) {
+        reshardedIndexes.emplace_back(BuildReshardedIndex(index, newShards->docs_));
+    }
+    
+    search_index_array reshardedSearchIndexes;
+    for (const auto& index : copiedSearchIndexes) {
+        reshardedSearchIndexes.emplace_back(QueueReshardedIndex(index, newShards->docs_));
+    }
+    
+    spatial_index_array reshardedSpatialIndexes;
+    for (const auto& index : copiedSpatialIndexes) {
+        reshardedSpatialIndexes.emplace_back(QueueReshardedIndex(index, newShards->docs_));
+    }
+    
+    if (!!progress) {
+        progress(90);
+    }
+    
+    boost::lock_guard<decltype(indexesMtx_)> guard{indexesMtx_};
+    auto locks = LockCollections(*oldShards);
+    
+    auto applyChange = [&](const document_ptr& oldDoc, const document_ptr& newDoc) {
+        auto coll = GetDocumentCollectionIndex(*newShards, (!!newDoc ? newDoc : oldDoc)->getId());
+        if (!!newDoc) {
+            newShards->docs_[coll]->insert(newDoc);
+        } else {
+            newShards->docs_[coll]->erase(oldDoc);
+        }
+        
+        for (const auto& index : reshardedIndexes) {
+            index->Update(coll, oldDoc, newDoc);
+        }
+        
+        for (const auto& index : reshardedSearchIndexes) {
+            index->Update(coll, oldDoc, newDoc);
+        }
+        
+        for (const auto& index : reshardedSpatialIndexes) {
+            index->Update(coll, oldDoc, newDoc);
+        }
+    };
+    
+    // only the changes made while the documents were being copied are applied under the locks, 
+    // both snapshots are sorted by id so they are compared in a single pass
+    Document::Less less;
+    for (unsigned i = 0; i < oldShards->count_; ++i) {
+        auto snapshot = oldShards->docs_[i]->Snapshot();
+        if (snapshot->Version() == snapshots[i]->Version()) {
+            continue;
+        }
+        
+        auto copied = snapshots[i]->cbegin(), copiedEnd = snapshots[i]->cend();
+        auto current = snapshot->cbegin(), currentEnd = snapshot->cend();
+        
+        while (copied != copiedEnd || current != currentEnd) {
+            if (current == currentEnd || (copied != copiedEnd && less(*copied, *current))) {
+                applyChange(*copied++, document_ptr{});
+            } else if (copied == copiedEnd || less(*current, *copied)) {
+                applyChange(document_ptr{}, *current++);
+            } else {
+                if (*copied != *current) {
+                    applyChange(*copied, *current);
                 }
                 
-                max = mid - 1;
-            } else {
-                min = mid + 1;
+                ++copied;
+                ++current;
             }
         }
+    }
+    
+    // an index created or replaced while the documents were being copied is built now
+    auto indexes = MatchReshardedIndexes(indexes_, copiedIndexes, reshardedIndexes, [&](const mango_index_ptr& index) {
+        return BuildReshardedIndex(index, newShards->docs_);
+    });
+    
+    auto searchIndexes = MatchReshardedIndexes(searchIndexes_, copiedSearchIndexes, reshardedSearchIndexes, [&](const search_index_ptr& index) {
+        return QueueReshardedIndex(index, newShards->docs_);
+    });
+    
+    auto spatialIndexes = MatchReshardedIndexes(spatialIndexes_, copiedSpatialIndexes, reshardedSpatialIndexes, [&](const spatial_index_ptr& index) {
+        return QueueReshardedIndex(index, newShards->docs_);
+    });
+    
+    indexes_.swap(indexes);
+    searchIndexes_.swap(searchIndexes);
+    spatialIndexes_.swap(spatialIndexes);
+    
+    // writers waiting on the old locks find them retired and move on to the new shards
+    boost::atomic_store(&shards_, newShards);
+    oldShards->retired_ = true;
+}
+
+std::vector<boost::unique_lock<DocumentCollection>> Documents::LockCollections(const Shards& shards) {
+    std::vector<boost::unique_lock<DocumentCollection>> locks;
+    locks.reserve(shards.count_);
+    
+    // always taken in the same order so two callers can't deadlock
+    for (unsigned i = 0; i < shards.count_; ++i) {
+        locks.emplace_back(*shards.docs_[i]);
+    }
+    
+    return locks;
+}
+
+void Documents::ForEachCollection(const Shards& shards, const std::function<void(unsigned coll, std::size_t threadId)>& func) {
+    std::mutex m;
+    std::condition_variable collEnd;
+    std::atomic<unsigned> threads(shards.count_);
+    std::exception_ptr error;
+    
+    auto threadPool = MapReduceThreadPool::Get();
+    for (unsigned i = 0; i < shards.count_; ++i) {
+        threadPool->Post([&, i](size_t threadId) {
+            try {
+                func(i, threadId);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{m};
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            
+            std::lock_guard<std::mutex> lock{m};
+            --threads;
+            collEnd.notify_one();
+        });
+    }
+    
+    std::unique_lock<std::mutex> lock{m};
+    collEnd.wait(lock, [&]() { return threads.load() == 0; });
+    
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void Documents::UpdateIndexes(unsigned coll, const document_ptr& oldDoc, const document_ptr& newDoc) {
+    auto id = !!newDoc ? newDoc->getId() : oldDoc->getId();
+    if (IsDesignDocument(id)) {
+        UpdateValidators(oldDoc, newDoc);
+        
+        // results of the old view definitions can't be looked up again, the keys hash the map source
+        mapReduceResultsCache_.Purge(getUpdateSequence());
+    }
+    
+    // the caller holds the collection lock which keeps the index list stable
+    for (const auto& index : indexes_) {
+        index->Update(coll, oldDoc, newDoc);
+    }
+    
+    for (const auto& index : searchIndexes_) {
+        index->Update(coll, oldDoc, newDoc);
+    }
+    
+    for (const auto& index : spatialIndexes_) {
+        index->Update(coll, oldDoc, newDoc);
+    }
+}
+
+DesignFunctions::validator_array_ptr Documents::GetValidators(const char* id) {
+    // without users and roles every writer is an admin, and like CouchDB admins aren't 
+    // validated when writing design documents so a broken validator can always be fixed
+    if (id != nullptr && IsDesignDocument(id)) {
+        return DesignFunctions::validator_array_ptr{};
+    }
+    
+    boost::lock_guard<boost::mutex> guard{validatorsMtx_};
+    return validators_;
+}
+
+void Documents::UpdateValidators(const document_ptr& oldDoc, const document_ptr& newDoc) {
+    auto id = !!newDoc ? newDoc->getId() : oldDoc->getId();
+    
+    const char* function = nullptr;
+    if (!!newDoc) {
+        auto obj = newDoc->getObject();
+        if (obj->getType("validate_doc_update") == rs::scriptobject::ScriptObjectType::String) {
+            function = obj->getString("validate_doc_update");
+        }
+    }
+    
+    boost::lock_guard<boost::mutex> guard{validatorsMtx_};
+    
+    if (function != nullptr) {
+        // the function is wrapped once here for each revision of the design document
+        validatorScripts_[id] = DesignFunctions::CreateValidator(function);
+    } else if (validatorScripts_.erase(id) == 0) {
+        return;
+    }
+    
+    if (validatorScripts_.size() == 0) {
+        validators_.reset();
+    } else {
+        auto validators = boost::make_shared<DesignFunctions::validator_array>();
+        validators->reserve(validatorScripts_.size());
+        
+        for (const auto& script : validatorScripts_) {
+            validators->emplace_back(script.second);
+        }
+        
+        validators_ = validators;
+    }
+}
+
+void Documents::ValidateDocument(rs::jsapi::Context& cx, std::size_t threadId, const DesignFunctions::validator_array& validators, 
+        const char* id, script_object_ptr obj, const document_ptr& oldDoc) {
+    auto db = db_.lock();
+    
+    DesignFunctions::validation_array validations;
+    validations.emplace_back(id, obj, oldDoc);
+    
+    DesignFunctions::Validate(cx, threadId, validators, !!db ? db->Name() : "", validations);
+    
+    const auto& validation = validations.front();
+    if (validation.error_ == "unauthorized") {
+        throw DocumentUnauthorized{validation.reason_.c_str()};
+    } else if (validation.error_.size() > 0) {
+        throw DocumentForbidden{validation.reason_.c_str()};
+    }
+}
+
+map_reduce_results_ptr Documents::PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj) {        
+    MapReduceResultsCache::shard_results_array shardResults;
+    PostTempView(options, obj, [&](map_reduce_shard_results_ptr result) {
+        shardResults.emplace_back(result);
+    });
+    
+    auto results = mapReduce_.Merge(options, shardResults);    
+    return results;
+}
 
-        return ~min;
+void Documents::PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj, const MapReduce::shard_results_handler& handler) {
+    auto task = MapReduce::MapReduceTask::Create(obj);
+    
+    // read the sequence before mapping so that concurrent updates can't be cached as current
+    auto updateSeq = getUpdateSequence();
+    auto key = MapReduceResultsCache::MakeKey(task, options);
+    
+    auto found = false;
+    MapReduceResultsCache::shard_results_array shardResults;
+    
+    const auto updateMode = options.Update();
+    if (updateMode == GetViewOptions::UpdateMode::Update) {
+        found = mapReduceResultsCache_.Get(key, updateSeq, shardResults);
+    } else {
+        sequence_type resultsUpdateSeq = 0;
+        found = mapReduceResultsCache_.GetLatest(key, shardResults, resultsUpdateSeq);
+        
+        if (found && updateMode == GetViewOptions::UpdateMode::Lazy && resultsUpdateSeq != updateSeq) {
+            mapReduceIndexer_.Post(key, task, options);
+        }
     }
+    
+    if (found) {
+        for (const auto& result : shardResults) {
+            handler(result);
+        }
+    } else {
+        ExecuteView(options, task, key, updateSeq, handler);
+    }
+}
+
+void Documents::ExecuteView(const GetViewOptions& options, const MapReduce::MapReduceTask& task, const std::string& key, sequence_type updateSeq, const MapReduce::shard_results_handler& handler) {
+    auto colls = GetShards()->docs_;
+    
+    MapReduceResultsCache::shard_results_array shardResults;
+    shardResults.reserve(colls.size());
+
+    mapReduce_.Execute(options, task, colls, [&](map_reduce_shard_results_ptr result) {
+        shardResults.emplace_back(result);
+        handler(result);
+    });
+
+    mapReduceResultsCache_.Put(key, updateSeq, shardResults);
+}
+
+void Documents::IndexView(const MapReduce::MapReduceTask& task, const GetViewOptions& options) {
+    auto updateSeq = getUpdateSequence();
+    auto key = MapReduceResultsCache::MakeKey(task, options);
+    
+    ExecuteView(options, task, key, updateSeq, [](map_reduce_shard_results_ptr) {});
+}
+
+const MapReduceResultsCache& Documents::getMapReduceResultsCache() const {
+    return mapReduceResultsCache_;
 }
 
-unsigned Documents::GetCollectionCount() const {
+unsigned Documents::GetCollectionCount() {
     auto collections = Config::Environment::CpuCount() * 2;           
-    return collections;
+    return std::min(collections, MaxShards);
 }
 
-unsigned Documents::GetDocumentCollectionIndex(const char* id) const {
+unsigned Documents::GetDocumentCollectionIndex(const Shards& shards, const char* id) {
     auto hash = Document::getIdHash(id);
-    auto index = hash % collections_;   
+    auto index = hash % shards.count_;   
     return index;
 }
\ No newline at end of file
@@ -21,6 +21,9 @@
 
 #include <limits>
 #include <vector>
+#include <functional>
+#include <map>
+#include <string>
 
 #include <boost/noncopyable.hpp>
 #include <boost/enable_shared_from_this.hpp>
@@ -31,23 +34,41 @@
 #include "types.h"
 #include "document.h"
 #include "document_collection.h"
+#include "document_collection_merged_results_iterator.h"
 #include "get_all_documents_options.h"
 #include "post_all_documents_options.h"
 #include "bulk_documents_result.h"
 #include "json_stream.h"
 #include "get_view_options.h"
 #include "map_reduce.h"
+#include "map_reduce_results_cache.h"
+#include "map_reduce_indexer.h"
+#include "search_index.h"
+#include "spatial_index.h"
+#include "design_functions.h"
 
 class Database;
+class MangoQuery;
+class SearchQuery;
 
 class Documents final : public boost::enable_shared_from_this<Documents>, private boost::noncopyable {
 public:
-    static documents_ptr Create(database_ptr db);
+    // shards of 0 starts with a single collection and splits it into the default 
+    // of two collections per cpu once the database outgrows the shard threshold
+    static documents_ptr Create(database_ptr db, unsigned shards = 0);
+    
+    ~Documents();
+    
+    static const unsigned MaxShards = 256;
     
     document_ptr GetDocument(const char* id, bool throwOnFail = true);
     document_ptr DeleteDocument(const char* id, const char* rev);
     document_ptr SetDocument(const char* id, script_object_ptr obj);
     
+    // runs the update function and stores its result while holding the document's collection lock,
+    // without an id the function creates a document, returns the stored document or null
+    document_ptr UpdateDocument(const char* id, const char* function, script_object_ptr req, DesignFunctions::Response& response);
+    
     document_ptr SetDocumentAttachment(const char* id, const char* rev, const char* name, const char* contentType, const std::vector<unsigned char>& attachment);
     document_attachment_ptr GetDocumentAttachment(const char* id, const char* name, bool includeBody);
     document_ptr DeleteDocumentAttachment(const char* id, const char* rev, const char* name);
@@ -61,21 +82,80 @@ public:
     document_ptr SetLocalDocument(const char* id, script_object_ptr obj);
     
     document_array_ptr GetDocuments(const GetAllDocumentsOptions& options, DocumentCollection::size_type& offset, DocumentCollection::size_type& totalDocs, sequence_type& updateSequence);
+    
+    // the rows are merged from the collections as they are read rather than being materialized
+    DocumentCollectionMergedResultsIterator GetDocumentsIterator(const GetAllDocumentsOptions& options, sequence_type& updateSequence);
     document_array_ptr PostDocuments(const PostAllDocumentsOptions& options, DocumentCollection::size_type& totalDocs, sequence_type& updateSequence);
     
     BulkDocumentsResults PostBulkDocuments(script_array_ptr docs, bool newEdits);
     
+    document_array_ptr FindDocuments(const MangoQuery& query);
+    mango_index_ptr PlanFindDocuments(const MangoQuery& query);
+    
+    mango_index_ptr CreateIndex(script_object_ptr definition, bool& created);
+    bool DeleteIndex(const char* designId, const char* name);
+    mango_index_array GetIndexes();
+    
+    search_index_ptr GetSearchIndex(const char* designId, const char* name, const char* function);
+    SearchIndex::hit_array SearchDocuments(search_index_ptr index, const SearchQuery& query, std::size_t skip, std::size_t limit, std::uint64_t& totalHits);
+    
+    spatial_index_ptr GetSpatialIndex(const char* designId, const char* name, script_object_ptr spatial);
+    SpatialIndex::hit_array QuerySpatial(spatial_index_ptr index, const SpatialIndex::Region& region, std::size_t skip, std::size_t limit, std::uint64_t& totalRows);
+    
     map_reduce_results_ptr PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj);
+    void PostTempView(const GetViewOptions& options, rs::scriptobject::ScriptObjectPtr obj, const MapReduce::shard_results_handler& handler);
+    
+    // the state of the last reshard run on reshardThread_, error_ is set when it failed
+    struct ReshardTask final {
+        unsigned shards_;
+        std::uint64_t startedOn_;
+        std::uint64_t updatedOn_;
+        unsigned progress_;
+        bool running_;
+        std::string error_;
+    };
+    
+    // splits or merges the collections into the given number of shards, readers and writers 
+    // carry on against the old collections until the new ones replace them, an explicit 
+    // reshard stops a database from being split when it reaches the shard threshold
+    void Reshard(unsigned shards);
+    
+    // runs the reshard on reshardThread_, returns false without starting it when one is already running
+    bool StartReshard(unsigned shards);
+    
+    // returns false when the documents have never been resharded in the background
+    bool GetReshardTask(ReshardTask& task);
+    unsigned getShardCount();
+    
+    // frees one collection of a database nothing else can reach, returns false 
+    // when there are none left, bytes is the size of the documents it held
+    bool ReleaseShard(std::uint64_t& bytes);
     
     DocumentCollection::size_type getCount();
     std::uint64_t getDataSize();
     sequence_type getUpdateSequence();
     
+    const MapReduceResultsCache& getMapReduceResultsCache() const;
+    
 private:
     
-    friend documents_ptr boost::make_shared<documents_ptr::element_type>(database_ptr&);
+    friend documents_ptr boost::make_shared<documents_ptr::element_type>(database_ptr&, unsigned&);
+    
+    // how often an update function is run again when its document changed underneath it
+    static const unsigned MaxUpdateRetries = 3;
     
-    const DocumentCollection::size_type FindMissedFlag = ~(std::numeric_limits<DocumentCollection::size_type>::max() / 2);
+    // the collections the documents are split into, a reshard replaces them as a whole and 
+    // retires the old ones, a writer that finds its collection retired once it holds the 
+    // lock retries against the current shards
+    struct Shards final {
+        Shards(unsigned count);
+        
+        const unsigned count_;
+        document_collections_ptr_array docs_;
+        boost::atomic<bool> retired_;
+    };
+    
+    using shards_ptr = boost::shared_ptr<Shards>;
     
     class DocumentsMutex {
     public:
@@ -92,17 +172,64 @@ private:
         char padding_[64];
     };
     
-    Documents(database_ptr db);
+    Documents(database_ptr db, unsigned shards);
+    
+    static unsigned GetCollectionCount();
+    static unsigned GetDocumentCollectionIndex(const Shards& shards, const char* id);
+    
+    shards_ptr GetShards() const;
+    
+    // locks the collection holding the id in whichever shards are current once the lock is held
+    boost::unique_lock<DocumentCollection> LockDocumentCollection(const char* id, shards_ptr& shards, unsigned& coll);
+    
+    // the caller holds the collection lock, oldDoc is the document currently stored under the id
+    document_ptr StoreDocument(Shards& shards, unsigned coll, const char* id, script_object_ptr obj, const document_ptr& oldDoc);
+    void UpdateStatistics(const document_ptr& oldDoc, const document_ptr& newDoc);
+    
+    // called after documents are added, splits a database still in its single collection on 
+    // reshardThread_ once it's larger than the threshold
+    void CheckShardThreshold();
+    bool StartReshardThread(unsigned shards);
+    void JoinReshardThread();
+    void UpdateReshardTask(unsigned progress);
+    
+    // progress is called with the percentage done as each stage of the reshard completes
+    void ReshardCollections(unsigned shards, const std::function<void(unsigned)>& progress = nullptr);
+    
+    std::vector<boost::unique_lock<DocumentCollection>> LockCollections(const Shards& shards);
+    void UpdateIndexes(unsigned coll, const document_ptr& oldDoc, const document_ptr& newDoc);
+    
+    // returns null when there is nothing to validate, design documents are never validated
+    DesignFunctions::validator_array_ptr GetValidators(const char* id);
+    void UpdateValidators(const document_ptr& oldDoc, const document_ptr& newDoc);
     
-    document_array_ptr GetDocuments(sequence_type& updateSequence);
-    DocumentCollection::size_type FindDocument(const document_array& docs, const std::string& key, bool descending);
-    unsigned GetCollectionCount() const;
-    unsigned GetDocumentCollectionIndex(const char* id) const;
+    // throws the error of a rejected document
+    void ValidateDocument(rs::jsapi::Context& cx, std::size_t threadId, const DesignFunctions::validator_array& validators, 
+        const char* id, script_object_ptr obj, const document_ptr& oldDoc);
+    
+    // runs the function for each collection on the map/reduce thread pool and waits for them all
+    void ForEachCollection(const Shards& shards, const std::function<void(unsigned coll, std::size_t threadId)>& func);
+    
+    // the shards are read under the indexes mutex so the plan is for the shards returned
+    mango_index_ptr PlanFindDocuments(const MangoQuery& query, shards_ptr& shards);
+    
+    void ExecuteView(const GetViewOptions& options, const MapReduce::MapReduceTask& task, const std::string& key, sequence_type updateSeq, const MapReduce::shard_results_handler& handler);
+    void IndexView(const MapReduce::MapReduceTask& task, const GetViewOptions& options);
     
     database_wptr db_;
     
-    const unsigned collections_;
-    document_collections_ptr_array docs_;
+    // whether the database is still in the single collection it was created with
+    boost::atomic<bool> autoShard_;
+    
+    // only read and replaced with the atomic shared_ptr functions
+    shards_ptr shards_;
+    boost::mutex reshardMtx_;
+    
+    // the thread is only started or swapped out under reshardTaskMtx_
+    boost::mutex reshardTaskMtx_;
+    boost::thread reshardThread_;
+    ReshardTask reshardTask_;
+    
     boost::atomic<DocumentCollection::size_type> docCount_;
     boost::atomic<std::uint64_t> dataSize_;
     boost::atomic<sequence_type> updateSeq_;
@@ -110,11 +237,25 @@ private:
     document_collection_ptr localDocs_;
     boost::atomic<sequence_type> localUpdateSeq_;
     
-    boost::mutex allDocsCacheMtx_;
-    boost::atomic<sequence_type> allDocsCacheUpdateSequence_;
-    document_array_ptr allDocsCacheDocs_;
+    // changes to the indexes are made while holding every collection lock so updates 
+    // can read them under their own collection lock, queries use the indexes mutex 
+    // which is also held while the shards are replaced
+    boost::mutex indexesMtx_;
+    mango_index_array indexes_;
+    search_index_array searchIndexes_;
+    spatial_index_array spatialIndexes_;
+    
+    // validate_doc_update functions by design document id, the validators array is replaced 
+    // rather than modified so writers can validate against a snapshot without the mutex
+    boost::mutex validatorsMtx_;
+    std::map<std::string, std::string> validatorScripts_;
+    DesignFunctions::validator_array_ptr validators_;
 
     MapReduce mapReduce_;
+    MapReduceResultsCache mapReduceResultsCache_;
+    
+    // declared last so that the indexer thread is stopped before anything it uses is destroyed
+    MapReduceIndexer mapReduceIndexer_;
 };
 
 #endif /* RS_AVANCEDB_DOCUMENTS_H */
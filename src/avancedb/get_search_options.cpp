@@ -0,0 +1,36 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "get_search_options.h"
+
+#include "rest_exceptions.h"
+
+GetSearchOptions::GetSearchOptions(const rs::httpserver::QueryString& qs) : GetAllDocumentsOptions(qs) {
+    
+}
+
+const std::string& GetSearchOptions::Query() const {
+    if (query_.size() == 0) {
+        query_ = GetString("q", "query");
+        
+        if (query_.size() == 0) {
+            throw QueryParseError{"q", query_};
+        }
+    }
+    return query_;
+}
\ No newline at end of file
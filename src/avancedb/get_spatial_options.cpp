@@ -0,0 +1,69 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "get_spatial_options.h"
+
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "rest_exceptions.h"
+
+GetSpatialOptions::GetSpatialOptions(const rs::httpserver::QueryString& qs) : GetAllDocumentsOptions(qs) {
+    
+}
+
+SpatialIndex::Region GetSpatialOptions::Region() const {
+    if (qs_.IsKey("bbox")) {
+        auto value = qs_.getValue("bbox");
+        
+        std::vector<std::string> coords;
+        boost::split(coords, value, boost::is_any_of(","));
+        
+        if (coords.size() != 4) {
+            throw QueryParseError{"bbox", value};
+        }
+        
+        double bbox[4];
+        for (int i = 0; i < 4; ++i) {
+            try {
+                bbox[i] = boost::lexical_cast<double>(boost::trim_copy(coords[i]));
+            } catch (const boost::bad_lexical_cast&) {
+                throw QueryParseError{"bbox", value};
+            }
+        }
+        
+        return SpatialIndex::Region::Bbox(bbox[0], bbox[1], bbox[2], bbox[3]);
+    } else if (qs_.IsKey("radius")) {
+        return SpatialIndex::Region::Radius(GetDouble("lon"), GetDouble("lat"), GetDouble("radius"));
+    }
+    
+    // no region was given so everything is returned
+    return SpatialIndex::Region::Bbox(-180, -90, 180, 90);
+}
+
+double GetSpatialOptions::GetDouble(const char* name) const {
+    auto value = GetString(name);
+    
+    try {
+        return boost::lexical_cast<double>(value);
+    } catch (const boost::bad_lexical_cast&) {
+        throw QueryParseError{"number", value};
+    }
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_GET_SPATIAL_OPTIONS_H
+#define RS_AVANCEDB_GET_SPATIAL_OPTIONS_H
+
+#include "get_all_documents_options.h"
+#include "spatial_index.h"
+
+class GetSpatialOptions final : public GetAllDocumentsOptions {
+public:
+    GetSpatialOptions(const rs::httpserver::QueryString& qs);
+    
+    // either bbox=minLon,minLat,maxLon,maxLat or lon, lat and radius in meters
+    SpatialIndex::Region Region() const;
+    
+private:
+    
+    double GetDouble(const char* name) const;
+};
+
+#endif /* RS_AVANCEDB_GET_SPATIAL_OPTIONS_H */
+
@@ -17,10 +17,16 @@
  */
 #include "get_view_options.h"
 
+#include "rest_exceptions.h"
+
 GetViewOptions::GetViewOptions(const rs::httpserver::QueryString& qs) : GetAllDocumentsOptions(qs) {
     
 }
 
+const rs::httpserver::QueryString& GetViewOptions::Query() const {
+    return qs_;
+}
+
 bool GetViewOptions::Reduce() const {
     if (!reduce_.is_initialized()) {
         reduce_ = GetBoolean("reduce", false);
@@ -42,6 +48,47 @@ uint64_t GetViewOptions::GroupLevel() const {
     return groupLevel_.get();
 }
 
+bool GetViewOptions::Sorted() const {
+    if (!sorted_.is_initialized()) {
+        sorted_ = GetBoolean("sorted", true);
+    }
+    return sorted_.get();
+}
+
+GetViewOptions::UpdateMode GetViewOptions::Update() const {
+    if (!update_.is_initialized()) {
+        auto mode = UpdateMode::Update;
+        
+        // stale is the pre 2.0 spelling of update
+        auto stale = GetString("stale");
+        if (stale.size() > 0) {
+            if (stale == "ok") {
+                mode = UpdateMode::Stale;
+            } else if (stale == "update_after") {
+                mode = UpdateMode::Lazy;
+            } else {
+                throw QueryParseError{"stale", stale};
+            }
+        }
+        
+        auto update = GetString("update");
+        if (update.size() > 0) {
+            if (update == "true") {
+                mode = UpdateMode::Update;
+            } else if (update == "false") {
+                mode = UpdateMode::Stale;
+            } else if (update == "lazy") {
+                mode = UpdateMode::Lazy;
+            } else {
+                throw QueryParseError{"update", update};
+            }
+        }
+        
+        update_ = mode;
+    }
+    return update_.get();
+}
+
 map_reduce_query_key_ptr GetViewOptions::StartKeyObj() const {
     map_reduce_query_key_ptr ptr{nullptr};
     
@@ -24,11 +24,17 @@
 
 class GetViewOptions final : public GetAllDocumentsOptions  {
 public:
+    enum class UpdateMode { Update, Stale, Lazy };
+    
     GetViewOptions(const rs::httpserver::QueryString& qs);
     
+    const rs::httpserver::QueryString& Query() const;
+    
     bool Reduce() const;
     bool Group() const;    
     uint64_t GroupLevel() const;
+    bool Sorted() const;
+    UpdateMode Update() const;
     
     map_reduce_query_key_ptr StartKeyObj() const;
     map_reduce_query_key_ptr EndKeyObj() const;
@@ -38,6 +44,8 @@ private:
     mutable boost::optional<bool> reduce_;
     mutable boost::optional<bool> group_;
     mutable boost::optional<uint64_t> groupLevel_;
+    mutable boost::optional<bool> sorted_;
+    mutable boost::optional<UpdateMode> update_;
 };
 
 #endif /* RS_AVANCEDB_GET_VIEW_OPTIONS_H */
@@ -0,0 +1,36 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "global_function_scope.h"
+
+#include <string>
+#include <stdexcept>
+
+GlobalFunctionScope::GlobalFunctionScope(rs::jsapi::Context& cx, const char* name, const function_type& function) : cx_(cx), name_(name) {
+    rs::jsapi::Global::DefineFunction(cx_, name_, function);
+}
+
+GlobalFunctionScope::~GlobalFunctionScope() {
+    std::string message = name_;
+    message += " is not available outside the function which defined it";
+    
+    rs::jsapi::Global::DefineFunction(cx_, name_, 
+        [message](const std::vector<rs::jsapi::Value>&, rs::jsapi::Value&) {
+            throw std::runtime_error{message};
+    });
+}
@@ -0,0 +1,45 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_GLOBAL_FUNCTION_SCOPE_H
+#define RS_AVANCEDB_GLOBAL_FUNCTION_SCOPE_H
+
+#include <vector>
+#include <functional>
+
+#include <boost/noncopyable.hpp>
+
+#include "libjsapi.h"
+
+// defines a global JS function for the life of the scope, the functions capture
+// the caller's locals by reference and the pooled contexts outlive the caller so
+// on exit the function is replaced by a stub which throws when it is called
+class GlobalFunctionScope final : private boost::noncopyable {
+public:
+    using function_type = std::function<void(const std::vector<rs::jsapi::Value>&, rs::jsapi::Value&)>;
+    
+    GlobalFunctionScope(rs::jsapi::Context& cx, const char* name, const function_type& function);
+    ~GlobalFunctionScope();
+    
+private:
+    rs::jsapi::Context& cx_;
+    const char* name_;
+};
+
+#endif /* RS_AVANCEDB_GLOBAL_FUNCTION_SCOPE_H */
+
@@ -0,0 +1,247 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mango_index.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "document.h"
+#include "document_collection_snapshot.h"
+#include "rest_exceptions.h"
+
+MangoIndex::MangoIndex(unsigned shards) : shards_(shards) {
+    
+}
+
+mango_index_ptr MangoIndex::Create(script_object_ptr definition, unsigned shards) {
+    using ScriptObjectType = rs::scriptobject::ScriptObjectType;
+    
+    mango_index_ptr index{new MangoIndex{shards}};
+    
+    MangoValue body{definition};
+    
+    auto type = body.getField("type");
+    if (!type.IsMissing() && (type.getType() != ScriptObjectType::String || std::strcmp(type.getString(), "json") != 0)) {
+        throw MangoQueryError{"Only json indexes are supported"};
+    }
+    
+    auto fields = body.getPath({ "index", "fields" });
+    if (fields.getType() != ScriptObjectType::Array || fields.getCount() == 0) {
+        throw MangoQueryError{"index.fields must be a non-empty array"};
+    }
+    
+    for (unsigned i = 0, count = fields.getCount(); i < count; ++i) {
+        auto field = fields.getElement(i);
+        const char* name = nullptr;
+        
+        if (field.getType() == ScriptObjectType::String) {
+            name = field.getString();
+        } else if (field.getType() == ScriptObjectType::Object && field.getCount() == 1) {
+            // the sort direction doesn't matter as the index can be walked either way
+            auto direction = field.getField(field.getName(0));
+            if (direction.getType() == ScriptObjectType::String && 
+                    (std::strcmp(direction.getString(), "asc") == 0 || std::strcmp(direction.getString(), "desc") == 0)) {
+                name = field.getName(0);
+            }
+        }
+        
+        if (name == nullptr || *name == '\0') {
+            throw MangoQueryError{"index.fields must be field names or {\"field\": \"asc|desc\"} objects"};
+        }
+        
+        index->fieldNames_.emplace_back(name);
+        index->fields_.emplace_back(MangoValue::ParsePath(name));
+    }
+    
+    auto name = body.getField("name");
+    if (name.getType() == ScriptObjectType::String && std::strlen(name.getString()) > 0) {
+        index->name_ = name.getString();
+    } else if (!name.IsMissing()) {
+        throw MangoQueryError{"name must be a string"};
+    } else {
+        index->name_ = "idx";
+        for (const auto& fieldName : index->fieldNames_) {
+            index->name_ += '-';
+            index->name_ += fieldName;
+        }
+    }
+    
+    auto ddoc = body.getField("ddoc");
+    std::string designId = index->name_;
+    if (ddoc.getType() == ScriptObjectType::String && std::strlen(ddoc.getString()) > 0) {
+        designId = ddoc.getString();
+    } else if (!ddoc.IsMissing()) {
+        throw MangoQueryError{"ddoc must be a string"};
+    }
+    
+    index->designId_ = designId.compare(0, 8, "_design/") == 0 ? designId : "_design/" + designId;
+    
+    return index;
+}
+
+bool MangoIndex::IsSameDefinition(const MangoIndex& other) const {
+    return name_ == other.name_ && designId_ == other.designId_ && fields_ == other.fields_;
+}
+
+mango_index_ptr MangoIndex::Reshard(unsigned shards) const {
+    mango_index_ptr index{new MangoIndex{shards}};
+    
+    index->name_ = name_;
+    index->designId_ = designId_;
+    index->fieldNames_ = fieldNames_;
+    index->fields_ = fields_;
+    
+    return index;
+}
+
+void MangoIndex::Update(unsigned shard, const document_ptr& oldDoc, const document_ptr& newDoc) {
+    auto& entries = shards_[shard];
+    std::vector<MangoValue> keys;
+    
+    if (!!oldDoc && GetKeys(oldDoc, keys)) {
+        entries.erase(Entry{std::move(keys), oldDoc});
+    }
+    
+    if (!!newDoc && GetKeys(newDoc, keys)) {
+        entries.emplace(std::move(keys), newDoc);
+    }
+}
+
+void MangoIndex::Build(unsigned shard, const DocumentCollectionSnapshot& docs) {
+    auto& entries = shards_[shard];
+    entries.clear();
+    
+    for (auto iter = docs.cbegin(), end = docs.cend(); iter != end; ++iter) {
+        std::vector<MangoValue> keys;
+        if (GetKeys(*iter, keys)) {
+            entries.emplace(std::move(keys), *iter);
+        }
+    }
+}
+
+void MangoIndex::Release(unsigned shard) {
+    entry_set{}.swap(shards_[shard]);
+}
+
+unsigned MangoIndex::Score(const MangoSelector& selector) const {
+    unsigned score = 0;
+    auto narrowing = true;
+    
+    for (const auto& field : fields_) {
+        // documents without all of the fields aren't indexed, so every field must be constrained
+        auto range = selector.GetFieldRange(field);
+        if (range == nullptr) {
+            return 0;
+        }
+        
+        if (narrowing) {
+            if (range->IsEquality()) {
+                ++score;
+            } else {
+                if (!range->Lower().IsMissing() || !range->Upper().IsMissing()) {
+                    ++score;
+                }
+                
+                narrowing = false;
+            }
+        }
+    }
+    
+    return score;
+}
+
+void MangoIndex::Find(unsigned shard, const MangoSelector& selector, document_array& docs) const {
+    std::vector<MangoValue> lowerKeys, upperKeys;
+    auto lowerBound = -1, upperBound = 1;
+    
+    // equality on the leading fields followed by an optional range on the next field
+    for (const auto& field : fields_) {
+        auto range = selector.GetFieldRange(field);
+        if (range == nullptr) {
+            break;
+        }
+        
+        if (range->IsEquality()) {
+            lowerKeys.push_back(range->Lower());
+            upperKeys.push_back(range->Upper());
+        } else {
+            if (!range->Lower().IsMissing()) {
+                lowerKeys.push_back(range->Lower());
+                lowerBound = range->LowerInclusive() ? -1 : 1;
+            }
+            
+            if (!range->Upper().IsMissing()) {
+                upperKeys.push_back(range->Upper());
+                upperBound = range->UpperInclusive() ? 1 : -1;
+            }
+            
+            break;
+        }
+    }
+    
+    const auto& entries = shards_[shard];
+    Entry lower{lowerKeys, lowerBound}, upper{upperKeys, upperBound};
+    EntryLess less;
+    
+    for (auto iter = entries.lower_bound(lower), end = entries.cend(); iter != end && less(*iter, upper); ++iter) {
+        docs.push_back(iter->doc_);
+    }
+}
+
+std::size_t MangoIndex::Size(unsigned shard) const {
+    return shards_[shard].size();
+}
+
+bool MangoIndex::GetKeys(const document_ptr& doc, std::vector<MangoValue>& keys) const {
+    // design documents are never returned by _find so there is no point indexing them
+    if (std::strncmp(doc->getId(), "_design/", 8) == 0) {
+        return false;
+    }
+    
+    MangoValue obj{doc->getObject()};
+    
+    keys.clear();
+    keys.reserve(fields_.size());
+    for (const auto& field : fields_) {
+        auto key = obj.getPath(field);
+        if (key.IsMissing()) {
+            return false;
+        }
+        
+        keys.emplace_back(key);
+    }
+    
+    return true;
+}
+
+bool MangoIndex::EntryLess::operator()(const Entry& a, const Entry& b) const {
+    for (decltype(a.keys_.size()) i = 0, size = std::min(a.keys_.size(), b.keys_.size()); i < size; ++i) {
+        auto compare = MangoValue::Compare(a.keys_[i], b.keys_[i]);
+        if (compare != 0) {
+            return compare < 0;
+        }
+    }
+    
+    if (a.bound_ != 0 || b.bound_ != 0) {
+        return a.bound_ < b.bound_;
+    }
+    
+    return std::strcmp(a.doc_->getId(), b.doc_->getId()) < 0;
+}
\ No newline at end of file
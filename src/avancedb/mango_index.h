@@ -0,0 +1,97 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RS_AVANCEDB_MANGO_INDEX_H
+#define RS_AVANCEDB_MANGO_INDEX_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "types.h"
+#include "mango_value.h"
+#include "mango_selector.h"
+
+// a sorted secondary index over one or more document fields, split into the 
+// same shards as the documents, each shard must only be used while holding 
+// the lock of the matching document collection
+class MangoIndex final : private boost::noncopyable {
+public:
+    
+    static mango_index_ptr Create(script_object_ptr definition, unsigned shards);
+    
+    const std::string& Name() const { return name_; }
+    const std::string& DesignId() const { return designId_; }
+    const std::vector<std::string>& FieldNames() const { return fieldNames_; }
+    
+    bool IsSameDefinition(const MangoIndex& other) const;
+    
+    // an empty index with the same definition for a different number of shards
+    mango_index_ptr Reshard(unsigned shards) const;
+    
+    void Update(unsigned shard, const document_ptr& oldDoc, const document_ptr& newDoc);
+    void Build(unsigned shard, const DocumentCollectionSnapshot& docs);
+    
+    // frees the entries of a shard whose collection has been released
+    void Release(unsigned shard);
+    
+    // how many leading fields of the index the selector constrains, 0 when the 
+    // index would not narrow the search or could miss matching documents
+    unsigned Score(const MangoSelector& selector) const;
+    
+    void Find(unsigned shard, const MangoSelector& selector, document_array& docs) const;
+    
+    unsigned Shards() const { return shards_.size(); }
+    std::size_t Size(unsigned shard) const;
+    
+private:
+    
+    // probes sort before (-1) or after (+1) all entries sharing their keys
+    struct Entry final {
+        Entry(std::vector<MangoValue>&& keys, const document_ptr& doc) : keys_(std::move(keys)), doc_(doc), bound_(0) {}
+        Entry(const std::vector<MangoValue>& keys, int bound) : keys_(keys), bound_(bound) {}
+        
+        std::vector<MangoValue> keys_;
+        document_ptr doc_;
+        int bound_;
+    };
+    
+    struct EntryLess final {
+        bool operator()(const Entry& a, const Entry& b) const;
+    };
+    
+    using entry_set = std::set<Entry, EntryLess>;
+    
+    MangoIndex(unsigned shards);
+    
+    bool GetKeys(const document_ptr& doc, std::vector<MangoValue>& keys) const;
+    
+    std::string name_;
+    std::string designId_;
+    std::vector<std::string> fieldNames_;
+    std::vector<MangoValue::path_type> fields_;
+    
+    std::vector<entry_set> shards_;
+};
+
+#endif /* RS_AVANCEDB_MANGO_INDEX_H */
+
@@ -0,0 +1,216 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mango_query.h"
+
+#include <cstring>
+#include <string>
+
+#include "script_object_factory.h"
+#include "script_object_source.h"
+
+#include "document.h"
+#include "rest_exceptions.h"
+
+// exposes a subset of the fields of an object so that a projected copy can be
+// created without going through JSON, nested objects are projected up front
+class ScriptObjectProjectionSource final : public rs::scriptobject::ScriptObjectSource {
+    using ScriptObjectType = rs::scriptobject::ScriptObjectType;
+    
+public:
+    ScriptObjectProjectionSource(const script_object_ptr& obj) : obj_(obj) {}
+    
+    void Add(unsigned index, script_object_ptr child = script_object_ptr{}) {
+        indexes_.push_back(index);
+        children_.push_back(child);
+    }
+    
+    virtual unsigned count() const override { return indexes_.size(); }
+    virtual ScriptObjectType type(int index) const override { return !!children_[index] ? ScriptObjectType::Object : obj_->getType(indexes_[index]); }
+    virtual const char* name(int index) const override { return obj_->getName(indexes_[index]); }
+    virtual unsigned length(int index) const override { return std::strlen(name(index)); }
+    
+    virtual bool getBoolean(int index) const override { return obj_->getBoolean(indexes_[index]); }
+    virtual std::int32_t getInt32(int index) const override { return obj_->getInt32(indexes_[index]); }
+    virtual std::uint32_t getUInt32(int index) const override { return obj_->getUInt32(indexes_[index]); }
+    virtual std::int64_t getInt64(int index) const override { return obj_->getInt64(indexes_[index]); }
+    virtual std::uint64_t getUInt64(int index) const override { return obj_->getUInt64(indexes_[index]); }
+    virtual double getDouble(int index) const override { return obj_->getDouble(indexes_[index]); }
+    virtual const char* getString(int index) const override { return obj_->getString(indexes_[index]); }
+    virtual int getStringLength(int index) const override { return obj_->getStringLength(indexes_[index]); }
+    virtual const rs::scriptobject::ScriptObjectPtr getObject(int index) const override { return !!children_[index] ? children_[index] : obj_->getObject(indexes_[index]); }
+    virtual const rs::scriptobject::ScriptArrayPtr getArray(int index) const override { return obj_->getArray(indexes_[index]); }
+    
+private:
+    const script_object_ptr& obj_;
+    std::vector<unsigned> indexes_;
+    std::vector<script_object_ptr> children_;
+};
+
+MangoQuery::MangoQuery(script_object_ptr query) : skip_(0), limit_(DefaultLimit) {
+    for (unsigned i = 0, count = query->getCount(); i < count; ++i) {
+        auto name = query->getName(i);
+        MangoValue value{query, i};
+        
+        if (std::strcmp(name, "selector") == 0) {
+            if (value.getType() != MangoValue::ScriptObjectType::Object) {
+                throw MangoQueryError{"selector must be an object"};
+            }
+            
+            selector_ = MangoSelector::Compile(value.getObject());
+        } else if (std::strcmp(name, "sort") == 0) {
+            ParseSort(value);
+        } else if (std::strcmp(name, "fields") == 0) {
+            ParseFields(value);
+        } else if (std::strcmp(name, "skip") == 0) {
+            skip_ = ParseUnsigned(name, value);
+        } else if (std::strcmp(name, "limit") == 0) {
+            limit_ = ParseUnsigned(name, value);
+        }
+    }
+    
+    if (!selector_) {
+        throw MangoQueryError{"Missing required key: selector"};
+    }
+}
+
+bool MangoQuery::Match(const document_ptr& doc) const {
+    // design documents are never returned by _find
+    return std::strncmp(doc->getId(), "_design/", 8) != 0 && selector_->Match(doc->getObject());
+}
+
+const MangoSelector& MangoQuery::Selector() const {
+    return *selector_;
+}
+
+bool MangoQuery::Less(const document_ptr& a, const document_ptr& b) const {
+    if (sort_.size() > 0) {
+        MangoValue objA{a->getObject()}, objB{b->getObject()};
+        
+        for (const auto& field : sort_) {
+            auto compare = MangoValue::Compare(objA.getPath(field.path_), objB.getPath(field.path_));
+            if (compare != 0) {
+                return field.descending_ ? compare > 0 : compare < 0;
+            }
+        }
+    }
+    
+    auto compare = std::strcmp(a->getId(), b->getId());
+    return sort_.size() > 0 && sort_[0].descending_ ? compare > 0 : compare < 0;
+}
+
+script_object_ptr MangoQuery::Project(const script_object_ptr& obj) const {
+    if (fields_.size() == 0) {
+        return obj;
+    }
+    
+    fields_array fields;
+    fields.reserve(fields_.size());
+    for (const auto& field : fields_) {
+        fields.push_back(&field);
+    }
+    
+    return Project(obj, fields, 0);
+}
+
+std::uint64_t MangoQuery::Skip() const {
+    return skip_;
+}
+
+std::uint64_t MangoQuery::Limit() const {
+    return limit_;
+}
+
+void MangoQuery::ParseSort(const MangoValue& sort) {
+    if (sort.getType() != MangoValue::ScriptObjectType::Array) {
+        throw MangoQueryError{"sort must be an array"};
+    }
+    
+    for (unsigned i = 0, count = sort.getCount(); i < count; ++i) {
+        auto field = sort.getElement(i);
+        
+        if (field.getType() == MangoValue::ScriptObjectType::String) {
+            sort_.emplace_back(MangoValue::ParsePath(field.getString()), false);
+        } else if (field.getType() == MangoValue::ScriptObjectType::Object && field.getCount() == 1) {
+            auto direction = field.getField(field.getName(0));
+            if (direction.getType() != MangoValue::ScriptObjectType::String || 
+                    (std::strcmp(direction.getString(), "asc") != 0 && std::strcmp(direction.getString(), "desc") != 0)) {
+                throw MangoQueryError{"sort direction must be asc or desc"};
+            }
+            
+            sort_.emplace_back(MangoValue::ParsePath(field.getName(0)), direction.getString()[0] == 'd');
+        } else {
+            throw MangoQueryError{"sort must be an array of field names or {\"field\": \"asc|desc\"} objects"};
+        }
+    }
+}
+
+void MangoQuery::ParseFields(const MangoValue& fields) {
+    if (fields.getType() != MangoValue::ScriptObjectType::Array) {
+        throw MangoQueryError{"fields must be an array of field names"};
+    }
+    
+    for (unsigned i = 0, count = fields.getCount(); i < count; ++i) {
+        auto field = fields.getElement(i);
+        if (field.getType() != MangoValue::ScriptObjectType::String) {
+            throw MangoQueryError{"fields must be an array of field names"};
+        }
+        
+        fields_.emplace_back(MangoValue::ParsePath(field.getString()));
+    }
+}
+
+std::uint64_t MangoQuery::ParseUnsigned(const char* name, const MangoValue& value) {
+    if (!value.IsInteger() || value.getNumber() < 0) {
+        throw MangoQueryError{std::string{name} + " must be a positive integer"};
+    }
+    
+    return static_cast<std::uint64_t>(value.getNumber());
+}
+
+script_object_ptr MangoQuery::Project(const script_object_ptr& obj, const fields_array& fields, unsigned depth) {
+    ScriptObjectProjectionSource source{obj};
+    
+    for (unsigned i = 0, count = obj->getCount(); i < count; ++i) {
+        auto name = obj->getName(i);
+        auto whole = false;
+        fields_array childFields;
+        
+        for (auto field : fields) {
+            if ((*field)[depth] == name) {
+                if (field->size() == depth + 1) {
+                    whole = true;
+                } else {
+                    childFields.push_back(field);
+                }
+            }
+        }
+        
+        if (whole) {
+            source.Add(i);
+        } else if (childFields.size() > 0 && obj->getType(i) == rs::scriptobject::ScriptObjectType::Object) {
+            auto child = Project(obj->getObject(i), childFields, depth + 1);
+            if (child->getCount() > 0) {
+                source.Add(i, child);
+            }
+        }
+    }
+    
+    return rs::scriptobject::ScriptObjectFactory::CreateObject(source);
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RS_AVANCEDB_MANGO_QUERY_H
+#define RS_AVANCEDB_MANGO_QUERY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "mango_value.h"
+#include "mango_selector.h"
+
+// the body of a _find request: selector, fields, sort, skip and limit
+class MangoQuery final {
+public:
+    static const std::uint64_t DefaultLimit = 25;
+    
+    MangoQuery(script_object_ptr query);
+    
+    bool Match(const document_ptr& doc) const;
+    
+    const MangoSelector& Selector() const;
+    
+    // orders documents by the requested sort fields and then by id
+    bool Less(const document_ptr& a, const document_ptr& b) const;
+    
+    // returns the object reduced to the requested fields, or the object itself
+    script_object_ptr Project(const script_object_ptr& obj) const;
+    
+    std::uint64_t Skip() const;
+    std::uint64_t Limit() const;
+    
+private:
+    
+    struct SortField final {
+        SortField(MangoValue::path_type&& path, bool descending) : path_(std::move(path)), descending_(descending) {}
+        
+        MangoValue::path_type path_;
+        bool descending_;
+    };
+    
+    using fields_array = std::vector<const MangoValue::path_type*>;
+    
+    void ParseSort(const MangoValue& sort);
+    void ParseFields(const MangoValue& fields);
+    static std::uint64_t ParseUnsigned(const char* name, const MangoValue& value);
+    
+    static script_object_ptr Project(const script_object_ptr& obj, const fields_array& fields, unsigned depth);
+    
+    mango_selector_ptr selector_;
+    std::vector<SortField> sort_;
+    std::vector<MangoValue::path_type> fields_;
+    std::uint64_t skip_;
+    std::uint64_t limit_;
+};
+
+#endif /* RS_AVANCEDB_MANGO_QUERY_H */
+
@@ -0,0 +1,589 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mango_selector.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/regex.hpp>
+
+#include "script_object_factory.h"
+#include "script_object_vector_source.h"
+
+#include "rest_exceptions.h"
+
+using node_ptr = MangoSelector::node_ptr;
+using node_array = std::vector<node_ptr>;
+
+// the smallest string greater than every string starting with prefix, empty
+// when there is none (an empty prefix or one made only of 0xff bytes)
+static std::string PrefixSuccessor(const char* prefix) {
+    std::string successor{prefix};
+    while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xff) {
+        successor.pop_back();
+    }
+    
+    if (!successor.empty()) {
+        successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+    }
+    
+    return successor;
+}
+
+// casting a double outside the int64 range is undefined so it has to be checked first
+static bool IsInt64(double value) {
+    return value >= -9223372036854775808.0 && value < 9223372036854775808.0;
+}
+
+class AndNode final : public MangoSelector::Node {
+public:
+    AndNode(node_array&& nodes) : nodes_(std::move(nodes)) {}
+    
+    bool Match(const MangoValue& value) const override {
+        for (const auto& node : nodes_) {
+            if (!node->Match(value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+private:
+    const node_array nodes_;
+};
+
+class OrNode final : public MangoSelector::Node {
+public:
+    OrNode(node_array&& nodes) : nodes_(std::move(nodes)) {}
+    
+    bool Match(const MangoValue& value) const override {
+        for (const auto& node : nodes_) {
+            if (node->Match(value)) {
+                return true;
+            }
+        }
+        return nodes_.size() == 0;
+    }
+    
+private:
+    const node_array nodes_;
+};
+
+class NorNode final : public MangoSelector::Node {
+public:
+    NorNode(node_array&& nodes) : nodes_(std::move(nodes)) {}
+    
+    bool Match(const MangoValue& value) const override {
+        for (const auto& node : nodes_) {
+            if (node->Match(value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+private:
+    const node_array nodes_;
+};
+
+class NotNode final : public MangoSelector::Node {
+public:
+    NotNode(node_ptr&& node) : node_(std::move(node)) {}
+    
+    bool Match(const MangoValue& value) const override {
+        return !node_->Match(value);
+    }
+    
+private:
+    const node_ptr node_;
+};
+
+class FieldNode final : public MangoSelector::Node {
+public:
+    FieldNode(MangoValue::path_type&& path, node_ptr&& node) : path_(std::move(path)), node_(std::move(node)) {}
+    
+    bool Match(const MangoValue& value) const override {
+        return node_->Match(value.getPath(path_));
+    }
+    
+private:
+    const MangoValue::path_type path_;
+    const node_ptr node_;
+};
+
+class CompareNode final : public MangoSelector::Node {
+public:
+    enum class Op { Eq, Ne, Lt, Lte, Gt, Gte };
+    
+    CompareNode(Op op, const MangoValue& arg) : op_(op), arg_(arg) {}
+    
+    bool Match(const MangoValue& value) const override {
+        if (value.IsMissing()) {
+            return false;
+        }
+        
+        auto compare = MangoValue::Compare(value, arg_);
+        switch (op_) {
+            case Op::Eq: return compare == 0;
+            case Op::Ne: return compare != 0;
+            case Op::Lt: return compare < 0;
+            case Op::Lte: return compare <= 0;
+            case Op::Gt: return compare > 0;
+            case Op::Gte: return compare >= 0;
+            default: return false;
+        }
+    }
+    
+private:
+    const Op op_;
+    const MangoValue arg_;
+};
+
+class ExistsNode final : public MangoSelector::Node {
+public:
+    ExistsNode(bool exists) : exists_(exists) {}
+    
+    bool Match(const MangoValue& value) const override {
+        return value.IsMissing() != exists_;
+    }
+    
+private:
+    const bool exists_;
+};
+
+class TypeNode final : public MangoSelector::Node {
+public:
+    TypeNode(int precedence) : precedence_(precedence) {}
+    
+    bool Match(const MangoValue& value) const override {
+        return !value.IsMissing() && value.getTypePrecedence() == precedence_;
+    }
+    
+private:
+    const int precedence_;
+};
+
+class InNode final : public MangoSelector::Node {
+public:
+    InNode(const MangoValue& args, bool negate) : args_(args), negate_(negate) {}
+    
+    bool Match(const MangoValue& value) const override {
+        if (value.IsMissing()) {
+            return false;
+        }
+        
+        // an array field is in the list when any of its elements are
+        auto found = false;
+        if (value.getType() == MangoValue::ScriptObjectType::Array) {
+            for (unsigned i = 0, count = value.getCount(); !found && i < count; ++i) {
+                found = Contains(value.getElement(i));
+            }
+        } else {
+            found = Contains(value);
+        }
+        
+        return found != negate_;
+    }
+    
+private:
+    bool Contains(const MangoValue& value) const {
+        for (unsigned i = 0, count = args_.getCount(); i < count; ++i) {
+            if (MangoValue::Compare(value, args_.getElement(i)) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    const MangoValue args_;
+    const bool negate_;
+};
+
+class AllNode final : public MangoSelector::Node {
+public:
+    AllNode(const MangoValue& args) : args_(args) {}
+    
+    bool Match(const MangoValue& value) const override {
+        if (value.getType() != MangoValue::ScriptObjectType::Array || args_.getCount() == 0) {
+            return false;
+        }
+        
+        for (unsigned i = 0, argCount = args_.getCount(); i < argCount; ++i) {
+            auto arg = args_.getElement(i);
+            auto found = false;
+            
+            for (unsigned j = 0, count = value.getCount(); !found && j < count; ++j) {
+                found = MangoValue::Compare(value.getElement(j), arg) == 0;
+            }
+            
+            if (!found) {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+private:
+    const MangoValue args_;
+};
+
+class SizeNode final : public MangoSelector::Node {
+public:
+    SizeNode(unsigned size) : size_(size) {}
+    
+    bool Match(const MangoValue& value) const override {
+        return value.getType() == MangoValue::ScriptObjectType::Array && value.getCount() == size_;
+    }
+    
+private:
+    const unsigned size_;
+};
+
+class ModNode final : public MangoSelector::Node {
+public:
+    ModNode(std::int64_t divisor, std::int64_t remainder) : divisor_(divisor), remainder_(remainder) {}
+    
+    bool Match(const MangoValue& value) const override {
+        if (!value.IsInteger() || !IsInt64(value.getNumber())) {
+            return false;
+        }
+        
+        // INT64_MIN % -1 overflows, every integer divides by -1 anyway
+        auto number = static_cast<std::int64_t>(value.getNumber());
+        return (divisor_ != -1 ? number % divisor_ : 0) == remainder_;
+    }
+    
+private:
+    const std::int64_t divisor_;
+    const std::int64_t remainder_;
+};
+
+class RegexNode final : public MangoSelector::Node {
+public:
+    RegexNode(const char* pattern) : regex_(pattern) {}
+    
+    bool Match(const MangoValue& value) const override {
+        return value.getType() == MangoValue::ScriptObjectType::String && boost::regex_search(value.getString(), regex_);
+    }
+    
+private:
+    const boost::regex regex_;
+};
+
+class BeginsWithNode final : public MangoSelector::Node {
+public:
+    BeginsWithNode(const char* prefix) : prefix_(prefix) {}
+    
+    bool Match(const MangoValue& value) const override {
+        return value.getType() == MangoValue::ScriptObjectType::String && std::strncmp(value.getString(), prefix_.c_str(), prefix_.size()) == 0;
+    }
+    
+private:
+    const std::string prefix_;
+};
+
+class ElemMatchNode final : public MangoSelector::Node {
+public:
+    ElemMatchNode(node_ptr&& node, bool all) : node_(std::move(node)), all_(all) {}
+    
+    bool Match(const MangoValue& value) const override {
+        if (value.getType() != MangoValue::ScriptObjectType::Array || value.getCount() == 0) {
+            return false;
+        }
+        
+        for (unsigned i = 0, count = value.getCount(); i < count; ++i) {
+            if (node_->Match(value.getElement(i)) != all_) {
+                return !all_;
+            }
+        }
+        
+        return all_;
+    }
+    
+private:
+    const node_ptr node_;
+    const bool all_;
+};
+
+static MangoQueryError BadArgument(const char* op, const char* expected) {
+    return MangoQueryError{std::string{"Bad argument for operator "} + op + ", expected " + expected};
+}
+
+MangoSelector::MangoSelector(script_object_ptr selector) : selector_(selector) {
+    
+}
+
+mango_selector_ptr MangoSelector::Compile(script_object_ptr selector) {
+    if (!selector) {
+        throw MangoQueryError{"Missing required key: selector"};
+    }
+    
+    mango_selector_ptr compiled{new MangoSelector{selector}};
+    compiled->root_ = compiled->CompileSelector(selector, MangoValue::path_type{}, true);
+    return compiled;
+}
+
+bool MangoSelector::Match(const script_object_ptr& doc) const {
+    return root_->Match(MangoValue{doc});
+}
+
+const MangoSelector::FieldRange* MangoSelector::GetFieldRange(const MangoValue::path_type& path) const {
+    for (const auto& range : ranges_) {
+        if (range.Path() == path) {
+            return &range;
+        }
+    }
+    
+    return nullptr;
+}
+
+MangoSelector::FieldRange& MangoSelector::AddFieldRange(const MangoValue::path_type& path) {
+    for (auto& range : ranges_) {
+        if (range.Path() == path) {
+            return range;
+        }
+    }
+    
+    ranges_.emplace_back(path);
+    return ranges_.back();
+}
+
+node_ptr MangoSelector::CompileSelector(const script_object_ptr& selector, const MangoValue::path_type& path, bool ranged) {
+    node_array nodes;
+    
+    for (unsigned i = 0, count = selector->getCount(); i < count; ++i) {
+        auto name = selector->getName(i);
+        MangoValue arg{selector, i};
+        
+        if (name[0] == '$') {
+            nodes.emplace_back(CompileOperator(name, arg, path, ranged));
+        } else {
+            auto fieldPath = MangoValue::ParsePath(name);
+            
+            auto fullPath = path;
+            fullPath.insert(fullPath.end(), fieldPath.cbegin(), fieldPath.cend());
+            
+            nodes.emplace_back(new FieldNode{std::move(fieldPath), CompileCondition(arg, fullPath, ranged)});
+        }
+    }
+    
+    // sibling conditions are implicitly and'ed together
+    if (nodes.size() == 1) {
+        return std::move(nodes[0]);
+    } else {
+        return node_ptr{new AndNode{std::move(nodes)}};
+    }
+}
+
+node_ptr MangoSelector::CompileCondition(const MangoValue& arg, const MangoValue::path_type& path, bool ranged) {
+    // objects hold operators and/or nested fields, anything else is an implicit $eq
+    if (arg.getType() == MangoValue::ScriptObjectType::Object && arg.getCount() > 0) {
+        return CompileSelector(arg.getObject(), path, ranged);
+    } else {
+        return CompileOperator("$eq", arg, path, ranged);
+    }
+}
+
+node_ptr MangoSelector::CompileOperator(const char* op, const MangoValue& arg, const MangoValue::path_type& path, bool ranged) {
+    using ScriptObjectType = MangoValue::ScriptObjectType;
+    
+    // ranges can only be taken from conditions on a field which aren't negated or alternatives
+    auto bounded = ranged && path.size() > 0;
+    
+    if (std::strcmp(op, "$and") == 0 || std::strcmp(op, "$or") == 0 || std::strcmp(op, "$nor") == 0) {
+        if (arg.getType() != ScriptObjectType::Array) {
+            throw BadArgument(op, "an array of selectors");
+        }
+        
+        auto isAnd = op[1] == 'a';
+        
+        node_array nodes;
+        for (unsigned i = 0, count = arg.getCount(); i < count; ++i) {
+            auto element = arg.getElement(i);
+            if (element.getType() != ScriptObjectType::Object) {
+                throw BadArgument(op, "an array of selectors");
+            }
+            
+            nodes.emplace_back(CompileSelector(element.getObject(), path, isAnd && ranged));
+        }
+        
+        if (isAnd) {
+            return node_ptr{new AndNode{std::move(nodes)}};
+        } else if (op[2] == 'r') {
+            return node_ptr{new OrNode{std::move(nodes)}};
+        } else {
+            return node_ptr{new NorNode{std::move(nodes)}};
+        }
+    } else if (std::strcmp(op, "$not") == 0) {
+        if (arg.getType() != ScriptObjectType::Object) {
+            throw BadArgument(op, "a selector");
+        }
+        
+        return node_ptr{new NotNode{CompileSelector(arg.getObject(), path, false)}};
+    } else if (std::strcmp(op, "$eq") == 0) {
+        if (bounded) {
+            auto& range = AddFieldRange(path);
+            range.TightenLower(arg, true);
+            range.TightenUpper(arg, true);
+        }
+        
+        return node_ptr{new CompareNode{CompareNode::Op::Eq, arg}};
+    } else if (std::strcmp(op, "$ne") == 0) {
+        return node_ptr{new CompareNode{CompareNode::Op::Ne, arg}};
+    } else if (std::strcmp(op, "$lt") == 0 || std::strcmp(op, "$lte") == 0) {
+        auto inclusive = op[3] == 'e';
+        if (bounded) {
+            AddFieldRange(path).TightenUpper(arg, inclusive);
+        }
+        
+        return node_ptr{new CompareNode{inclusive ? CompareNode::Op::Lte : CompareNode::Op::Lt, arg}};
+    } else if (std::strcmp(op, "$gt") == 0 || std::strcmp(op, "$gte") == 0) {
+        auto inclusive = op[3] == 'e';
+        if (bounded) {
+            AddFieldRange(path).TightenLower(arg, inclusive);
+        }
+        
+        return node_ptr{new CompareNode{inclusive ? CompareNode::Op::Gte : CompareNode::Op::Gt, arg}};
+    } else if (std::strcmp(op, "$exists") == 0) {
+        if (arg.getType() != ScriptObjectType::Boolean) {
+            throw BadArgument(op, "a boolean");
+        }
+        
+        if (bounded && arg.getBoolean()) {
+            AddFieldRange(path);
+        }
+        
+        return node_ptr{new ExistsNode{arg.getBoolean()}};
+    } else if (std::strcmp(op, "$type") == 0) {
+        static const char* types[] = { "null", "boolean", "number", "string", "array", "object" };
+        
+        if (arg.getType() == ScriptObjectType::String) {
+            for (unsigned i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+                if (std::strcmp(types[i], arg.getString()) == 0) {
+                    if (bounded) {
+                        AddFieldRange(path);
+                    }
+                    
+                    return node_ptr{new TypeNode{static_cast<int>(i)}};
+                }
+            }
+        }
+        
+        throw BadArgument(op, "one of null, boolean, number, string, array or object");
+    } else if (std::strcmp(op, "$in") == 0 || std::strcmp(op, "$nin") == 0) {
+        if (arg.getType() != ScriptObjectType::Array) {
+            throw BadArgument(op, "an array");
+        }
+        
+        auto negate = op[1] == 'n';
+        
+        // array fields match on any of their elements so the list can't bound the field
+        if (bounded && !negate) {
+            AddFieldRange(path);
+        }
+        
+        return node_ptr{new InNode{arg, negate}};
+    } else if (std::strcmp(op, "$all") == 0) {
+        if (arg.getType() != ScriptObjectType::Array) {
+            throw BadArgument(op, "an array");
+        }
+        
+        return node_ptr{new AllNode{arg}};
+    } else if (std::strcmp(op, "$size") == 0) {
+        if (!arg.IsInteger() || arg.getNumber() < 0) {
+            throw BadArgument(op, "a positive integer");
+        }
+        
+        return node_ptr{new SizeNode{static_cast<unsigned>(arg.getNumber())}};
+    } else if (std::strcmp(op, "$mod") == 0) {
+        if (arg.getType() != ScriptObjectType::Array || arg.getCount() != 2 || 
+                !arg.getElement(0).IsInteger() || !arg.getElement(1).IsInteger() || 
+                !IsInt64(arg.getElement(0).getNumber()) || !IsInt64(arg.getElement(1).getNumber()) ||
+                arg.getElement(0).getNumber() == 0) {
+            throw BadArgument(op, "[non-zero divisor, remainder]");
+        }
+        
+        auto divisor = static_cast<std::int64_t>(arg.getElement(0).getNumber());
+        auto remainder = static_cast<std::int64_t>(arg.getElement(1).getNumber());
+        return node_ptr{new ModNode{divisor, remainder}};
+    } else if (std::strcmp(op, "$regex") == 0) {
+        if (arg.getType() != ScriptObjectType::String) {
+            throw BadArgument(op, "a string");
+        }
+        
+        try {
+            return node_ptr{new RegexNode{arg.getString()}};
+        } catch (const boost::regex_error&) {
+            throw BadArgument(op, "a valid regular expression");
+        }
+    } else if (std::strcmp(op, "$beginsWith") == 0) {
+        if (arg.getType() != ScriptObjectType::String) {
+            throw BadArgument(op, "a string");
+        }
+        
+        if (bounded) {
+            auto& range = AddFieldRange(path);
+            range.TightenLower(arg, true);
+            
+            auto successor = PrefixSuccessor(arg.getString());
+            if (!successor.empty()) {
+                rs::scriptobject::utils::ScriptObjectVectorSource boundSource({
+                    std::make_pair("upper", successor.c_str())
+                });
+                
+                bounds_.push_back(rs::scriptobject::ScriptObjectFactory::CreateObject(boundSource));
+                range.TightenUpper(MangoValue{bounds_.back(), 0}, false);
+            }
+        }
+        
+        return node_ptr{new BeginsWithNode{arg.getString()}};
+    } else if (std::strcmp(op, "$elemMatch") == 0 || std::strcmp(op, "$allMatch") == 0) {
+        if (arg.getType() != ScriptObjectType::Object) {
+            throw BadArgument(op, "a selector");
+        }
+        
+        return node_ptr{new ElemMatchNode{CompileSelector(arg.getObject(), MangoValue::path_type{}, false), op[1] == 'a'}};
+    } else {
+        throw MangoQueryError{std::string{"Invalid operator: "} + op};
+    }
+}
+
+void MangoSelector::FieldRange::TightenLower(const MangoValue& lower, bool inclusive) {
+    auto compare = lower_.IsMissing() ? 1 : MangoValue::Compare(lower, lower_);
+    if (compare > 0 || (compare == 0 && !inclusive)) {
+        lower_ = lower;
+        lowerInclusive_ = inclusive;
+    }
+}
+
+void MangoSelector::FieldRange::TightenUpper(const MangoValue& upper, bool inclusive) {
+    auto compare = upper_.IsMissing() ? -1 : MangoValue::Compare(upper, upper_);
+    if (compare < 0 || (compare == 0 && !inclusive)) {
+        upper_ = upper;
+        upperInclusive_ = inclusive;
+    }
+}
+
+bool MangoSelector::FieldRange::IsEquality() const {
+    return !lower_.IsMissing() && !upper_.IsMissing() && lowerInclusive_ && upperInclusive_ && MangoValue::Compare(lower_, upper_) == 0;
+}
\ No newline at end of file
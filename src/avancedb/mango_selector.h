@@ -0,0 +1,100 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RS_AVANCEDB_MANGO_SELECTOR_H
+#define RS_AVANCEDB_MANGO_SELECTOR_H
+
+#include <memory>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "types.h"
+#include "mango_value.h"
+
+// a Mango selector compiled into a tree of native predicates, the tree holds 
+// no per-match state so a single selector can be matched from many threads
+class MangoSelector final : private boost::noncopyable {
+public:
+    class Node {
+    public:
+        virtual ~Node() {}
+        virtual bool Match(const MangoValue& value) const = 0;
+    };
+    
+    using node_ptr = std::unique_ptr<Node>;
+    
+    // the bounds a selector places on a field which every match must satisfy, 
+    // a missing bound is unbounded, used by the planner to pick an index
+    class FieldRange final {
+    public:
+        FieldRange(const MangoValue::path_type& path) : path_(path), lowerInclusive_(true), upperInclusive_(true) {}
+        
+        void TightenLower(const MangoValue& lower, bool inclusive);
+        void TightenUpper(const MangoValue& upper, bool inclusive);
+        
+        bool IsEquality() const;
+        
+        const MangoValue::path_type& Path() const { return path_; }
+        const MangoValue& Lower() const { return lower_; }
+        const MangoValue& Upper() const { return upper_; }
+        bool LowerInclusive() const { return lowerInclusive_; }
+        bool UpperInclusive() const { return upperInclusive_; }
+        
+    private:
+        MangoValue::path_type path_;
+        MangoValue lower_;
+        MangoValue upper_;
+        bool lowerInclusive_;
+        bool upperInclusive_;
+    };
+    
+    using field_ranges = std::vector<FieldRange>;
+    
+    static mango_selector_ptr Compile(script_object_ptr selector);
+    
+    bool Match(const script_object_ptr& doc) const;
+    
+    const FieldRange* GetFieldRange(const MangoValue::path_type& path) const;
+    
+private:
+    
+    MangoSelector(script_object_ptr selector);
+    
+    node_ptr CompileSelector(const script_object_ptr& selector, const MangoValue::path_type& path, bool ranged);
+    node_ptr CompileCondition(const MangoValue& arg, const MangoValue::path_type& path, bool ranged);
+    node_ptr CompileOperator(const char* op, const MangoValue& arg, const MangoValue::path_type& path, bool ranged);
+    
+    FieldRange& AddFieldRange(const MangoValue::path_type& path);
+    
+    // the compiled operands reference values held by the selector object
+    const script_object_ptr selector_;
+    
+    // generated range bounds (the successor of a $beginsWith prefix) aren't in 
+    // the selector object so they are held here for the ranges to reference
+    std::vector<script_object_ptr> bounds_;
+    node_ptr root_;
+    
+    // only conditions which are and'ed together from the root constrain the matches
+    field_ranges ranges_;
+};
+
+#endif /* RS_AVANCEDB_MANGO_SELECTOR_H */
+
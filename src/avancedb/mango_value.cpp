@@ -0,0 +1,239 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mango_value.h"
+
+#include <cmath>
+#include <cstring>
+
+template <typename T>
+static double GetNumber(const T& container, int index, rs::scriptobject::ScriptObjectType type) {
+    using ScriptObjectType = rs::scriptobject::ScriptObjectType;
+    
+    switch (type) {
+        case ScriptObjectType::Int32: return container->getInt32(index);
+        case ScriptObjectType::UInt32: return container->getUInt32(index);
+        case ScriptObjectType::Int64: return container->getInt64(index);
+        case ScriptObjectType::UInt64: return container->getUInt64(index);
+        case ScriptObjectType::Double: return container->getDouble(index);
+        default: return 0;
+    }
+}
+
+static inline int CompareDouble(double a, double b) {
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+MangoValue::MangoValue() : type_(ScriptObjectType::Unknown), index_(NoIndex) {
+    
+}
+
+MangoValue::MangoValue(const script_object_ptr& obj) : 
+        type_(!!obj ? ScriptObjectType::Object : ScriptObjectType::Unknown), obj_(obj), index_(NoIndex) {
+    
+}
+
+MangoValue::MangoValue(const script_array_ptr& arr) : 
+        type_(!!arr ? ScriptObjectType::Array : ScriptObjectType::Unknown), arr_(arr), index_(NoIndex) {
+    
+}
+
+MangoValue::MangoValue(const script_object_ptr& obj, unsigned index) : type_(obj->getType(index)), index_(index) {
+    switch (type_) {
+        case ScriptObjectType::Object: obj_ = obj->getObject(index); index_ = NoIndex; break;
+        case ScriptObjectType::Array: arr_ = obj->getArray(index); index_ = NoIndex; break;
+        default: obj_ = obj; break;
+    }
+}
+
+MangoValue::MangoValue(const script_array_ptr& arr, unsigned index) : type_(arr->getType(index)), index_(index) {
+    switch (type_) {
+        case ScriptObjectType::Object: obj_ = arr->getObject(index); index_ = NoIndex; break;
+        case ScriptObjectType::Array: arr_ = arr->getArray(index); index_ = NoIndex; break;
+        default: arr_ = arr; break;
+    }
+}
+
+bool MangoValue::IsNumber() const {
+    switch (type_) {
+        case ScriptObjectType::Int32:
+        case ScriptObjectType::UInt32:
+        case ScriptObjectType::Int64:
+        case ScriptObjectType::UInt64:
+        case ScriptObjectType::Double:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool MangoValue::IsInteger() const {
+    if (type_ == ScriptObjectType::Double) {
+        auto number = getNumber();
+        return std::isfinite(number) && std::trunc(number) == number;
+    } else {
+        return IsNumber();
+    }
+}
+
+int MangoValue::getTypePrecedence() const {
+    switch (type_) {
+        case ScriptObjectType::Null: return 0;
+        case ScriptObjectType::Boolean: return 1;
+        case ScriptObjectType::Int32: return 2;
+        case ScriptObjectType::UInt32: return 2;
+        case ScriptObjectType::Int64: return 2;
+        case ScriptObjectType::UInt64: return 2;
+        case ScriptObjectType::Double: return 2;
+        case ScriptObjectType::String: return 3;
+        case ScriptObjectType::Array: return 4;
+        case ScriptObjectType::Object: return 5;
+        default: return -1;
+    }
+}
+
+double MangoValue::getNumber() const {
+    return !!obj_ ? GetNumber(obj_, index_, type_) : GetNumber(arr_, index_, type_);
+}
+
+bool MangoValue::getBoolean() const {
+    return !!obj_ ? obj_->getBoolean(index_) : arr_->getBoolean(index_);
+}
+
+const char* MangoValue::getString() const {
+    return !!obj_ ? obj_->getString(index_) : arr_->getString(index_);
+}
+
+unsigned MangoValue::getCount() const {
+    switch (type_) {
+        case ScriptObjectType::Object: return obj_->getCount();
+        case ScriptObjectType::Array: return arr_->getCount();
+        default: return 0;
+    }
+}
+
+const char* MangoValue::getName(unsigned index) const {
+    return obj_->getName(index);
+}
+
+MangoValue MangoValue::getElement(unsigned index) const {
+    if (type_ == ScriptObjectType::Array && index < arr_->getCount()) {
+        return MangoValue{arr_, index};
+    } else {
+        return MangoValue{};
+    }
+}
+
+MangoValue MangoValue::getField(const char* name) const {
+    if (type_ == ScriptObjectType::Object) {
+        for (unsigned i = 0, count = obj_->getCount(); i < count; ++i) {
+            if (std::strcmp(name, obj_->getName(i)) == 0) {
+                return MangoValue{obj_, i};
+            }
+        }
+    }
+    
+    return MangoValue{};
+}
+
+MangoValue MangoValue::getPath(const path_type& path) const {
+    if (path.size() == 0) {
+        return *this;
+    }
+    
+    auto value = getField(path[0].c_str());
+    for (decltype(path.size()) i = 1, size = path.size(); i < size && !value.IsMissing(); ++i) {
+        value = value.getField(path[i].c_str());
+    }
+    
+    return value;
+}
+
+MangoValue::path_type MangoValue::ParsePath(const char* field) {
+    path_type path;
+    std::string name;
+    
+    for (auto ch = field; *ch != '\0'; ++ch) {
+        if (*ch == '\\' && *(ch + 1) == '.') {
+            name += '.';
+            ++ch;
+        } else if (*ch == '.') {
+            path.emplace_back(name);
+            name.clear();
+        } else {
+            name += *ch;
+        }
+    }
+    
+    path.emplace_back(name);
+    return path;
+}
+
+int MangoValue::Compare(const MangoValue& a, const MangoValue& b) {
+    auto compare = a.getTypePrecedence() - b.getTypePrecedence();
+    
+    if (compare == 0) {
+        switch (a.type_) {
+            case ScriptObjectType::Boolean: 
+                compare = static_cast<int>(a.getBoolean()) - static_cast<int>(b.getBoolean()); 
+                break;
+                
+            case ScriptObjectType::String: 
+                compare = std::strcmp(a.getString(), b.getString()); 
+                break;
+                
+            case ScriptObjectType::Array: {
+                auto countA = a.getCount();
+                auto countB = b.getCount();
+                for (unsigned i = 0; compare == 0 && i < countA && i < countB; ++i) {
+                    compare = Compare(a.getElement(i), b.getElement(i));
+                }
+                
+                if (compare == 0) {
+                    compare = CompareDouble(countA, countB);
+                }
+                break;
+            }
+            
+            case ScriptObjectType::Object: {
+                auto countA = a.getCount();
+                auto countB = b.getCount();
+                for (unsigned i = 0; compare == 0 && i < countA && i < countB; ++i) {
+                    compare = std::strcmp(a.getName(i), b.getName(i));
+                    if (compare == 0) {
+                        compare = Compare(MangoValue{a.obj_, i}, MangoValue{b.obj_, i});
+                    }
+                }
+                
+                if (compare == 0) {
+                    compare = CompareDouble(countA, countB);
+                }
+                break;
+            }
+            
+            default:
+                if (a.IsNumber()) {
+                    compare = CompareDouble(a.getNumber(), b.getNumber());
+                }
+                break;
+        }
+    }
+    
+    return compare;
+}
\ No newline at end of file
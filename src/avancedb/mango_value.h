@@ -0,0 +1,77 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RS_AVANCEDB_MANGO_VALUE_H
+#define RS_AVANCEDB_MANGO_VALUE_H
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// a reference to a single value inside a document (or a selector) which is 
+// either an object/array itself or a scalar held at an index of its parent,
+// values are compared using the same collation as view keys
+class MangoValue final {
+public:
+    using ScriptObjectType = rs::scriptobject::ScriptObjectType;
+    using path_type = std::vector<std::string>;
+    
+    MangoValue();
+    explicit MangoValue(const script_object_ptr& obj);
+    explicit MangoValue(const script_array_ptr& arr);
+    MangoValue(const script_object_ptr& obj, unsigned index);
+    MangoValue(const script_array_ptr& arr, unsigned index);
+    
+    bool IsMissing() const { return type_ == ScriptObjectType::Unknown; }
+    bool IsNumber() const;
+    bool IsInteger() const;
+    
+    ScriptObjectType getType() const { return type_; }
+    int getTypePrecedence() const;
+    
+    double getNumber() const;
+    bool getBoolean() const;
+    const char* getString() const;
+    const script_object_ptr& getObject() const { return obj_; }
+    const script_array_ptr& getArray() const { return arr_; }
+    
+    unsigned getCount() const;
+    const char* getName(unsigned index) const;
+    MangoValue getElement(unsigned index) const;
+    MangoValue getField(const char* name) const;
+    MangoValue getPath(const path_type& path) const;
+    
+    // splits a field name on unescaped dots, "a.b\.c" is ["a", "b.c"]
+    static path_type ParsePath(const char* field);
+    
+    static int Compare(const MangoValue& a, const MangoValue& b);
+    
+private:
+    
+    static const int NoIndex = -1;
+    
+    ScriptObjectType type_;
+    script_object_ptr obj_;
+    script_array_ptr arr_;
+    int index_;
+};
+
+#endif /* RS_AVANCEDB_MANGO_VALUE_H */
+
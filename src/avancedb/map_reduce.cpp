@@ -25,6 +25,7 @@
 #include <memory>
 #include <algorithm>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 
 #include "script_array_jsapi_key_value_source.h"
@@ -48,71 +49,23 @@ MapReduce::MapReduce() : mapReduceThreadPool_(MapReduceThreadPool::Get()) {
 }
 
 map_reduce_results_ptr MapReduce::Execute(const GetViewOptions& options, const MapReduceTask& task, document_collections_ptr_array colls) {
-    auto language = task.Language();
-    if (!boost::iequals("javascript", language)) {
-        throw BadLanguageError{language};
-    }
-    
-    std::mutex m;
-    auto collsSize = colls.size();
     std::vector<map_reduce_shard_results_ptr> filteredResults;
-    std::vector<rs::jsapi::ScriptException> scriptExceptions;
-    std::atomic<int> threads(collsSize);
-    std::condition_variable threadEnd;
+    filteredResults.reserve(colls.size());
     
+    Execute(options, task, colls, [&](map_reduce_shard_results_ptr result) {
+        filteredResults.emplace_back(result);
+    });
+    
+    return Merge(options, filteredResults);
+}
+
+map_reduce_results_ptr MapReduce::Merge(const GetViewOptions& options, const std::vector<map_reduce_shard_results_ptr>& filteredResults) {
+    auto collsSize = filteredResults.size();
+    std::atomic<int> threads(0);
     const auto skip = options.Skip();
     const auto limit = options.Limit();
-    const auto startKey = options.StartKeyObj();
-    const auto endKey = options.EndKeyObj();
-    const auto inclusiveEnd = options.InclusiveEnd();
     const auto descending = options.Descending();
     
-    // run the map
-    for (auto& coll : colls) {
-        mapReduceThreadPool_->Post([&](size_t threadId) {
-            std::unique_lock<std::mutex> lock{m, std::defer_lock};
-            
-            try {
-                BOOST_SCOPE_EXIT(&threads) { --threads; } BOOST_SCOPE_EXIT_END
-                auto& cx = mapReduceThreadPool_->GetThreadContext(threadId);
-                
-                boost::unique_lock<document_collections_ptr_array::value_type::element_type> collLock{*coll};                
-                document_array docs;
-                coll->copy(docs, false);
-                collLock.unlock();
-                
-                auto result = Execute(cx, task, docs);                                
-                
-                auto filteredResult = boost::make_shared<map_reduce_shard_results_ptr::element_type>(
-                    result, skip + std::min(limit, result->size()), startKey, endKey, inclusiveEnd, descending);               
-
-                lock.lock();
-                filteredResults.emplace_back(filteredResult);
-                threadEnd.notify_one();
-            } catch (const rs::jsapi::ScriptException& ex) {
-                lock.lock();
-                threadEnd.notify_one();
-                scriptExceptions.emplace_back(ex);
-            }
-        });
-    }
-    
-    // wait for the map threads to finish
-    std::unique_lock<std::mutex> lock{m};
-    threadEnd.wait(lock, [&]() { return threads.load() == 0; });
-    
-    // we need to pass back any script exceptions to the caller
-    if (scriptExceptions.size() > 0) {
-        auto what = scriptExceptions[0].what();
-        throw CompilationError{what};
-    }
-    
-    // if the number of results doesn't match the number of colls then
-    // we've most likely got a non-script exception during the map phase
-    if (filteredResults.size() != colls.size()) {
-        throw MapReduceException{};
-    }
-    
     // calculate the number of map rows and offsets
     decltype(filteredResults.size()) filteredRows = 0;
     decltype(filteredResults.size()) totalRows = 0;
@@ -183,16 +136,122 @@ map_reduce_results_ptr MapReduce::Execute(const GetViewOptions& options, const M
     return boost::make_shared<map_reduce_results_ptr::element_type>(results, offset, totalRows, skip, limit, descending);
 }
 
-map_reduce_result_array_ptr MapReduce::Execute(rs::jsapi::Context& cx, const MapReduceTask& task, const document_array& docs) {
+void MapReduce::Execute(const GetViewOptions& options, const MapReduceTask& task, document_collections_ptr_array colls, const shard_results_handler& handler) {
+    auto language = task.Language();
+    if (!boost::iequals("javascript", language)) {
+        throw BadLanguageError{language};
+    }
+    
+    std::mutex m;
+    std::deque<map_reduce_shard_results_ptr> completedResults;
+    std::vector<rs::jsapi::ScriptException> scriptExceptions;
+    std::atomic<int> threads(colls.size());
+    std::condition_variable shardEnd;
+    decltype(colls.size()) handledResults = 0;
+    
+    const auto skip = options.Skip();
+    const auto limit = options.Limit();
+    const auto startKey = options.StartKeyObj();
+    const auto endKey = options.EndKeyObj();
+    const auto inclusiveEnd = options.InclusiveEnd();
+    const auto descending = options.Descending();
+    
+    // run the map
+    for (auto& coll : colls) {
+        mapReduceThreadPool_->Post([&](size_t threadId) {
+            std::unique_lock<std::mutex> lock{m, std::defer_lock};
+            
+            try {
+                auto& cx = mapReduceThreadPool_->GetThreadContext(threadId);
+                
+                document_collection_snapshot_ptr docs;
+                {
+                    boost::shared_lock<DocumentCollection> collLock{*coll};
+                    docs = coll->Snapshot();
+                }
+                
+                auto result = Execute(cx, task, docs);                                
+                
+                auto filteredResult = boost::make_shared<map_reduce_shard_results_ptr::element_type>(
+                    result, skip + std::min(limit, result->size()), startKey, endKey, inclusiveEnd, descending);               
+
+                lock.lock();
+                completedResults.emplace_back(filteredResult);
+            } catch (const rs::jsapi::ScriptException& ex) {
+                if (!lock.owns_lock()) {
+                    lock.lock();
+                }
+                scriptExceptions.emplace_back(ex);
+            } catch (...) {
+                if (!lock.owns_lock()) {
+                    lock.lock();
+                }
+            }
+            
+            --threads;
+            shardEnd.notify_one();
+        });
+    }
+    
+    std::unique_lock<std::mutex> lock{m};
+    
+    // the map threads reference this stack frame so they must all finish before 
+    // we leave, even when the handler throws
+    BOOST_SCOPE_EXIT(&lock, &shardEnd, &threads) {
+        if (!lock.owns_lock()) {
+            lock.lock();
+        }
+        
+        while (threads.load() > 0) {
+            shardEnd.wait(lock);
+        }
+    } BOOST_SCOPE_EXIT_END
+    
+    // hand the shard results to the caller as they arrive
+    while (threads.load() > 0 || completedResults.size() > 0) {
+        shardEnd.wait(lock, [&]() { return completedResults.size() > 0 || threads.load() == 0; });
+        
+        while (completedResults.size() > 0) {
+            auto result = completedResults.front();
+            completedResults.pop_front();
+            
+            // once a shard has failed there is no point passing on more results
+            if (scriptExceptions.size() == 0) {
+                lock.unlock();
+                handler(result);
+                lock.lock();
+                
+                ++handledResults;
+            }
+        }
+    }
+    
+    // we need to pass back any script exceptions to the caller
+    if (scriptExceptions.size() > 0) {
+        auto what = scriptExceptions[0].what();
+        throw CompilationError{what};
+    }
+    
+    // if the number of results doesn't match the number of colls then
+    // we've most likely got a non-script exception during the map phase
+    if (handledResults != colls.size()) {
+        throw MapReduceException{};
+    }
+}
+
+map_reduce_result_array_ptr MapReduce::Execute(rs::jsapi::Context& cx, const MapReduceTask& task, document_collection_snapshot_ptr docs) {
     map_reduce_result_array_ptr results = boost::make_shared<map_reduce_result_array_ptr::element_type>();
+    results->reserve(docs->size());
+    
+    // the rows point at the documents without counting references, the snapshot outlives them
+    results->retain(docs);
     
     // create the function script
     std::string mapScript = "(function() { return ";
     mapScript += task.Map();
     mapScript += "; })();";
     
-    document_array::value_type empty;
-    auto doc = std::cref(empty);
+    const Document* doc = nullptr;
 
     // define a function in global scope implemented by a C++ lambda
     rs::jsapi::Global::DefineFunction(cx, "emit", 
@@ -232,9 +291,9 @@ map_reduce_result_array_ptr MapReduce::Execute(rs::jsapi::Context& cx, const Map
     rs::jsapi::FunctionArguments args(cx);
     args.Append(object);
 
-    for (DocumentCollection::size_type i = 0, size = docs.size(); i < size; ++i) {
-        doc = std::cref(docs[i]);
-        scriptObj = doc.get()->getObject();
+    for (auto iter = docs->cbegin(), end = docs->cend(); iter != end; ++iter) {
+        doc = iter->get();
+        scriptObj = doc->getObject();
 
         state->scriptObj_ = scriptObj;
 
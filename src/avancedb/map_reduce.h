@@ -20,6 +20,8 @@
 #define RS_AVANCEDB_MAP_REDUCE_H
 
 #include <string>
+#include <vector>
+#include <functional>
 
 #include "types.h"
 #include "map_reduce_results.h"
@@ -58,23 +60,30 @@ public:
         const std::string language_;
     };
     
+    using shard_results_handler = std::function<void(map_reduce_shard_results_ptr)>;
+    
     MapReduce();
     
     map_reduce_results_ptr Execute(const GetViewOptions& options, const MapReduceTask& task, document_collections_ptr_array colls);
     
+    // the handler is called on the calling thread as each shard completes its map, in completion order
+    void Execute(const GetViewOptions& options, const MapReduceTask& task, document_collections_ptr_array colls, const shard_results_handler& handler);
+    
+    map_reduce_results_ptr Merge(const GetViewOptions& options, const std::vector<map_reduce_shard_results_ptr>& shardResults);
+    
     static script_object_ptr GetValueScriptObject(const rs::jsapi::Value& value);
     static script_array_ptr GetValueScriptArray(const rs::jsapi::Value& value);
     
+    static void CreateValueObject(script_object_ptr obj, rs::jsapi::Value& value);
+    static void CreateValueArray(script_array_ptr arr, rs::jsapi::Value& value);
+    
 private:
     
-    map_reduce_result_array_ptr Execute(rs::jsapi::Context& cx, const MapReduceTask& task, const document_array& docs);
+    map_reduce_result_array_ptr Execute(rs::jsapi::Context& cx, const MapReduceTask& task, document_collection_snapshot_ptr docs);
     
     static void GetFieldValue(script_object_ptr scriptObj, const char* name, rs::jsapi::Value& value);
     static void GetFieldValue(script_array_ptr scriptObj, int index, rs::jsapi::Value& value);
     
-    static void CreateValueObject(script_object_ptr obj, rs::jsapi::Value& value);
-    static void CreateValueArray(script_array_ptr arr, rs::jsapi::Value& value);
-    
     static void SortResultArray(map_reduce_result_array_ptr results);
     
     MapReduceThreadPool::map_reduce_thread_pool_ptr mapReduceThreadPool_;
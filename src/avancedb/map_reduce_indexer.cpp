@@ -0,0 +1,85 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "map_reduce_indexer.h"
+
+#include "set_thread_name.h"
+
+MapReduceIndexer::MapReduceIndexer(index_handler handler) : handler_(handler), stop_(false) {
+    
+}
+
+MapReduceIndexer::~MapReduceIndexer() {
+    Stop();
+}
+
+void MapReduceIndexer::Stop() {
+    std::unique_lock<std::mutex> lock{m_};
+    stop_ = true;
+    jobPosted_.notify_all();
+    lock.unlock();
+    
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MapReduceIndexer::Post(const std::string& key, const MapReduce::MapReduceTask& task, const GetViewOptions& options) {
+    std::unique_lock<std::mutex> lock{m_};
+    
+    if (!stop_ && pendingKeys_.insert(key).second) {
+        jobs_.emplace_back(new Job{key, task, options.Query()});
+        
+        if (!thread_.joinable()) {
+            thread_ = std::thread{&MapReduceIndexer::Run, this};
+        }
+        
+        jobPosted_.notify_one();
+    }
+}
+
+std::size_t MapReduceIndexer::Pending() const {
+    std::unique_lock<std::mutex> lock{m_};
+    return pendingKeys_.size();
+}
+
+void MapReduceIndexer::Run() {
+    SetThreadName::Set("avancedb-index");
+    
+    std::unique_lock<std::mutex> lock{m_};
+    
+    while (!stop_) {
+        jobPosted_.wait(lock, [&]() { return stop_ || jobs_.size() > 0; });
+        
+        if (!stop_) {
+            auto job = std::move(jobs_.front());
+            jobs_.pop_front();
+            lock.unlock();
+            
+            try {
+                GetViewOptions options{job->qs_};
+                handler_(job->task_, options);
+            } catch (...) {
+                // the next stale read will queue the view again
+            }
+            
+            lock.lock();
+            pendingKeys_.erase(job->key_);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_MAP_REDUCE_INDEXER_H
+#define RS_AVANCEDB_MAP_REDUCE_INDEXER_H
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <unordered_set>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "libhttpserver.h"
+
+#include "map_reduce.h"
+#include "get_view_options.h"
+
+// brings views up to date in the background for queries which were answered 
+// from stale results, the thread is only started when the first job is posted
+class MapReduceIndexer final {
+public:
+    using index_handler = std::function<void(const MapReduce::MapReduceTask&, const GetViewOptions&)>;
+    
+    MapReduceIndexer(index_handler handler);
+    MapReduceIndexer(const MapReduceIndexer&) = delete;
+    MapReduceIndexer& operator=(const MapReduceIndexer&) = delete;
+    ~MapReduceIndexer();
+    
+    // jobs are keyed so that a view which is already queued isn't queued again
+    void Post(const std::string& key, const MapReduce::MapReduceTask& task, const GetViewOptions& options);
+    
+    std::size_t Pending() const;
+    
+    // drops the queued jobs and waits for the one running, nothing is indexed afterwards
+    void Stop();
+    
+private:
+    
+    struct Job final {
+        Job(const std::string& key, const MapReduce::MapReduceTask& task, const rs::httpserver::QueryString& qs) :
+            key_(key), task_(task), qs_(qs) {}
+        
+        const std::string key_;
+        const MapReduce::MapReduceTask task_;
+        const rs::httpserver::QueryString qs_;
+    };
+    
+    void Run();
+    
+    const index_handler handler_;
+    
+    mutable std::mutex m_;
+    std::condition_variable jobPosted_;
+    std::deque<std::unique_ptr<Job>> jobs_;
+    std::unordered_set<std::string> pendingKeys_;
+    bool stop_;
+    
+    std::thread thread_;
+};
+
+#endif /* RS_AVANCEDB_MAP_REDUCE_INDEXER_H */
+
@@ -0,0 +1,104 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "map_reduce_merged_results_iterator.h"
+
+#include <algorithm>
+
+#include "map_reduce_result.h"
+
+MapReduceMergedResultsIterator::MapReduceMergedResultsIterator(const std::vector<map_reduce_shard_results_ptr>& shardResults, size_type skip, size_type limit, bool descending) :
+        shardResults_(shardResults), descending_(descending), skip_(0), limit_(limit), offset_(0), totalRows_(0) {
+    
+    size_type filteredRows = 0;
+    
+    heap_.reserve(shardResults_.size());
+    for (const auto& result : shardResults_) {
+        filteredRows += result->FilteredRows();
+        totalRows_ += result->TotalRows();
+        offset_ += result->Offset();
+        
+        if (result->cbegin() != result->cend()) {
+            heap_.push_back({result->cbegin(), result->cend()});
+        }
+    }
+    
+    skip_ = std::min(skip, filteredRows);
+    offset_ = std::min(offset_ + skip_, totalRows_);
+    
+    std::make_heap(heap_.begin(), heap_.end(), [&](const Cursor& a, const Cursor& b) { return HeapCompare(a, b); });
+}
+
+map_reduce_result_ptr MapReduceMergedResultsIterator::Next() {
+    while (skip_ > 0) {
+        --skip_;
+        Pop();
+    }
+    
+    map_reduce_result_ptr result = nullptr;
+    if (limit_ > 0) {
+        result = Pop();
+        if (result) {
+            --limit_;
+        }
+    }
+    
+    return result;
+}
+
+MapReduceMergedResultsIterator::size_type MapReduceMergedResultsIterator::Offset() const {
+    return offset_;
+}
+
+MapReduceMergedResultsIterator::size_type MapReduceMergedResultsIterator::TotalRows() const {
+    return totalRows_;
+}
+
+map_reduce_result_ptr MapReduceMergedResultsIterator::Pop() {
+    map_reduce_result_ptr result = nullptr;
+    
+    if (heap_.size() > 0) {
+        auto compare = [&](const Cursor& a, const Cursor& b) { return HeapCompare(a, b); };
+        
+        std::pop_heap(heap_.begin(), heap_.end(), compare);
+        
+        auto& cursor = heap_.back();
+        if (!descending_) {
+            result = *cursor.begin_++;
+        } else {
+            result = *--cursor.end_;
+        }
+        
+        if (cursor.begin_ != cursor.end_) {
+            std::push_heap(heap_.begin(), heap_.end(), compare);
+        } else {
+            heap_.pop_back();
+        }
+    }
+    
+    return result;
+}
+
+bool MapReduceMergedResultsIterator::HeapCompare(const Cursor& a, const Cursor& b) const {
+    // std heaps keep the greatest element at the front so the order is inverted when ascending
+    if (!descending_) {
+        return MapReduceResult::Less(*b.begin_, *a.begin_);
+    } else {
+        return MapReduceResult::Less(*(a.end_ - 1), *(b.end_ - 1));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_MAP_REDUCE_MERGED_RESULTS_ITERATOR_H
+#define RS_AVANCEDB_MAP_REDUCE_MERGED_RESULTS_ITERATOR_H
+
+#include <vector>
+
+#include "types.h"
+#include "map_reduce_shard_results.h"
+
+// performs a k-way merge over the sorted shard results so that rows can be 
+// streamed without first materializing the fully merged results
+class MapReduceMergedResultsIterator final {
+public:
+    using size_type = MapReduceShardResults::size_type;
+    
+    MapReduceMergedResultsIterator(const std::vector<map_reduce_shard_results_ptr>& shardResults, size_type skip, size_type limit, bool descending);
+    
+    map_reduce_result_ptr Next();
+    
+    size_type Offset() const;
+    size_type TotalRows() const;
+    
+private:
+    
+    struct Cursor final {
+        MapReduceShardResults::const_iterator begin_;
+        MapReduceShardResults::const_iterator end_;
+    };
+    
+    map_reduce_result_ptr Pop();
+    
+    bool HeapCompare(const Cursor& a, const Cursor& b) const;
+    
+    const std::vector<map_reduce_shard_results_ptr> shardResults_;
+    const bool descending_;
+    std::vector<Cursor> heap_;
+    size_type skip_;
+    size_type limit_;
+    size_type offset_;
+    size_type totalRows_;
+};
+
+#endif /* RS_AVANCEDB_MAP_REDUCE_MERGED_RESULTS_ITERATOR_H */
+
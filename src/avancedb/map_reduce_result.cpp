@@ -23,12 +23,12 @@
 #include "document.h"
 #include "map_reduce_result_comparers.h"
 
-MapReduceResult::MapReduceResult(script_array_ptr&& result, document_ptr&& doc) :
+MapReduceResult::MapReduceResult(script_array_ptr&& result, const Document* doc) :
         result_(result), doc_(doc), id_(doc->getId()) {
 }
 
-map_reduce_result_ptr MapReduceResult::Create(script_array_ptr result, document_ptr doc) {    
-    return new MapReduceResult{std::move(result), std::move(doc)};
+map_reduce_result_ptr MapReduceResult::Create(script_array_ptr result, const Document* doc) {    
+    return new MapReduceResult{std::move(result), doc};
 }
 
 const char* MapReduceResult::MapReduceResult::getId() const {
@@ -43,7 +43,7 @@ rs::scriptobject::ScriptObjectType MapReduceResult::getValueType() const {
     return result_->getType(ValueIndex);
 }
 
-const document_ptr MapReduceResult::getDoc() const {
+const Document* MapReduceResult::getDoc() const {
     return doc_;
 }
 
@@ -60,6 +60,9 @@ std::int32_t MapReduceResult::getKeyInt32() const {
 }
 
 double MapReduceResult::getKeyDouble() const {
+    if (getKeyType() == rs::scriptobject::ScriptObjectType::Int32) {
+        return result_->getInt32(KeyIndex);
+    }
     return result_->getDouble(KeyIndex);
 }
 
@@ -84,6 +87,9 @@ std::int32_t MapReduceResult::getValueInt32() const {
 }
 
 double MapReduceResult::getValueDouble() const {
+    if (getValueType() == rs::scriptobject::ScriptObjectType::Int32) {
+        return result_->getInt32(ValueIndex);
+    }
     return result_->getDouble(ValueIndex);
 }
 
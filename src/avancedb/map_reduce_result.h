@@ -31,10 +31,11 @@ public:
     static constexpr unsigned KeyIndex{0};
     static constexpr unsigned ValueIndex{1};
     
-    static map_reduce_result_ptr Create(script_array_ptr result, document_ptr doc);
+    // the document is owned by the collection snapshot the result array holds
+    static map_reduce_result_ptr Create(script_array_ptr result, const Document* doc);
     
     const char* getId() const;
-    const document_ptr getDoc() const;
+    const Document* getDoc() const;
     const script_array_ptr getResultArray() const;
     
     rs::scriptobject::ScriptObjectType getKeyType() const;
@@ -64,10 +65,10 @@ public:
     
 private:
     
-    MapReduceResult(script_array_ptr&&, document_ptr&&);
+    MapReduceResult(script_array_ptr&&, const Document*);
     
     const char* id_;
-    document_ptr doc_;
+    const Document* doc_;
     script_array_ptr result_;
 
 };
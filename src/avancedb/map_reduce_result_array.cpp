@@ -24,7 +24,7 @@ MapReduceResultArray::MapReduceResultArray(collection::size_type capacity) {
     data_.reserve(capacity);
 }
 
-MapReduceResultArray::MapReduceResultArray(MapReduceResultArray&& rhs) : data_(std::move(rhs.data_)) {
+MapReduceResultArray::MapReduceResultArray(MapReduceResultArray&& rhs) : data_(std::move(rhs.data_)), docs_(std::move(rhs.docs_)) {
     
 }
 
@@ -74,6 +74,14 @@ void MapReduceResultArray::push_back(map_reduce_result_ptr ptr) {
     data_.push_back(ptr);
 }
 
+void MapReduceResultArray::retain(document_collection_snapshot_ptr docs) {
+    docs_ = docs;
+}
+
+const document_collection_snapshot_ptr& MapReduceResultArray::retained() const {
+    return docs_;
+}
+
 void MapReduceResultArray::insert(iterator position, const_iterator first, const_iterator last, const map_reduce_result_array_ptr& sourcePtr) {
     // TODO: this case has two personalities - that should be refactored out sometime
     if (data_.size() > 0 && sources_.size() == 0) {
@@ -55,6 +55,10 @@ public:
     
     void push_back(map_reduce_result_ptr);
     
+    // keeps the documents the results point at alive for as long as the array
+    void retain(document_collection_snapshot_ptr docs);
+    const document_collection_snapshot_ptr& retained() const;
+    
     collection& operator=(const collection&) = delete;
     const_reference operator[](int n) const;
     
@@ -62,6 +66,7 @@ private:
     collection data_;
     
     std::vector<map_reduce_result_array_ptr> sources_;
+    document_collection_snapshot_ptr docs_;
 };
 
 #endif /* RS_AVANCEDB_MAP_REDUCE_RESULT_ARRAY_H */
@@ -152,11 +152,16 @@ private:
 
         if (typeA != typeB) {
             compare = GetScriptObjectTypePrecedence(typeA) - GetScriptObjectTypePrecedence(typeB);
+            
+            // integer and floating point keys share a precedence so compare their values
+            if (compare == 0 && IsNumber(typeA) && IsNumber(typeB)) {
+                compare = CompareDouble(GetNumber(index, a, typeA), GetNumber(index, b, typeB));
+            }
         } else {
             switch (typeA) {
                 case ScriptObjectType::Null: compare = 0; break;
                 case ScriptObjectType::Boolean: compare = CompareBoolean(a->getBoolean(index), b->getBoolean(index)); break;
-                case ScriptObjectType::Int32: compare = a->getInt32(index) - b->getInt32(index); break;
+                case ScriptObjectType::Int32: compare = CompareInt32(a->getInt32(index), b->getInt32(index)); break;
                 case ScriptObjectType::Double: compare = CompareDouble(a->getDouble(index), b->getDouble(index)); break;
                 case ScriptObjectType::String: compare = std::strcmp(a->getString(index), b->getString(index)); break;
                 case ScriptObjectType::Object: compare = CompareImpl(a->getObject(index), b->getObject(index)); break;
@@ -171,6 +176,19 @@ private:
         return a < b ? -1 : (a > b ? 1 : 0);
     }
     
+    static inline int CompareInt32(std::int32_t a, std::int32_t b) {
+        return a < b ? -1 : (a > b ? 1 : 0);
+    }
+    
+    static inline bool IsNumber(rs::scriptobject::ScriptObjectType type) {
+        return type == rs::scriptobject::ScriptObjectType::Int32 || type == rs::scriptobject::ScriptObjectType::Double;
+    }
+    
+    template <typename T>
+    static inline double GetNumber(unsigned index, const T& obj, rs::scriptobject::ScriptObjectType type) {
+        return type == rs::scriptobject::ScriptObjectType::Int32 ? obj->getInt32(index) : obj->getDouble(index);
+    }
+    
     static inline int CompareBoolean(bool a, bool b) {
         return a == b ? 0 : (a == false ? -1 : 1);
     }
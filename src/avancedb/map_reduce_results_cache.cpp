@@ -0,0 +1,209 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "map_reduce_results_cache.h"
+
+#include <iterator>
+
+#include <boost/format.hpp>
+
+#include "get_view_options.h"
+#include "map_reduce_shard_results.h"
+#include "map_reduce_result_array.h"
+#include "map_reduce_result.h"
+#include "document_collection_snapshot.h"
+#include "document.h"
+
+#include "city.h"
+
+MapReduceResultsCache::MapReduceResultsCache(size_type capacity) : 
+        capacity_(capacity), size_(0), hits_(0), misses_(0) {
+    
+}
+
+std::string MapReduceResultsCache::MakeKey(const MapReduce::MapReduceTask& task, const GetViewOptions& options) {
+    std::string source = task.Language();
+    source += '\0';
+    source += task.Map();
+    source += '\0';
+    source += task.Reduce();
+    
+    auto sourceHash = CityHash64(source.c_str(), source.size());
+    
+    // only the options which change the shard results take part in the key
+    auto key = (boost::format("%016x|%u|%u|%d|%d|%d|%d") 
+        % sourceHash
+        % options.Skip()
+        % options.Limit()
+        % options.Descending()
+        % options.InclusiveEnd()
+        % options.HasStartKey()
+        % options.HasEndKey()).str();
+    
+    // the raw keys are length prefixed so a separator inside one can't make two queries collide
+    for (const auto* field : { &options.StartKey(), &options.StartKeyDocId(), &options.EndKey(), &options.EndKeyDocId() }) {
+        key += (boost::format("|%u:") % field->size()).str();
+        key += *field;
+    }
+    
+    return key;
+}
+
+bool MapReduceResultsCache::Get(const std::string& key, sequence_type updateSequence, shard_results_array& results) {
+    auto found = false;
+    
+    if (capacity_ > 0) {
+        std::lock_guard<std::mutex> lock{m_};
+
+        auto iter = entries_.find(key);
+        if (iter != entries_.end()) {
+            if (iter->second.updateSequence_ == updateSequence) {
+                lru_.splice(lru_.begin(), lru_, iter->second.lruIter_);
+                results = iter->second.results_;
+                found = true;
+            } else if (iter->second.updateSequence_ < updateSequence) {
+                // the caller is about to rebuild the entry so the stale one is released now
+                Erase(iter);
+            }
+        }
+    }
+    
+    if (found) {
+        ++hits_;
+    } else {
+        ++misses_;
+    }
+    
+    return found;
+}
+
+void MapReduceResultsCache::Put(const std::string& key, sequence_type updateSequence, const shard_results_array& results) {
+    if (capacity_ > 0) {
+        auto size = GetResultsSize(results);
+        
+        std::lock_guard<std::mutex> lock{m_};
+        
+        auto iter = entries_.find(key);
+        if (iter != entries_.end()) {
+            if (iter->second.updateSequence_ > updateSequence) {
+                return;
+            }
+            
+            Erase(iter);
+        }
+        
+        // results bigger than the whole cache would only flush everything else out
+        if (size <= capacity_) {
+            while (size_ + size > capacity_) {
+                Erase(entries_.find(lru_.back()));
+            }
+            
+            lru_.push_front(key);
+            entries_.emplace(key, Entry{updateSequence, results, size, lru_.begin()});
+            size_ += size;
+        }
+    }
+}
+
+void MapReduceResultsCache::Purge(sequence_type updateSequence) {
+    std::lock_guard<std::mutex> lock{m_};
+    
+    for (auto iter = entries_.begin(); iter != entries_.end();) {
+        auto next = std::next(iter);
+        if (iter->second.updateSequence_ < updateSequence) {
+            Erase(iter);
+        }
+        
+        iter = next;
+    }
+}
+
+bool MapReduceResultsCache::GetLatest(const std::string& key, shard_results_array& results, sequence_type& updateSequence) {
+    auto found = false;
+    
+    if (capacity_ > 0) {
+        std::lock_guard<std::mutex> lock{m_};
+
+        auto iter = entries_.find(key);
+        if (iter != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, iter->second.lruIter_);
+            results = iter->second.results_;
+            updateSequence = iter->second.updateSequence_;
+            found = true;
+        }
+    }
+    
+    if (found) {
+        ++hits_;
+    } else {
+        ++misses_;
+    }
+    
+    return found;
+}
+
+MapReduceResultsCache::size_type MapReduceResultsCache::Capacity() const {
+    return capacity_;
+}
+
+MapReduceResultsCache::size_type MapReduceResultsCache::Size() const {
+    std::lock_guard<std::mutex> lock{m_};
+    return size_;
+}
+
+MapReduceResultsCache::size_type MapReduceResultsCache::Count() const {
+    std::lock_guard<std::mutex> lock{m_};
+    return entries_.size();
+}
+
+std::uint64_t MapReduceResultsCache::Hits() const {
+    return hits_;
+}
+
+std::uint64_t MapReduceResultsCache::Misses() const {
+    return misses_;
+}
+
+MapReduceResultsCache::size_type MapReduceResultsCache::GetResultsSize(const shard_results_array& results) {
+    size_type size = 0;
+    
+    for (const auto& shardResults : results) {
+        auto rows = shardResults->SourceResults();
+        for (auto iter = rows->cbegin(); iter != rows->cend(); ++iter) {
+            size += sizeof(MapReduceResult) + sizeof(map_reduce_result_ptr) + (*iter)->getResultArray()->getSize(true);
+        }
+        
+        // the rows retain the snapshot of the shard they were mapped from, which keeps every document 
+        // of that version alive after the database has replaced or deleted it, so it is charged too
+        const auto& docs = rows->retained();
+        if (!!docs) {
+            size += sizeof(DocumentCollectionSnapshot) + docs->size() * sizeof(document_ptr);
+            for (auto iter = docs->cbegin(); iter != docs->cend(); ++iter) {
+                size += (*iter)->getDataSize();
+            }
+        }
+    }
+    
+    return size;
+}
+
+void MapReduceResultsCache::Erase(std::unordered_map<std::string, Entry>::iterator iter) {
+    size_ -= iter->second.size_;
+    lru_.erase(iter->second.lruIter_);
+    entries_.erase(iter);
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_MAP_REDUCE_RESULTS_CACHE_H
+#define RS_AVANCEDB_MAP_REDUCE_RESULTS_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+#include <boost/atomic.hpp>
+
+#include "types.h"
+#include "map_reduce.h"
+
+class GetViewOptions;
+
+// an LRU cache of the filtered shard results of a view query bounded by the bytes of the rows
+// it holds and of the document snapshots they retain, entries are current for the update 
+// sequence they were produced at and stale afterwards
+class MapReduceResultsCache final {
+public:
+    using shard_results_array = std::vector<map_reduce_shard_results_ptr>;
+    using size_type = std::size_t;
+    
+    // the capacity is in bytes
+    MapReduceResultsCache(size_type capacity);
+    MapReduceResultsCache(const MapReduceResultsCache&) = delete;
+    MapReduceResultsCache& operator=(const MapReduceResultsCache&) = delete;
+    
+    static std::string MakeKey(const MapReduce::MapReduceTask& task, const GetViewOptions& options);
+    
+    bool Get(const std::string& key, sequence_type updateSequence, shard_results_array& results);
+    bool GetLatest(const std::string& key, shard_results_array& results, sequence_type& updateSequence);
+    void Put(const std::string& key, sequence_type updateSequence, const shard_results_array& results);
+    
+    // drops the entries produced before the update sequence, stale reads of them then rebuild
+    void Purge(sequence_type updateSequence);
+    
+    size_type Capacity() const;
+    size_type Size() const;
+    size_type Count() const;
+    std::uint64_t Hits() const;
+    std::uint64_t Misses() const;
+    
+private:
+    
+    struct Entry final {
+        sequence_type updateSequence_;
+        shard_results_array results_;
+        size_type size_;
+        std::list<std::string>::iterator lruIter_;
+    };
+    
+    static size_type GetResultsSize(const shard_results_array& results);
+    
+    void Erase(std::unordered_map<std::string, Entry>::iterator iter);
+    
+    const size_type capacity_;
+    
+    mutable std::mutex m_;
+    size_type size_;
+    std::list<std::string> lru_;
+    std::unordered_map<std::string, Entry> entries_;
+    
+    boost::atomic<std::uint64_t> hits_;
+    boost::atomic<std::uint64_t> misses_;
+};
+
+#endif /* RS_AVANCEDB_MAP_REDUCE_RESULTS_CACHE_H */
+
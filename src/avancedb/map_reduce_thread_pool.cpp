@@ -31,6 +31,7 @@ MapReduceThreadPool::map_reduce_thread_pool_ptr MapReduceThreadPool::Start(
     threadPoolOptions.threads_count = Config::MapReduce::Workers();
 
     threadPool->threadPoolContexts_.resize(threadPoolOptions.threads_count);
+    threadPool->threadPoolFunctions_.resize(threadPoolOptions.threads_count);
 
     threadPoolOptions.onStart = [=](size_t id){
         SetThreadName::Set("avancedb-mapred");
@@ -40,6 +41,7 @@ MapReduceThreadPool::map_reduce_thread_pool_ptr MapReduceThreadPool::Start(
     };
 
     threadPoolOptions.onStop = [=](size_t id) {
+        threadPool->threadPoolFunctions_[id].clear();
         threadPool->threadPoolContexts_[id].release();
     };
     
@@ -60,4 +62,23 @@ void MapReduceThreadPool::Stop() {
 
 rs::jsapi::Context& MapReduceThreadPool::GetThreadContext(size_t threadId) {
     return *(threadPoolContexts_[threadId]);
+}
+
+rs::jsapi::Value& MapReduceThreadPool::GetThreadFunction(size_t id, const std::string& script) {
+    auto& functions = threadPoolFunctions_[id];
+    
+    auto iter = functions.find(script);
+    if (iter != functions.end()) {
+        return *(iter->second);
+    }
+    
+    if (functions.size() >= MaxThreadFunctions) {
+        functions.clear();
+    }
+    
+    // only successfully compiled functions are cached, the exception propagates to the caller
+    std::unique_ptr<rs::jsapi::Value> func{new rs::jsapi::Value(GetThreadContext(id))};
+    GetThreadContext(id).Evaluate(script.c_str(), *func);
+    
+    return *(functions[script] = std::move(func));
 }
\ No newline at end of file
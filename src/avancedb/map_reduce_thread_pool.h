@@ -19,6 +19,10 @@
 #ifndef RS_AVANCEDB_MAP_REDUCE_THREAD_POOL_H
 #define RS_AVANCEDB_MAP_REDUCE_THREAD_POOL_H
 
+#include <string>
+#include <memory>
+#include <unordered_map>
+
 #include <boost/thread.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
@@ -47,12 +51,21 @@ public:
     
     rs::jsapi::Context& GetThreadContext(size_t id);
     
+    // evaluates the script to a function once per thread, must be called on the pool thread
+    rs::jsapi::Value& GetThreadFunction(size_t id, const std::string& script);
+    
 private:
+    using function_cache = std::unordered_map<std::string, std::unique_ptr<rs::jsapi::Value>>;
+    
+    // bounds the cache when design documents keep changing
+    static const std::size_t MaxThreadFunctions = 256;
+    
     friend map_reduce_thread_pool_ptr boost::make_shared<map_reduce_thread_pool_ptr::element_type>();
     
     MapReduceThreadPool() {}
 
     std::vector<std::unique_ptr<rs::jsapi::Context>> threadPoolContexts_;
+    std::vector<function_cache> threadPoolFunctions_;
     std::unique_ptr<ThreadPool> threadPool_;
 };
 
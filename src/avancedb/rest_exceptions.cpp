@@ -27,6 +27,7 @@ static const char* badRequestDescription = "Bad Request";
 static const char* notFoundDescription = "Not Found";
 static const char* conflictDescription = "Conflict";
 static const char* forbiddenDescription = "Forbidden";
+static const char* unauthorizedDescription = "Unauthorized";
 static const char* requestedRangeErrorDescription = "Requested Range Not Satisfiable";
 static const char* internalServerErrorDescription = "Internal Server Error";
 
@@ -65,6 +66,16 @@ static const char* missingDocumentAttachmentJsonBody = R"({
     "reason": "Document is missing attachment"
 })";
 
+static const char* missingViewJsonBody = R"({
+    "error": "not_found",
+    "reason": "missing_named_view"
+})";
+
+static const char* missingIndexJsonBody = R"({
+    "error": "not_found",
+    "reason": "Index not found"
+})";
+
 static const char* uuidCountLimitJsonBody = R"({
     "error": "forbidden",
     "reason": "count parameter too large"
@@ -95,6 +106,46 @@ static const char* requestedRangeErrorJsonBody = R"({
     "reason": "Requested range not satisfiable"
 })";
 
+static const char* mangoQueryErrorJsonBody = R"({
+    "error": "bad_request",
+    "reason": "%s"
+})";
+
+static const char* missingDesignFunctionJsonBody = R"({
+    "error": "not_found",
+    "reason": "missing %s function %s"
+})";
+
+static const char* internalServerErrorJsonBody = R"({
+    "error": "unknown_error",
+    "reason": "The request failed after its response had started."
+})";
+
+static const char* reshardInProgressJsonBody = R"({
+    "error": "conflict",
+    "reason": "The database is already being resharded."
+})";
+
+static const char* renderErrorJsonBody = R"({
+    "error": "render_error",
+    "reason": "%s"
+})";
+
+static const char* documentForbiddenJsonBody = R"({
+    "error": "forbidden",
+    "reason": "%s"
+})";
+
+static const char* documentUnauthorizedJsonBody = R"({
+    "error": "unauthorized",
+    "reason": "%s"
+})";
+
+static const char* missingStubJsonBody = R"({
+    "error": "missing_stub",
+    "reason": "Invalid attachment stub in %s for %s"
+})";
+
 static const char* contentType = "application/json";
 
 DatabaseAlreadyExists::DatabaseAlreadyExists() : 
@@ -132,6 +183,16 @@ DocumentMissing::DocumentMissing() :
     
 }
 
+MissingView::MissingView() :
+    HttpServerException(404, notFoundDescription, missingViewJsonBody, contentType) {
+    
+}
+
+MissingIndex::MissingIndex() :
+    HttpServerException(404, notFoundDescription, missingIndexJsonBody, contentType) {
+    
+}
+
 DocumentAttachmentMissing::DocumentAttachmentMissing() :
     HttpServerException(404, notFoundDescription, missingDocumentAttachmentJsonBody, contentType) {
     
@@ -170,4 +231,44 @@ BadRangeError::BadRangeError() :
 BadRequestBodyError::BadRequestBodyError() :
     HttpServerException(400, badRequestDescription, std::string{}, contentType) {
     
-}
\ No newline at end of file
+}
+
+MangoQueryError::MangoQueryError(const std::string& msg) :
+    HttpServerException(400, badRequestDescription, (boost::format(mangoQueryErrorJsonBody) % JsonHelper::EscapeJsonString(msg.c_str())).str(), contentType) {
+    
+}
+
+MissingDesignFunction::MissingDesignFunction(const char* type, const char* name) :
+    HttpServerException(404, notFoundDescription, (boost::format(missingDesignFunctionJsonBody) % type % JsonHelper::EscapeJsonString(name)).str(), contentType) {
+    
+}
+
+RenderError::RenderError(const char* msg) :
+    HttpServerException(500, internalServerErrorDescription, (boost::format(renderErrorJsonBody) % JsonHelper::EscapeJsonString(msg)).str(), contentType) {
+    
+}
+
+DocumentForbidden::DocumentForbidden(const char* reason) :
+    HttpServerException(403, forbiddenDescription, (boost::format(documentForbiddenJsonBody) % JsonHelper::EscapeJsonString(reason)).str(), contentType) {
+    
+}
+
+DocumentUnauthorized::DocumentUnauthorized(const char* reason) :
+    HttpServerException(401, unauthorizedDescription, (boost::format(documentUnauthorizedJsonBody) % JsonHelper::EscapeJsonString(reason)).str(), contentType) {
+    
+}
+
+MissingStub::MissingStub(const char* id, const char* name) :
+    HttpServerException(412, preconditionFailedDescription, (boost::format(missingStubJsonBody) % JsonHelper::EscapeJsonString(id) % JsonHelper::EscapeJsonString(name)).str(), contentType) {
+    
+}
+
+InternalServerError::InternalServerError() :
+    HttpServerException(500, internalServerErrorDescription, internalServerErrorJsonBody, contentType) {
+    
+}
+
+ReshardInProgress::ReshardInProgress() :
+    HttpServerException(409, conflictDescription, reshardInProgressJsonBody, contentType) {
+    
+}
@@ -56,6 +56,16 @@ public:
     DocumentMissing();
 };
 
+class MissingView final : public HttpServerException {
+public:
+    MissingView();
+};
+
+class MissingIndex final : public HttpServerException {
+public:
+    MissingIndex();
+};
+
 class DocumentAttachmentMissing final : public HttpServerException {
 public:
     DocumentAttachmentMissing();
@@ -96,4 +106,44 @@ public:
     BadRequestBodyError();
 };
 
+class MangoQueryError final : public HttpServerException {
+public:
+    MangoQueryError(const std::string& msg);
+};
+
+class MissingDesignFunction final : public HttpServerException {
+public:
+    MissingDesignFunction(const char* type, const char* name);
+};
+
+class RenderError final : public HttpServerException {
+public:
+    RenderError(const char* msg);
+};
+
+class DocumentForbidden final : public HttpServerException {
+public:
+    DocumentForbidden(const char* reason);
+};
+
+class DocumentUnauthorized final : public HttpServerException {
+public:
+    DocumentUnauthorized(const char* reason);
+};
+
+class MissingStub final : public HttpServerException {
+public:
+    MissingStub(const char* id, const char* name);
+};
+
+class InternalServerError final : public HttpServerException {
+public:
+    InternalServerError();
+};
+
+class ReshardInProgress final : public HttpServerException {
+public:
+    ReshardInProgress();
+};
+
 #endif /* RS_AVANCEDB_REST_EXCEPTIONS_H */
@@ -23,8 +23,11 @@
 #include <iomanip>
 #include <vector>
 #include <algorithm>
+#include <cctype>
+#include <thread>
 
 #include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
 
 #include "content_types.h"
 #include "json_stream.h"
@@ -37,12 +40,20 @@
 #include "rest_config.h"
 #include "document_revision.h"
 #include "map_reduce_result.h"
-#include "map_reduce_results_iterator.h"
+#include "map_reduce_merged_results_iterator.h"
 #include "get_view_options.h"
+#include "mango_query.h"
+#include "mango_index.h"
+#include "search_query.h"
+#include "get_search_options.h"
+#include "get_spatial_options.h"
+#include "design_functions.h"
+#include "json_helper.h"
 
 #include "libscriptobject_gason.h"
 #include "libscriptobject_msgpack.h"
 #include "base64_helper.h"
+#include "script_object_vector_source.h"
 
 #define REGEX_DBNAME R"(_?[a-z][a-z0-9_\$\+\-\(\)]+)"
 #define REGEX_DBNAME_GROUP "/(?<db>" REGEX_DBNAME ")"
@@ -51,9 +62,22 @@
 #define REGEX_ATTACHMENT_NAME R"(.*)"
 #define REGEX_DESIGNID REGEX_DOCID
 #define REGEX_VIEWID REGEX_DOCID
+#define REGEX_INDEXNAME REGEX_DOCID
+#define REGEX_SEARCHID REGEX_DOCID
+#define REGEX_SPATIALID REGEX_DOCID
+#define REGEX_SHOWID REGEX_DOCID
+#define REGEX_LISTID REGEX_DOCID
+#define REGEX_UPDATEID REGEX_DOCID
 #define REGEX_DOCID_GROUP "/+(?<id>" REGEX_DOCID ")"
 #define REGEX_DESIGNID_GROUP "/+(?<designid>" REGEX_DESIGNID ")"
 #define REGEX_VIEWID_GROUP "/+(?<viewid>" REGEX_VIEWID ")"
+#define REGEX_INDEXNAME_GROUP "/+(?<indexname>" REGEX_INDEXNAME ")"
+#define REGEX_SEARCHID_GROUP "/+(?<searchid>" REGEX_SEARCHID ")"
+#define REGEX_SPATIALID_GROUP "/+(?<spatialid>" REGEX_SPATIALID ")"
+#define REGEX_SHOWID_GROUP "/+(?<showid>" REGEX_SHOWID ")"
+#define REGEX_LISTID_GROUP "/+(?<listid>" REGEX_LISTID ")"
+#define REGEX_UPDATEID_GROUP "/+(?<updateid>" REGEX_UPDATEID ")"
+#define REGEX_VIEWDESIGNID_GROUP "/+(?<viewdesignid>" REGEX_DESIGNID ")"
 #define REGEX_ATTACHMENT_NAME_GROUP "/+(?<attname>" REGEX_ATTACHMENT_NAME ")"
 
 RestServer::RestServer() {
@@ -64,12 +88,14 @@ RestServer::RestServer() {
     AddRoute("HEAD", "/+", &RestServer::HeadServer);
     
     AddRoute("DELETE", REGEX_DBNAME_GROUP "/+_local" REGEX_DOCID_GROUP, &RestServer::DeleteLocalDocument);
+    AddRoute("DELETE", REGEX_DBNAME_GROUP "/+_index(/+_design)?" REGEX_DESIGNID_GROUP "/+json" REGEX_INDEXNAME_GROUP "/{0,}$", &RestServer::DeleteDatabaseIndex);
     AddRoute("DELETE", REGEX_DBNAME_GROUP "/{0,}$", &RestServer::DeleteDatabase);
     AddRoute("DELETE", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP, &RestServer::DeleteDesignDocument);
     AddRoute("DELETE", REGEX_DBNAME_GROUP REGEX_DOCID_GROUP REGEX_ATTACHMENT_NAME_GROUP, &RestServer::DeleteDocumentAttachment);
     AddRoute("DELETE", REGEX_DBNAME_GROUP REGEX_DOCID_GROUP, &RestServer::DeleteDocument);
     
     AddRoute("PUT", REGEX_DBNAME_GROUP "/+_local" REGEX_DOCID_GROUP, &RestServer::PutLocalDocument);
+    AddRoute("PUT", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_update" REGEX_UPDATEID_GROUP REGEX_DOCID_GROUP, &RestServer::PostDesignDocumentUpdate);
     AddRoute("PUT", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP, &RestServer::PutDesignDocument);
     AddRoute("PUT", REGEX_DBNAME_GROUP REGEX_DOCID_GROUP REGEX_ATTACHMENT_NAME_GROUP, &RestServer::PutDocumentAttachment);
     AddRoute("PUT", REGEX_DBNAME_GROUP REGEX_DOCID_GROUP, &RestServer::PutDocument);
@@ -80,9 +106,16 @@ RestServer::RestServer() {
     AddRoute("POST", REGEX_DBNAME_GROUP "/+_revs_diff", &RestServer::PostDatabaseRevsDiff);
     AddRoute("POST", REGEX_DBNAME_GROUP "/+_ensure_full_commit", &RestServer::PostEnsureFullCommit);
     AddRoute("POST", REGEX_DBNAME_GROUP "/+_temp_view", &RestServer::PostTempView);
+    AddRoute("POST", REGEX_DBNAME_GROUP "/+_find/{0,}$", &RestServer::PostDatabaseFind);
+    AddRoute("POST", REGEX_DBNAME_GROUP "/+_explain/{0,}$", &RestServer::PostDatabaseExplain);
+    AddRoute("POST", REGEX_DBNAME_GROUP "/+_index/{0,}$", &RestServer::PostDatabaseIndex);
+    AddRoute("POST", REGEX_DBNAME_GROUP "/+_reshard/{0,}$", &RestServer::PostDatabaseReshard);
+    AddRoute("POST", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_update" REGEX_UPDATEID_GROUP REGEX_DOCID_GROUP, &RestServer::PostDesignDocumentUpdate);
+    AddRoute("POST", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_update" REGEX_UPDATEID_GROUP "/{0,}$", &RestServer::PostDesignDocumentUpdate);
     AddRoute("POST", REGEX_DBNAME_GROUP "/{0,}$", &RestServer::PostDatabase);
     
     AddRoute("GET", "/+_active_tasks/{0,}$", &RestServer::GetActiveTasks);
+    AddRoute("GET", "/+_stats/{0,}$", &RestServer::GetStats);
     AddRoute("GET", "/+_uuids/{0,}$", &RestServer::GetUuids);
     AddRoute("GET", "/+_session/{0,}$", &RestServer::GetSession);
     AddRoute("GET", "/+_all_dbs/{0,}$", &RestServer::GetAllDbs);    
@@ -91,16 +124,24 @@ RestServer::RestServer() {
     AddRoute("GET", "/+_config/{0,}$", &RestServer::GetConfig);
     AddRoute("GET", REGEX_DBNAME_GROUP "/+_local" REGEX_DOCID_GROUP, &RestServer::GetLocalDocument);
     AddRoute("GET", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_view" REGEX_VIEWID_GROUP, &RestServer::GetDesignDocumentView);
+    AddRoute("GET", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_search" REGEX_SEARCHID_GROUP, &RestServer::GetDesignDocumentSearch);
+    AddRoute("GET", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_spatial" REGEX_SPATIALID_GROUP, &RestServer::GetDesignDocumentSpatial);
+    AddRoute("GET", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_show" REGEX_SHOWID_GROUP REGEX_DOCID_GROUP, &RestServer::GetDesignDocumentShow);
+    AddRoute("GET", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_show" REGEX_SHOWID_GROUP "/{0,}$", &RestServer::GetDesignDocumentShow);
+    AddRoute("GET", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_list" REGEX_LISTID_GROUP REGEX_VIEWDESIGNID_GROUP REGEX_VIEWID_GROUP, &RestServer::GetDesignDocumentList);
+    AddRoute("GET", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP "/_list" REGEX_LISTID_GROUP REGEX_VIEWID_GROUP, &RestServer::GetDesignDocumentList);
     AddRoute("GET", REGEX_DBNAME_GROUP "/+_design" REGEX_DESIGNID_GROUP, &RestServer::GetDesignDocument);
     AddRoute("GET", REGEX_DBNAME_GROUP REGEX_DOCID_GROUP REGEX_ATTACHMENT_NAME_GROUP, &RestServer::GetDocumentAttachment);
     AddRoute("GET", REGEX_DBNAME_GROUP REGEX_DOCID_GROUP, &RestServer::GetDocument);
     AddRoute("GET", REGEX_DBNAME_GROUP "/+_all_docs/{0,}$", &RestServer::GetDatabaseAllDocs);
     AddRoute("GET", REGEX_DBNAME_GROUP "/+_revs_limit/{0,}$", &RestServer::GetDatabaseRevsLimit);
+    AddRoute("GET", REGEX_DBNAME_GROUP "/+_index/{0,}$", &RestServer::GetDatabaseIndexes);
     AddRoute("GET", REGEX_DBNAME_GROUP "/{0,}$", &RestServer::GetDatabase);
     AddRoute("GET", "/{0,}$", &RestServer::GetSignature);
     
-    databases_.AddDatabase("_replicator");
-    databases_.AddDatabase("_users");
+    // the system databases only ever hold a handful of documents
+    databases_.AddDatabase("_replicator", 1);
+    databases_.AddDatabase("_users", 1);
 }
 
 void RestServer::AddRoute(const char* method, const char* re, Callback func) {
@@ -116,7 +157,52 @@ void RestServer::RouteRequest(rs::httpserver::socket_ptr, rs::httpserver::reques
 }
 
 bool RestServer::GetActiveTasks(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response) {
-    response->setContentType(ContentTypes::applicationJson).Send("[]");
+    auto tasks = databases_.Reaper().GetTasks();
+    
+    JsonStream stream{JsonStream::ContextType::Array};
+    for (const auto& task : tasks) {
+        stream.PushContext(JsonStream::ContextType::Object);
+        stream.Append("type", "database_deletion");
+        stream.Append("database", task.database_);
+        stream.Append("progress", task.progress_);
+        stream.Append("started_on", task.startedOn_);
+        stream.Append("updated_on", task.updatedOn_);
+        stream.PopContext();
+    }
+    
+    auto names = databases_.GetDatabases();
+    for (const auto& name : names) {
+        Documents::ReshardTask task;
+        auto db = databases_.GetDatabase(name.c_str());
+        if (!!db && db->GetReshardTask(task) && task.running_) {
+            stream.PushContext(JsonStream::ContextType::Object);
+            stream.Append("type", "reshard");
+            stream.Append("database", name);
+            stream.Append("shards", task.shards_);
+            stream.Append("progress", task.progress_);
+            stream.Append("started_on", task.startedOn_);
+            stream.Append("updated_on", task.updatedOn_);
+            stream.PopContext();
+        }
+    }
+    
+    response->setContentType(ContentTypes::applicationJson).Send(stream.Flush());
+    return true;
+}
+
+bool RestServer::GetStats(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response) {
+    const auto& reaper = databases_.Reaper();
+    
+    JsonStream stream;
+    stream.PushContext(JsonStream::ContextType::Object, "avancedb");
+    stream.PushContext(JsonStream::ContextType::Object, "database_reaper");
+    stream.Append("pending", reaper.Pending());
+    stream.Append("databases_reaped", reaper.DatabasesReaped());
+    stream.Append("bytes_reclaimed", reaper.BytesReclaimed());
+    stream.PopContext();
+    stream.PopContext();
+    
+    response->setContentType(ContentTypes::applicationJson).Send(stream.Flush());
     return true;
 }
 
@@ -210,6 +296,23 @@ bool RestServer::GetDatabase(rs::httpserver::request_ptr request, const rs::http
             stream.Append("purge_seq", db->PurgeSequence());
             stream.Append("update_seq", db->UpdateSequence());
             
+            stream.PushContext(JsonStream::ContextType::Object, "cluster");
+            stream.Append("q", db->ShardCount());
+            Documents::ReshardTask reshardTask;
+            if (db->GetReshardTask(reshardTask) && !reshardTask.error_.empty()) {
+                stream.Append("reshard_error", reshardTask.error_);
+            }
+            stream.PopContext();
+            
+            const auto& resultsCache = db->ResultsCache();
+            stream.PushContext(JsonStream::ContextType::Object, "view_results_cache");
+            stream.Append("size", resultsCache.Size());
+            stream.Append("capacity", resultsCache.Capacity());
+            stream.Append("entries", resultsCache.Count());
+            stream.Append("hits", resultsCache.Hits());
+            stream.Append("misses", resultsCache.Misses());
+            stream.PopContext();
+            
             response->setContentType(ContentTypes::applicationJson).Send(stream.Flush());
         } else {
             throw MissingDatabase();
@@ -231,8 +334,10 @@ bool RestServer::PutDatabase(rs::httpserver::request_ptr request, const rs::http
         if (databases_.IsDatabase(name)) {
             throw DatabaseAlreadyExists();
         }
+        
+        auto shards = GetShardCount(request->getQueryString(), false);
 
-        created = databases_.AddDatabase(name);
+        created = databases_.AddDatabase(name, shards);
         
         if (created) {
             response->setStatusCode(201).setContentType(ContentTypes::applicationJson).Send(R"({"ok":true})");
@@ -242,6 +347,25 @@ bool RestServer::PutDatabase(rs::httpserver::request_ptr request, const rs::http
     return created;
 }
 
+bool RestServer::PostDatabaseReshard(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto accepted = false;
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto shards = GetShardCount(request->getQueryString(), true);
+        
+        // the documents are copied on the database's reshard thread, the database keeps 
+        // serving requests from the old shards until the new ones replace them
+        if (!db->StartReshard(shards)) {
+            throw ReshardInProgress();
+        }
+        
+        response->setStatusCode(202).setContentType(ContentTypes::applicationJson).Send(R"({"ok":true})");
+        accepted = true;
+    }
+    
+    return accepted;
+}
+
 bool RestServer::PostDatabase(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
     auto created = false;
     auto db = GetDatabase(args);
@@ -301,7 +425,9 @@ bool RestServer::GetDocument(rs::httpserver::request_ptr request, const rs::http
     auto db = GetDatabase(args);
     if (!!db) {
         auto id = GetParameter("id", args);
-        auto multiPartAttachments = GetParameter("attachments", request->getQueryString(), false) == "true";
+        auto includeAttachments = GetParameter("attachments", request->getQueryString(), false) == "true";
+        auto multiPartAttachments = includeAttachments && AcceptsMultipart(request);
+        auto inlineAttachments = includeAttachments && !multiPartAttachments;
         
         auto doc = db->GetDocument(id);
         auto obj = doc->getObject();
@@ -310,7 +436,13 @@ bool RestServer::GetDocument(rs::httpserver::request_ptr request, const rs::http
         
         response->setStatusCode(200).setETag(rev);
 
-        if (multiPartAttachments) {
+        if (inlineAttachments) {
+            // the stored bodies are only base64 encoded when the client wants them in the JSON
+            auto& stream = response->setContentType(ContentTypes::Utf8::applicationJson).getResponseStream();
+            ScriptObjectResponseStream<> objStream{stream};
+            objStream.Serialize(doc, ScriptObjectResponseStreamAttachmentMode::Inline);
+            objStream.Flush();
+        } else if (multiPartAttachments) {
             auto& stream = response->getMultiResponseStream();
             
             stream.EmitPart(ContentTypes::Utf8::applicationJson);
@@ -365,12 +497,275 @@ bool RestServer::GetDesignDocumentView(rs::httpserver::request_ptr request, cons
     auto gotView = false;
     auto db = GetDatabase(args);
     if (!!db) {
-        response->setStatusCode(200).setContentType(ContentTypes::Utf8::applicationJson).Send(R"({"offset":0,"rows":[],"total_rows":0})");
+        auto id = GetParameter("designid", args);
+        auto viewId = GetParameter("viewid", args);
+        
+        auto doc = db->GetDesignDocument(id);
+        auto viewsObj = doc->getObject()->getObject("views", false);
+        script_object_ptr viewObj;
+        if (!!viewsObj) {
+            viewObj = viewsObj->getObject(viewId, false);
+        }
+        
+        if (!viewObj || viewObj->getType("map") != rs::scriptobject::ScriptObjectType::String) {
+            throw MissingView();
+        }
+        
+        GetViewOptions options{request->getQueryString()};
+        SerializeView(db, options, viewObj, response);
+        
         gotView = true;
     }
     return gotView;
 }
 
+bool RestServer::GetDesignDocumentSearch(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto searched = false;
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto id = GetParameter("designid", args);
+        auto searchId = GetParameter("searchid", args);
+        
+        auto doc = db->GetDesignDocument(id);
+        auto indexesObj = doc->getObject()->getObject("indexes", false);
+        script_object_ptr indexObj;
+        if (!!indexesObj) {
+            indexObj = indexesObj->getObject(searchId, false);
+        }
+        
+        if (!indexObj || indexObj->getType("index") != rs::scriptobject::ScriptObjectType::String) {
+            throw MissingIndex();
+        }
+        
+        GetSearchOptions options{request->getQueryString()};
+        SearchQuery query{options.Query()};
+        
+        auto index = db->GetSearchIndex(doc->getId(), searchId, indexObj->getString("index"));
+        
+        std::uint64_t totalHits = 0;
+        auto hits = db->SearchDocuments(index, query, options.Skip(), options.Limit(GetSearchOptions::DefaultLimit), totalHits);
+        
+        const auto includeDocs = options.IncludeDocs();
+        
+        auto& stream = response->setContentType(ContentTypes::Utf8::applicationJson).getResponseStream();
+        ScriptObjectResponseStream<> objStream{stream};
+        objStream << R"({"total_rows":)" << totalHits << R"(,"rows":[)";
+        
+        for (decltype(hits.size()) i = 0, size = hits.size(); i < size; ++i) {
+            const auto& hit = hits[i];
+            
+            objStream << (i > 0 ? ',' : ' ');
+            objStream << R"({"id":")" << hit.doc_->getId() << R"(","order":[)" << hit.score_ << R"(],"fields":{})";
+            
+            if (includeDocs) {
+                objStream << R"(,"doc":)" << hit.doc_->getObject();
+            }
+            
+            objStream << '}';
+        }
+        
+        objStream << "]}";
+        objStream.Flush();
+        
+        searched = true;
+    }
+    return searched;
+}
+
+bool RestServer::GetDesignDocumentSpatial(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto queried = false;
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto id = GetParameter("designid", args);
+        auto spatialId = GetParameter("spatialid", args);
+        
+        auto doc = db->GetDesignDocument(id);
+        auto spatialObj = doc->getObject()->getObject("spatial", false);
+        if (!spatialObj) {
+            throw MissingIndex();
+        }
+        
+        GetSpatialOptions options{request->getQueryString()};
+        auto region = options.Region();
+        
+        auto index = db->GetSpatialIndex(doc->getId(), spatialId, spatialObj);
+        
+        std::uint64_t totalRows = 0;
+        auto hits = db->QuerySpatial(index, region, options.Skip(), options.Limit(), totalRows);
+        
+        const auto includeDocs = options.IncludeDocs();
+        
+        auto& stream = response->setContentType(ContentTypes::Utf8::applicationJson).getResponseStream();
+        ScriptObjectResponseStream<> objStream{stream};
+        objStream << R"({"total_rows":)" << totalRows << R"(,"rows":[)";
+        
+        for (decltype(hits.size()) i = 0, size = hits.size(); i < size; ++i) {
+            const auto& hit = hits[i];
+            
+            objStream << (i > 0 ? ',' : ' ');
+            objStream << R"({"id":")" << hit.doc_->getId() << R"(","geometry":{"type":"Point","coordinates":[)";
+            objStream << hit.lon_ << ',' << hit.lat_ << R"(]},"value":)";
+            
+            if (!!hit.keyValue_) {
+                objStream.Serialize(hit.keyValue_, 1);
+            } else {
+                objStream << "null";
+            }
+            
+            if (region.IsRadius()) {
+                objStream << R"(,"distance":)" << hit.distance_;
+            }
+            
+            if (includeDocs) {
+                objStream << R"(,"doc":)" << hit.doc_->getObject();
+            }
+            
+            objStream << '}';
+        }
+        
+        objStream << "]}";
+        objStream.Flush();
+        
+        queried = true;
+    }
+    return queried;
+}
+
+bool RestServer::GetDesignDocumentShow(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto shown = false;
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto showId = GetParameter("showid", args);
+        
+        auto ddoc = db->GetDesignDocument(GetParameter("designid", args));
+        auto showsObj = ddoc->getObject()->getObject("shows", false);
+        if (!showsObj || showsObj->getType(showId) != rs::scriptobject::ScriptObjectType::String) {
+            throw MissingDesignFunction("show", showId);
+        }
+        
+        // like CouchDB a missing document is passed to the function as null
+        const char* id = nullptr;
+        document_ptr doc;
+        if (args.find("id") != args.cend()) {
+            id = GetParameter("id", args);
+            doc = db->GetDocument(id, false);
+        }
+        
+        auto result = DesignFunctions::Show(showsObj->getString(showId), doc, GetRequestObject(request, args, id));
+        response->setStatusCode(result.code_).setContentType(result.contentType_.c_str()).Send(result.body_);
+        
+        shown = true;
+    }
+    return shown;
+}
+
+bool RestServer::PostDesignDocumentUpdate(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto updated = false;
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto updateId = GetParameter("updateid", args);
+        
+        auto ddoc = db->GetDesignDocument(GetParameter("designid", args));
+        auto updatesObj = ddoc->getObject()->getObject("updates", false);
+        if (!updatesObj || updatesObj->getType(updateId) != rs::scriptobject::ScriptObjectType::String) {
+            throw MissingDesignFunction("update", updateId);
+        }
+        
+        const char* id = nullptr;
+        if (args.find("id") != args.cend()) {
+            id = GetParameter("id", args);
+        }
+        
+        // the modify and store happen in one step under the document's collection lock
+        DesignFunctions::Response result;
+        auto doc = db->UpdateDocument(id, updatesObj->getString(updateId), GetRequestObject(request, args, id, true), result);
+        
+        response->setStatusCode(result.code_).setContentType(result.contentType_.c_str());
+        if (!!doc) {
+            response->setETag(doc->getRev());
+        }
+        
+        response->Send(result.body_);
+        
+        updated = true;
+    }
+    return updated;
+}
+
+bool RestServer::GetDesignDocumentList(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto listed = false;
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto id = GetParameter("designid", args);
+        auto listId = GetParameter("listid", args);
+        auto viewId = GetParameter("viewid", args);
+        
+        auto ddoc = db->GetDesignDocument(id);
+        auto listsObj = ddoc->getObject()->getObject("lists", false);
+        if (!listsObj || listsObj->getType(listId) != rs::scriptobject::ScriptObjectType::String) {
+            throw MissingDesignFunction("list", listId);
+        }
+        
+        // the view can come from another design document
+        auto viewDoc = ddoc;
+        if (args.find("viewdesignid") != args.cend()) {
+            viewDoc = db->GetDesignDocument(GetParameter("viewdesignid", args));
+        }
+        
+        auto viewsObj = viewDoc->getObject()->getObject("views", false);
+        script_object_ptr viewObj;
+        if (!!viewsObj) {
+            viewObj = viewsObj->getObject(viewId, false);
+        }
+        
+        if (!viewObj || viewObj->getType("map") != rs::scriptobject::ScriptObjectType::String) {
+            throw MissingView();
+        }
+        
+        GetViewOptions options{request->getQueryString()};
+        
+        std::vector<map_reduce_shard_results_ptr> shardResults;
+        db->PostTempView(options, viewObj, [&](map_reduce_shard_results_ptr shardResult) {
+            shardResults.emplace_back(shardResult);
+        });
+        
+        // rows are merged only as the list function asks for them
+        MapReduceMergedResultsIterator iter{shardResults, options.Skip(), options.Limit(), options.Descending()};
+        
+        rs::scriptobject::utils::ScriptObjectVectorSource headSource({
+            std::make_pair("total_rows", iter.TotalRows()),
+            std::make_pair("offset", iter.Offset())
+        });
+        
+        auto head = rs::scriptobject::ScriptObjectFactory::CreateObject(headSource, false);
+        
+        rs::httpserver::Stream* stream = nullptr;
+        try {
+            DesignFunctions::List(listsObj->getString(listId), head, GetRequestObject(request, args, nullptr), options.IncludeDocs(),
+                [&]() { 
+                    return iter.Next(); 
+                },
+                [&](const DesignFunctions::Response& start) {
+                    stream = &response->setStatusCode(start.code_).setContentType(start.contentType_.c_str()).getResponseStream();
+                },
+                [&](const char* chunk, std::size_t size) {
+                    stream->Write(reinterpret_cast<const rs::httpserver::Stream::byte*>(chunk), 0, size);
+                });
+        } catch (...) {
+            // once the list has started its response any error can't be reported,
+            // the stream is ended with what was sent so far
+            if (stream == nullptr) {
+                throw;
+            }
+        }
+        
+        stream->Flush();
+        
+        listed = true;
+    }
+    return listed;
+}
+
 bool RestServer::PutDocument(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
     auto created = false;
     auto db = GetDatabase(args);
@@ -703,13 +1098,12 @@ bool RestServer::GetDatabaseAllDocs(rs::httpserver::request_ptr request, const r
         const auto includeDocs = options.IncludeDocs();
         const auto updateSequence = options.UpdateSequence();
         
-        DocumentCollection::size_type offset = 0, totalDocs = 0;
         sequence_type updateSequenceNumber = 0;
-        auto docs = db->GetDocuments(options, offset, totalDocs, updateSequenceNumber);
+        auto docs = db->GetDocumentsIterator(options, updateSequenceNumber);
         
         auto& stream = response->setContentType(ContentTypes::Utf8::applicationJson).getResponseStream();
         ScriptObjectResponseStream<> objStream{stream};
-        objStream << R"({"offset":)" << offset << R"(,"total_rows":)" << totalDocs;
+        objStream << R"({"offset":)" << docs.Offset() << R"(,"total_rows":)" << docs.TotalRows();
         
         if (updateSequence) {
             objStream << R"(,"update_seq":)" << updateSequenceNumber;
@@ -717,12 +1111,14 @@ bool RestServer::GetDatabaseAllDocs(rs::httpserver::request_ptr request, const r
         
         objStream << R"(,"rows":[)";
         
-        for (decltype(docs->size()) i = 0, size = docs->size(); i < size; ++i) {
-            if (i > 0) {
+        // the rows are merged as they are written
+        auto first = true;
+        for (auto doc = docs.Next(); !!doc; doc = docs.Next()) {
+            if (!first) {
                 objStream << ',';
             }
-
-            auto doc = (*docs)[i];
+            
+            first = false;
 
             auto id = doc->getId();
             auto rev= doc->getRev();
@@ -829,48 +1225,291 @@ bool RestServer::PostTempView(rs::httpserver::request_ptr request, const rs::htt
     auto db = GetDatabase(args);
     if (!!db) {
         GetViewOptions options{request->getQueryString()};
-        const auto includeDocs = options.IncludeDocs();
         
         auto obj = GetRequestBody(request);
         if (!obj || obj->getType("map") != rs::scriptobject::ScriptObjectType::String) {
             throw InvalidJson();
         }
         
-        auto results = db->PostTempView(options, obj);        
+        SerializeView(db, options, obj, response);
+        
+        executed = true;
+    }
+    
+    return executed;
+}
+
+bool RestServer::PostDatabaseFind(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto found = false;
+    
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto obj = GetRequestBody(request);
+        if (!obj) {
+            throw InvalidJson();
+        }
+        
+        MangoQuery query{obj};
+        auto docs = db->FindDocuments(query);
         
         auto& stream = response->setContentType(ContentTypes::Utf8::applicationJson).getResponseStream();
         ScriptObjectResponseStream<> objStream{stream};
-        objStream << R"({"offset":)" << results->Offset() << R"(,"total_rows":)" << results->TotalRows() << R"(,"rows":[)";
+        objStream << R"({"docs":[)";
+        
+        for (decltype(docs->size()) i = 0, size = docs->size(); i < size; ++i) {
+            if (i > 0) {
+                objStream << ',';
+            }
+            
+            objStream << query.Project((*docs)[i]->getObject());
+        }
+        
+        objStream << "]}";
+        objStream.Flush();
+        
+        found = true;
+    }
+    
+    return found;
+}
+
+bool RestServer::PostDatabaseExplain(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto explained = false;
+    
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto obj = GetRequestBody(request);
+        if (!obj) {
+            throw InvalidJson();
+        }
+        
+        MangoQuery query{obj};
+        auto index = db->PlanFindDocuments(query);
+        
+        JsonStream stream;
+        stream.Append("dbname", GetDatabaseName(args));
+        stream.PushContext(JsonStream::ContextType::Object, "index");
+        if (!!index) {
+            stream.Append("ddoc", index->DesignId());
+            stream.Append("name", index->Name());
+            stream.Append("type", "json");
+        } else {
+            stream.Append("name", "_all_docs");
+            stream.Append("type", "special");
+        }
+        stream.PopContext();
+        stream.Append("skip", query.Skip());
+        stream.Append("limit", query.Limit());
+        
+        response->setContentType(ContentTypes::Utf8::applicationJson).Send(stream.Flush());
+        
+        explained = true;
+    }
+    
+    return explained;
+}
+
+bool RestServer::PostDatabaseIndex(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto posted = false;
+    
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto obj = GetRequestBody(request);
+        if (!obj) {
+            throw InvalidJson();
+        }
+        
+        auto created = false;
+        auto index = db->CreateIndex(obj, created);
+        
+        JsonStream stream;
+        stream.Append("result", created ? "created" : "exists");
+        stream.Append("id", index->DesignId());
+        stream.Append("name", index->Name());
+        
+        response->setStatusCode(200).setContentType(ContentTypes::Utf8::applicationJson).Send(stream.Flush());
+        
+        posted = true;
+    }
+    
+    return posted;
+}
+
+bool RestServer::GetDatabaseIndexes(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto gotIndexes = false;
+    
+    auto db = GetDatabase(args);
+    if (!!db) {
+        auto indexes = db->GetIndexes();
+        
+        JsonStream stream;
+        stream.Append("total_rows", indexes.size() + 1);
+        stream.PushContext(JsonStream::ContextType::Array, "indexes");
+        
+        // the primary index is always listed first
+        stream.PushContext(JsonStream::ContextType::Object);
+        stream.Append("name", "_all_docs");
+        stream.Append("type", "special");
+        stream.PushContext(JsonStream::ContextType::Object, "def");
+        stream.PushContext(JsonStream::ContextType::Array, "fields");
+        stream.PushContext(JsonStream::ContextType::Object);
+        stream.Append("_id", "asc");
+        stream.PopContext();
+        stream.PopContext();
+        stream.PopContext();
+        stream.PopContext();
+        
+        for (const auto& index : indexes) {
+            stream.PushContext(JsonStream::ContextType::Object);
+            stream.Append("ddoc", index->DesignId());
+            stream.Append("name", index->Name());
+            stream.Append("type", "json");
+            stream.PushContext(JsonStream::ContextType::Object, "def");
+            stream.PushContext(JsonStream::ContextType::Array, "fields");
+            for (const auto& field : index->FieldNames()) {
+                stream.PushContext(JsonStream::ContextType::Object);
+                stream.Append(field.c_str(), "asc");
+                stream.PopContext();
+            }
+            stream.PopContext();
+            stream.PopContext();
+            stream.PopContext();
+        }
+        
+        stream.PopContext();
+        
+        response->setContentType(ContentTypes::Utf8::applicationJson).Send(stream.Flush());
+        
+        gotIndexes = true;
+    }
+    
+    return gotIndexes;
+}
+
+bool RestServer::DeleteDatabaseIndex(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, rs::httpserver::response_ptr response) {
+    auto deleted = false;
+    
+    auto db = GetDatabase(args);
+    if (!!db) {
+        std::string designId{"_design/"};
+        designId += GetParameter("designid", args);
+        
+        if (!db->DeleteIndex(designId.c_str(), GetParameter("indexname", args))) {
+            throw MissingIndex();
+        }
+        
+        JsonStream stream;
+        stream.Append("ok", true);
+        
+        response->setStatusCode(200).setContentType(ContentTypes::Utf8::applicationJson).Send(stream.Flush());
+        
+        deleted = true;
+    }
+    
+    return deleted;
+}
+
+void RestServer::SerializeView(database_ptr db, const GetViewOptions& options, script_object_ptr viewObj, rs::httpserver::response_ptr response) {
+    const auto includeDocs = options.IncludeDocs();
+    
+    auto& stream = response->setContentType(ContentTypes::Utf8::applicationJson).getResponseStream();
+    ScriptObjectResponseStream<> objStream{stream};
+
+    auto prefixComma = false;
+    auto serializeResult = [&](map_reduce_result_ptr result) {
+        auto resultObj = result->getResultArray();
+        
+        objStream << (prefixComma ? ',' : ' ');
+        objStream << R"({"id":")" << result->getId() << R"(","key":)";
+        objStream.Serialize(resultObj, MapReduceResult::KeyIndex);
+        objStream << R"(,"value":)";
+        objStream.Serialize(resultObj, MapReduceResult::ValueIndex);
+        
+        if (includeDocs) {
+            objStream << R"(,"doc":)" << result->getDoc()->getObject();
+        }
+        
+        objStream << '}';
+        prefixComma = true;
+    };
+    
+    if (options.Sorted()) {
+        std::vector<map_reduce_shard_results_ptr> shardResults;
+        db->PostTempView(options, viewObj, [&](map_reduce_shard_results_ptr shardResult) {
+            shardResults.emplace_back(shardResult);
+        });
+        
+        // merge the shards while writing rather than waiting for a fully merged result set
+        MapReduceMergedResultsIterator iter{shardResults, options.Skip(), options.Limit(), options.Descending()};
+        objStream << R"({"offset":)" << iter.Offset() << R"(,"total_rows":)" << iter.TotalRows() << R"(,"rows":[)";
 
-        auto prefixComma = false;
-        auto iter = results->Iterator();
         auto result = iter.Next();
         while (result) {
-            auto resultObj = result->getResultArray();
+            serializeResult(result);
+            result = iter.Next();
+        }
+
+        objStream << "]}";
+    } else {
+        // rows are written as each shard completes so offset and total_rows can only follow them
+        objStream << R"({"rows":[)";
+        
+        auto skip = options.Skip();
+        auto limit = options.Limit();
+        const auto descending = options.Descending();
+        
+        DocumentCollection::size_type skipped = 0;
+        DocumentCollection::size_type offset = 0;
+        DocumentCollection::size_type totalRows = 0;
+        
+        try {
+            db->PostTempView(options, viewObj, [&](map_reduce_shard_results_ptr shardResult) {
+                offset += shardResult->Offset();
+                totalRows += shardResult->TotalRows();
+                
+                auto begin = shardResult->cbegin();
+                auto end = shardResult->cend();
+                
+                while (begin != end && limit > 0) {
+                    auto result = !descending ? *begin++ : *--end;
+                    if (skip > 0) {
+                        --skip;
+                        ++skipped;
+                    } else {
+                        serializeResult(result);
+                        --limit;
+                    }
+                }
+                
+                objStream.Flush();
+            });
+        } catch (const HttpServerException& ex) {
+            // once rows have been sent the error can only be reported in the body
+            if (!response->HasResponded()) {
+                throw;
+            }
             
-            objStream << (prefixComma ? ',' : ' ');
-            objStream << R"({"id":")" << result->getId() << R"(","key":)";
-            objStream.Serialize(resultObj, MapReduceResult::KeyIndex);
-            objStream << R"(,"value":)";
-            objStream.Serialize(resultObj, MapReduceResult::ValueIndex);
+            objStream << (prefixComma ? ',' : ' ') << ex.Body() << "]}";
+            objStream.Flush();
             
-            if (includeDocs) {
-                objStream << R"(,"doc":)" << result->getDoc()->getObject();
+            return;
+        } catch (...) {
+            // any other failure still has to close the rows array the client is reading
+            if (!response->HasResponded()) {
+                throw;
             }
             
-            objStream << '}';
-            prefixComma = true;
+            objStream << (prefixComma ? ',' : ' ') << InternalServerError{}.Body() << "]}";
+            objStream.Flush();
             
-            result = iter.Next();
+            return;
         }
         
-        objStream << "]}";
-        objStream.Flush();
-        
-        executed = true;
+        offset = std::min(offset + skipped, totalRows);
+        objStream << R"(],"offset":)" << offset << R"(,"total_rows":)" << totalRows << '}';
     }
     
-    return executed;
+    objStream.Flush();
 }
 
 bool RestServer::GetConfig(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response) {
@@ -979,23 +1618,17 @@ bool RestServer::GetDocumentAttachment(rs::httpserver::request_ptr request, cons
             
             auto range = request->getByteRanges();
             if (contentType == ContentTypes::applicationOctetStream && range.size() == 1) {
-                auto rangeStart = range[0].first;
-                auto rangeEnd = range[0].second;
-                
-                if (rangeStart < 0) {
-                    rangeStart += size;
-                }
+                std::int64_t rangeStart = range[0].first;
+                std::int64_t rangeEnd = range[0].second;
                 
-                if (rangeStart < 0 || rangeStart >= size) {
+                if (!DocumentAttachment::ResolveRange(rangeStart, rangeEnd, size)) {
                     throw BadRangeError{};
                 }
                 
-                auto endIndex = static_cast<decltype(rangeEnd)>(size > 0 ? size - 1 : 0);
-                rangeEnd = std::min(rangeEnd, endIndex);
-                auto rangeSize = std::min(rangeEnd - rangeStart + 1, endIndex);
-                
-                auto contentRange = (boost::format("bytes %1%-%2%/%3%") % rangeStart % rangeEnd % rangeSize).str();
+                auto rangeSize = rangeEnd - rangeStart + 1;
+                auto contentRange = DocumentAttachment::FormatContentRange(rangeStart, rangeEnd, size);
                 
+                // the range is written straight from the stored body without copying it
                 response->setStatusCode(206).setStatusDescription("Partial Content").setContentType(contentType, compress).setContentRange(contentRange);
                 auto& stream = response->getResponseStream();
                 stream.Write(attachment->Data(), rangeStart, rangeSize);
@@ -1064,6 +1697,27 @@ const char* RestServer::GetParameter(const char* param, const rs::httpserver::Re
     return argsIter->second;
 }
 
+unsigned RestServer::GetShardCount(const rs::httpserver::QueryString& qs, bool throwIfMissing) {
+    const auto& value = GetParameter("q", qs, throwIfMissing);
+    if (value.size() == 0) {
+        return 0;
+    }
+    
+    unsigned shards = 0;
+    try {
+        if (value[0] != '-') {
+            shards = boost::lexical_cast<unsigned>(value);
+        }
+    } catch (const boost::bad_lexical_cast&) {
+    }
+    
+    if (shards == 0 || shards > Documents::MaxShards) {
+        throw QueryParseError{"q", value};
+    }
+    
+    return shards;
+}
+
 const std::string& RestServer::GetParameter(const char* param, const rs::httpserver::QueryString& qs, bool throwIfMissing) {
     if (throwIfMissing && !qs.IsKey(param)) {
         // TODO: this isn't the best exception message to return, however there are no obvious alternatives that CouchDB uses
@@ -1073,6 +1727,114 @@ const std::string& RestServer::GetParameter(const char* param, const rs::httpser
     return qs.getValue(param);
 }
 
+script_object_ptr RestServer::GetRequestObject(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, const char* id, bool includeBody) {
+    std::string json = R"({"method":")";
+    json += JsonHelper::EscapeJsonString(request->getMethod().c_str());
+    json += R"(","path":")";
+    json += JsonHelper::EscapeJsonString(request->getUri().c_str());
+    json += R"(","query":{)";
+    
+    std::vector<std::string> params;
+    const auto& queryString = request->getHeaders()->getQueryString();
+    boost::split(params, queryString, boost::is_any_of("&"));
+    
+    auto prefixComma = false;
+    for (const auto& param : params) {
+        if (param.size() > 0) {
+            auto equals = param.find('=');
+            auto name = DecodeQueryComponent(param.substr(0, equals));
+            auto value = equals != std::string::npos ? DecodeQueryComponent(param.substr(equals + 1)) : std::string{};
+            
+            json += prefixComma ? ",\"" : "\"";
+            json += JsonHelper::EscapeJsonString(name.c_str());
+            json += R"(":")";
+            json += JsonHelper::EscapeJsonString(value.c_str());
+            json += '"';
+            
+            prefixComma = true;
+        }
+    }
+    
+    json += R"(},"id":)";
+    if (id != nullptr) {
+        json += '"';
+        json += JsonHelper::EscapeJsonString(id);
+        json += '"';
+    } else {
+        json += "null";
+    }
+    
+    json += R"(,"info":{"db_name":")";
+    json += JsonHelper::EscapeJsonString(GetDatabaseName(args));
+    json += R"("})";
+    
+    if (includeBody) {
+        std::vector<rs::httpserver::RequestStream::byte> body;
+        if (request->HasBody() && !ReadRequestBody(request, body)) {
+            throw BadRequestBodyError{};
+        }
+        
+        body.push_back('\0');
+        
+        json += R"(,"body":")";
+        json += JsonHelper::EscapeJsonString(reinterpret_cast<const char*>(body.data()));
+        json += '"';
+    }
+    
+    json += '}';
+    
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());
+    return rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+}
+
+bool RestServer::AcceptsMultipart(rs::httpserver::request_ptr request) {
+    auto accept = request->getHeaders()->getHeader("Accept");
+    return accept != nullptr && (accept->find("multipart/related") != std::string::npos || accept->find("multipart/mixed") != std::string::npos);
+}
+
+std::string RestServer::DecodeQueryComponent(const std::string& component) {
+    std::string decoded;
+    decoded.reserve(component.size());
+    
+    for (decltype(component.size()) i = 0, size = component.size(); i < size; ++i) {
+        auto ch = component[i];
+        if (ch == '+') {
+            decoded += ' ';
+        } else if (ch == '%' && i + 2 < size && std::isxdigit(static_cast<unsigned char>(component[i + 1])) && std::isxdigit(static_cast<unsigned char>(component[i + 2]))) {
+            decoded += static_cast<char>(std::stoi(component.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            decoded += ch;
+        }
+    }
+    
+    return decoded;
+}
+
+bool RestServer::ReadRequestBody(rs::httpserver::request_ptr request, std::vector<rs::httpserver::RequestStream::byte>& buffer) {
+    auto& requestStream = request->getRequestStream();
+    auto requestLength = request->getContentLength();
+    
+    buffer.resize(requestLength);
+    
+    decltype(requestLength) offset = 0;
+    while (offset < requestLength) {
+        auto remaining = requestLength - offset;
+        auto bytesRead = requestStream.Read(&buffer[offset], 0, remaining, false);
+        
+        if (bytesRead <= 0) {
+            return false;
+        }
+        
+        offset += bytesRead;
+    }
+    
+    return true;
+}
+
 rs::scriptobject::ScriptObjectPtr RestServer::GetRequestBody(rs::httpserver::request_ptr request, bool useCachedObjectKeys) {
     if (request->HasBody()) {
         bool gotJson = request->getContentType().find(ContentTypes::applicationJson) != std::string::npos;
@@ -1082,23 +1844,12 @@ rs::scriptobject::ScriptObjectPtr RestServer::GetRequestBody(rs::httpserver::req
             throw InvalidJson{};
         }
 
-        auto& requestStream = request->getRequestStream();
-        auto requestLength = request->getContentLength();
-        
-        std::vector<rs::httpserver::RequestStream::byte> buffer(requestLength);
-        
-        decltype(requestLength) offset = 0;
-        while (offset < requestLength) {
-            auto remaining = requestLength - offset;
-            auto bytesRead = requestStream.Read(&buffer[offset], 0, remaining, false);
-            
-            if (bytesRead <= 0) {
-                throw InvalidJson{};
-            }
-            
-            offset += bytesRead;
+        std::vector<rs::httpserver::RequestStream::byte> buffer;
+        if (!ReadRequestBody(request, buffer)) {
+            throw InvalidJson{};
         }
         
+        auto requestLength = request->getContentLength();
         auto json = reinterpret_cast<char*>(buffer.data());
         
         if (gotJson) {
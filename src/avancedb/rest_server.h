@@ -26,6 +26,8 @@
 #include "databases.h"
 #include "uuid_helper.h"
 
+class GetViewOptions;
+
 class RestServer final {
 public:
     
@@ -44,6 +46,7 @@ private:
     bool HeadDesignDocument(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
         
     bool GetActiveTasks(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool GetStats(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool GetUuids(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool GetSession(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool GetDatabaseAllDocs(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
@@ -58,6 +61,10 @@ private:
     bool GetDocument(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool GetDesignDocument(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool GetDesignDocumentView(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool GetDesignDocumentSearch(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool GetDesignDocumentSpatial(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool GetDesignDocumentShow(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool GetDesignDocumentList(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     
     bool PutDatabase(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool PutDocument(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
@@ -68,6 +75,13 @@ private:
     bool PostEnsureFullCommit(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool PostDatabase(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool PostTempView(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool PostDatabaseFind(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool PostDatabaseExplain(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool PostDesignDocumentUpdate(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool PostDatabaseIndex(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool PostDatabaseReshard(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool GetDatabaseIndexes(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
+    bool DeleteDatabaseIndex(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     
     bool DeleteDatabase(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
     bool DeleteDocument(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs&, rs::httpserver::response_ptr response);
@@ -86,7 +100,20 @@ private:
     const char* GetDatabaseName(const rs::httpserver::RequestRouter::CallbackArgs&);
     const std::string& GetParameter(const char* param, const rs::httpserver::QueryString&, bool throwIfMissing = false);
     const char* GetParameter(const char* param, const rs::httpserver::RequestRouter::CallbackArgs&);
+    
+    // the q parameter, 0 when it's missing or empty
+    unsigned GetShardCount(const rs::httpserver::QueryString&, bool throwIfMissing);
     rs::scriptobject::ScriptObjectPtr GetRequestBody(rs::httpserver::request_ptr request, bool useCachedObjectKeys = true);
+    bool ReadRequestBody(rs::httpserver::request_ptr request, std::vector<rs::httpserver::RequestStream::byte>& buffer);
+    
+    // the req argument passed to show, list and update functions
+    script_object_ptr GetRequestObject(rs::httpserver::request_ptr request, const rs::httpserver::RequestRouter::CallbackArgs& args, const char* id, bool includeBody = false);
+    static std::string DecodeQueryComponent(const std::string& component);
+    
+    // true when the Accept header asks for a multipart response
+    static bool AcceptsMultipart(rs::httpserver::request_ptr request);
+    
+    void SerializeView(database_ptr db, const GetViewOptions& options, script_object_ptr viewObj, rs::httpserver::response_ptr response);
     
     rs::httpserver::RequestRouter router_;        
     Databases databases_;
@@ -44,7 +44,11 @@ ScriptArrayJsapiKeyValueSource ScriptArrayJsapiKeyValueSource::Create(const rs::
                 source.stringValues_[i] = std::move(source.values_[i].ToString());
                 break;
 
-            case JSTYPE_NUMBER: source.types_[i] = ScriptObjectType::Double; break;
+            case JSTYPE_NUMBER:
+                // keep integers as integers rather than widening every number to a double
+                source.types_[i] = source.values_[i].isInt32() ? ScriptObjectType::Int32 : ScriptObjectType::Double;
+                break;
+                
             case JSTYPE_BOOLEAN: source.types_[i] = ScriptObjectType::Boolean; break;
             default: source.types_[i] = ScriptObjectType::Null; break;
         }
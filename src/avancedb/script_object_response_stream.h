@@ -20,12 +20,16 @@
 #define RS_AVANCEDB_SCRIPT_OBJECT_RESPONSE_STREAM_H
 
 #include <cstring>
+#include <array>
+#include <algorithm>
 #include <type_traits>
 #include <string>
 
 #include "libhttpserver.h"
 
 #include "types.h"
+#include "document.h"
+#include "document_attachment.h"
 #include "json_helper.h"
 #include "base64_helper.h"
 #include "c99_formatters.h"
@@ -33,7 +37,8 @@
 enum class ScriptObjectResponseStreamAttachmentMode {
     Default,
     Stub,
-    Follows
+    Follows,
+    Inline
 };
 
 template <unsigned SIZE = 2048>
@@ -48,6 +53,11 @@ public:
     void Serialize(T obj, ScriptObjectResponseStreamAttachmentMode attachmentMode = AttachmentMode::Default) {
         AppendObject(obj, false, attachmentMode);
     }
+    
+    template <typename T, typename std::enable_if<std::is_same<T, document_ptr>::value>::type* = nullptr>
+    void Serialize(T doc, ScriptObjectResponseStreamAttachmentMode attachmentMode) {
+        AppendObject(doc->getObject(), false, attachmentMode, doc.get());
+    }
 
     template <typename T, typename std::enable_if<std::is_same<T, script_array_ptr>::value || std::is_same<T, script_object_ptr>::value>::type* = nullptr>    
     void Serialize(T arr, unsigned index) {
@@ -119,7 +129,7 @@ public:
     
 private:
 
-    void AppendObject(script_object_ptr obj, bool comma = false, AttachmentMode attachmentMode = AttachmentMode::Default) {
+    void AppendObject(script_object_ptr obj, bool comma = false, AttachmentMode attachmentMode = AttachmentMode::Default, const Document* doc = nullptr) {
         if (comma) {
             if (getRemainingBytes() == 0) {
                 FlushBuffer();
@@ -142,7 +152,7 @@ private:
             AppendName(name, i > 0);
                         
             if (attachmentMode != AttachmentMode::Default && type == rs::scriptobject::ScriptObjectType::Object && std::strcmp("_attachments", name) == 0) {
-                AppendAttachments(obj->getObject(i), attachmentMode);
+                AppendAttachments(obj->getObject(i), attachmentMode, doc);
             } else {                        
                 switch (type) {
                     case rs::scriptobject::ScriptObjectType::Array: AppendArray(obj->getArray(i)); break;
@@ -166,7 +176,7 @@ private:
         buffer_[pos_++] = '}';
     }
     
-    void AppendAttachments(script_object_ptr obj, AttachmentMode attachmentMode) {
+    void AppendAttachments(script_object_ptr obj, AttachmentMode attachmentMode, const Document* doc) {
         if (getRemainingBytes() == 0) {
             FlushBuffer();
         }
@@ -180,7 +190,8 @@ private:
             if (type == rs::scriptobject::ScriptObjectType::Object) {
                 auto name = obj->getName(i);
                 AppendName(name, attachments > 0); 
-                AppendAttachment(obj->getObject(i), attachmentMode);
+                auto attachment = attachmentMode == AttachmentMode::Inline && doc != nullptr ? doc->getAttachment(name, true) : document_attachment_ptr{};
+                AppendAttachment(obj->getObject(i), attachmentMode, attachment);
                 ++attachments;
             }
         }
@@ -192,7 +203,7 @@ private:
         buffer_[pos_++] = '}';
     }
     
-    void AppendAttachment(script_object_ptr obj, AttachmentMode attachmentMode) {
+    void AppendAttachment(script_object_ptr obj, AttachmentMode attachmentMode, const document_attachment_ptr& attachment) {
         if (getRemainingBytes() == 0) {
             FlushBuffer();
         }
@@ -200,24 +211,45 @@ private:
         buffer_[pos_++] = '{';
         
         auto gotLength = false;
+        auto gotBody = false;
         std::uint64_t dataLength = 0;
         auto count = obj->getCount();        
-        decltype(count) i = 0;
+        decltype(count) i = 0, fields = 0;
         for (; i < count; ++i) {
             auto name = obj->getName(i);
             auto type = obj->getType(i);                       
             
-            if (type == rs::scriptobject::ScriptObjectType::String && std::strcmp("data", name) == 0) {
-                switch (attachmentMode) {
-                    case AttachmentMode::Follows: AppendName("follows", i > 0); AppendBool(true); break;
-                    case AttachmentMode::Stub: AppendName("stub", i > 0); AppendBool(true); break;
+            auto isData = type == rs::scriptobject::ScriptObjectType::String && std::strcmp("data", name) == 0;
+            auto isMarker = type == rs::scriptobject::ScriptObjectType::Boolean && (std::strcmp("stub", name) == 0 || std::strcmp("follows", name) == 0);
+            
+            if (isData || isMarker) {
+                // the body field is written once in whichever form the mode asks for
+                if (!gotBody) {
+                    switch (attachmentMode) {
+                        case AttachmentMode::Follows: AppendName("follows", fields++ > 0); AppendBool(true); break;
+                        case AttachmentMode::Stub: AppendName("stub", fields++ > 0); AppendBool(true); break;
+                        case AttachmentMode::Inline:
+                            if (!!attachment && !!attachment->Buffer()) {
+                                AppendName("data", fields++ > 0);
+                                AppendBase64(attachment->Data(), attachment->Size());
+                            } else {
+                                AppendName("stub", fields++ > 0); 
+                                AppendBool(true);
+                            }
+                            break;
+                        default: break;
+                    }
+                    
+                    gotBody = true;
+                }
+                
+                if (isData) {
+                    auto data = obj->getString(i);
+                    auto encodedDataLength = obj->getStringLength(i);
+                    dataLength = Base64Helper::GetDecodedSize(data, encodedDataLength);
                 }
-                                
-                auto data = obj->getString(i);
-                auto encodedDataLength = obj->getStringLength(i);
-                dataLength = Base64Helper::GetDecodedSize(data, encodedDataLength);
             } else {
-                AppendName(name, i > 0);
+                AppendName(name, fields++ > 0);
                 
                 switch (type) {
                     case rs::scriptobject::ScriptObjectType::Boolean: AppendBool(obj->getBoolean(i)); break;
@@ -235,7 +267,7 @@ private:
         }
         
         if (!gotLength) {
-            AppendName("length", i > 0);
+            AppendName("length", fields > 0);
             AppendUInt64(dataLength);
         }
         
@@ -245,6 +277,29 @@ private:
         
         buffer_[pos_++] = '}';
     }
+    
+    void AppendBase64(const DocumentAttachment::value_type* data, DocumentAttachment::size_type size) {
+        // the body is encoded a chunk at a time so it is never held in memory as text
+        const DocumentAttachment::size_type chunkSize = 3 * 256;
+        std::array<char, (chunkSize / 3) * 4 + 1> text;
+        
+        if (getRemainingBytes() == 0) {
+            FlushBuffer();
+        }
+        
+        buffer_[pos_++] = '"';
+        
+        for (decltype(size) offset = 0; offset < size; offset += chunkSize) {
+            Base64Helper::Encode(data + offset, std::min(chunkSize, size - offset), text.data());
+            AppendLiteralString(text.data());
+        }
+        
+        if (getRemainingBytes() == 0) {
+            FlushBuffer();
+        }
+        
+        buffer_[pos_++] = '"';
+    }
 
     void AppendArray(script_array_ptr arr, bool comma = false) {
         if (comma) {
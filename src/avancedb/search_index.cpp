@@ -0,0 +1,464 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "search_index.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include <boost/thread.hpp>
+
+#include "document.h"
+#include "document_collection.h"
+#include "global_function_scope.h"
+#include "map_reduce.h"
+#include "map_reduce_thread_pool.h"
+#include "rest_exceptions.h"
+
+static const double bm25K1 = 1.2;
+static const double bm25B = 0.75;
+
+// compacting is only worth it once a good share of the entries are dead
+static const std::uint32_t minCompactEntries = 1024;
+
+static void WriteVarint(std::vector<std::uint8_t>& data, std::uint32_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    
+    data.push_back(static_cast<std::uint8_t>(value));
+}
+
+static bool ReadVarint(const std::uint8_t*& pos, const std::uint8_t* end, std::uint32_t& value) {
+    value = 0;
+    
+    for (unsigned shift = 0; pos < end && shift < 35; shift += 7) {
+        auto byte = *pos++;
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void SearchIndex::Statistics::Merge(const Statistics& other) {
+    docs_ += other.docs_;
+    
+    for (decltype(termDocs_.size()) i = 0, size = termDocs_.size(); i < size; ++i) {
+        termDocs_[i] += other.termDocs_[i];
+        fieldLength_[i] += other.fieldLength_[i];
+        fieldDocs_[i] += other.fieldDocs_[i];
+    }
+}
+
+void SearchIndex::Postings::Append(std::uint32_t docNum, std::uint32_t freq) {
+    WriteVarint(data_, docNum - lastDocNum_);
+    WriteVarint(data_, freq);
+    
+    lastDocNum_ = docNum;
+    ++docs_;
+}
+
+SearchIndex::SearchIndex(const std::string& designId, const std::string& name, const std::string& function, unsigned shards) :
+        designId_(designId), name_(name), function_(function), shards_(shards) {
+    
+}
+
+search_index_ptr SearchIndex::Create(const std::string& designId, const std::string& name, const std::string& function, unsigned shards) {
+    return search_index_ptr{new SearchIndex{designId, name, function, shards}};
+}
+
+search_index_ptr SearchIndex::Reshard(unsigned shards) const {
+    return Create(designId_, name_, function_, shards);
+}
+
+void SearchIndex::Update(unsigned shard, const document_ptr& oldDoc, const document_ptr& newDoc) {
+    const auto& doc = !!oldDoc ? oldDoc : newDoc;
+    if (!!doc && std::strncmp(doc->getId(), "_design/", 8) != 0) {
+        shards_[shard].pending_.emplace_back(oldDoc, newDoc);
+    }
+}
+
+void SearchIndex::Refresh(unsigned shard, DocumentCollection& coll, std::size_t threadId) {
+    auto& s = shards_[shard];
+    std::lock_guard<std::mutex> guard{s.m_};
+    
+    // writers append to the changes while holding the collection exclusively so reading 
+    // or swapping them only needs to keep the writers out, not the other readers
+    boost::shared_lock<DocumentCollection> collLock{coll};
+    auto pending = s.pending_.size() > 0;
+    collLock.unlock();
+    
+    if (!pending) {
+        return;
+    }
+    
+    auto threadPool = MapReduceThreadPool::Get();
+    auto& cx = threadPool->GetThreadContext(threadId);
+    
+    field_values values;
+    
+    GlobalFunctionScope indexScope(cx, "index", 
+        [&](const std::vector<rs::jsapi::Value>& args, rs::jsapi::Value&) {
+            if (args.size() < 2) {
+                return;
+            }
+            
+            std::string value;
+            switch (JS_TypeOfValue(args[1].getContext(), args[1])) {
+                case JSTYPE_STRING: value = args[1].ToString(); break;
+                case JSTYPE_NUMBER: value = args[1].isInt32() ? std::to_string(args[1].toInt32()) : std::to_string(args[1].toNumber()); break;
+                case JSTYPE_BOOLEAN: value = args[1].toBoolean() ? "true" : "false"; break;
+                default: return;
+            }
+            
+            values.emplace_back(args[0].ToString(), std::move(value));
+    });
+    
+    // the function is compiled once per pool thread, and before the changes are taken so a bad function loses nothing
+    std::string script = "(function() { return ";
+    script += function_;
+    script += "; })();";
+    
+    rs::jsapi::Value* func = nullptr;
+    try {
+        func = &threadPool->GetThreadFunction(threadId, script);
+    } catch (const rs::jsapi::ScriptException& ex) {
+        throw CompilationError{ex.what()};
+    }
+    
+    change_array changes;
+    collLock.lock();
+    changes.swap(s.pending_);
+    collLock.unlock();
+    
+    for (const auto& change : changes) {
+        if (!!change.first) {
+            Remove(s, change.first->getId());
+        }
+        
+        if (!!change.second) {
+            values.clear();
+            
+            rs::jsapi::Value object(cx);
+            MapReduce::CreateValueObject(change.second->getObject(), object);
+            
+            rs::jsapi::FunctionArguments args(cx);
+            args.Append(object);
+            
+            try {
+                func->CallFunction(args, false);
+            } catch (const rs::jsapi::ScriptException&) {
+                // as with CouchDB a document the function fails on is left out of the index
+                values.clear();
+            }
+            
+            Add(s, change.second, values);
+        }
+    }
+    
+    if (s.deadEntries_ > minCompactEntries && s.deadEntries_ * 2 > s.entries_.size()) {
+        Compact(s);
+    }
+}
+
+void SearchIndex::Release(unsigned shard) {
+    auto& s = shards_[shard];
+    std::lock_guard<std::mutex> guard{s.m_};
+    
+    // swapped rather than cleared so the memory is given back
+    change_array{}.swap(s.pending_);
+    std::vector<Entry>{}.swap(s.entries_);
+    decltype(s.docNums_){}.swap(s.docNums_);
+    decltype(s.postings_){}.swap(s.postings_);
+    decltype(s.fields_){}.swap(s.fields_);
+    s.deadEntries_ = 0;
+}
+
+void SearchIndex::GetStatistics(unsigned shard, const SearchQuery& query, Statistics& stats) {
+    auto& s = shards_[shard];
+    std::lock_guard<std::mutex> guard{s.m_};
+    
+    stats.docs_ += s.docNums_.size();
+    
+    const auto& terms = query.Terms();
+    for (decltype(terms.size()) i = 0, size = terms.size(); i < size; ++i) {
+        auto postings = s.postings_.find(MakeKey(terms[i].field_, terms[i].token_));
+        if (postings != s.postings_.cend()) {
+            stats.termDocs_[i] += postings->second.docs_;
+        }
+        
+        auto field = s.fields_.find(terms[i].field_);
+        if (field != s.fields_.cend()) {
+            stats.fieldLength_[i] += field->second.length_;
+            stats.fieldDocs_[i] += field->second.docs_;
+        }
+    }
+}
+
+void SearchIndex::Search(unsigned shard, const SearchQuery& query, const Statistics& stats, std::size_t maxHits, hit_array& hits, std::uint64_t& totalHits) {
+    struct Score final {
+        Score() : score_(0), must_(0), excluded_(false) {}
+        
+        double score_;
+        unsigned must_;
+        bool excluded_;
+    };
+    
+    auto& s = shards_[shard];
+    std::lock_guard<std::mutex> guard{s.m_};
+    
+    std::unordered_map<std::uint32_t, Score> scores;
+    const auto& terms = query.Terms();
+    
+    // exclusions can only be applied once every scoring term has been seen
+    for (auto excludePass : { false, true }) {
+        for (decltype(terms.size()) i = 0, size = terms.size(); i < size; ++i) {
+            const auto& term = terms[i];
+            auto exclude = term.occur_ == SearchQuery::Occur::MustNot;
+            if (exclude != excludePass) {
+                continue;
+            }
+            
+            auto postings = s.postings_.find(MakeKey(term.field_, term.token_));
+            if (postings == s.postings_.cend()) {
+                continue;
+            }
+            
+            const double docs = stats.docs_;
+            const double termDocs = stats.termDocs_[i];
+            const auto idf = std::log(1.0 + (docs - termDocs + 0.5) / (termDocs + 0.5));
+            const auto avgLength = stats.fieldDocs_[i] > 0 ? static_cast<double>(stats.fieldLength_[i]) / stats.fieldDocs_[i] : 1.0;
+            
+            const auto& data = postings->second.data_;
+            const auto* pos = data.data();
+            const auto* end = pos + data.size();
+            
+            std::uint32_t docNum = 0;
+            std::uint32_t freq = 0;
+            while (ReadPosting(pos, end, docNum, freq)) {
+                const auto& entry = s.entries_[docNum];
+                if (!entry.doc_) {
+                    continue;
+                }
+                
+                if (exclude) {
+                    auto score = scores.find(docNum);
+                    if (score != scores.end()) {
+                        score->second.excluded_ = true;
+                    }
+                    continue;
+                }
+                
+                double length = 0;
+                for (const auto& fieldLength : entry.fieldLengths_) {
+                    if (fieldLength.first == term.field_) {
+                        length = fieldLength.second;
+                        break;
+                    }
+                }
+                
+                auto& score = scores[docNum];
+                score.score_ += idf * (freq * (bm25K1 + 1)) / (freq + bm25K1 * (1 - bm25B + bm25B * length / avgLength));
+                
+                if (term.occur_ == SearchQuery::Occur::Must) {
+                    ++score.must_;
+                }
+            }
+        }
+    }
+    
+    const auto mustCount = query.MustCount();
+    for (const auto& score : scores) {
+        if (!score.second.excluded_ && score.second.must_ == mustCount) {
+            hits.emplace_back(s.entries_[score.first].doc_, score.second.score_);
+            ++totalHits;
+        }
+    }
+    
+    if (hits.size() > maxHits) {
+        std::partial_sort(hits.begin(), hits.begin() + maxHits, hits.end(), &SearchIndex::Less);
+        hits.erase(hits.begin() + maxHits, hits.end());
+    } else {
+        std::sort(hits.begin(), hits.end(), &SearchIndex::Less);
+    }
+}
+
+bool SearchIndex::Less(const Hit& a, const Hit& b) {
+    if (a.score_ != b.score_) {
+        return a.score_ > b.score_;
+    }
+    
+    return std::strcmp(a.doc_->getId(), b.doc_->getId()) < 0;
+}
+
+std::string SearchIndex::MakeKey(const std::string& field, const std::string& token) {
+    std::string key;
+    key.reserve(field.size() + token.size() + 1);
+    key += field;
+    key += '\0';
+    key += token;
+    return key;
+}
+
+bool SearchIndex::ReadPosting(const std::uint8_t*& pos, const std::uint8_t* end, std::uint32_t& docNum, std::uint32_t& freq) {
+    std::uint32_t delta = 0;
+    if (!ReadVarint(pos, end, delta) || !ReadVarint(pos, end, freq)) {
+        return false;
+    }
+    
+    docNum += delta;
+    return true;
+}
+
+void SearchIndex::Remove(Shard& shard, const char* id) {
+    auto docNum = shard.docNums_.find(id);
+    if (docNum == shard.docNums_.end()) {
+        return;
+    }
+    
+    auto& entry = shard.entries_[docNum->second];
+    
+    for (auto postings : entry.postings_) {
+        --postings->docs_;
+    }
+    
+    for (const auto& fieldLength : entry.fieldLengths_) {
+        auto& field = shard.fields_[fieldLength.first];
+        field.length_ -= fieldLength.second;
+        --field.docs_;
+    }
+    
+    // the entry stays in place as the postings still refer to its number
+    entry = Entry{};
+    shard.docNums_.erase(docNum);
+    ++shard.deadEntries_;
+}
+
+void SearchIndex::Add(Shard& shard, const document_ptr& doc, const field_values& values) {
+    Entry entry;
+    std::unordered_map<std::string, std::uint32_t> freqs;
+    std::vector<std::string> tokens;
+    
+    for (const auto& value : values) {
+        tokens.clear();
+        SearchQuery::Tokenize(value.second.c_str(), value.second.size(), tokens);
+        if (tokens.size() == 0) {
+            continue;
+        }
+        
+        auto fieldLength = std::find_if(entry.fieldLengths_.begin(), entry.fieldLengths_.end(), 
+            [&](const std::pair<std::string, std::uint32_t>& fieldLength) { return fieldLength.first == value.first; });
+        
+        if (fieldLength == entry.fieldLengths_.end()) {
+            entry.fieldLengths_.emplace_back(value.first, tokens.size());
+        } else {
+            fieldLength->second += tokens.size();
+        }
+        
+        for (const auto& token : tokens) {
+            ++freqs[MakeKey(value.first, token)];
+        }
+    }
+    
+    if (freqs.size() == 0) {
+        return;
+    }
+    
+    const std::uint32_t docNum = shard.entries_.size();
+    
+    entry.doc_ = doc;
+    entry.postings_.reserve(freqs.size());
+    for (const auto& freq : freqs) {
+        auto& postings = shard.postings_[freq.first];
+        postings.Append(docNum, freq.second);
+        entry.postings_.push_back(&postings);
+    }
+    
+    for (const auto& fieldLength : entry.fieldLengths_) {
+        auto& field = shard.fields_[fieldLength.first];
+        field.length_ += fieldLength.second;
+        ++field.docs_;
+    }
+    
+    shard.docNums_[doc->getId()] = docNum;
+    shard.entries_.emplace_back(std::move(entry));
+}
+
+void SearchIndex::Compact(Shard& shard) {
+    const auto dead = std::numeric_limits<std::uint32_t>::max();
+    
+    std::vector<std::uint32_t> docNums(shard.entries_.size(), dead);
+    std::vector<Entry> entries;
+    entries.reserve(shard.entries_.size() - shard.deadEntries_);
+    
+    for (decltype(shard.entries_.size()) i = 0, size = shard.entries_.size(); i < size; ++i) {
+        if (!!shard.entries_[i].doc_) {
+            docNums[i] = entries.size();
+            entries.emplace_back(std::move(shard.entries_[i]));
+        }
+    }
+    
+    for (auto iter = shard.postings_.begin(); iter != shard.postings_.end();) {
+        auto& postings = iter->second;
+        if (postings.docs_ == 0) {
+            iter = shard.postings_.erase(iter);
+            continue;
+        }
+        
+        Postings compacted;
+        
+        const auto* pos = postings.data_.data();
+        const auto* end = pos + postings.data_.size();
+        
+        std::uint32_t docNum = 0;
+        std::uint32_t freq = 0;
+        while (ReadPosting(pos, end, docNum, freq)) {
+            if (docNums[docNum] != dead) {
+                compacted.Append(docNums[docNum], freq);
+            }
+        }
+        
+        compacted.data_.shrink_to_fit();
+        postings.data_.swap(compacted.data_);
+        postings.lastDocNum_ = compacted.lastDocNum_;
+        
+        ++iter;
+    }
+    
+    for (auto iter = shard.fields_.begin(); iter != shard.fields_.end();) {
+        if (iter->second.docs_ == 0) {
+            iter = shard.fields_.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    
+    for (decltype(entries.size()) i = 0, size = entries.size(); i < size; ++i) {
+        shard.docNums_[entries[i].doc_->getId()] = i;
+    }
+    
+    shard.entries_.swap(entries);
+    shard.deadEntries_ = 0;
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_SEARCH_INDEX_H
+#define RS_AVANCEDB_SEARCH_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <mutex>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "libjsapi.h"
+
+#include "types.h"
+#include "search_query.h"
+
+// an inverted index over the fields a design document index function passes 
+// to index(name, value), split into the same shards as the documents. Writes 
+// only queue their changes under the collection lock, the index function is 
+// run over them by the next query on a map/reduce thread.
+class SearchIndex final : private boost::noncopyable {
+public:
+    
+    // the collection wide counts BM25 needs, one entry per query term
+    struct Statistics final {
+        Statistics(std::size_t terms) : docs_(0), termDocs_(terms), fieldLength_(terms), fieldDocs_(terms) {}
+        
+        void Merge(const Statistics& other);
+        
+        std::uint64_t docs_;
+        std::vector<std::uint64_t> termDocs_;
+        std::vector<std::uint64_t> fieldLength_;
+        std::vector<std::uint64_t> fieldDocs_;
+    };
+    
+    struct Hit final {
+        Hit(const document_ptr& doc, double score) : doc_(doc), score_(score) {}
+        
+        document_ptr doc_;
+        double score_;
+    };
+    
+    using hit_array = std::vector<Hit>;
+    
+    static search_index_ptr Create(const std::string& designId, const std::string& name, const std::string& function, unsigned shards);
+    
+    const std::string& DesignId() const { return designId_; }
+    const std::string& Name() const { return name_; }
+    const std::string& Function() const { return function_; }
+    
+    // an empty index with the same definition for a different number of shards
+    search_index_ptr Reshard(unsigned shards) const;
+    
+    // must be called while holding the lock of the shard's collection
+    void Update(unsigned shard, const document_ptr& oldDoc, const document_ptr& newDoc);
+    
+    // runs the index function over the changes queued on the shard, must be called on the map/reduce pool thread
+    void Refresh(unsigned shard, DocumentCollection& coll, std::size_t threadId);
+    
+    // frees the entries and changes of a shard whose collection has been released
+    void Release(unsigned shard);
+    
+    void GetStatistics(unsigned shard, const SearchQuery& query, Statistics& stats);
+    void Search(unsigned shard, const SearchQuery& query, const Statistics& stats, std::size_t maxHits, hit_array& hits, std::uint64_t& totalHits);
+    
+    // highest score first, ties ordered by document id
+    static bool Less(const Hit& a, const Hit& b);
+    
+private:
+    
+    // a posting is the varint delta from the previous document number followed
+    // by the varint count of the term in the document, document numbers only 
+    // ever increase until the shard is compacted so postings are only appended
+    struct Postings final {
+        Postings() : docs_(0), lastDocNum_(0) {}
+        
+        void Append(std::uint32_t docNum, std::uint32_t freq);
+        
+        std::vector<std::uint8_t> data_;
+        std::uint32_t docs_;
+        std::uint32_t lastDocNum_;
+    };
+    
+    struct FieldStatistics final {
+        FieldStatistics() : length_(0), docs_(0) {}
+        
+        std::uint64_t length_;
+        std::uint64_t docs_;
+    };
+    
+    struct Entry final {
+        document_ptr doc_;
+        std::vector<std::pair<std::string, std::uint32_t>> fieldLengths_;
+        std::vector<Postings*> postings_;
+    };
+    
+    using change_array = std::vector<std::pair<document_ptr, document_ptr>>;
+    using field_values = std::vector<std::pair<std::string, std::string>>;
+    
+    struct Shard final {
+        Shard() : deadEntries_(0) {}
+        
+        std::mutex m_;
+        change_array pending_;
+        
+        std::vector<Entry> entries_;
+        std::unordered_map<std::string, std::uint32_t> docNums_;
+        std::unordered_map<std::string, Postings> postings_;
+        std::unordered_map<std::string, FieldStatistics> fields_;
+        std::uint32_t deadEntries_;
+    };
+    
+    SearchIndex(const std::string& designId, const std::string& name, const std::string& function, unsigned shards);
+    
+    static std::string MakeKey(const std::string& field, const std::string& token);
+    static bool ReadPosting(const std::uint8_t*& pos, const std::uint8_t* end, std::uint32_t& docNum, std::uint32_t& freq);
+    
+    void Remove(Shard& shard, const char* id);
+    void Add(Shard& shard, const document_ptr& doc, const field_values& values);
+    void Compact(Shard& shard);
+    
+    const std::string designId_;
+    const std::string name_;
+    const std::string function_;
+    
+    std::vector<Shard> shards_;
+};
+
+#endif /* RS_AVANCEDB_SEARCH_INDEX_H */
+
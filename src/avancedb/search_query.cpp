@@ -0,0 +1,116 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "search_query.h"
+
+#include <cctype>
+
+#include "rest_exceptions.h"
+
+const char SearchQuery::DefaultField[] = "default";
+
+SearchQuery::SearchQuery(const std::string& query) : mustCount_(0) {
+    std::vector<std::string> tokens;
+    
+    auto iter = query.cbegin();
+    const auto end = query.cend();
+    
+    while (iter != end) {
+        if (std::isspace(static_cast<unsigned char>(*iter))) {
+            ++iter;
+            continue;
+        }
+        
+        auto occur = Occur::Should;
+        if (*iter == '+') {
+            occur = Occur::Must;
+            ++iter;
+        } else if (*iter == '-') {
+            occur = Occur::MustNot;
+            ++iter;
+        }
+        
+        // a field name runs up to a colon which comes before any whitespace or quote
+        std::string field{DefaultField};
+        auto fieldEnd = iter;
+        while (fieldEnd != end && *fieldEnd != ':' && *fieldEnd != '"' && !std::isspace(static_cast<unsigned char>(*fieldEnd))) {
+            ++fieldEnd;
+        }
+        
+        if (fieldEnd != end && *fieldEnd == ':' && fieldEnd != iter) {
+            field.assign(iter, fieldEnd);
+            iter = fieldEnd + 1;
+        }
+        
+        auto valueBegin = iter;
+        if (iter != end && *iter == '"') {
+            valueBegin = ++iter;
+            while (iter != end && *iter != '"') {
+                ++iter;
+            }
+        } else {
+            while (iter != end && !std::isspace(static_cast<unsigned char>(*iter))) {
+                ++iter;
+            }
+        }
+        
+        tokens.clear();
+        Tokenize(query.data() + (valueBegin - query.cbegin()), iter - valueBegin, tokens);
+        
+        if (iter != end && *iter == '"') {
+            ++iter;
+        }
+        
+        for (auto& token : tokens) {
+            terms_.emplace_back(occur, field, std::move(token));
+            
+            if (occur == Occur::Must) {
+                ++mustCount_;
+            }
+        }
+    }
+    
+    if (terms_.size() == 0) {
+        throw QueryParseError{"q", query};
+    }
+}
+
+const SearchQuery::term_array& SearchQuery::Terms() const {
+    return terms_;
+}
+
+unsigned SearchQuery::MustCount() const {
+    return mustCount_;
+}
+
+void SearchQuery::Tokenize(const char* text, std::size_t length, std::vector<std::string>& tokens) {
+    std::string token;
+    
+    for (std::size_t i = 0; i <= length; ++i) {
+        auto ch = i < length ? static_cast<unsigned char>(text[i]) : '\0';
+        
+        if (ch >= 0x80 || std::isdigit(ch)) {
+            token += static_cast<char>(ch);
+        } else if (std::isalpha(ch)) {
+            token += static_cast<char>(std::tolower(ch));
+        } else if (token.size() > 0) {
+            tokens.emplace_back(std::move(token));
+            token.clear();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_SEARCH_QUERY_H
+#define RS_AVANCEDB_SEARCH_QUERY_H
+
+#include <string>
+#include <vector>
+
+// a parsed full text query, terms are separated by whitespace and may be 
+// prefixed with + (required) or - (excluded) and qualified with field:, 
+// a quoted value is analyzed into terms the same way as an unquoted one
+class SearchQuery final {
+public:
+    enum class Occur { Should, Must, MustNot };
+    
+    struct Term final {
+        Term(Occur occur, const std::string& field, std::string&& token) : 
+            occur_(occur), field_(field), token_(std::move(token)) {}
+        
+        Occur occur_;
+        std::string field_;
+        std::string token_;
+    };
+    
+    using term_array = std::vector<Term>;
+    
+    static const char DefaultField[];
+    
+    SearchQuery(const std::string& query);
+    
+    const term_array& Terms() const;
+    unsigned MustCount() const;
+    
+    // lower cases ASCII letters and splits on anything else which isn't a digit, 
+    // bytes outside ASCII are kept so UTF-8 words aren't broken up
+    static void Tokenize(const char* text, std::size_t length, std::vector<std::string>& tokens);
+    
+private:
+    
+    term_array terms_;
+    unsigned mustCount_;
+};
+
+#endif /* RS_AVANCEDB_SEARCH_QUERY_H */
+
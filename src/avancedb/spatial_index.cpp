@@ -0,0 +1,520 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spatial_index.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+
+#include <boost/thread.hpp>
+#include <boost/format.hpp>
+
+#include "document.h"
+#include "document_collection.h"
+#include "global_function_scope.h"
+#include "map_reduce.h"
+#include "map_reduce_thread_pool.h"
+#include "rest_exceptions.h"
+#include "script_array_jsapi_key_value_source.h"
+
+#include "script_array_factory.h"
+
+const std::size_t SpatialIndex::MinMergeEntries;
+
+static const double pi = 3.14159265358979323846;
+static const double earthRadiusMeters = 6371008.8;
+
+static double ToRadians(double degrees) {
+    return degrees * pi / 180.0;
+}
+
+static double GetDistance(double lon1, double lat1, double lon2, double lat2) {
+    auto sinLat = std::sin(ToRadians(lat2 - lat1) / 2);
+    auto sinLon = std::sin(ToRadians(lon2 - lon1) / 2);
+    
+    auto a = sinLat * sinLat + std::cos(ToRadians(lat1)) * std::cos(ToRadians(lat2)) * sinLon * sinLon;
+    return 2 * earthRadiusMeters * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+bool SpatialIndex::Box::Intersects(const Box& other) const {
+    return minLon_ <= other.maxLon_ && other.minLon_ <= maxLon_ && minLat_ <= other.maxLat_ && other.minLat_ <= maxLat_;
+}
+
+bool SpatialIndex::Box::Contains(double lon, double lat) const {
+    return lon >= minLon_ && lon <= maxLon_ && lat >= minLat_ && lat <= maxLat_;
+}
+
+void SpatialIndex::Box::Extend(const Box& other) {
+    minLon_ = std::min(minLon_, other.minLon_);
+    minLat_ = std::min(minLat_, other.minLat_);
+    maxLon_ = std::max(maxLon_, other.maxLon_);
+    maxLat_ = std::max(maxLat_, other.maxLat_);
+}
+
+SpatialIndex::Region SpatialIndex::Region::Bbox(double minLon, double minLat, double maxLon, double maxLat) {
+    // NaN fails every comparison so it is rejected explicitly
+    if (!std::isfinite(minLon) || !std::isfinite(minLat) || !std::isfinite(maxLon) || !std::isfinite(maxLat) || 
+            minLat > maxLat || minLon < -180 || minLon > 180 || maxLon < -180 || maxLon > 180 || minLat < -90 || maxLat > 90) {
+        throw QueryParseError{"bbox", (boost::format("%f,%f,%f,%f") % minLon % minLat % maxLon % maxLat).str()};
+    }
+    
+    Region region;
+    
+    if (minLon <= maxLon) {
+        region.boxes_.emplace_back(minLon, minLat, maxLon, maxLat);
+    } else {
+        // the box crosses the antimeridian
+        region.boxes_.emplace_back(minLon, minLat, 180, maxLat);
+        region.boxes_.emplace_back(-180, minLat, maxLon, maxLat);
+    }
+    
+    return region;
+}
+
+SpatialIndex::Region SpatialIndex::Region::Radius(double lon, double lat, double meters) {
+    if (!std::isfinite(lon) || !std::isfinite(lat) || !std::isfinite(meters) || 
+            lon < -180 || lon > 180 || lat < -90 || lat > 90 || meters < 0) {
+        throw QueryParseError{"radius", (boost::format("%f,%f,%f") % lon % lat % meters).str()};
+    }
+    
+    const auto angle = meters / earthRadiusMeters;
+    const auto latDelta = angle * 180.0 / pi;
+    
+    auto minLat = lat - latDelta;
+    auto maxLat = lat + latDelta;
+    
+    Region region;
+    
+    if (minLat <= -90 || maxLat >= 90 || angle >= pi / 2) {
+        // the circle covers a pole so it covers every longitude
+        region = Bbox(-180, std::max(minLat, -90.0), 180, std::min(maxLat, 90.0));
+    } else {
+        const auto lonDelta = std::asin(std::min(1.0, std::sin(angle) / std::cos(ToRadians(lat)))) * 180.0 / pi;
+        
+        auto minLon = lon - lonDelta;
+        auto maxLon = lon + lonDelta;
+        
+        if (lonDelta >= 180) {
+            region = Bbox(-180, minLat, 180, maxLat);
+        } else {
+            region = Bbox(minLon < -180 ? minLon + 360 : minLon, minLat, maxLon > 180 ? maxLon - 360 : maxLon, maxLat);
+        }
+    }
+    
+    region.lon_ = lon;
+    region.lat_ = lat;
+    region.radius_ = meters;
+    
+    return region;
+}
+
+bool SpatialIndex::Region::Contains(double lon, double lat, double& distance) const {
+    auto contained = std::any_of(boxes_.cbegin(), boxes_.cend(), [&](const Box& box) { return box.Contains(lon, lat); });
+    
+    if (contained && IsRadius()) {
+        distance = GetDistance(lon_, lat_, lon, lat);
+        contained = distance <= radius_;
+    }
+    
+    return contained;
+}
+
+SpatialIndex::SpatialIndex(const std::string& designId, const std::string& name, unsigned shards) :
+        designId_(designId), name_(name), shards_(shards) {
+    
+}
+
+spatial_index_ptr SpatialIndex::Create(const std::string& designId, const std::string& name, script_object_ptr spatial, unsigned shards) {
+    using ScriptObjectType = rs::scriptobject::ScriptObjectType;
+    
+    spatial_index_ptr index{new SpatialIndex{designId, name, shards}};
+    
+    auto definition = !!spatial ? MangoValue{spatial}.getField(name.c_str()) : MangoValue{};
+    
+    if (definition.getType() == ScriptObjectType::String) {
+        index->function_ = definition.getString();
+        index->definition_ = index->function_;
+    } else {
+        auto lon = definition.getField("lon");
+        auto lat = definition.getField("lat");
+        
+        if (lon.getType() != ScriptObjectType::String || lat.getType() != ScriptObjectType::String) {
+            throw MissingIndex{};
+        }
+        
+        index->lonField_ = MangoValue::ParsePath(lon.getString());
+        index->latField_ = MangoValue::ParsePath(lat.getString());
+        
+        index->definition_ = "lon:";
+        index->definition_ += lon.getString();
+        index->definition_ += "\nlat:";
+        index->definition_ += lat.getString();
+    }
+    
+    return index;
+}
+
+spatial_index_ptr SpatialIndex::Reshard(unsigned shards) const {
+    spatial_index_ptr index{new SpatialIndex{designId_, name_, shards}};
+    
+    index->definition_ = definition_;
+    index->function_ = function_;
+    index->lonField_ = lonField_;
+    index->latField_ = latField_;
+    
+    return index;
+}
+
+void SpatialIndex::Update(unsigned shard, const document_ptr& oldDoc, const document_ptr& newDoc) {
+    const auto& doc = !!oldDoc ? oldDoc : newDoc;
+    if (!!doc && std::strncmp(doc->getId(), "_design/", 8) != 0) {
+        shards_[shard].pending_.emplace_back(oldDoc, newDoc);
+    }
+}
+
+void SpatialIndex::Refresh(unsigned shard, DocumentCollection& coll, std::size_t threadId) {
+    auto& s = shards_[shard];
+    std::lock_guard<std::mutex> guard{s.m_};
+    
+    // writers append to the changes while holding the collection exclusively so reading 
+    // or swapping them only needs to keep the writers out, not the other readers
+    boost::shared_lock<DocumentCollection> collLock{coll};
+    auto pending = s.pending_.size() > 0;
+    collLock.unlock();
+    
+    if (!pending) {
+        return;
+    }
+    
+    entry_array added;
+    document_ptr emitDoc;
+    
+    std::unique_ptr<GlobalFunctionScope> emitScope;
+    
+    auto threadPool = MapReduceThreadPool::Get();
+    auto& cx = threadPool->GetThreadContext(threadId);
+    
+    rs::jsapi::Value* func = nullptr;
+    if (function_.size() > 0) {
+        emitScope.reset(new GlobalFunctionScope(cx, "emit", 
+            [&](const std::vector<rs::jsapi::Value>& args, rs::jsapi::Value&) {
+                auto source = ScriptArrayJsapiKeyValueSource::Create(args[0], args[1]);
+                auto keyValue = rs::scriptobject::ScriptArrayFactory::CreateArray(source);
+                
+                double lon = 0, lat = 0;
+                if (GetPoint(MangoValue{keyValue, 0}, lon, lat)) {
+                    added.emplace_back(GetHilbertIndex(lon, lat), lon, lat, emitDoc, keyValue);
+                }
+        }));
+        
+        // compiled once per pool thread
+        std::string script = "(function() { return ";
+        script += function_;
+        script += "; })();";
+        
+        try {
+            func = &threadPool->GetThreadFunction(threadId, script);
+        } catch (const rs::jsapi::ScriptException& ex) {
+            throw CompilationError{ex.what()};
+        }
+    }
+    
+    change_array changes;
+    collLock.lock();
+    changes.swap(s.pending_);
+    collLock.unlock();
+    
+    // only the latest revision of each changed document matters
+    std::unordered_map<std::string, document_ptr> latest;
+    for (const auto& change : changes) {
+        latest[(!!change.first ? change.first : change.second)->getId()] = change.second;
+    }
+    
+    for (const auto& doc : latest) {
+        auto points = s.docPoints_.find(doc.first);
+        if (points != s.docPoints_.end()) {
+            for (auto hilbert : points->second) {
+                s.deadEntries_ += KillEntries(s.entries_, hilbert, doc.first.c_str());
+                KillEntries(s.recent_, hilbert, doc.first.c_str());
+            }
+            
+            s.docPoints_.erase(points);
+        }
+        
+        if (!doc.second) {
+            continue;
+        }
+        
+        if (!!func) {
+            emitDoc = doc.second;
+            
+            rs::jsapi::Value object(cx);
+            MapReduce::CreateValueObject(emitDoc->getObject(), object);
+            
+            rs::jsapi::FunctionArguments args(cx);
+            args.Append(object);
+            
+            try {
+                func->CallFunction(args, false);
+            } catch (const rs::jsapi::ScriptException&) {
+                // the points emitted before the failure are kept, as a view would
+            }
+        } else {
+            MangoValue obj{doc.second->getObject()};
+            auto lon = obj.getPath(lonField_);
+            auto lat = obj.getPath(latField_);
+            
+            if (lon.IsNumber() && lat.IsNumber() && lon.getNumber() >= -180 && lon.getNumber() <= 180 && lat.getNumber() >= -90 && lat.getNumber() <= 90) {
+                added.emplace_back(GetHilbertIndex(lon.getNumber(), lat.getNumber()), lon.getNumber(), lat.getNumber(), doc.second, script_array_ptr{});
+            }
+        }
+    }
+    
+    for (const auto& entry : added) {
+        s.docPoints_[entry.doc_->getId()].push_back(entry.hilbert_);
+    }
+    
+    std::sort(added.begin(), added.end(), &SpatialIndex::EntryLess);
+    
+    auto& recent = s.recent_;
+    recent.erase(std::remove_if(recent.begin(), recent.end(), [](const Entry& entry) { return !entry.live_; }), recent.end());
+    
+    auto oldSize = recent.size();
+    recent.insert(recent.end(), added.cbegin(), added.cend());
+    std::inplace_merge(recent.begin(), recent.begin() + oldSize, recent.end(), &SpatialIndex::EntryLess);
+    
+    auto& entries = s.entries_;
+    if (recent.size() + s.deadEntries_ > std::max(MinMergeEntries, entries.size() / 4)) {
+        // a merge costs the size of the shard, waiting for a share of it keeps the cost per change constant
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) { return !entry.live_; }), entries.end());
+        
+        oldSize = entries.size();
+        entries.insert(entries.end(), recent.cbegin(), recent.cend());
+        std::inplace_merge(entries.begin(), entries.begin() + oldSize, entries.end(), &SpatialIndex::EntryLess);
+        
+        entry_array{}.swap(recent);
+        s.deadEntries_ = 0;
+        
+        BuildTree(entries, s.levels_);
+    }
+    
+    BuildTree(recent, s.recentLevels_);
+}
+
+void SpatialIndex::Release(unsigned shard) {
+    auto& s = shards_[shard];
+    std::lock_guard<std::mutex> guard{s.m_};
+    
+    // swapped rather than cleared so the memory is given back
+    change_array{}.swap(s.pending_);
+    entry_array{}.swap(s.entries_);
+    level_array{}.swap(s.levels_);
+    entry_array{}.swap(s.recent_);
+    level_array{}.swap(s.recentLevels_);
+    decltype(s.docPoints_){}.swap(s.docPoints_);
+    s.deadEntries_ = 0;
+}
+
+void SpatialIndex::Query(unsigned shard, const Region& region, hit_array& hits) {
+    auto& s = shards_[shard];
+    std::lock_guard<std::mutex> guard{s.m_};
+    
+    QueryTree(s.entries_, s.levels_, region, hits);
+    QueryTree(s.recent_, s.recentLevels_, region, hits);
+}
+
+void SpatialIndex::QueryTree(const entry_array& entries, const level_array& levels, const Region& region, hit_array& hits) {
+    if (levels.size() == 0) {
+        return;
+    }
+    
+    const auto& boxes = region.Boxes();
+    auto intersects = [&](const Box& box) {
+        return std::any_of(boxes.cbegin(), boxes.cend(), [&](const Box& regionBox) { return regionBox.Intersects(box); });
+    };
+    
+    // walk down from the root, the top level always holds a single box
+    std::vector<std::pair<std::size_t, std::size_t>> nodes;
+    nodes.emplace_back(levels.size() - 1, 0);
+    
+    while (nodes.size() > 0) {
+        auto node = nodes.back();
+        nodes.pop_back();
+        
+        if (!intersects(levels[node.first][node.second])) {
+            continue;
+        }
+        
+        const auto begin = node.second * NodeSize;
+        if (node.first > 0) {
+            const auto end = std::min(begin + NodeSize, levels[node.first - 1].size());
+            for (auto i = begin; i < end; ++i) {
+                nodes.emplace_back(node.first - 1, i);
+            }
+        } else {
+            const auto end = std::min(begin + NodeSize, entries.size());
+            for (auto i = begin; i < end; ++i) {
+                const auto& entry = entries[i];
+                
+                double distance = 0;
+                if (entry.live_ && region.Contains(entry.lon_, entry.lat_, distance)) {
+                    hits.emplace_back(entry.doc_, entry.lon_, entry.lat_, entry.keyValue_, distance);
+                }
+            }
+        }
+    }
+}
+
+std::size_t SpatialIndex::Size(unsigned shard) {
+    auto& s = shards_[shard];
+    std::lock_guard<std::mutex> guard{s.m_};
+    return s.entries_.size() - s.deadEntries_ + s.recent_.size();
+}
+
+bool SpatialIndex::Less(const Hit& a, const Hit& b, bool byDistance) {
+    if (byDistance && a.distance_ != b.distance_) {
+        return a.distance_ < b.distance_;
+    }
+    
+    auto compare = std::strcmp(a.doc_->getId(), b.doc_->getId());
+    if (compare != 0) {
+        return compare < 0;
+    }
+    
+    return a.lon_ < b.lon_ || (a.lon_ == b.lon_ && a.lat_ < b.lat_);
+}
+
+std::uint32_t SpatialIndex::GetHilbertIndex(double lon, double lat) {
+    const std::uint32_t n = 1 << 16;
+    
+    auto x = static_cast<std::uint32_t>((lon + 180.0) / 360.0 * (n - 1));
+    auto y = static_cast<std::uint32_t>((lat + 90.0) / 180.0 * (n - 1));
+    
+    std::uint32_t index = 0;
+    for (std::uint32_t s = n / 2; s > 0; s /= 2) {
+        std::uint32_t rx = (x & s) > 0 ? 1 : 0;
+        std::uint32_t ry = (y & s) > 0 ? 1 : 0;
+        index += s * s * ((3 * rx) ^ ry);
+        
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            
+            std::swap(x, y);
+        }
+    }
+    
+    return index;
+}
+
+bool SpatialIndex::GetPoint(const MangoValue& value, double& lon, double& lat) {
+    auto coordinates = value;
+    
+    if (value.getType() == rs::scriptobject::ScriptObjectType::Object) {
+        auto type = value.getField("type");
+        if (type.getType() != rs::scriptobject::ScriptObjectType::String || std::strcmp(type.getString(), "Point") != 0) {
+            return false;
+        }
+        
+        coordinates = value.getField("coordinates");
+    }
+    
+    if (coordinates.getType() != rs::scriptobject::ScriptObjectType::Array || coordinates.getCount() < 2) {
+        return false;
+    }
+    
+    auto x = coordinates.getElement(0);
+    auto y = coordinates.getElement(1);
+    if (!x.IsNumber() || !y.IsNumber()) {
+        return false;
+    }
+    
+    lon = x.getNumber();
+    lat = y.getNumber();
+    
+    return lon >= -180 && lon <= 180 && lat >= -90 && lat <= 90;
+}
+
+bool SpatialIndex::EntryLess(const Entry& a, const Entry& b) {
+    if (a.hilbert_ != b.hilbert_) {
+        return a.hilbert_ < b.hilbert_;
+    }
+    
+    return std::strcmp(a.doc_->getId(), b.doc_->getId()) < 0;
+}
+
+std::size_t SpatialIndex::KillEntries(entry_array& entries, std::uint32_t hilbert, const char* id) {
+    auto iter = std::partition_point(entries.begin(), entries.end(), [&](const Entry& entry) {
+        return entry.hilbert_ < hilbert || (entry.hilbert_ == hilbert && std::strcmp(entry.doc_->getId(), id) < 0);
+    });
+    
+    std::size_t killed = 0;
+    for (; iter != entries.end() && iter->hilbert_ == hilbert && std::strcmp(iter->doc_->getId(), id) == 0; ++iter) {
+        if (iter->live_) {
+            iter->live_ = false;
+            ++killed;
+        }
+    }
+    
+    return killed;
+}
+
+void SpatialIndex::BuildTree(const entry_array& entries, level_array& levels) {
+    levels.clear();
+    
+    if (entries.size() == 0) {
+        return;
+    }
+    
+    std::vector<Box> level;
+    level.reserve((entries.size() + NodeSize - 1) / NodeSize);
+    
+    for (std::size_t i = 0, size = entries.size(); i < size; i += NodeSize) {
+        Box box{entries[i].lon_, entries[i].lat_, entries[i].lon_, entries[i].lat_};
+        for (auto j = i + 1, end = std::min(i + NodeSize, size); j < end; ++j) {
+            box.Extend(Box{entries[j].lon_, entries[j].lat_, entries[j].lon_, entries[j].lat_});
+        }
+        
+        level.push_back(box);
+    }
+    
+    levels.emplace_back(std::move(level));
+    
+    while (levels.back().size() > 1) {
+        const auto& below = levels.back();
+        
+        std::vector<Box> above;
+        above.reserve((below.size() + NodeSize - 1) / NodeSize);
+        
+        for (std::size_t i = 0, size = below.size(); i < size; i += NodeSize) {
+            auto box = below[i];
+            for (auto j = i + 1, end = std::min(i + NodeSize, size); j < end; ++j) {
+                box.Extend(below[j]);
+            }
+            
+            above.push_back(box);
+        }
+        
+        levels.emplace_back(std::move(above));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,194 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RS_AVANCEDB_SPATIAL_INDEX_H
+#define RS_AVANCEDB_SPATIAL_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "libjsapi.h"
+
+#include "types.h"
+#include "mango_value.h"
+
+// an index of the points in each document, either emitted by a design document 
+// spatial function as [lon, lat] or a GeoJSON Point, or read from a pair of 
+// longitude and latitude fields. Each shard keeps its points sorted along a 
+// Hilbert curve with a packed R-tree of bounding boxes built over them. As with 
+// search indexes writes only queue changes which the next query applies. The 
+// changes go in a second, smaller, tree which is only merged into the first 
+// once it is a good share of the shard, so a refresh costs in proportion to 
+// the changes rather than to the size of the shard.
+class SpatialIndex final : private boost::noncopyable {
+public:
+    
+    struct Box final {
+        Box() : minLon_(0), minLat_(0), maxLon_(0), maxLat_(0) {}
+        Box(double minLon, double minLat, double maxLon, double maxLat) : 
+            minLon_(minLon), minLat_(minLat), maxLon_(maxLon), maxLat_(maxLat) {}
+        
+        bool Intersects(const Box& other) const;
+        bool Contains(double lon, double lat) const;
+        void Extend(const Box& other);
+        
+        double minLon_;
+        double minLat_;
+        double maxLon_;
+        double maxLat_;
+    };
+    
+    // the boxes to search, boxes crossing the antimeridian are split in two, 
+    // radius regions also filter on the great circle distance from their centre
+    class Region final {
+    public:
+        static Region Bbox(double minLon, double minLat, double maxLon, double maxLat);
+        static Region Radius(double lon, double lat, double meters);
+        
+        const std::vector<Box>& Boxes() const { return boxes_; }
+        bool IsRadius() const { return radius_ >= 0; }
+        
+        bool Contains(double lon, double lat, double& distance) const;
+        
+    private:
+        Region() : lon_(0), lat_(0), radius_(-1) {}
+        
+        std::vector<Box> boxes_;
+        double lon_;
+        double lat_;
+        double radius_;
+    };
+    
+    struct Hit final {
+        Hit(const document_ptr& doc, double lon, double lat, const script_array_ptr& keyValue, double distance) : 
+            doc_(doc), lon_(lon), lat_(lat), keyValue_(keyValue), distance_(distance) {}
+        
+        document_ptr doc_;
+        double lon_;
+        double lat_;
+        script_array_ptr keyValue_;
+        double distance_;
+    };
+    
+    using hit_array = std::vector<Hit>;
+    
+    // the definition is the named member of a design document's spatial object
+    static spatial_index_ptr Create(const std::string& designId, const std::string& name, script_object_ptr spatial, unsigned shards);
+    
+    const std::string& DesignId() const { return designId_; }
+    const std::string& Name() const { return name_; }
+    const std::string& Definition() const { return definition_; }
+    
+    // an empty index with the same definition for a different number of shards
+    spatial_index_ptr Reshard(unsigned shards) const;
+    
+    // must be called while holding the lock of the shard's collection
+    void Update(unsigned shard, const document_ptr& oldDoc, const document_ptr& newDoc);
+    
+    // applies the changes queued on the shard, must be called on the map/reduce pool thread
+    void Refresh(unsigned shard, DocumentCollection& coll, std::size_t threadId);
+    
+    // frees the entries and changes of a shard whose collection has been released
+    void Release(unsigned shard);
+    void Query(unsigned shard, const Region& region, hit_array& hits);
+    
+    std::size_t Size(unsigned shard);
+    
+    // nearest first for radius regions, otherwise by document id
+    static bool Less(const Hit& a, const Hit& b, bool byDistance);
+    
+private:
+    
+    struct Entry final {
+        Entry(std::uint32_t hilbert, double lon, double lat, const document_ptr& doc, const script_array_ptr& keyValue) : 
+            hilbert_(hilbert), lon_(lon), lat_(lat), doc_(doc), keyValue_(keyValue), live_(true) {}
+        
+        std::uint32_t hilbert_;
+        double lon_;
+        double lat_;
+        document_ptr doc_;
+        script_array_ptr keyValue_;
+        
+        // entries of changed documents are marked rather than removed so the tree over them stays valid
+        bool live_;
+    };
+    
+    using change_array = std::vector<std::pair<document_ptr, document_ptr>>;
+    using entry_array = std::vector<Entry>;
+    
+    // levels[0] bounds each run of NodeSize entries, each level above 
+    // bounds NodeSize boxes of the level below
+    using level_array = std::vector<std::vector<Box>>;
+    
+    struct Shard final {
+        Shard() : deadEntries_(0) {}
+        
+        std::mutex m_;
+        change_array pending_;
+        
+        // the entries as of the last merge
+        entry_array entries_;
+        level_array levels_;
+        std::size_t deadEntries_;
+        
+        // the entries added since the last merge
+        entry_array recent_;
+        level_array recentLevels_;
+        
+        // the Hilbert index of each point of each indexed document, used to find 
+        // the entries of a changed document without scanning the shard
+        std::unordered_map<std::string, std::vector<std::uint32_t>> docPoints_;
+    };
+    
+    static const std::size_t NodeSize = 16;
+    
+    // the recent entries are merged once they, and the dead entries, pass a quarter of 
+    // the shard or this many, whichever is larger
+    static const std::size_t MinMergeEntries = 1024;
+    
+    SpatialIndex(const std::string& designId, const std::string& name, unsigned shards);
+    
+    static std::uint32_t GetHilbertIndex(double lon, double lat);
+    static bool GetPoint(const MangoValue& value, double& lon, double& lat);
+    static bool EntryLess(const Entry& a, const Entry& b);
+    
+    // marks the entries of the document at the Hilbert index dead, returns how many were live
+    static std::size_t KillEntries(entry_array& entries, std::uint32_t hilbert, const char* id);
+    
+    static void BuildTree(const entry_array& entries, level_array& levels);
+    static void QueryTree(const entry_array& entries, const level_array& levels, const Region& region, hit_array& hits);
+    
+    const std::string designId_;
+    const std::string name_;
+    std::string definition_;
+    
+    std::string function_;
+    MangoValue::path_type lonField_;
+    MangoValue::path_type latField_;
+    
+    std::vector<Shard> shards_;
+};
+
+#endif /* RS_AVANCEDB_SPATIAL_INDEX_H */
+
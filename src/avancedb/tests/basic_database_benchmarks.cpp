@@ -0,0 +1,130 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include "libscriptobject_gason.h"
+#include "script_object_factory.h"
+
+#include "libhttpserver.h"
+
+#include "../databases.h"
+#include "../database.h"
+#include "../config.h"
+
+// measurements rather than checks so they are kept out of the unit tests, the 
+// target is built with the tests and run on its own with "make benchmark"
+class BasicDatabaseBenchmarks : public ::testing::Test {
+protected:
+    static std::string MakeDocId(unsigned id) {
+        return (boost::format("%08u") % id).str();
+    }
+    
+    static std::string MakeDocJson(const std::string& id) {
+        return (boost::format(R"({"_id":"%s","num":42,"sunny":true,"pi":3.14159,"lorem":"ipsum","obj":{},"arr":[]})") % id).str();
+    }
+    
+    static Databases databases_;
+};
+
+Databases BasicDatabaseBenchmarks::databases_;
+
+TEST_F(BasicDatabaseBenchmarks, bench0) {
+    auto dbName = "BasicDatabaseBenchmarks0";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    
+    const auto count = 10000;
+    
+    std::string json = R"({"docs":[)";
+    for (auto i = 0; i < count; ++i) {
+        if (i > 0) {
+            json += ',';
+        }
+        
+        json += MakeDocJson(MakeDocId(i));
+    }
+    json += R"(]})";
+
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+    auto obj = rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+    db->PostBulkDocuments(obj->getArray("docs"), true);
+    
+    // a mixed load of 95% point reads and 5% writes, the reads per second should scale with 
+    // the threads since readers share the collection locks
+    const auto opsPerThread = 100000;
+    const auto maxThreads = std::max(4u, Config::Environment::CpuCount());
+    
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        std::atomic<unsigned> missing{0};
+        std::vector<boost::thread> workers;
+        
+        auto start = std::chrono::steady_clock::now();
+        
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                auto writeId = (boost::format("bench-%u-%u") % threads % t).str();
+                std::string rev;
+                
+                for (auto i = 0; i < opsPerThread; ++i) {
+                    if (i % 20 == 0) {
+                        auto writeJson = rev.size() > 0 ? 
+                            (boost::format(R"({"_rev":"%s","i":%d})") % rev % i).str() : 
+                            (boost::format(R"({"i":%d})") % i).str();
+                        
+                        std::vector<char> writeBuffer{writeJson.cbegin(), writeJson.cend()};
+                        writeBuffer.push_back('\0');
+                        
+                        rs::scriptobject::ScriptObjectJsonSource writeSource(writeBuffer.data());
+                        auto doc = db->SetDocument(writeId.c_str(), rs::scriptobject::ScriptObjectFactory::CreateObject(writeSource, false));
+                        rev = doc->getRev();
+                    } else {
+                        auto id = MakeDocId(((i * 7919) + t) % count);
+                        if (!db->GetDocument(id.c_str(), false)) {
+                            ++missing;
+                        }
+                    }
+                }
+            });
+        }
+        
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        auto opsPerSecond = (static_cast<double>(opsPerThread) * threads * 1000000) / std::max<decltype(elapsed)>(elapsed, 1);
+        
+        std::cout << (boost::format("[ BENCH    ] %u thread(s): %.0f ops/s") % threads % opsPerSecond).str() << std::endl;
+        
+        ASSERT_EQ(0, missing.load());
+    }
+}
\ No newline at end of file
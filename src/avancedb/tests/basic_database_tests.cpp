@@ -20,8 +20,16 @@
 
 #include <vector>
 #include <cstring>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <cstdint>
 
 #include <boost/format.hpp>
+#include <boost/thread.hpp>
 
 #include "libscriptobject_gason.h"
 #include "script_object_factory.h"
@@ -34,6 +42,35 @@
 #include "../database.h"
 #include "../rest_exceptions.h"
 #include "../post_all_documents_options.h"
+#include "../document_collection.h"
+#include "../document_collection_snapshot.h"
+#include "../database_reaper.h"
+#include "../config.h"
+#include "../base64_helper.h"
+#include "../script_object_response_stream.h"
+
+class BasicDatabaseTestsStream final : public rs::httpserver::Stream {
+public:
+    int Read(byte*, int, int, bool = false) override {
+        return 0;
+    }
+    
+    int Write(const byte* buffer, int offset, int count) override {
+        data_.append(reinterpret_cast<const char*>(buffer) + offset, count);
+        return count;
+    }
+    
+    void Flush() override {
+        
+    }
+    
+    const std::string& Data() const {
+        return data_;
+    }
+    
+private:
+    std::string data_;
+};
 
 class BasicDatabaseTests : public ::testing::Test {
 protected:
@@ -1184,4 +1221,817 @@ TEST_F(BasicDatabaseTests, test57) {
         auto doc = docs_->getObject(docs_->getCount() - 1 - 100 - i);
         ASSERT_STREQ(doc->getString("_id"), result->getId());
     }
-}
\ No newline at end of file
+}
+
+TEST_F(BasicDatabaseTests, test58) {
+    rs::scriptobject::utils::ArrayVector ids;
+    ids.emplace_back("00000010");
+    ids.emplace_back("missing");
+    ids.emplace_back("\"00000020\"");
+    ids.emplace_back("BasicDatabaseTests/test58");
+    
+    rs::scriptobject::utils::ScriptArrayVectorSource idSource{ids};    
+    auto keys = rs::scriptobject::ScriptArrayFactory::CreateArray(idSource);
+    
+    rs::httpserver::QueryString qs{""};    
+    PostAllDocumentsOptions options{qs, keys};    
+    DocumentCollection::size_type totalDocs = 0;
+    sequence_type updateSequence = 0;
+    auto results = db_->PostDocuments(options, totalDocs, updateSequence);
+    
+    ASSERT_EQ(4, results->size());
+    ASSERT_STREQ("00000010", (*results)[0]->getId());
+    ASSERT_FALSE(!!(*results)[1]);
+    ASSERT_STREQ("00000020", (*results)[2]->getId());
+    ASSERT_FALSE(!!(*results)[3]);
+    
+    // keyed lookups see writes made since the last lookup
+    auto json = MakeDocJson("BasicDatabaseTests/test58");
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());
+    db_->SetDocument("BasicDatabaseTests/test58", rs::scriptobject::ScriptObjectFactory::CreateObject(source, false));
+    
+    auto newTotalDocs = totalDocs;
+    results = db_->PostDocuments(options, newTotalDocs, updateSequence);
+    
+    ASSERT_EQ(totalDocs + 1, newTotalDocs);
+    ASSERT_STREQ("BasicDatabaseTests/test58", (*results)[3]->getId());
+    
+    db_->DeleteDocument("BasicDatabaseTests/test58", (*results)[3]->getRev());
+}
+
+TEST_F(BasicDatabaseTests, test59) {
+    auto dbName = "BasicDatabaseTests59";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    
+    // enough documents for every collection to be split into several chunks
+    const auto count = 20000;
+    
+    std::string json = R"({"docs":[)";
+    for (auto i = 0; i < count; ++i) {
+        if (i > 0) {
+            json += ',';
+        }
+        
+        json += MakeDocJson(MakeDocId(i * 2));
+    }
+    json += R"(]})";
+
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+    auto obj = rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+    db->PostBulkDocuments(obj->getArray("docs"), true);
+    
+    rs::httpserver::QueryString qs{"skip=15000&limit=5"};
+    GetAllDocumentsOptions options{qs};    
+    sequence_type updateSequence = 0;
+    auto iter = db->GetDocumentsIterator(options, updateSequence);
+    
+    ASSERT_EQ(15000, iter.Offset());
+    ASSERT_EQ(count, iter.TotalRows());
+    
+    for (auto i = 0; i < 5; ++i) {
+        auto doc = iter.Next();
+        ASSERT_TRUE(!!doc);
+        ASSERT_STREQ(MakeDocId((15000 + i) * 2).c_str(), doc->getId());
+    }
+    
+    ASSERT_FALSE(!!iter.Next());
+    
+    rs::httpserver::QueryString descendingQs{"descending=true"};
+    GetAllDocumentsOptions descendingOptions{descendingQs};
+    auto descendingIter = db->GetDocumentsIterator(descendingOptions, updateSequence);
+    
+    // the iterator reads snapshots so writes made while iterating are never returned, 
+    // whether they land behind it or ahead of it
+    auto behindId = MakeDocId((count * 2) - 1);
+    auto aheadId = MakeDocId(((count / 4) * 2) + 1);
+    
+    std::vector<std::string> ids;
+    for (auto doc = descendingIter.Next(); !!doc; doc = descendingIter.Next()) {
+        ids.emplace_back(doc->getId());
+        
+        if (ids.size() == count / 2) {
+            for (auto newId : { behindId, aheadId }) {
+                auto newJson = MakeDocJson(newId);
+                std::vector<char> newBuffer{newJson.cbegin(), newJson.cend()};
+                newBuffer.push_back('\0');
+
+                rs::scriptobject::ScriptObjectJsonSource newSource(newBuffer.data());
+                db->SetDocument(newId.c_str(), rs::scriptobject::ScriptObjectFactory::CreateObject(newSource, false));
+            }
+        }
+    }
+    
+    ASSERT_TRUE(std::is_sorted(ids.crbegin(), ids.crend()));
+    ASSERT_TRUE(std::adjacent_find(ids.cbegin(), ids.cend()) == ids.cend());
+    ASSERT_TRUE(std::find(ids.cbegin(), ids.cend(), behindId) == ids.cend());
+    ASSERT_TRUE(std::find(ids.cbegin(), ids.cend(), aheadId) == ids.cend());
+    
+    ASSERT_EQ(count, ids.size());
+    for (auto i = 0; i < count; ++i) {
+        ASSERT_STREQ(MakeDocId((count - 1 - i) * 2).c_str(), ids[i].c_str());
+    }
+    
+    ASSERT_FALSE(!!descendingIter.Next());
+}
+
+TEST_F(BasicDatabaseTests, test60) {
+    auto docs = DocumentCollection::Create(true);
+    
+    // enough documents for the hash index to grow several times
+    std::vector<document_ptr> created;
+    for (auto i = 0; i < 5000; ++i) {
+        auto id = MakeDocId(i);
+        auto json = MakeDocJson(id);
+        
+        std::vector<char> buffer{json.cbegin(), json.cend()};
+        buffer.push_back('\0');
+
+        rs::scriptobject::ScriptObjectJsonSource source(buffer.data());
+        auto doc = Document::Create(id.c_str(), rs::scriptobject::ScriptObjectFactory::CreateObject(source, false), i + 1);
+        
+        docs->insert(doc);
+        created.emplace_back(doc);
+    }
+    
+    // erasing shifts later entries back so every remaining document can still be found
+    for (decltype(created.size()) i = 0; i < created.size(); i += 3) {
+        docs->erase(created[i]);
+    }
+    
+    for (decltype(created.size()) i = 0; i < created.size(); ++i) {
+        auto doc = docs->find(created[i]->getId());
+        if (i % 3 == 0) {
+            ASSERT_FALSE(!!doc);
+        } else {
+            ASSERT_TRUE(doc == created[i]);
+        }
+    }
+    
+    ASSERT_FALSE(!!docs->find("missing"));
+    ASSERT_EQ(5000 - 1667, docs->size());
+}
+
+TEST_F(BasicDatabaseTests, test62) {
+    auto docs = DocumentCollection::Create();
+    
+    auto createDoc = [](int i) {
+        auto id = MakeDocId(i);
+        auto json = MakeDocJson(id);
+        
+        std::vector<char> buffer{json.cbegin(), json.cend()};
+        buffer.push_back('\0');
+
+        rs::scriptobject::ScriptObjectJsonSource source(buffer.data());
+        return Document::Create(id.c_str(), rs::scriptobject::ScriptObjectFactory::CreateObject(source, false), i + 1);
+    };
+    
+    // inserted out of order and enough of them to be split across many chunks
+    const auto count = 5000;
+    std::vector<document_ptr> created;
+    for (auto i = 0; i < count; ++i) {
+        created.emplace_back(createDoc((i * 7919) % count));
+        docs->insert(created.back());
+    }
+    
+    auto snapshot = docs->Snapshot();
+    ASSERT_EQ(count, snapshot->size());
+    ASSERT_TRUE(snapshot == docs->Snapshot());
+    
+    auto index = 0;
+    for (auto iter = snapshot->cbegin(); iter != snapshot->cend(); ++iter, ++index) {
+        ASSERT_STREQ(MakeDocId(index).c_str(), (*iter)->getId());
+        ASSERT_TRUE(*iter == (*snapshot)[index]);
+    }
+    
+    ASSERT_EQ(count, std::distance(snapshot->cbegin(), snapshot->cend()));
+    ASSERT_STREQ(MakeDocId(count - 1).c_str(), (*(snapshot->cend() - 1))->getId());
+    
+    auto probe = createDoc(1234);
+    ASSERT_STREQ(MakeDocId(1234).c_str(), (*snapshot->lower_bound(probe))->getId());
+    ASSERT_STREQ(MakeDocId(1235).c_str(), (*snapshot->upper_bound(probe))->getId());
+    
+    // writes after the snapshot copy the chunks they change and leave the snapshot as it was
+    for (auto i = 0; i < count; i += 2) {
+        docs->erase(created[i]);
+    }
+    
+    auto replaced = createDoc(1);
+    docs->insert(replaced);
+    docs->insert(createDoc(count));
+    
+    ASSERT_EQ(count, snapshot->size());
+    index = 0;
+    for (auto iter = snapshot->cbegin(); iter != snapshot->cend(); ++iter, ++index) {
+        ASSERT_STREQ(MakeDocId(index).c_str(), (*iter)->getId());
+    }
+    
+    auto newSnapshot = docs->Snapshot();
+    ASSERT_TRUE(newSnapshot != snapshot);
+    ASSERT_LT(snapshot->Version(), newSnapshot->Version());
+    ASSERT_EQ(docs->size(), newSnapshot->size());
+    ASSERT_EQ(count - (count / 2) + 1, newSnapshot->size());
+    ASSERT_TRUE(std::is_sorted(newSnapshot->cbegin(), newSnapshot->cend(), Document::Less{}));
+    ASSERT_TRUE(docs->find(MakeDocId(1).c_str()) == replaced);
+    ASSERT_TRUE(std::find(newSnapshot->cbegin(), newSnapshot->cend(), replaced) != newSnapshot->cend());
+    ASSERT_FALSE(std::find(snapshot->cbegin(), snapshot->cend(), replaced) != snapshot->cend());
+}
+
+TEST_F(BasicDatabaseTests, test63) {
+    auto dbName = "BasicDatabaseTests63";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    
+    // enough documents for every collection's pool task to have a batch to write
+    const auto count = 20000;
+    
+    auto postBulkDocuments = [&](const std::string& json) {
+        std::vector<char> buffer{json.cbegin(), json.cend()};
+        buffer.push_back('\0');
+
+        rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+        auto obj = rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+        return db->PostBulkDocuments(obj->getArray("docs"), true);
+    };
+    
+    std::string json = R"({"docs":[)";
+    for (auto i = 0; i < count; ++i) {
+        if (i > 0) {
+            json += ',';
+        }
+        
+        json += MakeDocJson(MakeDocId(i));
+    }
+    json += R"(]})";
+    
+    auto results = postBulkDocuments(json);
+    ASSERT_EQ(count, results.size());
+    ASSERT_EQ(count, db->DocCount());
+    ASSERT_EQ(count, db->UpdateSequence());
+    
+    // the even documents are updated with their current rev and the odd ones with a stale rev
+    json = R"({"docs":[)";
+    for (auto i = 0; i < count; ++i) {
+        if (i > 0) {
+            json += ',';
+        }
+        
+        auto rev = i % 2 == 0 ? results[i].rev() : std::string{"1-00000000000000000000000000000000"};
+        json += (boost::format(R"({"_id":"%s","_rev":"%s","index":%d})") % results[i].id() % rev % i).str();
+    }
+    json += R"(]})";
+    
+    auto updateResults = postBulkDocuments(json);
+    ASSERT_EQ(count, updateResults.size());
+    ASSERT_EQ(count, db->DocCount());
+    ASSERT_EQ(count + (count / 2), db->UpdateSequence());
+    
+    std::vector<sequence_type> updateSequences;
+    for (auto i = 0; i < count; ++i) {
+        const auto& result = updateResults[i];
+        ASSERT_STREQ(MakeDocId(i).c_str(), result.id().c_str());
+        
+        auto doc = db->GetDocument(result.id().c_str(), true);
+        
+        if (i % 2 == 0) {
+            ASSERT_TRUE(result.ok());
+            ASSERT_TRUE(ValidateRevision(2, result.rev()));
+            ASSERT_STREQ(result.rev().c_str(), doc->getRev());
+            ASSERT_EQ(i, doc->getObject()->getInt32("index"));
+        } else {
+            ASSERT_FALSE(result.ok());
+            ASSERT_STREQ("conflict", result.error().c_str());
+            ASSERT_STREQ(results[i].rev().c_str(), doc->getRev());
+        }
+        
+        updateSequences.push_back(doc->getUpdateSequence());
+    }
+    
+    // every write had its own update sequence even though the collections were written in parallel
+    std::sort(updateSequences.begin(), updateSequences.end());
+    ASSERT_TRUE(std::adjacent_find(updateSequences.cbegin(), updateSequences.cend()) == updateSequences.cend());
+    ASSERT_EQ(count + (count / 2), updateSequences.back());
+    
+    databases_.RemoveDatabase(dbName);
+}
+
+TEST_F(BasicDatabaseTests, test64) {
+    auto dbName = "BasicDatabaseTests64";
+    databases_.AddDatabase(dbName, 3);
+    auto db = databases_.GetDatabase(dbName);
+    ASSERT_EQ(3, db->ShardCount());
+    
+    const auto count = 2000;
+    
+    std::string json = R"({"docs":[)";
+    for (auto i = 0; i < count; ++i) {
+        if (i > 0) {
+            json += ',';
+        }
+        
+        json += MakeDocJson(MakeDocId(i));
+    }
+    json += R"(]})";
+    
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+    auto obj = rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+    auto results = db->PostBulkDocuments(obj->getArray("docs"), true);
+    ASSERT_EQ(count, results.size());
+    
+    // the first documents are rewritten while the database is resharded, 
+    // every write has to land in whichever shards are current
+    std::vector<std::string> revs(count / 10);
+    boost::thread writer{[&]() {
+        for (auto i = 0; i < revs.size(); ++i) {
+            auto json = (boost::format(R"({"_id":"%s","_rev":"%s","index":%d})") % MakeDocId(i) % results[i].rev() % i).str();
+            
+            std::vector<char> buffer{json.cbegin(), json.cend()};
+            buffer.push_back('\0');
+            
+            rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+            revs[i] = db->SetDocument(MakeDocId(i).c_str(), rs::scriptobject::ScriptObjectFactory::CreateObject(source, false))->getRev();
+        }
+    }};
+    
+    db->Reshard(7);
+    writer.join();
+    
+    ASSERT_EQ(7, db->ShardCount());
+    ASSERT_EQ(count, db->DocCount());
+    
+    auto checkDocs = [&]() {
+        for (auto i = 0; i < count; ++i) {
+            auto doc = db->GetDocument(MakeDocId(i).c_str(), false);
+            ASSERT_TRUE(!!doc);
+            ASSERT_STREQ(i < revs.size() ? revs[i].c_str() : results[i].rev().c_str(), doc->getRev());
+        }
+        
+        rs::httpserver::QueryString qs{""};
+        GetAllDocumentsOptions options{qs};
+        DocumentCollection::size_type offset = 0;
+        DocumentCollection::size_type totalDocs = 0;
+        sequence_type updateSequence = 0;
+        auto docs = db->GetDocuments(options, offset, totalDocs, updateSequence);
+        
+        ASSERT_EQ(count, docs->size());
+        for (auto i = 1; i < docs->size(); ++i) {
+            ASSERT_LT(std::strcmp((*docs)[i - 1]->getId(), (*docs)[i]->getId()), 0);
+        }
+    };
+    
+    checkDocs();
+    
+    db->Reshard(1);
+    ASSERT_EQ(1, db->ShardCount());
+    ASSERT_EQ(count, db->DocCount());
+    
+    checkDocs();
+    
+    databases_.RemoveDatabase(dbName);
+}
+
+TEST_F(BasicDatabaseTests, test65) {
+    auto dbName = "BasicDatabaseTests65";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    
+    // a database created without a shard count starts in a single collection
+    ASSERT_EQ(1, db->ShardCount());
+    
+    const auto threshold = Config::Data::ShardThreshold();
+    const auto shards = std::min(Config::Environment::CpuCount() * 2, Documents::MaxShards);
+    
+    auto postDocs = [&](unsigned first, unsigned count) {
+        std::string json = R"({"docs":[)";
+        for (unsigned i = first; i < first + count; ++i) {
+            if (i > first) {
+                json += ',';
+            }
+
+            json += MakeDocJson(MakeDocId(i));
+        }
+        json += R"(]})";
+
+        std::vector<char> buffer{json.cbegin(), json.cend()};
+        buffer.push_back('\0');
+
+        rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+        auto obj = rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+        return db->PostBulkDocuments(obj->getArray("docs"), true);
+    };
+    
+    // a batch up to the threshold stays in the single collection
+    auto results = postDocs(0, threshold);
+    ASSERT_EQ(threshold, results.size());
+    ASSERT_EQ(1, db->ShardCount());
+    
+    // a write past the threshold splits the collection in the background
+    auto json = MakeDocJson(MakeDocId(threshold));
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());
+    db->SetDocument(MakeDocId(threshold).c_str(), rs::scriptobject::ScriptObjectFactory::CreateObject(source, false));
+    
+    for (auto i = 0; i < 300 && db->ShardCount() != shards; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    
+    ASSERT_EQ(shards, db->ShardCount());
+    ASSERT_EQ(threshold + 1, db->DocCount());
+    
+    for (unsigned i = 0; i < threshold; ++i) {
+        auto doc = db->GetDocument(MakeDocId(i).c_str(), false);
+        ASSERT_TRUE(!!doc);
+        ASSERT_STREQ(results[i].rev().c_str(), doc->getRev());
+    }
+    
+    databases_.RemoveDatabase(dbName);
+    
+    // a batch which would cross the threshold is split before it is stored
+    dbName = "BasicDatabaseTests65b";
+    databases_.AddDatabase(dbName);
+    db = databases_.GetDatabase(dbName);
+    ASSERT_EQ(1, db->ShardCount());
+    
+    results = postDocs(0, threshold + 1);
+    ASSERT_EQ(threshold + 1, results.size());
+    ASSERT_EQ(shards, db->ShardCount());
+    ASSERT_EQ(threshold + 1, db->DocCount());
+    
+    for (unsigned i = 0; i <= threshold; ++i) {
+        auto doc = db->GetDocument(MakeDocId(i).c_str(), false);
+        ASSERT_TRUE(!!doc);
+        ASSERT_STREQ(results[i].rev().c_str(), doc->getRev());
+    }
+    
+    databases_.RemoveDatabase(dbName);
+}
+
+TEST_F(BasicDatabaseTests, test66) {
+    auto dbName = "BasicDatabaseTests66";
+    databases_.AddDatabase(dbName, 1);
+    
+    // lookups carry on while other databases are added and removed
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned> missing{0};
+    
+    std::vector<boost::thread> readers;
+    for (auto i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                if (!databases_.GetDatabase(dbName) || !databases_.IsDatabase(dbName)) {
+                    ++missing;
+                }
+            }
+        });
+    }
+    
+    // nothing is asserted until the readers have been stopped and joined, a failed assert
+    // returns from the test and would leave them running against its locals
+    unsigned failed = 0;
+    for (auto i = 0; i < 200; ++i) {
+        auto name = (boost::format("basicdatabasetests66_%d") % i).str();
+        auto ok = databases_.AddDatabase(name.c_str(), 1) && !databases_.AddDatabase(name.c_str(), 1) && 
+            !!databases_.GetDatabase(name.c_str());
+        
+        if (ok && i % 2 == 1) {
+            ok = databases_.RemoveDatabase(name.c_str()) && !databases_.IsDatabase(name.c_str());
+        }
+        
+        if (!ok) {
+            ++failed;
+        }
+    }
+    
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    
+    ASSERT_EQ(0, failed);
+    ASSERT_EQ(0, missing.load());
+    
+    auto names = databases_.GetDatabases();
+    for (auto i = 0; i < 200; ++i) {
+        auto name = (boost::format("basicdatabasetests66_%d") % i).str();
+        ASSERT_EQ(i % 2 == 0, std::find(names.cbegin(), names.cend(), name) != names.cend());
+        
+        if (i % 2 == 0) {
+            databases_.RemoveDatabase(name.c_str());
+        }
+    }
+    
+    databases_.RemoveDatabase(dbName);
+}
+
+TEST_F(BasicDatabaseTests, test67) {
+    DatabaseReaper reaper{std::chrono::seconds{0}};
+    
+    auto db = Database::Create("BasicDatabaseTests67", 4);
+    for (auto i = 0; i < 1000; ++i) {
+        db->SetDocument(MakeDocId(i).c_str(), docs_->getObject(i % docs_->getCount()));
+    }
+    
+    auto dataSize = db->DataSize();
+    ASSERT_GT(dataSize, 0);
+    
+    // a database still in use isn't freed
+    auto user = db;
+    reaper.Post(db);
+    db.reset();
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_EQ(1, reaper.Pending());
+    ASSERT_EQ(0, reaper.DatabasesReaped());
+    
+    auto tasks = reaper.GetTasks();
+    ASSERT_EQ(1, tasks.size());
+    ASSERT_STREQ("BasicDatabaseTests67", tasks[0].database_.c_str());
+    ASSERT_EQ(0, tasks[0].progress_);
+    
+    user.reset();
+    
+    for (auto i = 0; i < 100 && reaper.Pending() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    
+    ASSERT_EQ(0, reaper.Pending());
+    ASSERT_EQ(1, reaper.DatabasesReaped());
+    ASSERT_EQ(dataSize, reaper.BytesReclaimed());
+}
+
+TEST_F(BasicDatabaseTests, test68) {
+    auto db = Database::Create("BasicDatabaseTests68");
+    
+    auto json = MakeDocJson("test68");
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());
+    auto doc = db->SetDocument("test68", rs::scriptobject::ScriptObjectFactory::CreateObject(source, false));
+    auto docSize = db->DataSize();
+    
+    std::vector<unsigned char> body(4096);
+    for (decltype(body.size()) i = 0; i < body.size(); ++i) {
+        body[i] = static_cast<unsigned char>(i * 7);
+    }
+    
+    doc = db->SetDocumentAttachment("test68", doc->getRev(), "test.bin", "application/octet-stream", body);
+    ASSERT_GE(db->DataSize(), docSize + body.size());
+    
+    // the stored body is handed out without being decoded or copied
+    auto attachment1 = db->GetDocumentAttachment("test68", "test.bin", true);
+    auto attachment2 = db->GetDocumentAttachment("test68", "test.bin", true);
+    ASSERT_EQ(body.size(), attachment1->Size());
+    ASSERT_EQ(attachment1->Data(), attachment2->Data());
+    ASSERT_EQ(0, std::memcmp(body.data(), attachment1->Data(), body.size()));
+    
+    // the document only holds a stub
+    auto attachmentObj = doc->getObject()->getObject("_attachments")->getObject("test.bin");
+    ASSERT_EQ(rs::scriptobject::ScriptObjectType::Unknown, attachmentObj->getType("data"));
+    ASSERT_TRUE(attachmentObj->getBoolean("stub"));
+    
+    // an update carrying the stub keeps the body of the previous revision
+    json = R"({"_rev":")" + std::string(doc->getRev()) + R"(","_attachments":{"test.bin":{"content_type":"application/octet-stream","digest":"md5-)" + 
+        attachment1->Digest() + R"(","length":4096,"stub":true}}})";
+    buffer.assign(json.cbegin(), json.cend());
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource stubSource(buffer.data());
+    doc = db->SetDocument("test68", rs::scriptobject::ScriptObjectFactory::CreateObject(stubSource, false));
+    auto attachment3 = db->GetDocumentAttachment("test68", "test.bin", true);
+    ASSERT_EQ(attachment1->Data(), attachment3->Data());
+    
+    // inline bodies are decoded once when the document is stored
+    json = R"({"_rev":")" + std::string(doc->getRev()) + R"(","_attachments":{"test.txt":{"content_type":"text/plain","data":"MDEyMzQ1Njc4OQ=="}}})";
+    buffer.assign(json.cbegin(), json.cend());
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource inlineSource(buffer.data());
+    doc = db->SetDocument("test68", rs::scriptobject::ScriptObjectFactory::CreateObject(inlineSource, false));
+    
+    auto attachment4 = db->GetDocumentAttachment("test68", "test.txt", true);
+    ASSERT_EQ(10, attachment4->Size());
+    ASSERT_EQ(0, std::memcmp("0123456789", attachment4->Data(), 10));
+    ASSERT_TRUE(doc->getObject()->getObject("_attachments")->getObject("test.txt")->getBoolean("stub"));
+    
+    // the binary attachment wasn't in the new revision
+    ASSERT_THROW({
+        db->GetDocumentAttachment("test68", "test.bin", true);
+    }, DocumentAttachmentMissing);
+    
+    doc = db->DeleteDocumentAttachment("test68", doc->getRev(), "test.txt");
+    ASSERT_THROW({
+        db->GetDocumentAttachment("test68", "test.txt", true);
+    }, DocumentAttachmentMissing);
+}
+
+TEST_F(BasicDatabaseTests, test69) {
+    auto db = Database::Create("BasicDatabaseTests69");
+    
+    auto json = MakeDocJson("test69");
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());
+    auto doc = db->SetDocument("test69", rs::scriptobject::ScriptObjectFactory::CreateObject(source, false));
+    
+    // larger than both the encoding chunk and the serializer buffer
+    std::vector<unsigned char> body(5000);
+    for (decltype(body.size()) i = 0; i < body.size(); ++i) {
+        body[i] = static_cast<unsigned char>(i * 13);
+    }
+    
+    db->SetDocumentAttachment("test69", doc->getRev(), "test.bin", "application/octet-stream", body);
+    db->SetDocumentAttachment("test69", db->GetDocument("test69")->getRev(), "test.txt", "text/plain", std::vector<unsigned char>{'a', 'b', 'c', 'd'});
+    doc = db->GetDocument("test69");
+    
+    BasicDatabaseTestsStream stream;
+    ScriptObjectResponseStream<> objStream{stream};
+    objStream.Serialize(doc, ScriptObjectResponseStreamAttachmentMode::Inline);
+    objStream.Flush();
+    
+    buffer.assign(stream.Data().cbegin(), stream.Data().cend());
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource inlineSource(buffer.data());
+    auto obj = rs::scriptobject::ScriptObjectFactory::CreateObject(inlineSource, false);
+    ASSERT_STREQ("test69", obj->getString("_id"));
+    
+    auto attachmentObj = obj->getObject("_attachments")->getObject("test.bin");
+    ASSERT_EQ(rs::scriptobject::ScriptObjectType::Unknown, attachmentObj->getType("stub"));
+    
+    auto encodedData = attachmentObj->getString("data");
+    auto data = Base64Helper::Decode(encodedData, std::strlen(encodedData));
+    ASSERT_EQ(body.size(), data.size());
+    ASSERT_EQ(0, std::memcmp(body.data(), data.data(), body.size()));
+    
+    attachmentObj = obj->getObject("_attachments")->getObject("test.txt");
+    ASSERT_STREQ("YWJjZA==", attachmentObj->getString("data"));
+}
+
+TEST_F(BasicDatabaseTests, test70) {
+    std::int64_t start = 0;
+    std::int64_t end = 4;
+    ASSERT_TRUE(DocumentAttachment::ResolveRange(start, end, 10));
+    ASSERT_EQ(0, start);
+    ASSERT_EQ(4, end);
+    ASSERT_EQ("bytes 0-4/10", DocumentAttachment::FormatContentRange(start, end, 10));
+    
+    // the end is clamped to the last byte, the total stays the body size
+    start = 5;
+    end = 100;
+    ASSERT_TRUE(DocumentAttachment::ResolveRange(start, end, 10));
+    ASSERT_EQ(5, start);
+    ASSERT_EQ(9, end);
+    ASSERT_EQ("bytes 5-9/10", DocumentAttachment::FormatContentRange(start, end, 10));
+    
+    // a suffix range counts back from the end
+    start = -3;
+    end = std::numeric_limits<std::int64_t>::max();
+    ASSERT_TRUE(DocumentAttachment::ResolveRange(start, end, 10));
+    ASSERT_EQ(7, start);
+    ASSERT_EQ(9, end);
+    
+    start = 9;
+    end = 9;
+    ASSERT_TRUE(DocumentAttachment::ResolveRange(start, end, 10));
+    ASSERT_EQ("bytes 9-9/10", DocumentAttachment::FormatContentRange(start, end, 10));
+    
+    start = 10;
+    end = 20;
+    ASSERT_FALSE(DocumentAttachment::ResolveRange(start, end, 10));
+    
+    start = -11;
+    end = 20;
+    ASSERT_FALSE(DocumentAttachment::ResolveRange(start, end, 10));
+    
+    start = 6;
+    end = 3;
+    ASSERT_FALSE(DocumentAttachment::ResolveRange(start, end, 10));
+    
+    start = 0;
+    end = 0;
+    ASSERT_FALSE(DocumentAttachment::ResolveRange(start, end, 0));
+}
+
+TEST_F(BasicDatabaseTests, test71) {
+    auto db = Database::Create("BasicDatabaseTests71");
+    
+    // a new document has no previous revision to take a body from
+    std::string json = R"({"_attachments":{"test.bin":{"content_type":"application/octet-stream","digest":"md5-AAAAAAAAAAAAAAAAAAAAAA==","length":4,"stub":true}}})";
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());
+    ASSERT_THROW({
+        db->SetDocument("test71", rs::scriptobject::ScriptObjectFactory::CreateObject(source, false));
+    }, MissingStub);
+    
+    ASSERT_EQ(0, db->DocCount());
+    
+    json = MakeDocJson("test71");
+    buffer.assign(json.cbegin(), json.cend());
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource docSource(buffer.data());
+    auto doc = db->SetDocument("test71", rs::scriptobject::ScriptObjectFactory::CreateObject(docSource, false));
+    doc = db->SetDocumentAttachment("test71", doc->getRev(), "test.bin", "application/octet-stream", std::vector<unsigned char>{1, 2, 3, 4});
+    auto updateSequence = db->UpdateSequence();
+    
+    // the digest names different content than the stored body
+    json = R"({"_rev":")" + std::string(doc->getRev()) + R"(","_attachments":{"test.bin":{"content_type":"application/octet-stream","digest":"md5-AAAAAAAAAAAAAAAAAAAAAA==","length":4,"stub":true}}})";
+    buffer.assign(json.cbegin(), json.cend());
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource mismatchSource(buffer.data());
+    ASSERT_THROW({
+        db->SetDocument("test71", rs::scriptobject::ScriptObjectFactory::CreateObject(mismatchSource, false));
+    }, MissingStub);
+    
+    ASSERT_STREQ(doc->getRev(), db->GetDocument("test71")->getRev());
+    ASSERT_EQ(updateSequence, db->UpdateSequence());
+    
+    // the bulk api reports the stub against the document and stores the rest of the batch
+    json = R"({"docs":[{"_id":"test71b","_attachments":{"test.txt":{"content_type":"text/plain","stub":true}}},{"_id":"test71c"}]})";
+    buffer.assign(json.cbegin(), json.cend());
+    buffer.push_back('\0');
+    
+    rs::scriptobject::ScriptObjectJsonSource bulkSource(buffer.data());
+    auto obj = rs::scriptobject::ScriptObjectFactory::CreateObject(bulkSource, false);
+    auto results = db->PostBulkDocuments(obj->getArray("docs"), true);
+    
+    ASSERT_EQ(2, results.size());
+    ASSERT_FALSE(results[0].ok());
+    ASSERT_EQ("missing_stub", results[0].error());
+    ASSERT_TRUE(results[1].ok());
+    ASSERT_EQ(2, db->DocCount());
+}
+TEST_F(BasicDatabaseTests, test72) {
+    auto db = Database::Create("BasicDatabaseTests72", 3);
+    
+    const auto count = 2000;
+    
+    std::string json = R"({"docs":[)";
+    for (auto i = 0; i < count; ++i) {
+        if (i > 0) {
+            json += ',';
+        }
+        
+        json += MakeDocJson(MakeDocId(i));
+    }
+    json += R"(]})";
+    
+    std::vector<char> buffer{json.cbegin(), json.cend()};
+    buffer.push_back('\0');
+
+    rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+    auto obj = rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+    auto results = db->PostBulkDocuments(obj->getArray("docs"), true);
+    ASSERT_EQ(count, results.size());
+    
+    Documents::ReshardTask task;
+    ASSERT_FALSE(db->GetReshardTask(task));
+    
+    auto waitForReshard = [&]() {
+        while (db->GetReshardTask(task) && task.running_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    
+    // the reshard runs on the database's own thread and reports its progress until it's done
+    ASSERT_TRUE(db->StartReshard(5));
+    waitForReshard();
+    
+    ASSERT_EQ(5, task.shards_);
+    ASSERT_EQ(100, task.progress_);
+    ASSERT_TRUE(task.error_.empty());
+    ASSERT_LE(task.startedOn_, task.updatedOn_);
+    ASSERT_EQ(5, db->ShardCount());
+    ASSERT_EQ(count, db->DocCount());
+    
+    // a finished reshard doesn't stop the next one from starting
+    ASSERT_TRUE(db->StartReshard(2));
+    waitForReshard();
+    
+    ASSERT_EQ(2, task.shards_);
+    ASSERT_EQ(100, task.progress_);
+    ASSERT_EQ(2, db->ShardCount());
+    ASSERT_EQ(count, db->DocCount());
+    
+    for (auto i = 0; i < count; ++i) {
+        auto doc = db->GetDocument(MakeDocId(i).c_str(), false);
+        ASSERT_TRUE(!!doc);
+        ASSERT_STREQ(results[i].rev().c_str(), doc->getRev());
+    }
+}
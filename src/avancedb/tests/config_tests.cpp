@@ -56,6 +56,9 @@ TEST_F(ConfigTests, test0) {
     ASSERT_EQ(Config::SpiderMonkey::DefaultNurserySizeMB * 1024 * 1024, Config::SpiderMonkey::NurserySize());
     ASSERT_TRUE(Config::SpiderMonkey::EnableBaselineCompiler());
     ASSERT_TRUE(Config::SpiderMonkey::EnableIonCompiler());
+    ASSERT_EQ(Config::MapReduce::DefaultResultsCacheSize, Config::MapReduce::ResultsCacheSize());
+    ASSERT_TRUE(Config::Data::HashIndex());
+    ASSERT_EQ(Config::Data::DefaultShardThreshold, Config::Data::ShardThreshold());
 }
 
 TEST_F(ConfigTests, test1) {
@@ -248,3 +251,35 @@ TEST_F(ConfigTests, test23) {
     ASSERT_EQ(8, Config::Environment::CpuCount());
     ASSERT_EQ(std::lround(4.0 * Config::Environment::CpuCount()), Config::MapReduce::Workers());
 }
+
+
+TEST_F(ConfigTests, test24) {
+    const char* args[] = { nullptr, "--mapreduce-results-cache", "128" };
+    
+    Config::Parse(sizeof(args) / sizeof(args[0]), args);
+    
+    ASSERT_EQ(128, Config::MapReduce::ResultsCacheSize());
+}
+
+TEST_F(ConfigTests, test25) {
+    const char* args[] = { nullptr, "--data-hash-index", "false" };
+    
+    Config::Parse(sizeof(args) / sizeof(args[0]), args);
+    
+    ASSERT_FALSE(Config::Data::HashIndex());
+}
+
+TEST_F(ConfigTests, test26) {
+    const char* args[] = { nullptr, "--data-shard-threshold", "0" };
+    
+    Config::Parse(sizeof(args) / sizeof(args[0]), args);
+    
+    ASSERT_EQ(0, Config::Data::ShardThreshold());
+    
+    const char* defaultArgs[] = { nullptr };
+    
+    Config::Clear();
+    Config::Parse(sizeof(defaultArgs) / sizeof(defaultArgs[0]), defaultArgs);
+    
+    ASSERT_EQ(Config::Data::DefaultShardThreshold, Config::Data::ShardThreshold());
+}
\ No newline at end of file
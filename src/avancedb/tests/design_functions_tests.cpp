@@ -0,0 +1,357 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cstring>
+#include <memory>
+
+#include <boost/format.hpp>
+
+#include "libscriptobject_gason.h"
+#include "script_object_factory.h"
+
+#include "libhttpserver.h"
+
+#include "../databases.h"
+#include "../database.h"
+#include "../document.h"
+#include "../rest_exceptions.h"
+#include "../config.h"
+#include "../get_view_options.h"
+#include "../map_reduce_thread_pool.h"
+#include "../map_reduce_shard_results.h"
+#include "../map_reduce_merged_results_iterator.h"
+#include "../design_functions.h"
+
+class DesignFunctionsTests : public ::testing::Test {
+protected:
+    DesignFunctionsTests() {
+
+    }
+    
+    static void SetUpTestCase() {
+        threadPool_.reset(new MapReduceThreadPoolScope{Config::SpiderMonkey::HeapSize(), Config::SpiderMonkey::NurserySize(),
+                Config::SpiderMonkey::EnableBaselineCompiler(), Config::SpiderMonkey::EnableIonCompiler()});
+        
+        auto dbName = "designfunctionstests";
+        databases_.AddDatabase(dbName);
+        db_ = databases_.GetDatabase(dbName);
+        
+        std::string json = R"({"docs":[)";
+        for (auto i = 0; i < 100; ++i) {
+            if (i > 0) {
+                json += ',';
+            }
+            
+            json += (boost::format(R"({"_id":"%08u","index":%u,"name":"doc %u"})") % i % i % i).str();
+        }
+        json += R"(]})";
+        
+        auto docs = MakeObject(json.c_str())->getArray("docs");
+        db_->PostBulkDocuments(docs, true);
+        
+        req_ = MakeObject(R"({"method":"GET","path":"/db/_design/test/_show/test","query":{"format":"short"},"id":null,"info":{"db_name":"designfunctionstests"}})");
+    }
+    
+    static void TearDownTestCase() {
+        threadPool_.reset();
+    }
+    
+    virtual void SetUp() {
+        
+    }
+    
+    virtual void TearDown() {
+        
+    }
+    
+    static rs::scriptobject::ScriptObjectPtr MakeObject(const char* json) {
+        std::vector<char> buffer{json, json + std::strlen(json)};
+        buffer.push_back('\0');
+        
+        rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+        return rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+    }
+    
+    static std::string List(const char* function, const char* query, DesignFunctions::Response& start, unsigned& rowsPulled) {
+        rs::httpserver::QueryString qs{query};
+        GetViewOptions options{qs};
+        
+        std::vector<map_reduce_shard_results_ptr> shardResults;
+        db_->PostTempView(options, MakeObject(R"({"map":"function(doc) { emit(doc.index, doc.name); }"})"), [&](map_reduce_shard_results_ptr shardResult) {
+            shardResults.emplace_back(shardResult);
+        });
+        
+        MapReduceMergedResultsIterator iter{shardResults, options.Skip(), options.Limit(), options.Descending()};
+        
+        auto head = MakeObject((boost::format(R"({"total_rows":%u,"offset":%u})") % iter.TotalRows() % iter.Offset()).str().c_str());
+        
+        std::string body;
+        rowsPulled = 0;
+        
+        DesignFunctions::List(function, head, req_, options.IncludeDocs(), 
+            [&]() {
+                auto row = iter.Next();
+                if (!!row) {
+                    ++rowsPulled;
+                }
+                return row;
+            },
+            [&](const DesignFunctions::Response& response) {
+                start = response;
+            },
+            [&](const char* chunk, std::size_t size) {
+                body.append(chunk, size);
+            });
+        
+        return body;
+    }
+    
+    static Databases databases_;
+    static database_ptr db_;
+    static script_object_ptr req_;
+    
+    static std::unique_ptr<MapReduceThreadPoolScope> threadPool_;
+};
+
+Databases DesignFunctionsTests::databases_;
+database_ptr DesignFunctionsTests::db_;
+script_object_ptr DesignFunctionsTests::req_;
+std::unique_ptr<MapReduceThreadPoolScope> DesignFunctionsTests::threadPool_;
+
+TEST_F(DesignFunctionsTests, test0) {
+    auto doc = db_->GetDocument("00000042");
+    
+    auto response = DesignFunctions::Show("function(doc, req) { return doc.name + ' ' + req.query.format; }", doc, req_);
+    ASSERT_EQ(200, response.code_);
+    ASSERT_STREQ(DesignFunctions::DefaultContentType, response.contentType_.c_str());
+    ASSERT_STREQ("doc 42 short", response.body_.c_str());
+    
+    response = DesignFunctions::Show("function(doc, req) { return { code: 201, headers: { 'Content-Type': 'text/plain' }, body: doc._id }; }", doc, req_);
+    ASSERT_EQ(201, response.code_);
+    ASSERT_STREQ("text/plain", response.contentType_.c_str());
+    ASSERT_STREQ("00000042", response.body_.c_str());
+    
+    response = DesignFunctions::Show("function(doc, req) { return { json: { index: doc.index } }; }", doc, req_);
+    ASSERT_STREQ("application/json", response.contentType_.c_str());
+    ASSERT_STREQ(R"({"index":42})", response.body_.c_str());
+}
+
+TEST_F(DesignFunctionsTests, test1) {
+    auto response = DesignFunctions::Show("function(doc, req) { return doc === null ? { code: 404, body: 'missing' } : 'found'; }", document_ptr{}, req_);
+    ASSERT_EQ(404, response.code_);
+    ASSERT_STREQ("missing", response.body_.c_str());
+    
+    ASSERT_THROW(DesignFunctions::Show("function(doc, req) {", document_ptr{}, req_), CompilationError);
+    ASSERT_THROW(DesignFunctions::Show("function(doc, req) { return doc.missing.field; }", document_ptr{}, req_), RenderError);
+    
+    // the functions are cached per pool thread so repeated calls keep working
+    for (auto i = 0; i < 100; ++i) {
+        response = DesignFunctions::Show("function(doc, req) { return req.info.db_name; }", document_ptr{}, req_);
+        ASSERT_STREQ("designfunctionstests", response.body_.c_str());
+    }
+}
+
+TEST_F(DesignFunctionsTests, test2) {
+    DesignFunctions::Response start;
+    unsigned rowsPulled = 0;
+    
+    auto body = List(R"(function(head, req) { 
+        start({ headers: { 'Content-Type': 'text/plain' } }); 
+        send(head.total_rows + ':'); 
+        var row; 
+        while (row = getRow()) { 
+            send(row.key + '=' + row.value + ';'); 
+        } 
+        return 'end'; 
+    })", "limit=3&skip=10", start, rowsPulled);
+    
+    ASSERT_EQ(200, start.code_);
+    ASSERT_STREQ("text/plain", start.contentType_.c_str());
+    ASSERT_STREQ("100:10=doc 10;11=doc 11;12=doc 12;end", body.c_str());
+    ASSERT_EQ(3, rowsPulled);
+}
+
+TEST_F(DesignFunctionsTests, test3) {
+    DesignFunctions::Response start;
+    unsigned rowsPulled = 0;
+    
+    // rows the function never asks for are never merged
+    auto body = List(R"(function(head, req) { 
+        var row = getRow(); 
+        send(row.id); 
+    })", "", start, rowsPulled);
+    
+    ASSERT_STREQ(DesignFunctions::DefaultContentType, start.contentType_.c_str());
+    ASSERT_STREQ("00000000", body.c_str());
+    ASSERT_EQ(1, rowsPulled);
+    
+    body = List(R"(function(head, req) { 
+        var row = getRow(); 
+        send(row.doc.name); 
+    })", "include_docs=true&descending=true", start, rowsPulled);
+    
+    ASSERT_STREQ("doc 99", body.c_str());
+    
+    body = List("function(head, req) { }", "", start, rowsPulled);
+    ASSERT_EQ(0, body.size());
+    ASSERT_EQ(200, start.code_);
+    
+    ASSERT_THROW(List("function(head, req) { send(getRow().missing.field); }", "", start, rowsPulled), RenderError);
+}
+
+TEST_F(DesignFunctionsTests, test4) {
+    auto function = "function(doc, req) { doc.counter = (doc.counter || 0) + 1; return [doc, 'counter ' + doc.counter]; }";
+    
+    DesignFunctions::Response response;
+    for (auto i = 1; i <= 10; ++i) {
+        auto doc = db_->UpdateDocument("00000007", function, req_, response);
+        ASSERT_TRUE(!!doc);
+        ASSERT_EQ(201, response.code_);
+        ASSERT_EQ(i, doc->getObject()->getInt32("counter"));
+        ASSERT_STREQ((boost::format("counter %d") % i).str().c_str(), response.body_.c_str());
+    }
+    
+    auto doc = db_->GetDocument("00000007");
+    ASSERT_EQ(10, doc->getObject()->getInt32("counter"));
+    ASSERT_STREQ("doc 7", doc->getObject()->getString("name"));
+    ASSERT_EQ(0, std::strncmp("11-", doc->getRev(), 3));
+}
+
+TEST_F(DesignFunctionsTests, test5) {
+    auto docCount = db_->DocCount();
+    
+    // returning no document responds without saving anything
+    DesignFunctions::Response response;
+    auto doc = db_->UpdateDocument("00000008", "function(doc, req) { return [null, { code: 202, body: doc.name }]; }", req_, response);
+    ASSERT_FALSE(!!doc);
+    ASSERT_EQ(202, response.code_);
+    ASSERT_STREQ("doc 8", response.body_.c_str());
+    ASSERT_EQ(0, std::strncmp("1-", db_->GetDocument("00000008")->getRev(), 2));
+    
+    // without an id the function creates a new document
+    doc = db_->UpdateDocument(nullptr, "function(doc, req) { return [{ _id: 'created', made: doc === null }, 'created']; }", req_, response);
+    ASSERT_TRUE(!!doc);
+    ASSERT_EQ(201, response.code_);
+    ASSERT_STREQ("created", doc->getId());
+    ASSERT_TRUE(doc->getObject()->getBoolean("made"));
+    ASSERT_EQ(docCount + 1, db_->DocCount());
+    
+    // a stale revision is rejected like any other write
+    ASSERT_THROW(db_->UpdateDocument("00000009", "function(doc, req) { doc._rev = '1-00000000000000000000000000000000'; doc.x = 1; return [doc, '']; }", req_, response), DocumentConflict);
+    ASSERT_THROW(db_->UpdateDocument("00000009", "function(doc, req) { throw 'oops'; }", req_, response), RenderError);
+}
+
+TEST_F(DesignFunctionsTests, test6) {
+    auto dbName = "designfunctionsvalidatetests";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    
+    db->SetDocument("locked", MakeObject(R"({"name":"locked","locked":true})"));
+    
+    auto ddoc = db->SetDesignDocument("validate", MakeObject(R"({"validate_doc_update":"function(newDoc, oldDoc, userCtx, secObj) { 
+        if (newDoc.secret) { throw { unauthorized: 'no secrets' }; } 
+        if (typeof newDoc.name !== 'string') { throw { forbidden: 'name is required' }; } 
+        if (oldDoc && oldDoc.locked) { throw { forbidden: userCtx.db + ' ' + newDoc._id + ' is locked' }; } 
+    }"})"));
+    
+    db->SetDocument("valid", MakeObject(R"({"name":"valid"})"));
+    ASSERT_THROW(db->SetDocument("invalid", MakeObject(R"({"index":1})")), DocumentForbidden);
+    ASSERT_THROW(db->SetDocument("secret", MakeObject(R"({"name":"secret","secret":true})")), DocumentUnauthorized);
+    ASSERT_FALSE(!!db->GetDocument("invalid", false));
+    
+    auto locked = db->GetDocument("locked");
+    try {
+        db->SetDocument("locked", MakeObject((boost::format(R"({"_rev":"%s","name":"unlocked"})") % locked->getRev()).str().c_str()));
+        FAIL();
+    } catch (const DocumentForbidden& ex) {
+        ASSERT_NE(std::string::npos, std::string{ex.Body()}.find("designfunctionsvalidatetests locked is locked"));
+    }
+    
+    // update handlers are validated too
+    DesignFunctions::Response response;
+    ASSERT_THROW(db->UpdateDocument("valid", "function(doc, req) { delete doc.name; return [doc, '']; }", req_, response), DocumentForbidden);
+    
+    // design documents are never validated and removing the function stops validation
+    auto rev = std::string{ddoc->getRev()};
+    db->SetDesignDocument("validate", MakeObject((boost::format(R"({"_rev":"%s"})") % rev).str().c_str()));
+    db->SetDocument("invalid", MakeObject(R"({"index":1})"));
+}
+
+TEST_F(DesignFunctionsTests, test7) {
+    auto dbName = "designfunctionsbulkvalidatetests";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    
+    db->SetDesignDocument("validate", MakeObject(R"({"validate_doc_update":"function(newDoc, oldDoc) { 
+        if (newDoc.index % 3 === 0) { throw { forbidden: 'index ' + newDoc.index }; } 
+    }"})"));
+    
+    std::string json = R"({"docs":[)";
+    for (auto i = 0; i < 1000; ++i) {
+        json += (boost::format(R"({"_id":"%08u","index":%u},)") % i % i).str();
+    }
+    json += R"({"_id":"_design/other","index":3},{"index":1}]})";
+    
+    auto results = db->PostBulkDocuments(MakeObject(json.c_str())->getArray("docs"), true);
+    ASSERT_EQ(1002, results.size());
+    
+    for (auto i = 0; i < 1000; ++i) {
+        const auto& result = results[i];
+        if (i % 3 == 0) {
+            ASSERT_FALSE(result.ok());
+            ASSERT_STREQ("forbidden", result.error().c_str());
+            ASSERT_STREQ((boost::format("index %u") % i).str().c_str(), result.reason().c_str());
+        } else {
+            ASSERT_TRUE(result.ok());
+        }
+    }
+    
+    // the design document isn't validated and a document without an id is validated with its new id
+    ASSERT_TRUE(results[1000].ok());
+    ASSERT_TRUE(results[1001].ok());
+    ASSERT_EQ(1000 - 334 + 1 + 2, db->DocCount());
+}
+
+TEST_F(DesignFunctionsTests, test8) {
+    auto dbName = "designfunctionsdeletevalidatetests";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    
+    auto kept = db->SetDocument("kept", MakeObject(R"({"keep":true})"));
+    auto removed = db->SetDocument("removed", MakeObject(R"({"keep":false})"));
+    
+    db->SetDesignDocument("validate", MakeObject(R"({"validate_doc_update":"function(newDoc, oldDoc) { 
+        if (newDoc._deleted && newDoc._id === oldDoc._id && oldDoc.keep) { throw { forbidden: newDoc._id + ' is kept' }; } 
+    }"})"));
+    
+    try {
+        db->DeleteDocument("kept", kept->getRev());
+        FAIL();
+    } catch (const DocumentForbidden& ex) {
+        ASSERT_NE(std::string::npos, std::string{ex.Body()}.find("kept is kept"));
+    }
+    
+    ASSERT_TRUE(!!db->GetDocument("kept", false));
+    
+    db->DeleteDocument("removed", removed->getRev());
+    ASSERT_FALSE(!!db->GetDocument("removed", false));
+    ASSERT_THROW(db->DeleteDocument("missing", kept->getRev()), DocumentMissing);
+}
\ No newline at end of file
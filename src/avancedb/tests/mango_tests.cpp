@@ -0,0 +1,447 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cstring>
+#include <memory>
+
+#include <boost/format.hpp>
+
+#include "libscriptobject_gason.h"
+#include "script_object_factory.h"
+
+#include "libhttpserver.h"
+
+#include "../databases.h"
+#include "../database.h"
+#include "../document.h"
+#include "../rest_exceptions.h"
+#include "../config.h"
+#include "../map_reduce_thread_pool.h"
+#include "../mango_value.h"
+#include "../mango_selector.h"
+#include "../mango_query.h"
+#include "../mango_index.h"
+
+class MangoTests : public ::testing::Test {
+protected:
+    MangoTests() {
+
+    }
+    
+    static void SetUpTestCase() {
+        threadPool_.reset(new MapReduceThreadPoolScope{Config::SpiderMonkey::HeapSize(), Config::SpiderMonkey::NurserySize(),
+                Config::SpiderMonkey::EnableBaselineCompiler(), Config::SpiderMonkey::EnableIonCompiler()});
+        
+        auto dbName = "mangotests";
+        databases_.AddDatabase(dbName);
+        db_ = databases_.GetDatabase(dbName);
+        
+        std::string json = R"({"docs":[)";
+        for (auto i = 0; i < 1000; ++i) {
+            if (i > 0) {
+                json += ',';
+            }
+            
+            json += MakeDocJson(i);
+        }
+        json += R"(,{"_id":"_design/mango","index":1}]})";
+        
+        docs_ = MakeObject(json.c_str())->getArray("docs");
+    }
+    
+    static void TearDownTestCase() {
+        threadPool_.reset();
+    }
+    
+    virtual void SetUp() {
+        
+    }
+    
+    virtual void TearDown() {
+        
+    }
+    
+    static std::string MakeDocJson(unsigned index) {
+        auto json = (boost::format(R"({"_id":"%08u","index":%u,"even":%s,"name":"doc%u","tags":["t%u","u%u"],"address":{"city":"%s","zip":%u}})") 
+            % index % index % (index % 2 == 0 ? "true" : "false") % index % (index % 10) % (index % 7) % (index % 3 == 0 ? "Paris" : "London") % (index % 100)).str();
+        return json;
+    }
+    
+    static rs::scriptobject::ScriptObjectPtr MakeObject(const char* json) {
+        std::vector<char> buffer{json, json + std::strlen(json)};
+        buffer.push_back('\0');
+        
+        rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+        return rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+    }
+    
+    static bool Match(const char* selector, const char* doc) {
+        auto compiled = MangoSelector::Compile(MakeObject(selector));
+        return compiled->Match(MakeObject(doc));
+    }
+    
+    static double GetNumber(const rs::scriptobject::ScriptObjectPtr& obj, const char* name) {
+        return MangoValue{obj}.getField(name).getNumber();
+    }
+    
+    static document_array_ptr Find(const char* query) {
+        MangoQuery mangoQuery{MakeObject(query)};
+        return db_->FindDocuments(mangoQuery);
+    }
+    
+    static Databases databases_;
+    static database_ptr db_;
+    static script_array_ptr docs_;
+    
+    static std::unique_ptr<MapReduceThreadPoolScope> threadPool_;
+};
+
+Databases MangoTests::databases_;
+database_ptr MangoTests::db_;
+script_array_ptr MangoTests::docs_;
+std::unique_ptr<MapReduceThreadPoolScope> MangoTests::threadPool_;
+
+TEST_F(MangoTests, test0) {
+    ASSERT_EQ(0, db_->DocCount());
+    
+    auto results = db_->PostBulkDocuments(docs_, true);
+    ASSERT_EQ(1001, db_->DocCount());
+    ASSERT_EQ(1001, results.size());
+}
+
+TEST_F(MangoTests, test1) {
+    ASSERT_TRUE(Match(R"({})", R"({"a":1})"));
+    ASSERT_TRUE(Match(R"({"a":1})", R"({"a":1})"));
+    ASSERT_TRUE(Match(R"({"a":1.0})", R"({"a":1})"));
+    ASSERT_FALSE(Match(R"({"a":2})", R"({"a":1})"));
+    ASSERT_FALSE(Match(R"({"a":"1"})", R"({"a":1})"));
+    ASSERT_FALSE(Match(R"({"b":1})", R"({"a":1})"));
+    ASSERT_TRUE(Match(R"({"a":1,"b":"x"})", R"({"a":1,"b":"x"})"));
+    ASSERT_FALSE(Match(R"({"a":1,"b":"y"})", R"({"a":1,"b":"x"})"));
+    ASSERT_TRUE(Match(R"({"a":[1,2]})", R"({"a":[1,2]})"));
+    ASSERT_FALSE(Match(R"({"a":[1]})", R"({"a":[1,2]})"));
+    ASSERT_TRUE(Match(R"({"a":{"$eq":{"b":null}}})", R"({"a":{"b":null}})"));
+    ASSERT_TRUE(Match(R"({"a":{"$ne":2}})", R"({"a":1})"));
+    ASSERT_FALSE(Match(R"({"a":{"$ne":2}})", R"({"b":1})"));
+}
+
+TEST_F(MangoTests, test2) {
+    ASSERT_TRUE(Match(R"({"a":{"$gt":1}})", R"({"a":2})"));
+    ASSERT_FALSE(Match(R"({"a":{"$gt":2}})", R"({"a":2})"));
+    ASSERT_TRUE(Match(R"({"a":{"$gte":2}})", R"({"a":2})"));
+    ASSERT_TRUE(Match(R"({"a":{"$lt":3}})", R"({"a":2.5})"));
+    ASSERT_FALSE(Match(R"({"a":{"$lte":2}})", R"({"a":2.5})"));
+    ASSERT_TRUE(Match(R"({"a":{"$gt":"abc"}})", R"({"a":"abd"})"));
+    ASSERT_TRUE(Match(R"({"a":{"$gt":1,"$lt":3}})", R"({"a":2})"));
+    ASSERT_FALSE(Match(R"({"a":{"$gt":1,"$lt":3}})", R"({"a":3})"));
+    
+    // values of different types are compared using view collation
+    ASSERT_TRUE(Match(R"({"a":{"$gt":100}})", R"({"a":"1"})"));
+    ASSERT_TRUE(Match(R"({"a":{"$lt":0}})", R"({"a":true})"));
+    ASSERT_TRUE(Match(R"({"a":{"$lt":false}})", R"({"a":null})"));
+    ASSERT_TRUE(Match(R"({"a":{"$gt":[]}})", R"({"a":{}})"));
+    ASSERT_FALSE(Match(R"({"a":{"$gt":null}})", R"({"b":1})"));
+}
+
+TEST_F(MangoTests, test3) {
+    ASSERT_TRUE(Match(R"({"$and":[{"a":1},{"b":2}]})", R"({"a":1,"b":2})"));
+    ASSERT_FALSE(Match(R"({"$and":[{"a":1},{"b":3}]})", R"({"a":1,"b":2})"));
+    ASSERT_TRUE(Match(R"({"$or":[{"a":2},{"b":2}]})", R"({"a":1,"b":2})"));
+    ASSERT_FALSE(Match(R"({"$or":[{"a":2},{"b":3}]})", R"({"a":1,"b":2})"));
+    ASSERT_TRUE(Match(R"({"$nor":[{"a":2},{"b":3}]})", R"({"a":1,"b":2})"));
+    ASSERT_FALSE(Match(R"({"$nor":[{"a":1},{"b":3}]})", R"({"a":1,"b":2})"));
+    ASSERT_TRUE(Match(R"({"$not":{"a":2}})", R"({"a":1})"));
+    ASSERT_FALSE(Match(R"({"$not":{"a":1}})", R"({"a":1})"));
+    ASSERT_TRUE(Match(R"({"a":{"$or":[{"$lt":0},{"$gt":10}]}})", R"({"a":11})"));
+    ASSERT_FALSE(Match(R"({"a":{"$or":[{"$lt":0},{"$gt":10}]}})", R"({"a":5})"));
+}
+
+TEST_F(MangoTests, test4) {
+    ASSERT_TRUE(Match(R"({"a":{"$in":[1,2,3]}})", R"({"a":2})"));
+    ASSERT_FALSE(Match(R"({"a":{"$in":[1,2,3]}})", R"({"a":4})"));
+    ASSERT_TRUE(Match(R"({"a":{"$in":["x","z"]}})", R"({"a":["y","z"]})"));
+    ASSERT_TRUE(Match(R"({"a":{"$nin":[1,2,3]}})", R"({"a":4})"));
+    ASSERT_FALSE(Match(R"({"a":{"$nin":[1,2,3]}})", R"({"a":3})"));
+    ASSERT_FALSE(Match(R"({"a":{"$nin":[1,2,3]}})", R"({"b":4})"));
+    ASSERT_TRUE(Match(R"({"a":{"$all":["x","z"]}})", R"({"a":["x","y","z"]})"));
+    ASSERT_FALSE(Match(R"({"a":{"$all":["x","w"]}})", R"({"a":["x","y","z"]})"));
+    ASSERT_TRUE(Match(R"({"a":{"$size":3}})", R"({"a":["x","y","z"]})"));
+    ASSERT_FALSE(Match(R"({"a":{"$size":2}})", R"({"a":["x","y","z"]})"));
+    ASSERT_TRUE(Match(R"({"a":{"$elemMatch":{"$gt":5}}})", R"({"a":[1,6]})"));
+    ASSERT_FALSE(Match(R"({"a":{"$elemMatch":{"$gt":6}}})", R"({"a":[1,6]})"));
+    ASSERT_TRUE(Match(R"({"a":{"$elemMatch":{"b":2,"c":3}}})", R"({"a":[{"b":1,"c":3},{"b":2,"c":3}]})"));
+    ASSERT_FALSE(Match(R"({"a":{"$elemMatch":{"b":1,"c":4}}})", R"({"a":[{"b":1,"c":3},{"b":2,"c":4}]})"));
+    ASSERT_TRUE(Match(R"({"a":{"$allMatch":{"$gt":0}}})", R"({"a":[1,6]})"));
+    ASSERT_FALSE(Match(R"({"a":{"$allMatch":{"$gt":1}}})", R"({"a":[1,6]})"));
+    ASSERT_FALSE(Match(R"({"a":{"$allMatch":{"$gt":1}}})", R"({"a":[]})"));
+}
+
+TEST_F(MangoTests, test5) {
+    ASSERT_TRUE(Match(R"({"a":{"$regex":"^ab+c$"}})", R"({"a":"abbbc"})"));
+    ASSERT_FALSE(Match(R"({"a":{"$regex":"^ab+c$"}})", R"({"a":"ac"})"));
+    ASSERT_FALSE(Match(R"({"a":{"$regex":"1"}})", R"({"a":1})"));
+    ASSERT_TRUE(Match(R"({"a":{"$beginsWith":"ab"}})", R"({"a":"abc"})"));
+    ASSERT_FALSE(Match(R"({"a":{"$beginsWith":"bc"}})", R"({"a":"abc"})"));
+    ASSERT_TRUE(Match(R"({"a":{"$exists":true}})", R"({"a":null})"));
+    ASSERT_FALSE(Match(R"({"a":{"$exists":true}})", R"({"b":null})"));
+    ASSERT_TRUE(Match(R"({"a":{"$exists":false}})", R"({"b":null})"));
+    ASSERT_TRUE(Match(R"({"a":{"$type":"number"}})", R"({"a":1.5})"));
+    ASSERT_TRUE(Match(R"({"a":{"$type":"array"}})", R"({"a":[]})"));
+    ASSERT_FALSE(Match(R"({"a":{"$type":"string"}})", R"({"a":{}})"));
+    ASSERT_TRUE(Match(R"({"a":{"$mod":[3,1]}})", R"({"a":7})"));
+    ASSERT_FALSE(Match(R"({"a":{"$mod":[3,1]}})", R"({"a":8})"));
+    ASSERT_FALSE(Match(R"({"a":{"$mod":[3,1]}})", R"({"a":7.5})"));
+    ASSERT_FALSE(Match(R"({"a":{"$mod":[3,1]}})", R"({"a":1e300})"));
+    ASSERT_TRUE(Match(R"({"a":{"$mod":[-1,0]}})", R"({"a":-9223372036854775808})"));
+}
+
+TEST_F(MangoTests, test6) {
+    ASSERT_TRUE(Match(R"({"a.b.c":1})", R"({"a":{"b":{"c":1}}})"));
+    ASSERT_TRUE(Match(R"({"a":{"b":{"c":1}}})", R"({"a":{"b":{"c":1}}})"));
+    ASSERT_TRUE(Match(R"({"a":{"b.c":{"$gt":0}}})", R"({"a":{"b":{"c":1}}})"));
+    ASSERT_FALSE(Match(R"({"a.b.d":1})", R"({"a":{"b":{"c":1}}})"));
+    ASSERT_FALSE(Match(R"({"a.b.c":1})", R"({"a":{"b":1}})"));
+    ASSERT_TRUE(Match(R"({"a\\.b":1})", R"({"a.b":1})"));
+    
+    auto path = MangoValue::ParsePath(R"(a.b\.c.d)");
+    ASSERT_EQ(3, path.size());
+    ASSERT_STREQ("a", path[0].c_str());
+    ASSERT_STREQ("b.c", path[1].c_str());
+    ASSERT_STREQ("d", path[2].c_str());
+}
+
+TEST_F(MangoTests, test7) {
+    ASSERT_THROW(Match(R"({"a":{"$foo":1}})", R"({"a":1})"), MangoQueryError);
+    ASSERT_THROW(Match(R"({"$and":{"a":1}})", R"({"a":1})"), MangoQueryError);
+    ASSERT_THROW(Match(R"({"a":{"$in":1}})", R"({"a":1})"), MangoQueryError);
+    ASSERT_THROW(Match(R"({"a":{"$size":-1}})", R"({"a":1})"), MangoQueryError);
+    ASSERT_THROW(Match(R"({"a":{"$mod":[0,1]}})", R"({"a":1})"), MangoQueryError);
+    ASSERT_THROW(Match(R"({"a":{"$mod":[1e300,1]}})", R"({"a":1})"), MangoQueryError);
+    ASSERT_THROW(Match(R"({"a":{"$regex":"(("}})", R"({"a":1})"), MangoQueryError);
+    ASSERT_THROW(Match(R"({"a":{"$type":"date"}})", R"({"a":1})"), MangoQueryError);
+    ASSERT_THROW(Match(R"({"a":{"$exists":1}})", R"({"a":1})"), MangoQueryError);
+    
+    ASSERT_THROW(Find(R"({"limit":10})"), MangoQueryError);
+    ASSERT_THROW(Find(R"({"selector":[]})"), MangoQueryError);
+    ASSERT_THROW(Find(R"({"selector":{},"limit":-1})"), MangoQueryError);
+    ASSERT_THROW(Find(R"({"selector":{},"sort":[{"a":"up"}]})"), MangoQueryError);
+    ASSERT_THROW(Find(R"({"selector":{},"fields":[1]})"), MangoQueryError);
+}
+
+TEST_F(MangoTests, test8) {
+    auto docs = Find(R"({"selector":{"index":{"$gte":990}}})");
+    ASSERT_EQ(10, docs->size());
+    
+    for (auto i = 0; i < docs->size(); ++i) {
+        auto doc = (*docs)[i];
+        ASSERT_STREQ((boost::format("%08u") % (990 + i)).str().c_str(), doc->getId());
+    }
+    
+    // the default limit is 25 and design documents are never returned
+    docs = Find(R"({"selector":{}})");
+    ASSERT_EQ(MangoQuery::DefaultLimit, docs->size());
+    ASSERT_STREQ("00000000", (*docs)[0]->getId());
+    
+    docs = Find(R"({"selector":{"index":1}})");
+    ASSERT_EQ(1, docs->size());
+    ASSERT_STREQ("00000001", (*docs)[0]->getId());
+    
+    docs = Find(R"({"selector":{"even":true,"address.city":"Paris","tags":{"$elemMatch":{"$eq":"t4"}}},"limit":1000})");
+    ASSERT_EQ(33, docs->size());
+    for (auto doc : *docs) {
+        auto index = GetNumber(doc->getObject(), "index");
+        ASSERT_EQ(24, static_cast<unsigned>(index) % 30);
+    }
+}
+
+TEST_F(MangoTests, test9) {
+    auto docs = Find(R"({"selector":{"index":{"$lt":100}},"sort":[{"index":"desc"}],"skip":5,"limit":10})");
+    ASSERT_EQ(10, docs->size());
+    
+    for (auto i = 0; i < docs->size(); ++i) {
+        auto doc = (*docs)[i];
+        ASSERT_EQ(94 - i, GetNumber(doc->getObject(), "index"));
+    }
+    
+    docs = Find(R"({"selector":{"index":{"$lt":100}},"sort":["address.zip","name"],"limit":3})");
+    ASSERT_EQ(3, docs->size());
+    ASSERT_STREQ("00000000", (*docs)[0]->getId());
+    ASSERT_STREQ("00000001", (*docs)[1]->getId());
+    ASSERT_STREQ("00000002", (*docs)[2]->getId());
+    
+    docs = Find(R"({"selector":{},"skip":2000})");
+    ASSERT_EQ(0, docs->size());
+}
+
+TEST_F(MangoTests, test10) {
+    MangoQuery query{MakeObject(R"({"selector":{"index":7},"fields":["_id","name","address.zip","missing"]})")};
+    auto docs = db_->FindDocuments(query);
+    ASSERT_EQ(1, docs->size());
+    
+    auto obj = query.Project((*docs)[0]->getObject());
+    ASSERT_EQ(3, obj->getCount());
+    ASSERT_STREQ("00000007", obj->getString("_id"));
+    ASSERT_STREQ("doc7", obj->getString("name"));
+    
+    auto address = obj->getObject("address");
+    ASSERT_EQ(1, address->getCount());
+    ASSERT_EQ(7, GetNumber(address, "zip"));
+    
+    MangoQuery allFields{MakeObject(R"({"selector":{"index":7}})")};
+    ASSERT_EQ((*docs)[0]->getObject(), allFields.Project((*docs)[0]->getObject()));
+}
+
+TEST_F(MangoTests, test11) {
+    ASSERT_EQ(0, db_->GetIndexes().size());
+    
+    auto created = false;
+    auto index = db_->CreateIndex(MakeObject(R"({"index":{"fields":["address.city",{"index":"asc"}]}})"), created);
+    ASSERT_TRUE(created);
+    ASSERT_STREQ("idx-address.city-index", index->Name().c_str());
+    ASSERT_STREQ("_design/idx-address.city-index", index->DesignId().c_str());
+    ASSERT_EQ(2, index->FieldNames().size());
+    
+    auto existing = db_->CreateIndex(MakeObject(R"({"index":{"fields":["address.city","index"]}})"), created);
+    ASSERT_FALSE(created);
+    ASSERT_EQ(index, existing);
+    
+    auto named = db_->CreateIndex(MakeObject(R"({"index":{"fields":["name"]},"name":"by-name","ddoc":"_design/names"})"), created);
+    ASSERT_TRUE(created);
+    ASSERT_STREQ("by-name", named->Name().c_str());
+    ASSERT_STREQ("_design/names", named->DesignId().c_str());
+    ASSERT_EQ(2, db_->GetIndexes().size());
+    
+    ASSERT_THROW(db_->CreateIndex(MakeObject(R"({"index":{"fields":[]}})"), created), MangoQueryError);
+    ASSERT_THROW(db_->CreateIndex(MakeObject(R"({"index":{"fields":["a"]},"type":"text"})"), created), MangoQueryError);
+    ASSERT_THROW(db_->CreateIndex(MakeObject(R"({"fields":["a"]})"), created), MangoQueryError);
+    
+    std::size_t indexed = 0;
+    for (unsigned i = 0; i < index->Shards(); ++i) {
+        indexed += index->Size(i);
+    }
+    
+    ASSERT_EQ(1000, indexed);
+}
+
+TEST_F(MangoTests, test12) {
+    auto plan = [](const char* query) {
+        MangoQuery mangoQuery{MakeObject(query)};
+        return db_->PlanFindDocuments(mangoQuery);
+    };
+    
+    auto index = plan(R"({"selector":{"address.city":"Paris","index":{"$gt":10}}})");
+    ASSERT_TRUE(!!index);
+    ASSERT_STREQ("idx-address.city-index", index->Name().c_str());
+    
+    index = plan(R"({"selector":{"name":{"$beginsWith":"doc1"}}})");
+    ASSERT_TRUE(!!index);
+    ASSERT_STREQ("by-name", index->Name().c_str());
+    
+    ASSERT_FALSE(!!plan(R"({"selector":{"index":{"$gt":10}}})"));
+    ASSERT_FALSE(!!plan(R"({"selector":{"$or":[{"name":"doc1"},{"name":"doc2"}]}})"));
+    ASSERT_FALSE(!!plan(R"({"selector":{"name":{"$ne":"doc1"}}})"));
+    ASSERT_FALSE(!!plan(R"({"selector":{"$not":{"name":"doc1"}}})"));
+}
+
+TEST_F(MangoTests, test13) {
+    auto docs = Find(R"({"selector":{"address.city":"Paris","index":{"$gte":30,"$lt":60}},"limit":100})");
+    ASSERT_EQ(10, docs->size());
+    for (decltype(docs->size()) i = 0; i < docs->size(); ++i) {
+        ASSERT_EQ(30 + (i * 3), GetNumber((*docs)[i]->getObject(), "index"));
+    }
+    
+    docs = Find(R"({"selector":{"name":"doc123"}})");
+    ASSERT_EQ(1, docs->size());
+    ASSERT_STREQ("00000123", (*docs)[0]->getId());
+    
+    docs = Find(R"({"selector":{"name":{"$gt":"doc99","$lte":"doc999"}},"limit":100})");
+    ASSERT_EQ(10, docs->size());
+    
+    docs = Find(R"({"selector":{"name":{"$beginsWith":"doc99"}},"limit":100})");
+    ASSERT_EQ(11, docs->size());
+    
+    // the same selector answered by the index and by a full scan
+    auto indexed = Find(R"({"selector":{"address.city":"London","index":{"$lt":100},"even":true},"limit":1000})");
+    auto scanned = Find(R"({"selector":{"$and":[{"address.city":"London"},{"index":{"$lt":100}},{"even":true}]},"limit":1000})");
+    ASSERT_EQ(33, indexed->size());
+    ASSERT_EQ(scanned->size(), indexed->size());
+    for (decltype(indexed->size()) i = 0; i < indexed->size(); ++i) {
+        ASSERT_EQ((*scanned)[i], (*indexed)[i]);
+    }
+}
+
+TEST_F(MangoTests, test14) {
+    auto created = false;
+    auto index = db_->CreateIndex(MakeObject(R"({"index":{"fields":["name"]},"name":"by-name","ddoc":"_design/names"})"), created);
+    ASSERT_FALSE(created);
+    
+    auto doc = db_->SetDocument("mangoindex", MakeObject(R"({"name":"doc123","index":2000})"));
+    auto docs = Find(R"({"selector":{"name":"doc123"}})");
+    ASSERT_EQ(2, docs->size());
+    ASSERT_STREQ("mangoindex", (*docs)[1]->getId());
+    
+    auto json = (boost::format(R"({"_rev":"%s","name":"doc124","index":2000})") % doc->getRev()).str();
+    doc = db_->SetDocument("mangoindex", MakeObject(json.c_str()));
+    docs = Find(R"({"selector":{"name":"doc123"}})");
+    ASSERT_EQ(1, docs->size());
+    docs = Find(R"({"selector":{"name":"doc124"}})");
+    ASSERT_EQ(2, docs->size());
+    
+    db_->DeleteDocument("mangoindex", doc->getRev());
+    docs = Find(R"({"selector":{"name":"doc124"}})");
+    ASSERT_EQ(1, docs->size());
+    ASSERT_STREQ("00000124", (*docs)[0]->getId());
+    
+    ASSERT_TRUE(db_->DeleteIndex("_design/names", "by-name"));
+    ASSERT_FALSE(db_->DeleteIndex("_design/names", "by-name"));
+    ASSERT_EQ(1, db_->GetIndexes().size());
+    
+    docs = Find(R"({"selector":{"name":"doc124"}})");
+    ASSERT_EQ(1, docs->size());
+}
+
+TEST_F(MangoTests, test15) {
+    auto selector = MangoSelector::Compile(MakeObject(R"({"name":{"$beginsWith":"doc9"}})"));
+    auto range = selector->GetFieldRange(MangoValue::ParsePath("name"));
+    ASSERT_TRUE(range != nullptr);
+    ASSERT_STREQ("doc9", range->Lower().getString());
+    ASSERT_TRUE(range->LowerInclusive());
+    ASSERT_STREQ("doc:", range->Upper().getString());
+    ASSERT_FALSE(range->UpperInclusive());
+    
+    selector = MangoSelector::Compile(MakeObject(R"({"name":{"$beginsWith":"doc9","$lt":"doc95"}})"));
+    range = selector->GetFieldRange(MangoValue::ParsePath("name"));
+    ASSERT_STREQ("doc95", range->Upper().getString());
+    
+    selector = MangoSelector::Compile(MakeObject(R"({"name":{"$beginsWith":""}})"));
+    range = selector->GetFieldRange(MangoValue::ParsePath("name"));
+    ASSERT_TRUE(range->Upper().IsMissing());
+    
+    // the bounded index scan returns exactly what a full scan does
+    auto indexed = Find(R"({"selector":{"name":{"$beginsWith":"doc9"}},"limit":1000})");
+    auto scanned = Find(R"({"selector":{"$or":[{"name":{"$beginsWith":"doc9"}}]},"limit":1000})");
+    ASSERT_EQ(111, indexed->size());
+    ASSERT_EQ(scanned->size(), indexed->size());
+    for (decltype(indexed->size()) i = 0; i < indexed->size(); ++i) {
+        ASSERT_EQ((*scanned)[i], (*indexed)[i]);
+    }
+}
\ No newline at end of file
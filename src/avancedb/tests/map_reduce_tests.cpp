@@ -21,6 +21,10 @@
 #include <vector>
 #include <cstring>
 #include <memory>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <limits>
 
 #include <boost/format.hpp>
 
@@ -38,7 +42,11 @@
 #include "../config.h"
 #include "../map_reduce_thread_pool.h"
 #include "../map_reduce_result.h"
+#include "../map_reduce_results_iterator.h"
+#include "../map_reduce_shard_results.h"
+#include "../map_reduce_merged_results_iterator.h"
 #include "../map_reduce_result_comparers.h"
+#include "../map_reduce_results_cache.h"
 
 class MapReduceTests : public ::testing::Test {
 protected:
@@ -1011,4 +1019,368 @@ TEST_F(MapReduceTests, test37) {
     auto iter = results->cbegin();
     auto end = results->cend();       
     ASSERT_EQ(0, std::distance(iter, end));
+}
+
+TEST_F(MapReduceTests, test38) {
+    rs::httpserver::QueryString qs{""};
+    GetViewOptions options{qs};
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { emit(doc.index, null); })");
+    
+    std::vector<map_reduce_shard_results_ptr> shardResults;
+    db_->PostTempView(options, mapObj, [&](map_reduce_shard_results_ptr shardResult) {
+        shardResults.emplace_back(shardResult);
+    });
+    
+    ASSERT_EQ(Config::Environment::CpuCount() * 2, shardResults.size());
+    
+    MapReduceResultArray::size_type totalRows = 0;
+    for (const auto& shardResult : shardResults) {
+        totalRows += shardResult->TotalRows();
+        ASSERT_TRUE(std::is_sorted(shardResult->cbegin(), shardResult->cend(), [](const map_reduce_result_ptr& a, const map_reduce_result_ptr& b) {
+            return MapReduceResult::Less(a, b);
+        }));
+    }
+    
+    ASSERT_EQ(docs_->getCount(), totalRows);
+}
+
+TEST_F(MapReduceTests, test39) {
+    rs::httpserver::QueryString qs{"skip=10&limit=20"};
+    GetViewOptions options{qs};
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { emit(doc.index, null); })");
+    
+    std::vector<map_reduce_shard_results_ptr> shardResults;
+    db_->PostTempView(options, mapObj, [&](map_reduce_shard_results_ptr shardResult) {
+        shardResults.emplace_back(shardResult);
+    });
+    
+    MapReduceMergedResultsIterator iter{shardResults, options.Skip(), options.Limit(), options.Descending()};
+    ASSERT_EQ(10, iter.Offset());
+    ASSERT_EQ(docs_->getCount(), iter.TotalRows());
+    
+    auto i = 0;
+    auto result = iter.Next();
+    while (result) {
+        auto obj = docs_->getObject(i + 10);
+        ASSERT_STREQ(obj->getString("_id"), result->getId());
+        ASSERT_EQ(i + 10, result->getKeyDouble());
+        
+        result = iter.Next();
+        ++i;
+    }
+    
+    ASSERT_EQ(20, i);
+}
+
+TEST_F(MapReduceTests, test40) {
+    rs::httpserver::QueryString qs{"descending=true&skip=10&limit=20"};
+    GetViewOptions options{qs};
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { emit(doc.index, null); })");
+    
+    std::vector<map_reduce_shard_results_ptr> shardResults;
+    db_->PostTempView(options, mapObj, [&](map_reduce_shard_results_ptr shardResult) {
+        shardResults.emplace_back(shardResult);
+    });
+    
+    auto results = db_->PostTempView(options, mapObj);
+    auto expectedIter = results->Iterator();
+    
+    MapReduceMergedResultsIterator iter{shardResults, options.Skip(), options.Limit(), options.Descending()};
+    ASSERT_EQ(results->Offset(), iter.Offset());
+    ASSERT_EQ(results->TotalRows(), iter.TotalRows());
+    
+    auto i = 0;
+    auto result = iter.Next();
+    auto expected = expectedIter.Next();
+    while (result) {
+        ASSERT_NE(nullptr, expected);
+        ASSERT_STREQ(expected->getId(), result->getId());
+        ASSERT_EQ(docs_->getCount() - 11 - i, result->getKeyDouble());
+        
+        result = iter.Next();
+        expected = expectedIter.Next();
+        ++i;
+    }
+    
+    ASSERT_EQ(nullptr, expected);
+    ASSERT_EQ(20, i);
+}
+
+TEST_F(MapReduceTests, test41) {
+    rs::httpserver::QueryString qs{""};
+    GetViewOptions options{qs};
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { var n = 0; for (var k in doc) { ++n; } emit(Object.keys(doc).join(','), n); })");
+    auto results = db_->PostTempView(options, mapObj);
+    
+    ASSERT_NE(nullptr, results);
+    ASSERT_EQ(docs_->getCount(), results->TotalRows());
+    
+    auto iter = results->cbegin();
+    auto end = results->cend();
+    
+    for (; iter != end; ++iter) {
+        const auto& result = *iter;
+        auto obj = result->getDoc()->getObject();
+        
+        std::string names;
+        for (decltype(obj->getCount()) i = 0, count = obj->getCount(); i < count; ++i) {
+            if (i > 0) {
+                names += ',';
+            }
+            names += obj->getName(i);
+        }
+        
+        ASSERT_STREQ(names.c_str(), result->getKeyString());
+        ASSERT_EQ(obj->getCount(), result->getValueDouble());
+    }
+}
+
+TEST_F(MapReduceTests, test42) {
+    rs::httpserver::QueryString qs{""};
+    GetViewOptions options{qs};
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { emit(doc.index | 0, doc.index + 0.5); })");
+    auto results = db_->PostTempView(options, mapObj);
+    
+    ASSERT_NE(nullptr, results);
+    ASSERT_EQ(docs_->getCount(), results->TotalRows());
+    
+    auto iter = results->cbegin();
+    auto end = results->cend();       
+    ASSERT_EQ(results->TotalRows(), std::distance(iter, end));
+    
+    for (auto i = 0; iter != end; ++iter, ++i) {
+        const auto& result = *iter;
+        auto obj = docs_->getObject(i);
+        ASSERT_STREQ(obj->getString("_id"), result->getId());
+        ASSERT_EQ(rs::scriptobject::ScriptObjectType::Int32, result->getKeyType());
+        ASSERT_EQ(i, result->getKeyInt32());
+        ASSERT_EQ(rs::scriptobject::ScriptObjectType::Double, result->getValueType());
+        ASSERT_EQ(i + 0.5, result->getValueDouble());
+    }
+}
+
+TEST_F(MapReduceTests, test43) {
+    rs::httpserver::QueryString qs{"startkey=10.5&endkey=19"};
+    GetViewOptions options{qs};
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { emit(doc.index % 2 == 0 ? doc.index | 0 : doc.index + 0.25, null); })");
+    auto results = db_->PostTempView(options, mapObj);
+    
+    ASSERT_NE(nullptr, results);
+    ASSERT_EQ(11, results->Offset());
+    ASSERT_EQ(docs_->getCount(), results->TotalRows());
+    
+    auto iter = results->cbegin();
+    auto end = results->cend();       
+    ASSERT_EQ(8, std::distance(iter, end));
+    
+    for (auto i = 11; iter != end; ++iter, ++i) {
+        const auto& result = *iter;
+        auto obj = docs_->getObject(i);
+        ASSERT_STREQ(obj->getString("_id"), result->getId());
+        ASSERT_EQ(i % 2 == 0 ? i : i + 0.25, result->getKeyDouble());
+    }
+}
+
+TEST_F(MapReduceTests, test44) {
+    rs::httpserver::QueryString qs{"skip=5&limit=7"};
+    GetViewOptions options{qs};
+    
+    const auto& cache = db_->ResultsCache();
+    auto hits = cache.Hits();
+    auto misses = cache.Misses();
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { emit([doc.index, 44], null); })");
+    auto results = db_->PostTempView(options, mapObj);
+    
+    ASSERT_EQ(hits, cache.Hits());
+    ASSERT_EQ(misses + 1, cache.Misses());
+    
+    auto cachedResults = db_->PostTempView(options, mapObj);
+    
+    ASSERT_EQ(hits + 1, cache.Hits());
+    ASSERT_EQ(misses + 1, cache.Misses());
+    
+    ASSERT_EQ(results->Offset(), cachedResults->Offset());
+    ASSERT_EQ(results->TotalRows(), cachedResults->TotalRows());
+    ASSERT_EQ(7, std::distance(cachedResults->cbegin(), cachedResults->cend()));
+    ASSERT_TRUE(std::equal(results->cbegin(), results->cend(), cachedResults->cbegin()));
+}
+
+TEST_F(MapReduceTests, test45) {
+    auto dbName = "mapreducetests45";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    ASSERT_NE(nullptr, db);
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { emit(doc.index, null); })");
+    
+    auto obj = docs_->getObject(0);
+    db->SetDocument(obj->getString("_id"), obj);
+    
+    rs::httpserver::QueryString qs{""};
+    GetViewOptions options{qs};
+    ASSERT_EQ(GetViewOptions::UpdateMode::Update, options.Update());
+    ASSERT_EQ(1, db->PostTempView(options, mapObj)->TotalRows());
+    
+    obj = docs_->getObject(1);
+    db->SetDocument(obj->getString("_id"), obj);
+    
+    rs::httpserver::QueryString staleQs{"stale=ok"};
+    GetViewOptions staleOptions{staleQs};
+    ASSERT_EQ(GetViewOptions::UpdateMode::Stale, staleOptions.Update());
+    ASSERT_EQ(1, db->PostTempView(staleOptions, mapObj)->TotalRows());
+    
+    rs::httpserver::QueryString lazyQs{"stale=update_after"};
+    GetViewOptions lazyOptions{lazyQs};
+    ASSERT_EQ(GetViewOptions::UpdateMode::Lazy, lazyOptions.Update());
+    ASSERT_EQ(1, db->PostTempView(lazyOptions, mapObj)->TotalRows());
+    
+    // the background indexer should catch the view up
+    auto totalRows = 0;
+    for (auto i = 0; i < 500 && totalRows != 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        totalRows = db->PostTempView(staleOptions, mapObj)->TotalRows();
+    }
+    
+    ASSERT_EQ(2, totalRows);
+    ASSERT_EQ(2, db->PostTempView(options, mapObj)->TotalRows());
+    
+    databases_.RemoveDatabase(dbName);
+}
+
+TEST_F(MapReduceTests, test46) {
+    rs::httpserver::QueryString qs{"update=lazy"};
+    GetViewOptions options{qs};
+    ASSERT_EQ(GetViewOptions::UpdateMode::Lazy, options.Update());
+    
+    rs::httpserver::QueryString qs2{"update=false"};
+    GetViewOptions options2{qs2};
+    ASSERT_EQ(GetViewOptions::UpdateMode::Stale, options2.Update());
+    
+    rs::httpserver::QueryString qs3{"stale=bad"};
+    GetViewOptions options3{qs3};
+    ASSERT_THROW(options3.Update(), QueryParseError);
+}
+
+TEST_F(MapReduceTests, test47) {
+    auto dbName = "mapreducetests47";
+    databases_.AddDatabase(dbName);
+    auto db = databases_.GetDatabase(dbName);
+    ASSERT_NE(nullptr, db);
+    
+    std::vector<std::string> revs;
+    for (auto i = 0; i < 3; ++i) {
+        auto obj = docs_->getObject(i);
+        revs.emplace_back(db->SetDocument(obj->getString("_id"), obj)->getRev());
+    }
+    
+    rs::httpserver::QueryString qs{""};
+    GetViewOptions options{qs};
+    
+    auto mapObj = MakeMapObject(R"(function(doc) { emit(doc.index, doc.num); })");
+    auto results = db->PostTempView(options, mapObj);
+    ASSERT_EQ(3, results->TotalRows());
+    
+    // the rows don't count references to their documents, the snapshot they were mapped 
+    // from keeps them alive after they have been deleted and the database has gone
+    for (auto i = 0; i < 3; ++i) {
+        db->DeleteDocument(docs_->getObject(i)->getString("_id"), revs[i].c_str());
+    }
+    
+    databases_.RemoveDatabase(dbName);
+    db.reset();
+    
+    auto i = 0;
+    for (auto iter = results->cbegin(); iter != results->cend(); ++iter, ++i) {
+        const auto& result = *iter;
+        ASSERT_STREQ(docs_->getObject(i)->getString("_id"), result->getDoc()->getId());
+        ASSERT_EQ(42, result->getDoc()->getObject()->getInt32("num"));
+        ASSERT_EQ(i, result->getKeyDouble());
+    }
+    
+    ASSERT_EQ(3, i);
+}
+
+TEST_F(MapReduceTests, test49) {
+    auto mapObj = MakeMapObject(R"(function(doc) { emit(doc._id, null); })");
+    auto task = MapReduce::MapReduceTask::Create(mapObj);
+    
+    // a separator inside a key can't make two different queries share a cache entry
+    rs::httpserver::QueryString qs1{R"(startkey="a|"&startkey_docid=b)"};
+    rs::httpserver::QueryString qs2{R"(startkey="a"&startkey_docid=|b)"};
+    GetViewOptions options1{qs1};
+    GetViewOptions options2{qs2};
+    ASSERT_NE(MapReduceResultsCache::MakeKey(task, options1), MapReduceResultsCache::MakeKey(task, options2));
+    
+    rs::httpserver::QueryString qs{""};
+    GetViewOptions options{qs};
+    
+    MapReduceResultsCache::shard_results_array results;
+    db_->PostTempView(options, mapObj, [&](map_reduce_shard_results_ptr shardResults) {
+        results.emplace_back(shardResults);
+    });
+    
+    MapReduceResultsCache unbounded{std::numeric_limits<MapReduceResultsCache::size_type>::max()};
+    unbounded.Put("test49", 1, results);
+    auto size = unbounded.Size();
+    ASSERT_GT(size, 0);
+    
+    // the documents of the snapshots the rows retain are charged to the entry
+    ASSERT_GE(size, db_->DataSize());
+    
+    // the bound is on the bytes of the cached rows rather than the number of entries
+    MapReduceResultsCache cache{size * 2};
+    cache.Put("1", 1, results);
+    cache.Put("2", 1, results);
+    ASSERT_EQ(2, cache.Count());
+    ASSERT_EQ(size * 2, cache.Size());
+    
+    cache.Put("3", 1, results);
+    ASSERT_EQ(2, cache.Count());
+    ASSERT_EQ(size * 2, cache.Size());
+    
+    MapReduceResultsCache::shard_results_array cachedResults;
+    ASSERT_FALSE(cache.Get("1", 1, cachedResults));
+    ASSERT_TRUE(cache.Get("3", 1, cachedResults));
+    
+    MapReduceResultsCache small{size - 1};
+    small.Put("1", 1, results);
+    ASSERT_EQ(0, small.Count());
+    ASSERT_EQ(0, small.Size());
+}
+
+TEST_F(MapReduceTests, test50) {
+    rs::httpserver::QueryString qs{""};
+    GetViewOptions options{qs};
+    
+    MapReduceResultsCache::shard_results_array results;
+    db_->PostTempView(options, MakeMapObject(R"(function(doc) { emit(doc._id, null); })"), [&](map_reduce_shard_results_ptr shardResults) {
+        results.emplace_back(shardResults);
+    });
+    
+    MapReduceResultsCache cache{std::numeric_limits<MapReduceResultsCache::size_type>::max()};
+    MapReduceResultsCache::shard_results_array cachedResults;
+    
+    // a lookup at a newer update sequence releases the stale entry
+    cache.Put("1", 1, results);
+    ASSERT_FALSE(cache.Get("1", 2, cachedResults));
+    ASSERT_EQ(0, cache.Count());
+    ASSERT_EQ(0, cache.Size());
+    
+    // stale entries stay available to stale reads until they are purged
+    cache.Put("1", 2, results);
+    cache.Put("2", 3, results);
+    sequence_type updateSequence = 0;
+    ASSERT_TRUE(cache.GetLatest("1", cachedResults, updateSequence));
+    ASSERT_EQ(2, updateSequence);
+    
+    cache.Purge(3);
+    ASSERT_EQ(1, cache.Count());
+    ASSERT_TRUE(cache.Get("2", 3, cachedResults));
 }
\ No newline at end of file
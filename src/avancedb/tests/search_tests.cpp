@@ -0,0 +1,245 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cstring>
+#include <memory>
+
+#include <boost/format.hpp>
+
+#include "libscriptobject_gason.h"
+#include "script_object_factory.h"
+
+#include "libhttpserver.h"
+
+#include "../databases.h"
+#include "../database.h"
+#include "../document.h"
+#include "../rest_exceptions.h"
+#include "../config.h"
+#include "../map_reduce_thread_pool.h"
+#include "../search_query.h"
+#include "../search_index.h"
+
+class SearchTests : public ::testing::Test {
+protected:
+    SearchTests() {
+
+    }
+    
+    static void SetUpTestCase() {
+        threadPool_.reset(new MapReduceThreadPoolScope{Config::SpiderMonkey::HeapSize(), Config::SpiderMonkey::NurserySize(),
+                Config::SpiderMonkey::EnableBaselineCompiler(), Config::SpiderMonkey::EnableIonCompiler()});
+        
+        auto dbName = "searchtests";
+        databases_.AddDatabase(dbName);
+        db_ = databases_.GetDatabase(dbName);
+        
+        const char* colours[] = { "red", "green", "blue", "yellow", "purple" };
+        
+        std::string json = R"({"docs":[)";
+        for (auto i = 0; i < 500; ++i) {
+            if (i > 0) {
+                json += ',';
+            }
+            
+            json += (boost::format(R"({"_id":"%08u","index":%u,"title":"The %s fox number %u","body":"%s %s"})") 
+                % i % i % colours[i % 5] % i % colours[(i + 1) % 5] % (i % 50 == 0 ? "jumps over the lazy dog" : "sleeps")).str();
+        }
+        json += R"(,{"_id":"_design/search","title":"red red red"}]})";
+        
+        auto docs = MakeObject(json.c_str())->getArray("docs");
+        db_->PostBulkDocuments(docs, true);
+        
+        index_ = db_->GetSearchIndex("_design/search", "text", IndexFunction);
+    }
+    
+    static void TearDownTestCase() {
+        index_.reset();
+        threadPool_.reset();
+    }
+    
+    virtual void SetUp() {
+        
+    }
+    
+    virtual void TearDown() {
+        
+    }
+    
+    static rs::scriptobject::ScriptObjectPtr MakeObject(const char* json) {
+        std::vector<char> buffer{json, json + std::strlen(json)};
+        buffer.push_back('\0');
+        
+        rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+        return rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+    }
+    
+    static SearchIndex::hit_array Search(const char* q, std::uint64_t& totalHits, std::size_t skip = 0, std::size_t limit = 25) {
+        SearchQuery query{q};
+        return db_->SearchDocuments(index_, query, skip, limit, totalHits);
+    }
+    
+    static const char IndexFunction[];
+    
+    static Databases databases_;
+    static database_ptr db_;
+    static search_index_ptr index_;
+    
+    static std::unique_ptr<MapReduceThreadPoolScope> threadPool_;
+};
+
+const char SearchTests::IndexFunction[] = "function(doc) { index('default', doc.title); index('body', doc.body); index('index', doc.index); }";
+
+Databases SearchTests::databases_;
+database_ptr SearchTests::db_;
+search_index_ptr SearchTests::index_;
+std::unique_ptr<MapReduceThreadPoolScope> SearchTests::threadPool_;
+
+TEST_F(SearchTests, test0) {
+    std::vector<std::string> tokens;
+    const char* text = "The Quick-brown FOX, 42 times!";
+    SearchQuery::Tokenize(text, std::strlen(text), tokens);
+    
+    ASSERT_EQ(6, tokens.size());
+    ASSERT_STREQ("the", tokens[0].c_str());
+    ASSERT_STREQ("quick", tokens[1].c_str());
+    ASSERT_STREQ("brown", tokens[2].c_str());
+    ASSERT_STREQ("fox", tokens[3].c_str());
+    ASSERT_STREQ("42", tokens[4].c_str());
+    ASSERT_STREQ("times", tokens[5].c_str());
+}
+
+TEST_F(SearchTests, test1) {
+    SearchQuery query{R"(red +body:"Lazy dog" -title:blue)"};
+    const auto& terms = query.Terms();
+    
+    ASSERT_EQ(4, terms.size());
+    ASSERT_EQ(2, query.MustCount());
+    
+    ASSERT_EQ(SearchQuery::Occur::Should, terms[0].occur_);
+    ASSERT_STREQ(SearchQuery::DefaultField, terms[0].field_.c_str());
+    ASSERT_STREQ("red", terms[0].token_.c_str());
+    
+    ASSERT_EQ(SearchQuery::Occur::Must, terms[1].occur_);
+    ASSERT_STREQ("body", terms[1].field_.c_str());
+    ASSERT_STREQ("lazy", terms[1].token_.c_str());
+    ASSERT_EQ(SearchQuery::Occur::Must, terms[2].occur_);
+    ASSERT_STREQ("dog", terms[2].token_.c_str());
+    
+    ASSERT_EQ(SearchQuery::Occur::MustNot, terms[3].occur_);
+    ASSERT_STREQ("title", terms[3].field_.c_str());
+    ASSERT_STREQ("blue", terms[3].token_.c_str());
+    
+    ASSERT_THROW(SearchQuery{"  ,, "}, QueryParseError);
+}
+
+TEST_F(SearchTests, test2) {
+    std::uint64_t totalHits = 0;
+    auto hits = Search("red", totalHits, 0, 1000);
+    
+    // the design document is never indexed
+    ASSERT_EQ(100, totalHits);
+    ASSERT_EQ(100, hits.size());
+    
+    for (decltype(hits.size()) i = 1; i < hits.size(); ++i) {
+        ASSERT_GE(hits[i - 1].score_, hits[i].score_);
+    }
+    
+    hits = Search("number 123", totalHits);
+    ASSERT_EQ(500, totalHits);
+    ASSERT_EQ(25, hits.size());
+    ASSERT_STREQ("00000123", hits[0].doc_->getId());
+    
+    hits = Search("index:7", totalHits);
+    ASSERT_EQ(1, totalHits);
+    ASSERT_STREQ("00000007", hits[0].doc_->getId());
+    
+    hits = Search("missing", totalHits);
+    ASSERT_EQ(0, totalHits);
+    ASSERT_EQ(0, hits.size());
+}
+
+TEST_F(SearchTests, test3) {
+    std::uint64_t totalHits = 0;
+    auto hits = Search("+body:lazy +body:dog", totalHits, 0, 1000);
+    ASSERT_EQ(10, totalHits);
+    
+    // every lazy dog document has a red title and a green body
+    hits = Search("+body:lazy -red", totalHits, 0, 1000);
+    ASSERT_EQ(0, totalHits);
+    
+    hits = Search("+body:lazy -green", totalHits, 0, 1000);
+    ASSERT_EQ(10, totalHits);
+    
+    hits = Search("+body:lazy -body:green", totalHits, 0, 1000);
+    ASSERT_EQ(0, totalHits);
+    
+    hits = Search("+body:lazy +yellow", totalHits, 0, 1000);
+    ASSERT_EQ(0, totalHits);
+    
+    auto all = Search("body:sleeps", totalHits, 0, 1000);
+    ASSERT_EQ(490, totalHits);
+    
+    hits = Search("body:sleeps", totalHits, 100, 50);
+    ASSERT_EQ(50, hits.size());
+    for (decltype(hits.size()) i = 0; i < hits.size(); ++i) {
+        ASSERT_EQ(all[100 + i].doc_, hits[i].doc_);
+    }
+}
+
+TEST_F(SearchTests, test4) {
+    std::uint64_t totalHits = 0;
+    auto hits = Search("aardvark", totalHits);
+    ASSERT_EQ(0, totalHits);
+    
+    auto doc = db_->SetDocument("searchdoc", MakeObject(R"({"title":"an aardvark","body":"aardvark aardvark"})"));
+    hits = Search("aardvark", totalHits);
+    ASSERT_EQ(1, totalHits);
+    ASSERT_STREQ("searchdoc", hits[0].doc_->getId());
+    
+    auto json = (boost::format(R"({"_rev":"%s","title":"an anteater"})") % doc->getRev()).str();
+    doc = db_->SetDocument("searchdoc", MakeObject(json.c_str()));
+    hits = Search("aardvark", totalHits);
+    ASSERT_EQ(0, totalHits);
+    hits = Search("anteater", totalHits);
+    ASSERT_EQ(1, totalHits);
+    
+    db_->DeleteDocument("searchdoc", doc->getRev());
+    hits = Search("anteater", totalHits);
+    ASSERT_EQ(0, totalHits);
+}
+
+TEST_F(SearchTests, test5) {
+    // a changed function replaces the index
+    auto index = db_->GetSearchIndex("_design/search", "text", IndexFunction);
+    ASSERT_EQ(index_, index);
+    
+    index = db_->GetSearchIndex("_design/search", "text", "function(doc) { index('default', doc.body); }");
+    ASSERT_NE(index_, index);
+    
+    SearchQuery query{"lazy"};
+    std::uint64_t totalHits = 0;
+    db_->SearchDocuments(index, query, 0, 25, totalHits);
+    ASSERT_EQ(10, totalHits);
+    
+    index = db_->GetSearchIndex("_design/search", "broken", "function(doc) {");
+    ASSERT_THROW(db_->SearchDocuments(index, query, 0, 25, totalHits), CompilationError);
+}
\ No newline at end of file
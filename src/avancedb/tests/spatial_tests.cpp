@@ -0,0 +1,317 @@
+/*
+ *  AvanceDB - an in-memory database similar to Apache CouchDB
+ *  Copyright (C) 2015-2017 Ripcord Software
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cstring>
+#include <memory>
+#include <cmath>
+#include <limits>
+
+#include <boost/format.hpp>
+
+#include "libscriptobject_gason.h"
+#include "script_object_factory.h"
+
+#include "libhttpserver.h"
+
+#include "../databases.h"
+#include "../database.h"
+#include "../document.h"
+#include "../rest_exceptions.h"
+#include "../config.h"
+#include "../map_reduce_thread_pool.h"
+#include "../spatial_index.h"
+
+class SpatialTests : public ::testing::Test {
+protected:
+    SpatialTests() {
+
+    }
+    
+    static void SetUpTestCase() {
+        threadPool_.reset(new MapReduceThreadPoolScope{Config::SpiderMonkey::HeapSize(), Config::SpiderMonkey::NurserySize(),
+                Config::SpiderMonkey::EnableBaselineCompiler(), Config::SpiderMonkey::EnableIonCompiler()});
+        
+        auto dbName = "spatialtests";
+        databases_.AddDatabase(dbName);
+        db_ = databases_.GetDatabase(dbName);
+        
+        // a 20 x 20 grid of points, 10 degrees apart in longitude and 5 apart in latitude
+        std::string json = R"({"docs":[)";
+        for (auto i = 0; i < 400; ++i) {
+            if (i > 0) {
+                json += ',';
+            }
+            
+            json += (boost::format(R"({"_id":"%08u","index":%u,"lon":%f,"lat":%f})") 
+                % i % i % ((i % 20) * 10.0 - 95.0) % ((i / 20) * 5.0 - 47.5)).str();
+        }
+        json += R"(,{"_id":"nowhere","index":-1}]})";
+        
+        auto docs = MakeObject(json.c_str())->getArray("docs");
+        db_->PostBulkDocuments(docs, true);
+        
+        spatial_ = MakeObject(R"({"points":"function(doc) { if (doc.lon !== undefined) { emit([doc.lon, doc.lat], doc.index); } }",)"
+            R"("geojson":"function(doc) { if (doc.lon !== undefined) { emit({type:'Point', coordinates:[doc.lon, doc.lat]}, null); } }",)"
+            R"("fields":{"lon":"lon","lat":"lat"},"broken":"function(doc) {"})");
+        
+        index_ = db_->GetSpatialIndex("_design/spatial", "points", spatial_);
+    }
+    
+    static void TearDownTestCase() {
+        index_.reset();
+        threadPool_.reset();
+    }
+    
+    virtual void SetUp() {
+        
+    }
+    
+    virtual void TearDown() {
+        
+    }
+    
+    static rs::scriptobject::ScriptObjectPtr MakeObject(const char* json) {
+        std::vector<char> buffer{json, json + std::strlen(json)};
+        buffer.push_back('\0');
+        
+        rs::scriptobject::ScriptObjectJsonSource source(buffer.data());        
+        return rs::scriptobject::ScriptObjectFactory::CreateObject(source, false);
+    }
+    
+    static SpatialIndex::hit_array Query(spatial_index_ptr index, const SpatialIndex::Region& region, std::uint64_t& totalRows, std::size_t skip = 0, std::size_t limit = 1000) {
+        return db_->QuerySpatial(index, region, skip, limit, totalRows);
+    }
+    
+    static Databases databases_;
+    static database_ptr db_;
+    static script_object_ptr spatial_;
+    static spatial_index_ptr index_;
+    
+    static std::unique_ptr<MapReduceThreadPoolScope> threadPool_;
+};
+
+Databases SpatialTests::databases_;
+database_ptr SpatialTests::db_;
+script_object_ptr SpatialTests::spatial_;
+spatial_index_ptr SpatialTests::index_;
+std::unique_ptr<MapReduceThreadPoolScope> SpatialTests::threadPool_;
+
+TEST_F(SpatialTests, test0) {
+    auto region = SpatialIndex::Region::Bbox(-10, -10, 10, 10);
+    ASSERT_FALSE(region.IsRadius());
+    ASSERT_EQ(1, region.Boxes().size());
+    
+    // boxes crossing the antimeridian are split
+    region = SpatialIndex::Region::Bbox(170, -10, -170, 10);
+    ASSERT_EQ(2, region.Boxes().size());
+    
+    double distance = 0;
+    ASSERT_TRUE(region.Contains(175, 0, distance));
+    ASSERT_TRUE(region.Contains(-175, 0, distance));
+    ASSERT_FALSE(region.Contains(0, 0, distance));
+    
+    region = SpatialIndex::Region::Radius(179.5, 0, 200000);
+    ASSERT_TRUE(region.IsRadius());
+    ASSERT_EQ(2, region.Boxes().size());
+    ASSERT_TRUE(region.Contains(-179.5, 0, distance));
+    ASSERT_NEAR(111195, distance, 10);
+    ASSERT_FALSE(region.Contains(177.5, 0, distance));
+    
+    ASSERT_THROW(SpatialIndex::Region::Bbox(0, 10, 10, 0), QueryParseError);
+    ASSERT_THROW(SpatialIndex::Region::Radius(0, 91, 10), QueryParseError);
+    ASSERT_THROW(SpatialIndex::Region::Bbox(std::nan(""), 0, 10, 10), QueryParseError);
+    ASSERT_THROW(SpatialIndex::Region::Bbox(0, 0, 10, std::numeric_limits<double>::quiet_NaN()), QueryParseError);
+    ASSERT_THROW(SpatialIndex::Region::Radius(0, std::nan(""), 10), QueryParseError);
+    ASSERT_THROW(SpatialIndex::Region::Radius(0, 0, std::nan("")), QueryParseError);
+    ASSERT_THROW(SpatialIndex::Region::Radius(0, 0, std::numeric_limits<double>::infinity()), QueryParseError);
+}
+
+TEST_F(SpatialTests, test1) {
+    std::uint64_t totalRows = 0;
+    auto hits = Query(index_, SpatialIndex::Region::Bbox(-180, -90, 180, 90), totalRows);
+    
+    // the document without a location is never indexed
+    ASSERT_EQ(400, totalRows);
+    ASSERT_EQ(400, hits.size());
+    
+    for (decltype(hits.size()) i = 1; i < hits.size(); ++i) {
+        ASSERT_LT(std::strcmp(hits[i - 1].doc_->getId(), hits[i].doc_->getId()), 0);
+    }
+    
+    hits = Query(index_, SpatialIndex::Region::Bbox(-5, -5, 5, 5), totalRows);
+    ASSERT_EQ(4, totalRows);
+    ASSERT_STREQ("00000189", hits[0].doc_->getId());
+    ASSERT_STREQ("00000190", hits[1].doc_->getId());
+    ASSERT_STREQ("00000209", hits[2].doc_->getId());
+    ASSERT_STREQ("00000210", hits[3].doc_->getId());
+    ASSERT_EQ(189, hits[0].keyValue_->getInt32(1));
+    ASSERT_DOUBLE_EQ(-5, hits[0].lon_);
+    ASSERT_DOUBLE_EQ(-2.5, hits[0].lat_);
+    
+    auto all = Query(index_, SpatialIndex::Region::Bbox(-100, -50, 100, 0), totalRows);
+    ASSERT_EQ(200, totalRows);
+    
+    hits = Query(index_, SpatialIndex::Region::Bbox(-100, -50, 100, 0), totalRows, 50, 25);
+    ASSERT_EQ(200, totalRows);
+    ASSERT_EQ(25, hits.size());
+    for (decltype(hits.size()) i = 0; i < hits.size(); ++i) {
+        ASSERT_EQ(all[50 + i].doc_, hits[i].doc_);
+    }
+}
+
+TEST_F(SpatialTests, test2) {
+    std::uint64_t totalRows = 0;
+    auto hits = Query(index_, SpatialIndex::Region::Radius(-5, -2.5, 1), totalRows);
+    ASSERT_EQ(1, totalRows);
+    ASSERT_STREQ("00000189", hits[0].doc_->getId());
+    ASSERT_DOUBLE_EQ(0, hits[0].distance_);
+    
+    // radius results are nearest first
+    hits = Query(index_, SpatialIndex::Region::Radius(-5, -2.5, 1500000), totalRows);
+    ASSERT_LT(4, totalRows);
+    ASSERT_STREQ("00000189", hits[0].doc_->getId());
+    
+    for (decltype(hits.size()) i = 1; i < hits.size(); ++i) {
+        ASSERT_LE(hits[i - 1].distance_, hits[i].distance_);
+        ASSERT_LE(hits[i].distance_, 1500000);
+    }
+}
+
+TEST_F(SpatialTests, test3) {
+    std::uint64_t totalRows = 0;
+    auto region = SpatialIndex::Region::Bbox(160, -1, -170, 1);
+    auto hits = Query(index_, region, totalRows);
+    ASSERT_EQ(0, totalRows);
+    
+    auto doc = db_->SetDocument("spatialdoc", MakeObject(R"({"lon":170,"lat":0,"index":1000})"));
+    hits = Query(index_, region, totalRows);
+    ASSERT_EQ(1, totalRows);
+    ASSERT_STREQ("spatialdoc", hits[0].doc_->getId());
+    
+    auto json = (boost::format(R"({"_rev":"%s","lon":-175,"lat":0.5,"index":1000})") % doc->getRev()).str();
+    doc = db_->SetDocument("spatialdoc", MakeObject(json.c_str()));
+    hits = Query(index_, region, totalRows);
+    ASSERT_EQ(1, totalRows);
+    ASSERT_DOUBLE_EQ(-175, hits[0].lon_);
+    
+    db_->DeleteDocument("spatialdoc", doc->getRev());
+    hits = Query(index_, region, totalRows);
+    ASSERT_EQ(0, totalRows);
+}
+
+TEST_F(SpatialTests, test4) {
+    auto index = db_->GetSpatialIndex("_design/spatial", "points", spatial_);
+    ASSERT_EQ(index_, index);
+    
+    std::uint64_t totalRows = 0;
+    auto region = SpatialIndex::Region::Bbox(-5, -5, 5, 5);
+    
+    index = db_->GetSpatialIndex("_design/spatial", "geojson", spatial_);
+    auto hits = Query(index, region, totalRows);
+    ASSERT_EQ(4, totalRows);
+    
+    // field pairs don't run any script and have no value
+    index = db_->GetSpatialIndex("_design/spatial", "fields", spatial_);
+    hits = Query(index, region, totalRows);
+    ASSERT_EQ(4, totalRows);
+    ASSERT_FALSE(!!hits[0].keyValue_);
+    
+    // a changed definition replaces the index
+    auto changed = MakeObject(R"({"points":{"lon":"lat","lat":"lon"}})");
+    index = db_->GetSpatialIndex("_design/spatial", "points", changed);
+    ASSERT_NE(index_, index);
+    
+    // swapped, the outer columns have latitudes of +/-95 and are skipped
+    hits = Query(index, SpatialIndex::Region::Bbox(-50, -90, -40, 90), totalRows);
+    ASSERT_EQ(36, totalRows);
+    
+    index = db_->GetSpatialIndex("_design/spatial", "broken", spatial_);
+    ASSERT_THROW(Query(index, region, totalRows), CompilationError);
+    
+    ASSERT_THROW(db_->GetSpatialIndex("_design/spatial", "missing", spatial_), MissingIndex);
+}
+
+TEST_F(SpatialTests, test5) {
+    auto db = Database::Create("spatialtests5", 1);
+    
+    // enough points that the first refresh merges them and later ones only add to the recent entries
+    std::string json = R"({"docs":[)";
+    for (auto i = 0; i < 3000; ++i) {
+        if (i > 0) {
+            json += ',';
+        }
+        
+        json += (boost::format(R"({"_id":"%08u","index":%u,"lon":%f,"lat":%f})") 
+            % i % i % ((i % 60) * 3.0 - 88.5) % ((i / 60) * 1.5 - 36.75)).str();
+    }
+    json += R"(]})";
+    
+    auto results = db->PostBulkDocuments(MakeObject(json.c_str())->getArray("docs"), true);
+    
+    auto index = db->GetSpatialIndex("_design/spatial", "points", spatial_);
+    
+    std::uint64_t totalRows = 0;
+    auto world = SpatialIndex::Region::Bbox(-180, -90, 180, 90);
+    db->QuerySpatial(index, world, 0, 10000, totalRows);
+    ASSERT_EQ(3000, totalRows);
+    ASSERT_EQ(3000, index->Size(0));
+    
+    auto moved = db->SetDocument("00000000", MakeObject((boost::format(R"({"_rev":"%s","index":0,"lon":150,"lat":60})") % results[0].rev()).str().c_str()));
+    db->DeleteDocument("00000001", results[1].rev().c_str());
+    
+    auto hits = db->QuerySpatial(index, SpatialIndex::Region::Bbox(149, 59, 151, 61), 0, 10000, totalRows);
+    ASSERT_EQ(1, totalRows);
+    ASSERT_EQ(moved, hits[0].doc_);
+    
+    // neither the old point of the moved document nor the deleted one are found
+    db->QuerySpatial(index, SpatialIndex::Region::Radius(-88.5, -36.75, 1000), 0, 10000, totalRows);
+    ASSERT_EQ(0, totalRows);
+    db->QuerySpatial(index, SpatialIndex::Region::Radius(-85.5, -36.75, 1000), 0, 10000, totalRows);
+    ASSERT_EQ(0, totalRows);
+    
+    db->QuerySpatial(index, world, 0, 10000, totalRows);
+    ASSERT_EQ(2999, totalRows);
+    ASSERT_EQ(2999, index->Size(0));
+    
+    // enough changes to merge the recent entries back into the shard
+    json = R"({"docs":[)";
+    for (auto i = 1000; i < 2000; ++i) {
+        if (i > 1000) {
+            json += ',';
+        }
+        
+        json += (boost::format(R"({"_id":"%08u","_rev":"%s","index":%u,"lon":170,"lat":%f})") 
+            % i % results[i].rev() % i % ((i - 1000) * 0.05 - 25)).str();
+    }
+    json += R"(]})";
+    
+    db->PostBulkDocuments(MakeObject(json.c_str())->getArray("docs"), true);
+    
+    hits = db->QuerySpatial(index, SpatialIndex::Region::Bbox(169, -90, 171, 90), 0, 10000, totalRows);
+    ASSERT_EQ(1000, totalRows);
+    for (const auto& hit : hits) {
+        ASSERT_DOUBLE_EQ(170, hit.lon_);
+    }
+    
+    db->QuerySpatial(index, world, 0, 10000, totalRows);
+    ASSERT_EQ(2999, totalRows);
+    ASSERT_EQ(2999, index->Size(0));
+}
\ No newline at end of file
@@ -40,6 +40,8 @@ using document_array_ptr = boost::shared_ptr<document_array>;
 class DocumentCollection;
 using document_collection_ptr = boost::shared_ptr<DocumentCollection>;
 using document_collections_ptr_array = std::vector<document_collection_ptr>;
+class DocumentCollectionSnapshot;
+using document_collection_snapshot_ptr = boost::shared_ptr<const DocumentCollectionSnapshot>;
 
 class DocumentAttachment;
 using document_attachment_ptr = boost::shared_ptr<DocumentAttachment>;
@@ -58,6 +60,19 @@ class MapReduceResultsIterator;
 class MapReduceQueryKey;
 using map_reduce_query_key_ptr = boost::shared_ptr<MapReduceQueryKey>;
 
+class MangoSelector;
+using mango_selector_ptr = boost::shared_ptr<MangoSelector>;
+class MangoIndex;
+using mango_index_ptr = boost::shared_ptr<MangoIndex>;
+using mango_index_array = std::vector<mango_index_ptr>;
+
+class SearchIndex;
+using search_index_ptr = boost::shared_ptr<SearchIndex>;
+using search_index_array = std::vector<search_index_ptr>;
+class SpatialIndex;
+using spatial_index_ptr = boost::shared_ptr<SpatialIndex>;
+using spatial_index_array = std::vector<spatial_index_ptr>;
+
 using script_object_ptr = rs::scriptobject::ScriptObjectPtr;
 using script_array_ptr = rs::scriptobject::ScriptArrayPtr;
 